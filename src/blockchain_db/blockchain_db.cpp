@@ -30,6 +30,7 @@
 
 #include "string_tools.h"
 #include "blockchain_db.h"
+#include "cryptonote_basic/block_filter.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "profile_tools.h"
 #include "ringct/rctOps.h"
@@ -243,6 +244,20 @@ void BlockchainDB::add_transaction(const crypto::hash& blk_hash, const std::pair
   add_tx_amount_output_indices(tx_id, amount_output_indices);
 }
 
+void block_emission_totals::add_tx(const transaction &tx, uint8_t major_version)
+{
+  const bool burning = major_version >= HF_VERSION_FEE_BURNING;
+  fees += get_tx_miner_fee(tx, burning);
+  if (burning)
+    burned += get_burned_amount_from_tx_extra(tx.extra);
+}
+
+void block_emission_totals::set_miner_tx(const transaction &miner_tx)
+{
+  const uint64_t coinbase = get_outs_money_amount(miner_tx);
+  emission = coinbase > fees ? coinbase - fees : 0;
+}
+
 uint64_t BlockchainDB::add_block( const std::pair<block, blobdata>& blck
                                 , size_t block_weight
                                 , uint64_t long_term_block_weight
@@ -269,6 +284,9 @@ uint64_t BlockchainDB::add_block( const std::pair<block, blobdata>& blck
   time1 = epee::misc_utils::get_tick_count();
 
   uint64_t num_rct_outs = 0;
+  block_emission_totals emission;
+  std::vector<const transaction*> filter_txs;
+  filter_txs.reserve(txs.size());
   add_transaction(blk_hash, std::make_pair(blk.miner_tx, tx_to_blob(blk.miner_tx)));
   if (blk.miner_tx.version >= 2)
     num_rct_outs += blk.miner_tx.vout.size();
@@ -283,14 +301,20 @@ uint64_t BlockchainDB::add_block( const std::pair<block, blobdata>& blck
       if (vout.amount == 0)
         ++num_rct_outs;
     }
+    emission.add_tx(tx.first, blk.major_version);
+    filter_txs.push_back(&tx.first);
     ++tx_i;
   }
+  emission.set_miner_tx(blk.miner_tx);
   TIME_MEASURE_FINISH(time1);
   time_add_transaction += time1;
 
   // call out to subclass implementation to add the block & metadata
   time1 = epee::misc_utils::get_tick_count();
-  add_block(blk, block_weight, long_term_block_weight, cumulative_difficulty, coins_generated, num_rct_outs, blk_hash);
+  add_block(blk, block_weight, long_term_block_weight, cumulative_difficulty, coins_generated, num_rct_outs, emission, blk_hash);
+  block_filter filter;
+  make_block_filter(blk, blk_hash, filter_txs, filter);
+  add_block_filter(prev_height, block_filter_to_blob(filter));
   TIME_MEASURE_FINISH(time1);
   time_add_block1 += time1;
 
@@ -116,6 +116,21 @@ enum class relay_category : uint8_t
 
 bool matches_category(relay_method method, relay_category category) noexcept;
 
+/**
+ * @brief kinds of keyed records making up the stored service node list state
+ *
+ * Each record type lives in its own key range so the service node list can
+ * rewrite only the records a block actually touched.
+ */
+enum class service_node_record_type : uint8_t
+{
+  header = 1,     //!< height and layout version of the stored state
+  info,           //!< one service_node_info, keyed by service node pubkey
+  quorum,         //!< one quorum as node table indices, keyed by big-endian height
+  rollback_event, //!< one rollback event, keyed by big-endian sequence id
+  quorum_node     //!< one quorum node table entry, keyed by big-endian chunk height and index
+};
+
 #pragma pack(push, 1)
 
 /**
@@ -148,6 +163,29 @@ struct alt_block_data_t
   uint64_t already_generated_coins;
 };
 
+/**
+ * @brief coin emission, miner fees and burned amounts of a block, or of a range of blocks
+ */
+struct block_emission_totals
+{
+  uint64_t emission = 0;  //!< coins generated, not counting fees
+  uint64_t fees = 0;      //!< miner fees paid, not counting burned amounts
+  uint64_t burned = 0;    //!< amounts burned through tx_extra
+
+  /**
+   * @brief add a block's non-miner transaction to the fee and burned totals
+   */
+  void add_tx(const transaction &tx, uint8_t major_version);
+
+  /**
+   * @brief set the emission from the block's miner tx; call after all add_tx calls
+   */
+  void set_miner_tx(const transaction &miner_tx);
+
+  block_emission_totals &operator+=(const block_emission_totals &o) { emission += o.emission; fees += o.fees; burned += o.burned; return *this; }
+  block_emission_totals &operator-=(const block_emission_totals &o) { emission -= o.emission; fees -= o.fees; burned -= o.burned; return *this; }
+};
+
 /**
  * @brief a struct containing txpool per transaction metadata
  */
@@ -397,6 +435,7 @@ private:
    * @param long_term_block_weight the long term block weight of the block (transactions and all)
    * @param cumulative_difficulty the accumulated difficulty after this block
    * @param coins_generated the number of coins generated total after this block
+   * @param emission the emission, fees and burned amounts of this block alone
    * @param blk_hash the hash of the block
    */
   virtual void add_block( const block& blk
@@ -405,6 +444,7 @@ private:
                 , const difficulty_type& cumulative_difficulty
                 , const uint64_t& coins_generated
                 , uint64_t num_rct_outs
+                , const block_emission_totals& emission
                 , const crypto::hash& blk_hash
                 ) = 0;
 
@@ -420,6 +460,17 @@ private:
    */
   virtual void remove_block() = 0;
 
+  /**
+   * @brief store the wallet filter of a block
+   *
+   * Called by BlockchainDB::add_block once the block itself has been added;
+   * remove_block() drops it again.
+   *
+   * @param height the height of the block
+   * @param filter the serialized block_filter
+   */
+  virtual void add_block_filter(const uint64_t& height, const cryptonote::blobdata& filter) = 0;
+
   /**
    * @brief store the transaction and its metadata
    *
@@ -937,6 +988,31 @@ public:
    */
   virtual cryptonote::blobdata get_block_blob_from_height(const uint64_t& height) const = 0;
 
+  /**
+   * @brief fetch the hashes of a block's transactions from the per-block index
+   *
+   * This gives a block's tx_hashes without parsing the block blob. Blocks
+   * stored before the index existed have no entry.
+   *
+   * @param height the height of the block
+   * @param tx_hashes return-by-reference the hashes, miner tx excluded
+   *
+   * @return true if the block is indexed, false otherwise
+   */
+  virtual bool get_block_tx_hashes(const uint64_t& height, std::vector<crypto::hash>& tx_hashes) const = 0;
+
+  /**
+   * @brief fetch a block's serialized wallet filter
+   *
+   * Blocks stored before filters existed have none.
+   *
+   * @param height the height of the block
+   * @param filter return-by-reference the serialized block_filter
+   *
+   * @return true if the block has a filter, false otherwise
+   */
+  virtual bool get_block_filter(const uint64_t& height, cryptonote::blobdata& filter) const = 0;
+
   /**
    * @brief fetch a block by height
    *
@@ -1053,6 +1129,35 @@ public:
    */
   virtual uint64_t get_block_already_generated_coins(const uint64_t& height) const = 0;
 
+  /**
+   * @brief fetch the emission, fees and burned amounts from genesis up to and including a block
+   *
+   * Databases created before these totals were indexed are filled in by
+   * set_block_cumulative_emission, from genesis up; blocks above that point
+   * have no totals yet.
+   *
+   * If the block does not exist, the subclass should throw BLOCK_DNE
+   *
+   * @param height the height requested
+   * @param totals return-by-reference the cumulative totals
+   *
+   * @return true if the block's totals are indexed, false otherwise
+   */
+  virtual bool get_block_cumulative_emission(const uint64_t& height, block_emission_totals& totals) const = 0;
+
+  /**
+   * @brief get the number of blocks, from genesis, which have cumulative emission totals
+   */
+  virtual uint64_t get_emission_index_height() const = 0;
+
+  /**
+   * @brief store a block's cumulative emission totals, when filling in an older database
+   *
+   * @param height the block's height; the block below it must already have its totals
+   * @param totals the emission, fees and burned amounts from genesis up to and including the block
+   */
+  virtual void set_block_cumulative_emission(const uint64_t& height, const block_emission_totals& totals) = 0;
+
   /**
    * @brief fetch a block's long term weight
    *
@@ -1677,6 +1782,37 @@ public:
    */
   virtual void drop_alt_blocks() = 0;
 
+  /**
+   * @brief add block proof-of-work hashes to the PoW hash cache
+   *
+   * The cache keeps the most recently added max_entries hashes and evicts
+   * the oldest ones beyond that. Block ids already cached are skipped.
+   *
+   * @param hashes pairs of block id and PoW hash
+   * @param max_entries the size bound of the cache
+   */
+  virtual void add_pow_hashes(const std::vector<std::pair<crypto::hash, crypto::hash>> &hashes, uint64_t max_entries) = 0;
+
+  /**
+   * @brief look up a block's proof-of-work hash in the PoW hash cache
+   *
+   * @param blkid the block hash
+   * @param pow_hash return-by-reference the PoW hash
+   *
+   * @return true if the block's PoW hash was cached, false otherwise
+   */
+  virtual bool get_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const = 0;
+
+  /**
+   * @brief get the number of PoW hashes cached
+   */
+  virtual uint64_t get_pow_hash_count() const = 0;
+
+  /**
+   * @brief drop all cached PoW hashes
+   */
+  virtual void drop_pow_hashes() = 0;
+
   /**
    * @brief runs a function over all txpool transactions
    *
@@ -1854,6 +1990,83 @@ public:
   virtual void set_service_node_data(const std::string& data) = 0;
   virtual bool get_service_node_data(std::string& data) = 0;
   virtual void clear_service_node_data() = 0;
+
+  /**
+   * @brief store a keyed service node list record
+   *
+   * @param type the record type
+   * @param key the record key, opaque to the database
+   * @param data the serialized record
+   */
+  virtual void set_service_node_record(service_node_record_type type, const std::string& key, const std::string& data) = 0;
+
+  /**
+   * @brief remove a keyed service node list record, if it exists
+   *
+   * @param type the record type
+   * @param key the record key
+   */
+  virtual void remove_service_node_record(service_node_record_type type, const std::string& key) = 0;
+
+  /**
+   * @brief fetch a keyed service node list record
+   *
+   * @param type the record type
+   * @param key the record key
+   * @param data return-by-reference the serialized record
+   *
+   * @return true if the record was found, otherwise false
+   */
+  virtual bool get_service_node_record(service_node_record_type type, const std::string& key, std::string& data) const = 0;
+
+  /**
+   * @brief runs a function over all service node list records of a type
+   *
+   * Records are visited in ascending key order.  If the function returns
+   * false, iteration stops.
+   *
+   * @param type the record type
+   * @param f the function to run
+   *
+   * @return false if the function returns false for any record, otherwise true
+   */
+  virtual bool for_all_service_node_records(service_node_record_type type, std::function<bool(const std::string& key, const std::string& data)> f) const = 0;
+
+  /**
+   * @brief store a service node list snapshot
+   *
+   * Snapshots are kept apart from the live service node list records and
+   * survive clear_service_node_data().
+   *
+   * @param height the height the snapshot was taken at
+   * @param data the serialized snapshot
+   */
+  virtual void set_service_node_snapshot(uint64_t height, const std::string& data) = 0;
+
+  /**
+   * @brief fetch the newest service node list snapshot at or below a height
+   *
+   * @param max_height the highest acceptable snapshot height
+   * @param height return-by-reference the height of the snapshot found
+   * @param data return-by-reference the serialized snapshot
+   *
+   * @return true if a snapshot was found, otherwise false
+   */
+  virtual bool get_service_node_snapshot(uint64_t max_height, uint64_t& height, std::string& data) const = 0;
+
+  /**
+   * @brief get the heights of all stored service node list snapshots
+   *
+   * @return the heights, in ascending order
+   */
+  virtual std::vector<uint64_t> get_service_node_snapshot_heights() const = 0;
+
+  /**
+   * @brief remove a service node list snapshot, if it exists
+   *
+   * @param height the height of the snapshot
+   */
+  virtual void remove_service_node_snapshot(uint64_t height) = 0;
   
   /**
    * @brief set whether or not to automatically remove logs
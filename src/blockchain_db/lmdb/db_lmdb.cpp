@@ -55,7 +55,7 @@ using epee::string_tools::pod_to_hex;
 using namespace crypto;
 
 // Increase when the DB structure changes
-#define VERSION 5
+#define VERSION 6
 
 namespace
 {
@@ -205,6 +205,16 @@ namespace
  *
  * alt_blocks       block hash   {block data, block blob}
  *
+ * block_tx_hashes  block ID     [txn hash...]
+ * block_filters    block ID     block filter blob
+ *
+ * pow_hashes       block hash   {PoW hash, insertion sequence}
+ * pow_hash_order   sequence     block hash
+ *
+ * service_node_data    1        legacy service node list blob
+ * service_node_records {type, key} service node list record
+ * service_node_snapshots height   service node list snapshot
+ *
  * Note: where the data items are of uniform size, DUPFIXED tables have
  * been used to save space. In most of these cases, a dummy "zerokval"
  * key is used when accessing the table; the Key listed above will be
@@ -234,9 +244,17 @@ const char* const LMDB_TXPOOL_BLOB = "txpool_blob";
 
 const char* const LMDB_ALT_BLOCKS = "alt_blocks";
 
+const char* const LMDB_BLOCK_TX_HASHES = "block_tx_hashes";
+const char* const LMDB_BLOCK_FILTERS = "block_filters";
+
+const char* const LMDB_POW_HASHES = "pow_hashes";
+const char* const LMDB_POW_HASH_ORDER = "pow_hash_order";
+
 const char* const LMDB_HF_STARTING_HEIGHTS = "hf_starting_heights";
 const char* const LMDB_HF_VERSIONS = "hf_versions";
 const char* const LMDB_SERVICE_NODE_DATA = "service_node_data";
+const char* const LMDB_SERVICE_NODE_RECORDS = "service_node_records";
+const char* const LMDB_SERVICE_NODE_SNAPSHOTS = "service_node_snapshots";
 
 const char* const LMDB_PROPERTIES = "properties";
 
@@ -328,7 +346,24 @@ typedef struct mdb_block_info_4
   uint64_t bi_long_term_block_weight;
 } mdb_block_info_4;
 
-typedef mdb_block_info_4 mdb_block_info;
+typedef struct mdb_block_info_5
+{
+  uint64_t bi_height;
+  uint64_t bi_timestamp;
+  uint64_t bi_coins;
+  uint64_t bi_weight; // a size_t really but we need 32-bit compat
+  uint64_t bi_diff_lo;
+  uint64_t bi_diff_hi;
+  crypto::hash bi_hash;
+  uint64_t bi_cum_rct;
+  uint64_t bi_long_term_block_weight;
+  uint64_t bi_cum_emission;
+  uint64_t bi_cum_fees;
+  uint64_t bi_cum_burned;
+  uint64_t bi_cum_indexed; // nonzero once the three totals above are filled in
+} mdb_block_info_5;
+
+typedef mdb_block_info_5 mdb_block_info;
 
 typedef struct blk_height {
     crypto::hash bh_hash;
@@ -737,7 +772,7 @@ estim:
 }
 
 void BlockchainLMDB::add_block(const block& blk, size_t block_weight, uint64_t long_term_block_weight, const difficulty_type& cumulative_difficulty, const uint64_t& coins_generated,
-    uint64_t num_rct_outs, const crypto::hash& blk_hash)
+    uint64_t num_rct_outs, const block_emission_totals& emission, const crypto::hash& blk_hash)
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
@@ -788,14 +823,30 @@ void BlockchainLMDB::add_block(const block& blk, size_t block_weight, uint64_t l
   bi.bi_diff_lo = (cumulative_difficulty & 0xffffffffffffffff).convert_to<uint64_t>();
   bi.bi_hash = blk_hash;
   bi.bi_cum_rct = num_rct_outs;
-  if (blk.major_version >= 4)
+  bi.bi_cum_emission = emission.emission;
+  bi.bi_cum_fees = emission.fees;
+  bi.bi_cum_burned = emission.burned;
+  bi.bi_cum_indexed = 1;
+  if (m_height > 0)
   {
     uint64_t last_height = m_height-1;
     MDB_val_set(h, last_height);
     if ((result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &h, MDB_GET_BOTH)))
         throw1(BLOCK_DNE(lmdb_error("Failed to get block info: ", result).c_str()));
     const mdb_block_info *bi_prev = (const mdb_block_info*)h.mv_data;
-    bi.bi_cum_rct += bi_prev->bi_cum_rct;
+    if (blk.major_version >= 4)
+      bi.bi_cum_rct += bi_prev->bi_cum_rct;
+    // totals stay unindexed until the background fill reaches the parent
+    if (bi_prev->bi_cum_indexed)
+    {
+      bi.bi_cum_emission += bi_prev->bi_cum_emission;
+      bi.bi_cum_fees += bi_prev->bi_cum_fees;
+      bi.bi_cum_burned += bi_prev->bi_cum_burned;
+    }
+    else
+    {
+      bi.bi_cum_emission = bi.bi_cum_fees = bi.bi_cum_burned = bi.bi_cum_indexed = 0;
+    }
   }
   bi.bi_long_term_block_weight = long_term_block_weight;
 
@@ -808,6 +859,12 @@ void BlockchainLMDB::add_block(const block& blk, size_t block_weight, uint64_t l
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add block height by hash to db transaction: ", result).c_str()));
 
+  CURSOR(block_tx_hashes)
+  MDB_val val_tx_hashes = {blk.tx_hashes.size() * sizeof(crypto::hash), (void *)blk.tx_hashes.data()};
+  result = mdb_cursor_put(m_cur_block_tx_hashes, &key, &val_tx_hashes, MDB_APPEND);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to add block tx hashes to db transaction: ", result).c_str()));
+
   // we use weight as a proxy for size, since we don't have size but weight is >= size
   // and often actually equal
   m_cum_size += block_weight;
@@ -849,6 +906,41 @@ void BlockchainLMDB::remove_block()
 
   if ((result = mdb_cursor_del(m_cur_block_info, 0)))
       throw1(DB_ERROR(lmdb_error("Failed to add removal of block info to db transaction: ", result).c_str()));
+
+  CURSOR(block_tx_hashes)
+  MDB_val_copy<uint64_t> kh(m_height - 1);
+  result = mdb_cursor_get(m_cur_block_tx_hashes, &kh, NULL, MDB_SET);
+  if (result == 0)
+  {
+    if ((result = mdb_cursor_del(m_cur_block_tx_hashes, 0)))
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of block tx hashes to db transaction: ", result).c_str()));
+  }
+  else if (result != MDB_NOTFOUND)
+    throw1(DB_ERROR(lmdb_error("Failed to locate block tx hashes for removal: ", result).c_str()));
+
+  CURSOR(block_filters)
+  result = mdb_cursor_get(m_cur_block_filters, &kh, NULL, MDB_SET);
+  if (result == 0)
+  {
+    if ((result = mdb_cursor_del(m_cur_block_filters, 0)))
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of block filter to db transaction: ", result).c_str()));
+  }
+  else if (result != MDB_NOTFOUND)
+    throw1(DB_ERROR(lmdb_error("Failed to locate block filter for removal: ", result).c_str()));
+}
+
+void BlockchainLMDB::add_block_filter(const uint64_t& height, const cryptonote::blobdata& filter)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  mdb_txn_cursors *m_cursors = &m_wcursors;
+
+  CURSOR(block_filters)
+  MDB_val_copy<uint64_t> key(height);
+  MDB_val val_filter = {filter.size(), (void *)filter.data()};
+  int result = mdb_cursor_put(m_cur_block_filters, &key, &val_filter, MDB_APPEND);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to add block filter to db transaction: ", result).c_str()));
 }
 
 uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash& blk_hash, const std::pair<transaction, blobdata>& txp, const crypto::hash& tx_hash, const crypto::hash& tx_prunable_hash)
@@ -1283,6 +1375,11 @@ BlockchainLMDB::BlockchainLMDB(bool batch_transactions): BlockchainDB()
   m_batch_active = false;
   m_cum_size = 0;
   m_cum_count = 0;
+  m_has_pow_hashes = false;
+  m_has_block_tx_hashes = false;
+  m_has_block_filters = false;
+  m_has_service_node_records = false;
+  m_has_service_node_snapshots = false;
 
   // reset may also need changing when initialize things here
 
@@ -1416,6 +1513,30 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
 
   lmdb_db_open(txn, LMDB_ALT_BLOCKS, MDB_CREATE, m_alt_blocks, "Failed to open db handle for m_alt_blocks");
 
+  // Likewise for the per-block tx hash index, blocks added before it existed have no entry
+  m_has_block_tx_hashes = true;
+  if (!(mdb_flags & MDB_RDONLY))
+    lmdb_db_open(txn, LMDB_BLOCK_TX_HASHES, MDB_INTEGERKEY | MDB_CREATE, m_block_tx_hashes, "Failed to open db handle for m_block_tx_hashes");
+  else if (mdb_dbi_open(txn, LMDB_BLOCK_TX_HASHES, MDB_INTEGERKEY, &m_block_tx_hashes))
+    m_has_block_tx_hashes = false;
+
+  m_has_block_filters = true;
+  if (!(mdb_flags & MDB_RDONLY))
+    lmdb_db_open(txn, LMDB_BLOCK_FILTERS, MDB_INTEGERKEY | MDB_CREATE, m_block_filters, "Failed to open db handle for m_block_filters");
+  else if (mdb_dbi_open(txn, LMDB_BLOCK_FILTERS, MDB_INTEGERKEY, &m_block_filters))
+    m_has_block_filters = false;
+
+  // The PoW hash cache is newer than the other tables, a read only open of a database
+  // that never had it runs without it
+  m_has_pow_hashes = true;
+  if (!(mdb_flags & MDB_RDONLY))
+  {
+    lmdb_db_open(txn, LMDB_POW_HASHES, MDB_CREATE, m_pow_hashes, "Failed to open db handle for m_pow_hashes");
+    lmdb_db_open(txn, LMDB_POW_HASH_ORDER, MDB_INTEGERKEY | MDB_CREATE, m_pow_hash_order, "Failed to open db handle for m_pow_hash_order");
+  }
+  else if (mdb_dbi_open(txn, LMDB_POW_HASHES, 0, &m_pow_hashes) || mdb_dbi_open(txn, LMDB_POW_HASH_ORDER, MDB_INTEGERKEY, &m_pow_hash_order))
+    m_has_pow_hashes = false;
+
   // this subdb is dropped on sight, so it may not be present when we open the DB.
   // Since we use MDB_CREATE, we'll get an exception if we open read-only and it does not exist.
   // So we don't open for read-only, and also not drop below. It is not used elsewhere.
@@ -1425,6 +1546,19 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   lmdb_db_open(txn, LMDB_HF_VERSIONS, MDB_INTEGERKEY | MDB_CREATE, m_hf_versions, "Failed to open db handle for m_hf_versions");
   lmdb_db_open(txn, LMDB_SERVICE_NODE_DATA, MDB_INTEGERKEY | MDB_CREATE, m_service_node_data, "Failed to open db handle for m_service_node_data");
 
+  // older databases opened read only fall back to the legacy service node data
+  m_has_service_node_records = true;
+  if (!(mdb_flags & MDB_RDONLY))
+    lmdb_db_open(txn, LMDB_SERVICE_NODE_RECORDS, MDB_CREATE, m_service_node_records, "Failed to open db handle for m_service_node_records");
+  else if (mdb_dbi_open(txn, LMDB_SERVICE_NODE_RECORDS, 0, &m_service_node_records))
+    m_has_service_node_records = false;
+
+  m_has_service_node_snapshots = true;
+  if (!(mdb_flags & MDB_RDONLY))
+    lmdb_db_open(txn, LMDB_SERVICE_NODE_SNAPSHOTS, MDB_INTEGERKEY | MDB_CREATE, m_service_node_snapshots, "Failed to open db handle for m_service_node_snapshots");
+  else if (mdb_dbi_open(txn, LMDB_SERVICE_NODE_SNAPSHOTS, MDB_INTEGERKEY, &m_service_node_snapshots))
+    m_has_service_node_snapshots = false;
+
 
   lmdb_db_open(txn, LMDB_PROPERTIES, MDB_CREATE, m_properties, "Failed to open db handle for m_properties");
 
@@ -1442,6 +1576,15 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   mdb_set_compare(txn, m_txpool_meta, compare_hash32);
   mdb_set_compare(txn, m_txpool_blob, compare_hash32);
   mdb_set_compare(txn, m_alt_blocks, compare_hash32);
+  if (m_has_block_tx_hashes)
+    mdb_set_compare(txn, m_block_tx_hashes, compare_uint64);
+  if (m_has_block_filters)
+    mdb_set_compare(txn, m_block_filters, compare_uint64);
+  if (m_has_pow_hashes)
+  {
+    mdb_set_compare(txn, m_pow_hashes, compare_hash32);
+    mdb_set_compare(txn, m_pow_hash_order, compare_uint64);
+  }
   mdb_set_compare(txn, m_properties, compare_string);
 
   if (!(mdb_flags & MDB_RDONLY))
@@ -1610,10 +1753,22 @@ void BlockchainLMDB::reset()
   if (auto result = mdb_drop(txn, m_spent_keys, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_spent_keys: ", result).c_str()));
   (void)mdb_drop(txn, m_hf_starting_heights, 0); // this one is dropped in new code
+  if (auto result = mdb_drop(txn, m_block_tx_hashes, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_block_tx_hashes: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_block_filters, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_block_filters: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_pow_hashes, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_pow_hashes: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_pow_hash_order, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_pow_hash_order: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_hf_versions, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_hf_versions: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_service_node_data, 0))
 	  throw0(DB_ERROR(lmdb_error("Failed to drop m_service_node_data: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_service_node_records, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_service_node_records: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_service_node_snapshots, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_service_node_snapshots: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_properties, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_properties: ", result).c_str()));
 
@@ -2476,6 +2631,56 @@ cryptonote::blobdata BlockchainLMDB::get_block_blob_from_height(const uint64_t&
   return bd;
 }
 
+bool BlockchainLMDB::get_block_tx_hashes(const uint64_t& height, std::vector<crypto::hash>& tx_hashes) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  if (!m_has_block_tx_hashes)
+    return false;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_tx_hashes);
+
+  MDB_val_copy<uint64_t> key(height);
+  MDB_val v;
+  auto get_result = mdb_cursor_get(m_cur_block_tx_hashes, &key, &v, MDB_SET);
+  if (get_result == MDB_NOTFOUND)
+    return false;
+  else if (get_result)
+    throw0(DB_ERROR(lmdb_error("Error attempting to retrieve block tx hashes from the db: ", get_result).c_str()));
+  if (v.mv_size % sizeof(crypto::hash))
+    throw0(DB_ERROR("Block tx hashes record has unexpected size"));
+
+  const crypto::hash *hashes = (const crypto::hash*)v.mv_data;
+  tx_hashes.assign(hashes, hashes + v.mv_size / sizeof(crypto::hash));
+
+  TXN_POSTFIX_RDONLY();
+  return true;
+}
+
+bool BlockchainLMDB::get_block_filter(const uint64_t& height, cryptonote::blobdata& filter) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  if (!m_has_block_filters)
+    return false;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_filters);
+
+  MDB_val_copy<uint64_t> key(height);
+  MDB_val v;
+  auto get_result = mdb_cursor_get(m_cur_block_filters, &key, &v, MDB_SET);
+  if (get_result == MDB_NOTFOUND)
+    return false;
+  else if (get_result)
+    throw0(DB_ERROR(lmdb_error("Error attempting to retrieve block filter from the db: ", get_result).c_str()));
+  filter.assign((const char*)v.mv_data, v.mv_size);
+
+  TXN_POSTFIX_RDONLY();
+  return true;
+}
+
 uint64_t BlockchainLMDB::get_block_timestamp(const uint64_t& height) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -2775,6 +2980,100 @@ uint64_t BlockchainLMDB::get_block_already_generated_coins(const uint64_t& heigh
   return ret;
 }
 
+bool BlockchainLMDB::get_block_cumulative_emission(const uint64_t& height, block_emission_totals& totals) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_info);
+
+  MDB_val_set(result, height);
+  auto get_result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &result, MDB_GET_BOTH);
+  if (get_result == MDB_NOTFOUND)
+  {
+    throw0(BLOCK_DNE(std::string("Attempt to get emission totals from height ").append(boost::lexical_cast<std::string>(height)).append(" failed -- block info not in db").c_str()));
+  }
+  else if (get_result)
+    throw0(DB_ERROR("Error attempting to retrieve emission totals from the db"));
+
+  const mdb_block_info *bi = (const mdb_block_info *)result.mv_data;
+  const bool indexed = bi->bi_cum_indexed;
+  if (indexed)
+  {
+    totals.emission = bi->bi_cum_emission;
+    totals.fees = bi->bi_cum_fees;
+    totals.burned = bi->bi_cum_burned;
+  }
+  TXN_POSTFIX_RDONLY();
+  return indexed;
+}
+
+uint64_t BlockchainLMDB::get_emission_index_height() const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_info);
+
+  MDB_stat db_stats;
+  int result = mdb_stat(m_txn, m_block_info, &db_stats);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to query m_block_info: ", result).c_str()));
+
+  // indexed blocks always form a prefix of the chain, so bisect for its end
+  uint64_t lo = 0, hi = db_stats.ms_entries;
+  while (lo < hi)
+  {
+    uint64_t mid = lo + (hi - lo) / 2;
+    MDB_val_set(v, mid);
+    result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Error attempting to retrieve block info from the db: ", result).c_str()));
+    if (((const mdb_block_info *)v.mv_data)->bi_cum_indexed)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  TXN_POSTFIX_RDONLY();
+  return lo;
+}
+
+void BlockchainLMDB::set_block_cumulative_emission(const uint64_t& height, const block_emission_totals& totals)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  mdb_txn_cursors *m_cursors = &m_wcursors;
+
+  CURSOR(block_info)
+
+  int result;
+  if (height > 0)
+  {
+    uint64_t prev_height = height - 1;
+    MDB_val_set(h, prev_height);
+    if ((result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &h, MDB_GET_BOTH)))
+      throw1(BLOCK_DNE(lmdb_error("Failed to get block info: ", result).c_str()));
+    if (!((const mdb_block_info *)h.mv_data)->bi_cum_indexed)
+      throw0(DB_ERROR("Attempting to index emission totals above an unindexed block"));
+  }
+
+  MDB_val_set(h, height);
+  if ((result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &h, MDB_GET_BOTH)))
+    throw1(BLOCK_DNE(lmdb_error("Failed to get block info: ", result).c_str()));
+
+  mdb_block_info bi = *(const mdb_block_info *)h.mv_data;
+  bi.bi_cum_emission = totals.emission;
+  bi.bi_cum_fees = totals.fees;
+  bi.bi_cum_burned = totals.burned;
+  bi.bi_cum_indexed = 1;
+
+  MDB_val_set(val, bi);
+  if ((result = mdb_cursor_put(m_cur_block_info, (MDB_val *)&zerokval, &val, MDB_CURRENT)))
+    throw0(DB_ERROR(lmdb_error("Failed to update block info in db transaction: ", result).c_str()));
+}
+
 uint64_t BlockchainLMDB::get_block_long_term_weight(const uint64_t& height) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -4441,6 +4740,130 @@ void BlockchainLMDB::drop_alt_blocks()
   TXN_POSTFIX_SUCCESS();
 }
 
+struct pow_hash_entry
+{
+  crypto::hash pow_hash;
+  uint64_t seq;
+};
+
+void BlockchainLMDB::add_pow_hashes(const std::vector<std::pair<crypto::hash, crypto::hash>> &hashes, uint64_t max_entries)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  if (!m_has_pow_hashes)
+    return;
+  if (hashes.empty())
+    return;
+
+  TXN_BLOCK_PREFIX(0);
+
+  MDB_cursor *order_cur;
+  if (auto result = mdb_cursor_open(*txn_ptr, m_pow_hash_order, &order_cur))
+    throw0(DB_ERROR(lmdb_error("Failed to open cursor: ", result).c_str()));
+  std::unique_ptr<MDB_cursor, void(*)(MDB_cursor*)> order_cur_closer(order_cur, mdb_cursor_close);
+
+  MDB_val k, v;
+  uint64_t seq = 0;
+  int result = mdb_cursor_get(order_cur, &k, &v, MDB_LAST);
+  if (result == 0)
+    seq = *(const uint64_t*)k.mv_data + 1;
+  else if (result != MDB_NOTFOUND)
+    throw0(DB_ERROR(lmdb_error("Failed to get last PoW hash sequence: ", result).c_str()));
+
+  for (const auto &h : hashes)
+  {
+    pow_hash_entry entry = {h.second, seq};
+    MDB_val_set(kid, h.first);
+    MDB_val_set(ventry, entry);
+    result = mdb_put(*txn_ptr, m_pow_hashes, &kid, &ventry, MDB_NOOVERWRITE);
+    if (result == MDB_KEYEXIST)
+      continue;
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to add PoW hash to db transaction: ", result).c_str()));
+
+    MDB_val_set(kseq, seq);
+    MDB_val_set(vid, h.first);
+    if ((result = mdb_cursor_put(order_cur, &kseq, &vid, MDB_APPEND)))
+      throw0(DB_ERROR(lmdb_error("Failed to add PoW hash sequence to db transaction: ", result).c_str()));
+    ++seq;
+  }
+
+  MDB_stat db_stats;
+  if ((result = mdb_stat(*txn_ptr, m_pow_hashes, &db_stats)))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_pow_hashes: ", result).c_str()));
+  for (uint64_t entries = db_stats.ms_entries; entries > max_entries; --entries)
+  {
+    if ((result = mdb_cursor_get(order_cur, &k, &v, MDB_FIRST)))
+      throw0(DB_ERROR(lmdb_error("Failed to get oldest PoW hash: ", result).c_str()));
+    if ((result = mdb_del(*txn_ptr, m_pow_hashes, &v, NULL)))
+      throw0(DB_ERROR(lmdb_error("Failed to evict PoW hash: ", result).c_str()));
+    if ((result = mdb_cursor_del(order_cur, 0)))
+      throw0(DB_ERROR(lmdb_error("Failed to evict PoW hash sequence: ", result).c_str()));
+  }
+
+  order_cur_closer.reset();
+  TXN_BLOCK_POSTFIX_SUCCESS();
+}
+
+bool BlockchainLMDB::get_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  if (!m_has_pow_hashes)
+    return false;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(pow_hashes);
+
+  MDB_val_set(k, blkid);
+  MDB_val v;
+  int result = mdb_cursor_get(m_cur_pow_hashes, &k, &v, MDB_SET);
+  if (result == MDB_NOTFOUND)
+    return false;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Error attempting to retrieve PoW hash of block " + epee::string_tools::pod_to_hex(blkid) + " from the db: ", result).c_str()));
+  if (v.mv_size != sizeof(pow_hash_entry))
+    throw0(DB_ERROR("PoW hash record has unexpected size"));
+
+  pow_hash = ((const pow_hash_entry*)v.mv_data)->pow_hash;
+  TXN_POSTFIX_RDONLY();
+  return true;
+}
+
+uint64_t BlockchainLMDB::get_pow_hash_count() const
+{
+  LOG_PRINT_L3("BlockchainLMDB:: " << __func__);
+  check_open();
+  if (!m_has_pow_hashes)
+    return 0;
+
+  TXN_PREFIX_RDONLY();
+
+  MDB_stat db_stats;
+  int result = mdb_stat(m_txn, m_pow_hashes, &db_stats);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to query m_pow_hashes: ", result).c_str()));
+  TXN_POSTFIX_RDONLY();
+  return db_stats.ms_entries;
+}
+
+void BlockchainLMDB::drop_pow_hashes()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX(0);
+
+  auto result = mdb_drop(*txn_ptr, m_pow_hashes, 0);
+  if (result)
+    throw1(DB_ERROR(lmdb_error("Error dropping PoW hashes: ", result).c_str()));
+  result = mdb_drop(*txn_ptr, m_pow_hash_order, 0);
+  if (result)
+    throw1(DB_ERROR(lmdb_error("Error dropping PoW hash sequences: ", result).c_str()));
+
+  TXN_POSTFIX_SUCCESS();
+}
+
 bool BlockchainLMDB::is_read_only() const
 {
   unsigned int flags;
@@ -5636,6 +6059,127 @@ void BlockchainLMDB::migrate_4_5()
   txn.commit();
 }
 
+void BlockchainLMDB::migrate_5_6()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  uint64_t i;
+  int result;
+  mdb_txn_safe txn(false);
+  MDB_val k, v;
+  char *ptr;
+
+  MGINFO_YELLOW("Migrating blockchain from DB version 5 to 6 - this may take a while:");
+
+  do {
+    LOG_PRINT_L1("migrating block info:");
+
+    result = mdb_txn_begin(m_env, NULL, 0, txn);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+    MDB_stat db_stats;
+    if ((result = mdb_stat(txn, m_blocks, &db_stats)))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_blocks: ", result).c_str()));
+    const uint64_t blockchain_height = db_stats.ms_entries;
+
+    /* the block_info table name is the same but the old version and new version
+     * have incompatible data. Create a new table. We want the name to be similar
+     * to the old name so that it will occupy the same location in the DB.
+     */
+    MDB_dbi o_block_info = m_block_info;
+    lmdb_db_open(txn, "block_infn", MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_block_info, "Failed to open db handle for block_infn");
+    mdb_set_dupsort(txn, m_block_info, compare_uint64);
+
+    MDB_cursor *c_old, *c_cur;
+    i = 0;
+    while(1) {
+      if (!(i % 1000)) {
+        if (i) {
+          LOGIF(el::Level::Info) {
+            std::cout << i << " / " << blockchain_height << "  \r" << std::flush;
+          }
+          txn.commit();
+          result = mdb_txn_begin(m_env, NULL, 0, txn);
+          if (result)
+            throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+        }
+        result = mdb_cursor_open(txn, m_block_info, &c_cur);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for block_infn: ", result).c_str()));
+        result = mdb_cursor_open(txn, o_block_info, &c_old);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for block_info: ", result).c_str()));
+        if (!i) {
+          result = mdb_stat(txn, m_block_info, &db_stats);
+          if (result)
+            throw0(DB_ERROR(lmdb_error("Failed to query m_block_info: ", result).c_str()));
+          i = db_stats.ms_entries;
+        }
+      }
+      result = mdb_cursor_get(c_old, &k, &v, MDB_NEXT);
+      if (result == MDB_NOTFOUND) {
+        txn.commit();
+        break;
+      }
+      else if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to get a record from block_info: ", result).c_str()));
+      const mdb_block_info_4 *bi_old = (const mdb_block_info_4*)v.mv_data;
+      mdb_block_info_5 bi;
+      bi.bi_height = bi_old->bi_height;
+      bi.bi_timestamp = bi_old->bi_timestamp;
+      bi.bi_coins = bi_old->bi_coins;
+      bi.bi_weight = bi_old->bi_weight;
+      bi.bi_diff_lo = bi_old->bi_diff_lo;
+      bi.bi_diff_hi = bi_old->bi_diff_hi;
+      bi.bi_hash = bi_old->bi_hash;
+      bi.bi_cum_rct = bi_old->bi_cum_rct;
+      bi.bi_long_term_block_weight = bi_old->bi_long_term_block_weight;
+      // computing these needs every transaction, so the daemon fills them in the background
+      bi.bi_cum_emission = 0;
+      bi.bi_cum_fees = 0;
+      bi.bi_cum_burned = 0;
+      bi.bi_cum_indexed = 0;
+
+      MDB_val_set(nv, bi);
+      result = mdb_cursor_put(c_cur, (MDB_val *)&zerokval, &nv, MDB_APPENDDUP);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to put a record into block_infn: ", result).c_str()));
+      result = mdb_cursor_del(c_old, 0);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to delete a record from block_info: ", result).c_str()));
+      i++;
+    }
+
+    result = mdb_txn_begin(m_env, NULL, 0, txn);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+    /* Delete the old table */
+    result = mdb_drop(txn, o_block_info, 1);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to delete old block_info table: ", result).c_str()));
+
+    RENAME_DB("block_infn");
+    mdb_dbi_close(m_env, m_block_info);
+
+    lmdb_db_open(txn, "block_info", MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_block_info, "Failed to open db handle for block_infn");
+    mdb_set_dupsort(txn, m_block_info, compare_uint64);
+
+    txn.commit();
+  } while(0);
+
+  uint32_t version = 6;
+  v.mv_data = (void *)&version;
+  v.mv_size = sizeof(version);
+  MDB_val_str(vk, "version");
+  result = mdb_txn_begin(m_env, NULL, 0, txn);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+  result = mdb_put(txn, m_properties, &vk, &v, 0);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
+  txn.commit();
+}
+
 void BlockchainLMDB::migrate(const uint32_t oldversion)
 {
   if (oldversion < 1)
@@ -5648,6 +6192,8 @@ void BlockchainLMDB::migrate(const uint32_t oldversion)
     migrate_3_4();
   if (oldversion < 5)
     migrate_4_5();
+  if (oldversion < 6)
+    migrate_5_6();
 
 }
 
@@ -5710,11 +6256,226 @@ void BlockchainLMDB::clear_service_node_data()
 	MDB_val_set(k, key);
 
 	int result;
+	if ((result = mdb_drop(*m_write_txn, m_service_node_records, 0)))
+		throw1(DB_ERROR(lmdb_error("Failed to drop service node records: ", result).c_str()));
 	if ((result = mdb_cursor_get(m_cur_service_node_data, &k, NULL, MDB_SET)))
 		return;
 	if ((result = mdb_cursor_del(m_cur_service_node_data, 0)))
 		throw1(DB_ERROR(lmdb_error("Failed to add removal of service node data to db transaction: ", result).c_str()));
 }
 
+// Records of all types share one table; the type byte prefixes the caller's
+// key so that each type occupies a contiguous, ordered key range.
+static std::string service_node_record_key(service_node_record_type type, const std::string& key)
+{
+	std::string full_key;
+	full_key.reserve(1 + key.size());
+	full_key.push_back(static_cast<char>(type));
+	full_key.append(key);
+	return full_key;
+}
+
+void BlockchainLMDB::set_service_node_record(service_node_record_type type, const std::string& key, const std::string& data)
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	mdb_txn_cursors *m_cursors = &m_wcursors;
+	CURSOR(service_node_records);
+
+	const std::string full_key = service_node_record_key(type, key);
+	MDB_val k = {full_key.size(), (void *)full_key.data()};
+	MDB_val v = {data.size(), (void *)data.data()};
+
+	int result = mdb_cursor_put(m_cur_service_node_records, &k, &v, 0);
+	if (result)
+		throw1(DB_ERROR(lmdb_error("Failed to add service node record to db transaction: ", result).c_str()));
+}
+
+void BlockchainLMDB::remove_service_node_record(service_node_record_type type, const std::string& key)
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	mdb_txn_cursors *m_cursors = &m_wcursors;
+	CURSOR(service_node_records);
+
+	const std::string full_key = service_node_record_key(type, key);
+	MDB_val k = {full_key.size(), (void *)full_key.data()};
+
+	int result = mdb_cursor_get(m_cur_service_node_records, &k, NULL, MDB_SET);
+	if (result == MDB_NOTFOUND)
+		return;
+	if (result)
+		throw1(DB_ERROR(lmdb_error("Failed to locate service node record: ", result).c_str()));
+	if ((result = mdb_cursor_del(m_cur_service_node_records, 0)))
+		throw1(DB_ERROR(lmdb_error("Failed to add removal of service node record to db transaction: ", result).c_str()));
+}
+
+bool BlockchainLMDB::get_service_node_record(service_node_record_type type, const std::string& key, std::string& data) const
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	if (!m_has_service_node_records)
+		return false;
+
+	TXN_PREFIX_RDONLY();
+	RCURSOR(service_node_records);
+
+	const std::string full_key = service_node_record_key(type, key);
+	MDB_val k = {full_key.size(), (void *)full_key.data()};
+	MDB_val v;
+
+	int result = mdb_cursor_get(m_cur_service_node_records, &k, &v, MDB_SET);
+	if (result == MDB_NOTFOUND)
+		return false;
+	if (result)
+		throw0(DB_ERROR(lmdb_error("DB error attempting to get service node record: ", result).c_str()));
+
+	data.assign(reinterpret_cast<const char*>(v.mv_data), v.mv_size);
+
+	TXN_POSTFIX_RDONLY();
+	return true;
+}
+
+bool BlockchainLMDB::for_all_service_node_records(service_node_record_type type, std::function<bool(const std::string& key, const std::string& data)> f) const
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	if (!m_has_service_node_records)
+		return true;
+
+	TXN_PREFIX_RDONLY();
+	RCURSOR(service_node_records);
+
+	const char prefix = static_cast<char>(type);
+	MDB_val k = {sizeof(prefix), (void *)&prefix};
+	MDB_val v;
+	bool ret = true;
+
+	MDB_cursor_op op = MDB_SET_RANGE;
+	while (1)
+	{
+		int result = mdb_cursor_get(m_cur_service_node_records, &k, &v, op);
+		op = MDB_NEXT;
+		if (result == MDB_NOTFOUND)
+			break;
+		if (result)
+			throw0(DB_ERROR(lmdb_error("Failed to enumerate service node records: ", result).c_str()));
+		if (k.mv_size < 1 || *(const char*)k.mv_data != prefix)
+			break;
+
+		const std::string key((const char*)k.mv_data + 1, k.mv_size - 1);
+		const std::string data((const char*)v.mv_data, v.mv_size);
+		if (!f(key, data))
+		{
+			ret = false;
+			break;
+		}
+	}
+
+	TXN_POSTFIX_RDONLY();
+	return ret;
+}
+
+
+void BlockchainLMDB::set_service_node_snapshot(uint64_t height, const std::string& data)
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	mdb_txn_cursors *m_cursors = &m_wcursors;
+	CURSOR(service_node_snapshots);
+
+	MDB_val_set(k, height);
+	MDB_val v = {data.size(), (void *)data.data()};
+
+	int result = mdb_cursor_put(m_cur_service_node_snapshots, &k, &v, 0);
+	if (result)
+		throw1(DB_ERROR(lmdb_error("Failed to add service node snapshot to db transaction: ", result).c_str()));
+}
+
+bool BlockchainLMDB::get_service_node_snapshot(uint64_t max_height, uint64_t& height, std::string& data) const
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	if (!m_has_service_node_snapshots)
+		return false;
+
+	TXN_PREFIX_RDONLY();
+	RCURSOR(service_node_snapshots);
+
+	MDB_val_set(k, max_height);
+	MDB_val v;
+
+	// position on the first snapshot above max_height (or past the end) and
+	// step back to the newest one at or below it
+	int result = mdb_cursor_get(m_cur_service_node_snapshots, &k, &v, MDB_SET_RANGE);
+	if (result == MDB_NOTFOUND)
+		result = mdb_cursor_get(m_cur_service_node_snapshots, &k, &v, MDB_LAST);
+	else if (result == 0 && *(const uint64_t*)k.mv_data > max_height)
+		result = mdb_cursor_get(m_cur_service_node_snapshots, &k, &v, MDB_PREV);
+	if (result == MDB_NOTFOUND)
+		return false;
+	if (result)
+		throw0(DB_ERROR(lmdb_error("DB error attempting to get service node snapshot: ", result).c_str()));
+
+	height = *(const uint64_t*)k.mv_data;
+	data.assign(reinterpret_cast<const char*>(v.mv_data), v.mv_size);
+
+	TXN_POSTFIX_RDONLY();
+	return true;
+}
+
+std::vector<uint64_t> BlockchainLMDB::get_service_node_snapshot_heights() const
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	std::vector<uint64_t> heights;
+	if (!m_has_service_node_snapshots)
+		return heights;
+
+	TXN_PREFIX_RDONLY();
+	RCURSOR(service_node_snapshots);
+
+	MDB_val k;
+	MDB_cursor_op op = MDB_FIRST;
+	while (1)
+	{
+		int result = mdb_cursor_get(m_cur_service_node_snapshots, &k, NULL, op);
+		op = MDB_NEXT;
+		if (result == MDB_NOTFOUND)
+			break;
+		if (result)
+			throw0(DB_ERROR(lmdb_error("Failed to enumerate service node snapshots: ", result).c_str()));
+		heights.push_back(*(const uint64_t*)k.mv_data);
+	}
+
+	TXN_POSTFIX_RDONLY();
+	return heights;
+}
+
+void BlockchainLMDB::remove_service_node_snapshot(uint64_t height)
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	mdb_txn_cursors *m_cursors = &m_wcursors;
+	CURSOR(service_node_snapshots);
+
+	MDB_val_set(k, height);
+
+	int result = mdb_cursor_get(m_cur_service_node_snapshots, &k, NULL, MDB_SET);
+	if (result == MDB_NOTFOUND)
+		return;
+	if (result)
+		throw1(DB_ERROR(lmdb_error("Failed to locate service node snapshot: ", result).c_str()));
+	if ((result = mdb_cursor_del(m_cur_service_node_snapshots, 0)))
+		throw1(DB_ERROR(lmdb_error("Failed to add removal of service node snapshot to db transaction: ", result).c_str()));
+}
 
 }  // namespace cryptonote
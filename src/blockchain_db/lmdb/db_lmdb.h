@@ -50,6 +50,8 @@ typedef struct mdb_txn_cursors
   MDB_cursor *m_txc_blocks;
   MDB_cursor *m_txc_block_heights;
   MDB_cursor *m_txc_block_info;
+  MDB_cursor *m_txc_block_tx_hashes;
+  MDB_cursor *m_txc_block_filters;
 
   MDB_cursor *m_txc_output_txs;
   MDB_cursor *m_txc_output_amounts;
@@ -69,8 +71,12 @@ typedef struct mdb_txn_cursors
 
   MDB_cursor *m_txc_alt_blocks;
 
+  MDB_cursor *m_txc_pow_hashes;
+
   MDB_cursor *m_txc_hf_versions;
   MDB_cursor *m_txc_service_node_data;
+  MDB_cursor *m_txc_service_node_records;
+  MDB_cursor *m_txc_service_node_snapshots;
 
   MDB_cursor *m_txc_properties;
 } mdb_txn_cursors;
@@ -78,6 +84,8 @@ typedef struct mdb_txn_cursors
 #define m_cur_blocks	m_cursors->m_txc_blocks
 #define m_cur_block_heights	m_cursors->m_txc_block_heights
 #define m_cur_block_info	m_cursors->m_txc_block_info
+#define m_cur_block_tx_hashes	m_cursors->m_txc_block_tx_hashes
+#define m_cur_block_filters	m_cursors->m_txc_block_filters
 #define m_cur_output_txs	m_cursors->m_txc_output_txs
 #define m_cur_output_amounts	m_cursors->m_txc_output_amounts
 #define m_cur_txs	m_cursors->m_txc_txs
@@ -91,8 +99,11 @@ typedef struct mdb_txn_cursors
 #define m_cur_txpool_meta	m_cursors->m_txc_txpool_meta
 #define m_cur_txpool_blob	m_cursors->m_txc_txpool_blob
 #define m_cur_alt_blocks	m_cursors->m_txc_alt_blocks
+#define m_cur_pow_hashes	m_cursors->m_txc_pow_hashes
 #define m_cur_hf_versions	m_cursors->m_txc_hf_versions
 #define m_cur_service_node_data	m_cursors->m_txc_service_node_data
+#define m_cur_service_node_records	m_cursors->m_txc_service_node_records
+#define m_cur_service_node_snapshots	m_cursors->m_txc_service_node_snapshots
 #define m_cur_properties	m_cursors->m_txc_properties
 
 typedef struct mdb_rflags
@@ -101,6 +112,8 @@ typedef struct mdb_rflags
   bool m_rf_blocks;
   bool m_rf_block_heights;
   bool m_rf_block_info;
+  bool m_rf_block_tx_hashes;
+  bool m_rf_block_filters;
   bool m_rf_output_txs;
   bool m_rf_output_amounts;
   bool m_rf_txs;
@@ -114,8 +127,11 @@ typedef struct mdb_rflags
   bool m_rf_txpool_meta;
   bool m_rf_txpool_blob;
   bool m_rf_alt_blocks;
+  bool m_rf_pow_hashes;
   bool m_rf_hf_versions;
   bool m_rf_service_node_data;
+  bool m_rf_service_node_records;
+  bool m_rf_service_node_snapshots;
 
   bool m_rf_properties;
 } mdb_rflags;
@@ -219,6 +235,10 @@ public:
 
   virtual cryptonote::blobdata get_block_blob_from_height(const uint64_t& height) const;
 
+  virtual bool get_block_tx_hashes(const uint64_t& height, std::vector<crypto::hash>& tx_hashes) const;
+
+  virtual bool get_block_filter(const uint64_t& height, cryptonote::blobdata& filter) const;
+
   virtual std::vector<uint64_t> get_block_cumulative_rct_outputs(const std::vector<uint64_t> &heights) const;
 
   virtual uint64_t get_block_timestamp(const uint64_t& height) const;
@@ -235,6 +255,12 @@ public:
 
   virtual uint64_t get_block_already_generated_coins(const uint64_t& height) const;
 
+  virtual bool get_block_cumulative_emission(const uint64_t& height, block_emission_totals& totals) const;
+
+  virtual uint64_t get_emission_index_height() const;
+
+  virtual void set_block_cumulative_emission(const uint64_t& height, const block_emission_totals& totals);
+
   virtual uint64_t get_block_long_term_weight(const uint64_t& height) const;
 
   virtual std::vector<uint64_t> get_long_term_block_weights(uint64_t start_height, size_t count) const;
@@ -304,6 +330,11 @@ public:
   virtual uint64_t get_alt_block_count();
   virtual void drop_alt_blocks();
 
+  virtual void add_pow_hashes(const std::vector<std::pair<crypto::hash, crypto::hash>> &hashes, uint64_t max_entries);
+  virtual bool get_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const;
+  virtual uint64_t get_pow_hash_count() const;
+  virtual void drop_pow_hashes();
+
   virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata*)> f, bool include_blob = false, relay_category category = relay_category::broadcasted) const;
 
   virtual bool for_all_key_images(std::function<bool(const crypto::key_image&)>) const;
@@ -372,11 +403,14 @@ private:
                 , const difficulty_type& cumulative_difficulty
                 , const uint64_t& coins_generated
                 , uint64_t num_rct_outs
+                , const block_emission_totals& emission
                 , const crypto::hash& block_hash
                 );
 
   virtual void remove_block();
 
+  virtual void add_block_filter(const uint64_t& height, const cryptonote::blobdata& filter);
+
   virtual uint64_t add_transaction_data(const crypto::hash& blk_hash, const std::pair<transaction, blobdata>& tx, const crypto::hash& tx_hash, const crypto::hash& tx_prunable_hash);
 
   virtual void remove_transaction_data(const crypto::hash& tx_hash, const transaction& tx);
@@ -444,10 +478,21 @@ private:
   // migrate from DB version 4 to 5
   void migrate_4_5();
 
+  // migrate from DB version 5 to 6
+  void migrate_5_6();
+
   void cleanup_batch();
   virtual void set_service_node_data(const std::string& data);
   virtual bool get_service_node_data(std::string& data);
   virtual void clear_service_node_data();
+  virtual void set_service_node_record(service_node_record_type type, const std::string& key, const std::string& data);
+  virtual void remove_service_node_record(service_node_record_type type, const std::string& key);
+  virtual bool get_service_node_record(service_node_record_type type, const std::string& key, std::string& data) const;
+  virtual bool for_all_service_node_records(service_node_record_type type, std::function<bool(const std::string& key, const std::string& data)> f) const;
+  virtual void set_service_node_snapshot(uint64_t height, const std::string& data);
+  virtual bool get_service_node_snapshot(uint64_t max_height, uint64_t& height, std::string& data) const;
+  virtual std::vector<uint64_t> get_service_node_snapshot_heights() const;
+  virtual void remove_service_node_snapshot(uint64_t height);
 
 private:
   MDB_env* m_env;
@@ -455,6 +500,10 @@ private:
   MDB_dbi m_blocks;
   MDB_dbi m_block_heights;
   MDB_dbi m_block_info;
+  MDB_dbi m_block_tx_hashes;
+  bool m_has_block_tx_hashes; // the table may be missing from older databases opened read only
+  MDB_dbi m_block_filters;
+  bool m_has_block_filters; // likewise
 
   MDB_dbi m_txs;
   MDB_dbi m_txs_pruned;
@@ -474,9 +523,17 @@ private:
 
   MDB_dbi m_alt_blocks;
 
+  MDB_dbi m_pow_hashes;
+  MDB_dbi m_pow_hash_order;
+  bool m_has_pow_hashes; // the tables may be missing from older databases opened read only
+
   MDB_dbi m_hf_starting_heights;
   MDB_dbi m_hf_versions;
   MDB_dbi m_service_node_data;
+  MDB_dbi m_service_node_records;
+  bool m_has_service_node_records; // likewise
+  MDB_dbi m_service_node_snapshots;
+  bool m_has_service_node_snapshots; // likewise
 
   MDB_dbi m_properties;
 
@@ -67,6 +67,8 @@ public:
   virtual bool block_exists(const crypto::hash& h, uint64_t *height) const override { return false; }
   virtual cryptonote::blobdata get_block_blob_from_height(const uint64_t& height) const override { return cryptonote::t_serializable_object_to_blob(get_block_from_height(height)); }
   virtual cryptonote::blobdata get_block_blob(const crypto::hash& h) const override { return cryptonote::blobdata(); }
+  virtual bool get_block_tx_hashes(const uint64_t& height, std::vector<crypto::hash>& tx_hashes) const override { return false; }
+  virtual bool get_block_filter(const uint64_t& height, cryptonote::blobdata& filter) const override { return false; }
   virtual bool get_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override { return false; }
   virtual bool get_pruned_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override { return false; }
   virtual bool get_pruned_tx_blobs_from(const crypto::hash& h, size_t count, std::vector<cryptonote::blobdata> &bd) const { return false; }
@@ -83,6 +85,9 @@ public:
   virtual cryptonote::difficulty_type get_block_cumulative_difficulty(const uint64_t& height) const override { return 10; }
   virtual cryptonote::difficulty_type get_block_difficulty(const uint64_t& height) const override { return 0; }
   virtual uint64_t get_block_already_generated_coins(const uint64_t& height) const override { return 10000000000; }
+  virtual bool get_block_cumulative_emission(const uint64_t& height, cryptonote::block_emission_totals& totals) const override { return false; }
+  virtual uint64_t get_emission_index_height() const override { return 0; }
+  virtual void set_block_cumulative_emission(const uint64_t& height, const cryptonote::block_emission_totals& totals) override {}
   virtual uint64_t get_block_long_term_weight(const uint64_t& height) const override { return 128; }
   virtual std::vector<uint64_t> get_long_term_block_weights(uint64_t start_height, size_t count) const override { return {}; }
   virtual crypto::hash get_block_hash_from_height(const uint64_t& height) const override { return crypto::hash(); }
@@ -110,6 +115,7 @@ public:
   virtual std::vector<std::vector<uint64_t>> get_tx_amount_output_indices(const uint64_t tx_index, size_t n_txes) const override { return std::vector<std::vector<uint64_t>>(); }
   virtual bool has_key_image(const crypto::key_image& img) const override { return false; }
   virtual void remove_block() override { }
+  virtual void add_block_filter(const uint64_t& height, const cryptonote::blobdata& filter) override { }
   virtual uint64_t add_transaction_data(const crypto::hash& blk_hash, const std::pair<cryptonote::transaction, cryptonote::blobdata>& tx, const crypto::hash& tx_hash, const crypto::hash& tx_prunable_hash) override {return 0;}
   virtual void remove_transaction_data(const crypto::hash& tx_hash, const cryptonote::transaction& tx) override {}
   virtual uint64_t add_output(const crypto::hash& tx_hash, const cryptonote::tx_out& tx_output, const uint64_t& local_index, const uint64_t unlock_time, const rct::key *commitment) override {return 0;}
@@ -143,6 +149,7 @@ public:
                         , const cryptonote::difficulty_type& cumulative_difficulty
                         , const uint64_t& coins_generated
                         , uint64_t num_rct_outs
+                        , const cryptonote::block_emission_totals& emission
                         , const crypto::hash& blk_hash
                         ) override { }
   virtual cryptonote::block get_block_from_height(const uint64_t& height) const override { return cryptonote::block(); }
@@ -164,7 +171,23 @@ public:
   virtual void remove_alt_block(const crypto::hash &blkid) override {}
   virtual uint64_t get_alt_block_count() override { return 0; }
   virtual void drop_alt_blocks() override {}
+  virtual void add_pow_hashes(const std::vector<std::pair<crypto::hash, crypto::hash>> &hashes, uint64_t max_entries) override {}
+  virtual bool get_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const override { return false; }
+  virtual uint64_t get_pow_hash_count() const override { return 0; }
+  virtual void drop_pow_hashes() override {}
   virtual bool for_all_alt_blocks(std::function<bool(const crypto::hash &blkid, const alt_block_data_t &data, const cryptonote::blobdata *blob)> f, bool include_blob = false) const override { return true; }
+
+  virtual void set_service_node_data(const std::string& data) override {}
+  virtual bool get_service_node_data(std::string& data) override { return false; }
+  virtual void clear_service_node_data() override {}
+  virtual void set_service_node_record(service_node_record_type type, const std::string& key, const std::string& data) override {}
+  virtual void remove_service_node_record(service_node_record_type type, const std::string& key) override {}
+  virtual bool get_service_node_record(service_node_record_type type, const std::string& key, std::string& data) const override { return false; }
+  virtual bool for_all_service_node_records(service_node_record_type type, std::function<bool(const std::string& key, const std::string& data)> f) const override { return true; }
+  virtual void set_service_node_snapshot(uint64_t height, const std::string& data) override {}
+  virtual bool get_service_node_snapshot(uint64_t max_height, uint64_t& height, std::string& data) const override { return false; }
+  virtual std::vector<uint64_t> get_service_node_snapshot_heights() const override { return std::vector<uint64_t>(); }
+  virtual void remove_service_node_snapshot(uint64_t height) override {}
 };
 
 }
@@ -0,0 +1,254 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "common/command_line.h"
+#include "common/threadpool.h"
+#include "cryptonote_core/tx_pool.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "cryptonote_core/blockchain.h"
+#include "blockchain_db/blockchain_db.h"
+#include "version.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
+
+namespace po = boost::program_options;
+using namespace epee;
+using namespace cryptonote;
+
+namespace
+{
+  // blocks read, hashed and written to the cache per round
+  constexpr uint64_t CHUNK_SIZE = 1024;
+
+  // hashes blobs[begin, end) with the given contexts, several at a time where the CPU allows it
+  void hash_range(std::vector<cn_gpu_hash> &ctxes, const std::vector<block> &blocks, const std::vector<blobdata> &blobs,
+      size_t begin, size_t end, std::vector<crypto::hash> &pows)
+  {
+    cn_gpu_hash *ctx[cn_gpu_hash::MULTI_WAYS];
+    const void *in[cn_gpu_hash::MULTI_WAYS];
+    size_t len[cn_gpu_hash::MULTI_WAYS];
+    void *out[cn_gpu_hash::MULTI_WAYS];
+    size_t queued = 0;
+
+    const auto flush = [&]() {
+      cn_gpu_hash::hash_multi(ctx, in, len, out, queued);
+      queued = 0;
+    };
+
+    for (size_t i = begin; i < end; ++i)
+    {
+      if (ctxes.size() < 2 || blocks[i].major_version < 6)
+      {
+        get_block_longhash(blocks[i], pows[i], ctxes[0]);
+        continue;
+      }
+      ctx[queued] = &ctxes[queued];
+      in[queued] = blobs[i].data();
+      len[queued] = blobs[i].size();
+      out[queued] = pows[i].data;
+      if (++queued == ctxes.size())
+        flush();
+    }
+    if (queued)
+      flush();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  TRY_ENTRY();
+
+  epee::string_tools::set_module_name_and_folder(argv[0]);
+
+  uint32_t log_level = 0;
+
+  tools::on_startup();
+
+  po::options_description desc_cmd_only("Command line options");
+  po::options_description desc_cmd_sett("Command line options and settings options");
+  const command_line::arg_descriptor<std::string> arg_log_level  = {"log-level",  "0-4 or categories", ""};
+  const command_line::arg_descriptor<uint64_t> arg_block_start  = {"block-start", "Start at block number (default: as many blocks below the top as the cache holds)", 0};
+  const command_line::arg_descriptor<uint64_t> arg_block_stop  = {"block-stop", "Stop at block number (default: the top block)", 0};
+  const command_line::arg_descriptor<uint64_t> arg_max_entries  = {"max-entries", "Size bound of the PoW hash cache", POW_HASH_CACHE_MAX_ENTRIES};
+
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_stagenet_on);
+  command_line::add_arg(desc_cmd_sett, arg_log_level);
+  command_line::add_arg(desc_cmd_sett, arg_block_start);
+  command_line::add_arg(desc_cmd_sett, arg_block_stop);
+  command_line::add_arg(desc_cmd_sett, arg_max_entries);
+  command_line::add_arg(desc_cmd_only, command_line::arg_help);
+
+  po::options_description desc_options("Allowed options");
+  desc_options.add(desc_cmd_only).add(desc_cmd_sett);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_options, [&]()
+  {
+    auto parser = po::command_line_parser(argc, argv).options(desc_options);
+    po::store(parser.run(), vm);
+    po::notify(vm);
+    return true;
+  });
+  if (! r)
+    return 1;
+
+  if (command_line::get_arg(vm, command_line::arg_help))
+  {
+    std::cout << "Equilibria '" << MONERO_RELEASE_NAME << "' (v" << MONERO_VERSION_FULL << ")" << ENDL << ENDL;
+    std::cout << desc_options << std::endl;
+    return 1;
+  }
+
+  mlog_configure(mlog_get_default_log_path("equilibria-blockchain-precompute-pow.log"), true);
+  if (!command_line::is_arg_defaulted(vm, arg_log_level))
+    mlog_set_log(command_line::get_arg(vm, arg_log_level).c_str());
+  else
+    mlog_set_log(std::string(std::to_string(log_level) + ",bcutil:INFO").c_str());
+
+  LOG_PRINT_L0("Starting...");
+
+  std::string opt_data_dir = command_line::get_arg(vm, cryptonote::arg_data_dir);
+  bool opt_testnet = command_line::get_arg(vm, cryptonote::arg_testnet_on);
+  bool opt_stagenet = command_line::get_arg(vm, cryptonote::arg_stagenet_on);
+  network_type net_type = opt_testnet ? TESTNET : opt_stagenet ? STAGENET : MAINNET;
+  const uint64_t max_entries = command_line::get_arg(vm, arg_max_entries);
+
+  LOG_PRINT_L0("Initializing source blockchain (BlockchainDB)");
+  // This is done this way because of the circular constructors.
+  struct BlockchainObjects
+  {
+    Blockchain m_blockchain;
+    tx_memory_pool m_mempool;
+    service_nodes::service_node_list m_service_node_list;
+    triton::deregister_vote_pool m_deregister_vote_pool;
+    BlockchainObjects() :
+      m_blockchain(m_mempool, m_service_node_list, m_deregister_vote_pool),
+      m_service_node_list(m_blockchain),
+      m_mempool(m_blockchain) { }
+  };
+
+  BlockchainObjects *blockchain_objects = new BlockchainObjects();
+  Blockchain *core_storage = &blockchain_objects->m_blockchain;
+  BlockchainDB *db = new_db();
+  if (db == NULL)
+  {
+    LOG_ERROR("Attempted to use non-existent database type: LMDB");
+    throw std::runtime_error("Attempting to use non-existent database type");
+  }
+  LOG_PRINT_L0("database: LMDB");
+
+  const std::string filename = (boost::filesystem::path(opt_data_dir) / db->get_db_name()).string();
+  LOG_PRINT_L0("Loading blockchain from folder " << filename << " ...");
+
+  try
+  {
+    db->open(filename, 0);
+  }
+  catch (const std::exception& e)
+  {
+    LOG_PRINT_L0("Error opening database: " << e.what());
+    return 1;
+  }
+  r = core_storage->init(db, net_type);
+
+  CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize source blockchain storage");
+  LOG_PRINT_L0("Source blockchain storage initialized OK");
+
+  const uint64_t db_height = db->height();
+  uint64_t block_stop = command_line::get_arg(vm, arg_block_stop);
+  if (command_line::is_arg_defaulted(vm, arg_block_stop) || block_stop >= db_height)
+    block_stop = db_height - 1;
+  uint64_t block_start = command_line::get_arg(vm, arg_block_start);
+  if (command_line::is_arg_defaulted(vm, arg_block_start))
+    block_start = block_stop + 1 > max_entries ? block_stop + 1 - max_entries : 0;
+  if (block_start > block_stop)
+  {
+    std::cerr << "block-start is above block-stop" << std::endl;
+    return 1;
+  }
+  if (block_stop - block_start + 1 > max_entries)
+    MWARNING("Only the top " << max_entries << " blocks of the range will stay in the cache");
+
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  const size_t threads = std::max<size_t>(tpool.get_max_concurrency(), 1);
+  const size_t ways = cn_gpu_hash::multi_ways();
+  std::vector<std::vector<cn_gpu_hash>> ctxes(threads);
+  for (auto &c : ctxes)
+    c.resize(ways);
+
+  LOG_PRINT_L0("Hashing blocks " << block_start << " to " << block_stop << " on " << threads << " threads, " << ways << " at a time each");
+  uint64_t hashed = 0, skipped = 0;
+  for (uint64_t height = block_start; height <= block_stop; height += CHUNK_SIZE)
+  {
+    const uint64_t chunk_end = std::min(block_stop + 1, height + CHUNK_SIZE);
+    std::vector<block> blocks;
+    std::vector<blobdata> blobs;
+    std::vector<crypto::hash> ids;
+    for (uint64_t h = height; h < chunk_end; ++h)
+    {
+      block b = db->get_block_from_height(h);
+      const crypto::hash id = get_block_hash(b);
+      crypto::hash pow;
+      if (db->get_pow_hash(id, pow))
+      {
+        ++skipped;
+        continue;
+      }
+      blobs.push_back(get_block_hashing_blob(b));
+      ids.push_back(id);
+      blocks.push_back(std::move(b));
+    }
+
+    std::vector<crypto::hash> pows(blocks.size());
+    const size_t per_thread = (blocks.size() + threads - 1) / threads;
+    tools::threadpool::waiter waiter;
+    for (size_t t = 0; t < threads && t * per_thread < blocks.size(); ++t)
+    {
+      const size_t begin = t * per_thread, end = std::min(blocks.size(), begin + per_thread);
+      tpool.submit(&waiter, [&, t, begin, end]() { hash_range(ctxes[t], blocks, blobs, begin, end, pows); });
+    }
+    waiter.wait(&tpool);
+
+    std::vector<std::pair<crypto::hash, crypto::hash>> hashes;
+    hashes.reserve(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i)
+      hashes.emplace_back(ids[i], pows[i]);
+    db->add_pow_hashes(hashes, max_entries);
+    hashed += hashes.size();
+    LOG_PRINT_L0("Up to block " << chunk_end - 1 << ": " << hashed << " hashed, " << skipped << " already cached");
+  }
+
+  LOG_PRINT_L0("PoW hash cache now holds " << db->get_pow_hash_count() << " hashes");
+  core_storage->deinit();
+  return 0;
+
+  CATCH_ENTRY("PoW precompute error", 1);
+}
@@ -146,6 +146,19 @@ static bool resize_point(size_t nrecords, MDB_env *env, MDB_txn **txn, size_t &b
   return true;
 }
 
+// tables newer than the source database are absent when it is opened read only
+static bool has_table(MDB_env *env, const char *table, unsigned int flags)
+{
+  MDB_txn *txn;
+  MDB_dbi dbi;
+  int dbr = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+  if (dbr) throw std::runtime_error("Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+  dbr = mdb_dbi_open(txn, table, flags, &dbi);
+  mdb_txn_abort(txn);
+  if (dbr && dbr != MDB_NOTFOUND) throw std::runtime_error("Failed to open LMDB dbi: " + std::string(mdb_strerror(dbr)));
+  return dbr == 0;
+}
+
 static void copy_table(MDB_env *env0, MDB_env *env1, const char *table, unsigned int flags, unsigned int putflags, int (*cmp)(const MDB_val*, const MDB_val*)=0)
 {
   MDB_dbi dbi0, dbi1;
@@ -613,6 +626,10 @@ int main(int argc, char* argv[])
   copy_table(env0, env1, "blocks", MDB_INTEGERKEY, MDB_APPEND);
   copy_table(env0, env1, "block_info", MDB_INTEGERKEY | MDB_DUPSORT| MDB_DUPFIXED, MDB_APPENDDUP, BlockchainLMDB::compare_uint64);
   copy_table(env0, env1, "block_heights", MDB_INTEGERKEY | MDB_DUPSORT| MDB_DUPFIXED, 0, BlockchainLMDB::compare_hash32);
+  if (has_table(env0, "block_tx_hashes", MDB_INTEGERKEY))
+    copy_table(env0, env1, "block_tx_hashes", MDB_INTEGERKEY, MDB_APPEND, BlockchainLMDB::compare_uint64);
+  if (has_table(env0, "block_filters", MDB_INTEGERKEY))
+    copy_table(env0, env1, "block_filters", MDB_INTEGERKEY, MDB_APPEND, BlockchainLMDB::compare_uint64);
   //copy_table(env0, env1, "txs", MDB_INTEGERKEY);
   copy_table(env0, env1, "txs_pruned", MDB_INTEGERKEY, MDB_APPEND);
   copy_table(env0, env1, "txs_prunable_hash", MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED, MDB_APPEND);
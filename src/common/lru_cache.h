@@ -0,0 +1,197 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace tools
+{
+  /**
+   * @brief a size bounded key/value cache, evicting least recently used entries
+   *
+   * Keys are spread over independently locked shards, each holding an equal
+   * share of the capacity, so concurrent users rarely contend.
+   */
+  template<typename K, typename V, typename Hash = std::hash<K>>
+  class lru_cache
+  {
+  public:
+    struct stats
+    {
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t evictions;
+      uint64_t size;
+    };
+
+    lru_cache(size_t capacity, size_t num_shards = 16): m_hits(0), m_misses(0), m_evictions(0)
+    {
+      if (num_shards == 0)
+        num_shards = 1;
+      const size_t shard_capacity = std::max<size_t>(1, (capacity + num_shards - 1) / num_shards);
+      m_shards.reserve(num_shards);
+      for (size_t n = 0; n < num_shards; ++n)
+        m_shards.emplace_back(new shard(shard_capacity));
+    }
+
+    /**
+     * @brief look up a key, marking it as recently used
+     *
+     * @return true and a copy of the value in value if found
+     */
+    bool get(const K &key, V &value)
+    {
+      return get(key, value, nullptr);
+    }
+
+    /**
+     * @brief look up a key, letting the caller revalidate the entry in place first
+     *
+     * @param still_valid called on the stored value under the shard lock; returning false drops
+     * the entry and the lookup counts as a miss
+     */
+    bool get(const K &key, V &value, const std::function<bool(V&)> &still_valid)
+    {
+      shard &s = get_shard(key);
+      boost::lock_guard<boost::mutex> lock(s.lock);
+      const auto i = s.index.find(key);
+      if (i == s.index.end())
+      {
+        ++m_misses;
+        return false;
+      }
+      if (still_valid && !still_valid(i->second->second))
+      {
+        s.entries.erase(i->second);
+        s.index.erase(i);
+        ++m_misses;
+        return false;
+      }
+      s.entries.splice(s.entries.begin(), s.entries, i->second);
+      value = i->second->second;
+      ++m_hits;
+      return true;
+    }
+
+    /**
+     * @brief insert or replace a value, evicting the least recently used entry of its shard if full
+     */
+    void put(const K &key, V value)
+    {
+      shard &s = get_shard(key);
+      boost::lock_guard<boost::mutex> lock(s.lock);
+      const auto i = s.index.find(key);
+      if (i != s.index.end())
+      {
+        i->second->second = std::move(value);
+        s.entries.splice(s.entries.begin(), s.entries, i->second);
+        return;
+      }
+      if (s.index.size() >= s.capacity)
+      {
+        s.index.erase(s.entries.back().first);
+        s.entries.pop_back();
+        ++m_evictions;
+      }
+      s.entries.emplace_front(key, std::move(value));
+      s.index.emplace(key, s.entries.begin());
+    }
+
+    void erase(const K &key)
+    {
+      shard &s = get_shard(key);
+      boost::lock_guard<boost::mutex> lock(s.lock);
+      const auto i = s.index.find(key);
+      if (i == s.index.end())
+        return;
+      s.entries.erase(i->second);
+      s.index.erase(i);
+    }
+
+    void clear()
+    {
+      for (auto &s: m_shards)
+      {
+        boost::lock_guard<boost::mutex> lock(s->lock);
+        s->index.clear();
+        s->entries.clear();
+      }
+    }
+
+    size_t size() const
+    {
+      size_t total = 0;
+      for (const auto &s: m_shards)
+      {
+        boost::lock_guard<boost::mutex> lock(s->lock);
+        total += s->index.size();
+      }
+      return total;
+    }
+
+    stats get_stats() const
+    {
+      return {m_hits, m_misses, m_evictions, size()};
+    }
+
+  private:
+    struct shard
+    {
+      explicit shard(size_t capacity): capacity(capacity) {}
+
+      mutable boost::mutex lock;
+      size_t capacity;
+      std::list<std::pair<K, V>> entries; //!< most recently used first
+      std::unordered_map<K, typename std::list<std::pair<K, V>>::iterator, Hash> index;
+    };
+
+    shard &get_shard(const K &key)
+    {
+      // mix the hash so the shard choice doesn't line up with bucket choice inside the shard
+      const uint64_t h = Hash()(key) * 0x9e3779b97f4a7c15ull;
+      return *m_shards[(h >> 32) % m_shards.size()];
+    }
+
+    std::vector<std::unique_ptr<shard>> m_shards;
+    std::atomic<uint64_t> m_hits;
+    std::atomic<uint64_t> m_misses;
+    std::atomic<uint64_t> m_evictions;
+  };
+}
@@ -2207,6 +2207,39 @@ void ge_mul8(ge_p1p1 *r, const ge_p2 *t) {
   ge_p2_dbl(r, &u);
 }
 
+/* Like ge_tobytes on each of h[0..n-1], writing 32 bytes per point to s, but
+   with a single field inversion for all of them (Montgomery's trick). tmp
+   must hold n field elements. No Z may be zero, which holds for any point. */
+void ge_tobytes_batch(unsigned char *s, const ge_p2 *h, fe *tmp, size_t n) {
+  fe inv;
+  fe recip;
+  fe x;
+  fe y;
+  size_t i;
+
+  if (n == 0) {
+    return;
+  }
+  fe_copy(tmp[0], h[0].Z);
+  for (i = 1; i < n; i++) {
+    fe_mul(tmp[i], tmp[i - 1], h[i].Z);
+  }
+  fe_invert(inv, tmp[n - 1]);
+  for (i = n - 1; i > 0; i--) {
+    /* inv is 1 / (Z0 * ... * Zi) here */
+    fe_mul(recip, inv, tmp[i - 1]);
+    fe_mul(inv, inv, h[i].Z);
+    fe_mul(x, h[i].X, recip);
+    fe_mul(y, h[i].Y, recip);
+    fe_tobytes(s + 32 * i, y);
+    s[32 * i + 31] ^= fe_isnegative(x) << 7;
+  }
+  fe_mul(x, h[0].X, inv);
+  fe_mul(y, h[0].Y, inv);
+  fe_tobytes(s, y);
+  s[31] ^= fe_isnegative(x) << 7;
+}
+
 void ge_fromfe_frombytes_vartime(ge_p2 *r, const unsigned char *s) {
   fe u, v, w, x, y, z;
   unsigned char sign;
@@ -30,6 +30,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 /* From fe.h */
 
 typedef int32_t fe[10];
@@ -133,6 +135,7 @@ void ge_double_scalarmult_precomp_vartime(ge_p2 *, const unsigned char *, const
 void ge_double_scalarmult_precomp_vartime2(ge_p2 *, const unsigned char *, const ge_dsmp, const unsigned char *, const ge_dsmp);
 void ge_double_scalarmult_precomp_vartime2_p3(ge_p3 *, const unsigned char *, const ge_dsmp, const unsigned char *, const ge_dsmp);
 void ge_mul8(ge_p1p1 *, const ge_p2 *);
+void ge_tobytes_batch(unsigned char *, const ge_p2 *, fe *, size_t);
 extern const fe fe_ma2;
 extern const fe fe_ma;
 extern const fe fe_fffb1;
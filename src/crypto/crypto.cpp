@@ -34,6 +34,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include <boost/shared_ptr.hpp>
@@ -255,6 +256,59 @@ namespace crypto {
     return true;
   }
 
+  void crypto_ops::generate_key_derivations(const std::vector<public_key> &keys, const secret_key &key2, std::vector<key_derivation> &derivations, std::vector<bool> &valid) {
+    const size_t n = keys.size();
+    std::vector<ge_p2> points(n);
+    std::unique_ptr<fe[]> tmp(new fe[n]);
+    assert(sc_check(&key2) == 0);
+    valid.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      ge_p3 point;
+      ge_p1p1 point3;
+      valid[i] = ge_frombytes_vartime(&point, &keys[i]) == 0;
+      if (!valid[i]) {
+        ge_p3_to_p2(&points[i], &ge_p3_identity);
+        continue;
+      }
+      ge_scalarmult(&points[i], &unwrap(key2), &point);
+      ge_mul8(&point3, &points[i]);
+      ge_p1p1_to_p2(&points[i], &point3);
+    }
+    derivations.resize(n);
+    ge_tobytes_batch(reinterpret_cast<unsigned char*>(derivations.data()), points.data(), tmp.get(), n);
+  }
+
+  void crypto_ops::derive_subaddress_public_keys(const std::vector<public_key> &out_keys, const std::vector<key_derivation> &derivations, const std::vector<std::size_t> &output_indices, std::vector<public_key> &derived_keys, std::vector<bool> &valid) {
+    const size_t n = out_keys.size();
+    std::vector<ge_p2> points(n);
+    std::unique_ptr<fe[]> tmp(new fe[n]);
+    ge_p3 point1;
+    bool point1_valid = false;
+    assert(derivations.size() == n && output_indices.size() == n);
+    valid.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      ec_scalar scalar;
+      ge_p3 point2;
+      ge_cached point3;
+      ge_p1p1 point4;
+      if (i == 0 || out_keys[i] != out_keys[i - 1]) {
+        point1_valid = ge_frombytes_vartime(&point1, &out_keys[i]) == 0;
+      }
+      valid[i] = point1_valid;
+      if (!valid[i]) {
+        ge_p3_to_p2(&points[i], &ge_p3_identity);
+        continue;
+      }
+      derivation_to_scalar(derivations[i], output_indices[i], scalar);
+      ge_scalarmult_base(&point2, &scalar);
+      ge_p3_to_cached(&point3, &point2);
+      ge_sub(&point4, &point1, &point3);
+      ge_p1p1_to_p2(&points[i], &point4);
+    }
+    derived_keys.resize(n);
+    ge_tobytes_batch(reinterpret_cast<unsigned char*>(derived_keys.data()), points.data(), tmp.get(), n);
+  }
+
   struct s_comm {
     hash h;
     ec_point key;
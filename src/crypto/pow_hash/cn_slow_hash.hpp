@@ -87,6 +87,37 @@ inline bool check_avx2()
 	const bool osxsave = (cpu_info[2] & (1 << 27)) != 0;
 	return has_avx2 && osxsave;
 }
+
+inline bool check_avx512_vaes_uncached()
+{
+	int32_t cpu_info[4];
+	cpuid(1, 0, cpu_info);
+	if((cpu_info[2] & (1 << 27)) == 0) // osxsave
+		return false;
+
+#if defined(HAS_WIN_INTRIN_API)
+	const uint64_t xcr0 = _xgetbv(0);
+#else
+	uint32_t xcr0_lo, xcr0_hi;
+	__asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+	const uint64_t xcr0 = xcr0_lo;
+#endif
+	// The OS has to save the xmm, ymm, opmask and both zmm register states
+	if((xcr0 & 0xE6) != 0xE6)
+		return false;
+
+	cpuid(7, 0, cpu_info);
+	const bool has_avx512f = (cpu_info[1] & (1 << 16)) != 0;
+	const bool has_avx512bw = (cpu_info[1] & (1 << 30)) != 0;
+	const bool has_vaes = (cpu_info[2] & (1 << 9)) != 0;
+	return has_avx512f && has_avx512bw && has_vaes;
+}
+
+inline bool check_avx512_vaes()
+{
+	static const bool has_avx512_vaes = check_avx512_vaes_uncached();
+	return has_avx512_vaes;
+}
 #endif
 
 #ifdef HAS_ARM_HW
@@ -103,6 +134,41 @@ inline bool hw_check_aes()
 }
 #endif
 
+// Scratchpads are backed by huge pages where the system allows it, which takes most of the
+// TLB misses out of the random scratchpad accesses. Every mode falls back to the next smaller
+// page size, down to plain aligned allocations, when the pages can't be had.
+enum cn_pad_mode : uint8_t
+{
+	CN_PAD_MODE_OFF, // plain aligned allocations
+	CN_PAD_MODE_2MB, // 2 MB huge pages, then transparent huge pages
+	CN_PAD_MODE_1GB  // 2 MB slots carved out of shared 1 GB pages, then as CN_PAD_MODE_2MB
+};
+
+enum cn_pad_kind : uint8_t
+{
+	CN_PAD_ALIGNED,
+	CN_PAD_TRANSPARENT,
+	CN_PAD_HUGE_2MB,
+	CN_PAD_HUGE_1GB,
+	CN_PAD_LARGE_WIN,
+	CN_PAD_KINDS
+};
+
+struct cn_pad_stats
+{
+	uint64_t pads[CN_PAD_KINDS]; // live scratchpads by backing
+	uint32_t numa_nodes;
+	uint64_t numa_moves; // scratchpads moved after their thread changed node
+};
+
+void cn_pad_set_mode(cn_pad_mode mode);
+cn_pad_mode cn_pad_get_mode();
+void* cn_pad_alloc(size_t size, cn_pad_kind& kind);
+void cn_pad_free(void* ptr, size_t size, cn_pad_kind kind);
+// Moves the scratchpad to the NUMA node of the calling thread, node caches where it was last bound
+void cn_pad_bind_node(void* ptr, size_t size, cn_pad_kind kind, int32_t& node);
+cn_pad_stats cn_pad_get_stats();
+
 // This cruft avoids casting-galore and allows us not to worry about sizeof(void*)
 class cn_sptr
 {
@@ -142,13 +208,14 @@ template <size_t MEMORY, size_t ITER, size_t VERSION>
 class cn_slow_hash
 {
   public:
-	cn_slow_hash() : borrowed_pad(false)
+	cn_slow_hash() : borrowed_pad(false), lpad_node(-1)
 	{
-		lpad.set(boost::alignment::aligned_alloc(4096, MEMORY));
+		lpad.set(cn_pad_alloc(MEMORY, lpad_kind));
 		spad.set(boost::alignment::aligned_alloc(4096, 4096));
 	}
 
-	cn_slow_hash(cn_slow_hash&& other) noexcept : lpad(other.lpad.as_byte()), spad(other.spad.as_byte()), borrowed_pad(other.borrowed_pad)
+	cn_slow_hash(cn_slow_hash&& other) noexcept : lpad(other.lpad.as_byte()), spad(other.spad.as_byte()), borrowed_pad(other.borrowed_pad),
+		lpad_kind(other.lpad_kind), lpad_node(other.lpad_node)
 	{
 		other.lpad.set(nullptr);
 		other.spad.set(nullptr);
@@ -176,6 +243,10 @@ class cn_slow_hash
 		lpad.set(other.lpad.as_void());
 		spad.set(other.spad.as_void());
 		borrowed_pad = other.borrowed_pad;
+		lpad_kind = other.lpad_kind;
+		lpad_node = other.lpad_node;
+		other.lpad.set(nullptr);
+		other.spad.set(nullptr);
 		return *this;
 	}
 
@@ -190,6 +261,7 @@ class cn_slow_hash
 
 	void hash(const void* in, size_t len, void* out)
 	{
+		bind_pad();
 		if(VERSION <= 1)
 		{
 			if(hw_check_aes() && !check_override())
@@ -206,6 +278,38 @@ class cn_slow_hash
 		}
 	}
 
+	// Number of hashes the interleaved path computes side by side
+	static constexpr size_t MULTI_WAYS = 4;
+
+	// Number of contexts hash_multi can put to use on this CPU
+	static size_t multi_ways()
+	{
+#ifdef HAS_INTEL_HW
+		if(VERSION == 2 && hw_check_aes() && check_avx512_vaes())
+			return MULTI_WAYS;
+#endif
+		return 1;
+	}
+
+	// Hashes n <= MULTI_WAYS independent inputs, ctx[i] being used as the scratchpad for in[i].
+	// Gives the same result as ctx[i]->hash(in[i], len[i], out[i]) for every i, but interleaves
+	// the hashes where the CPU allows it so that the memory latency of one hides behind the others.
+	static void hash_multi(cn_slow_hash* const* ctx, const void* const* in, const size_t* len, void* const* out, size_t n)
+	{
+		assert(n <= MULTI_WAYS);
+#ifdef HAS_INTEL_HW
+		if(VERSION == 2 && n > 1 && hw_check_aes() && check_avx512_vaes() && !ctx[0]->check_override())
+		{
+			for(size_t i = 0; i < n; i++)
+				ctx[i]->bind_pad();
+			hardware_hash_3_multi(ctx, in, len, out, n);
+			return;
+		}
+#endif
+		for(size_t i = 0; i < n; i++)
+			ctx[i]->hash(in[i], len[i], out[i]);
+	}
+
 	void software_hash(const void* in, size_t len, void* out);
 	void software_hash_3(const void* in, size_t len, void* pout);
 
@@ -233,6 +337,14 @@ private:
 		lpad.set(lptr);
 		spad.set(sptr);
 		borrowed_pad = true;
+		lpad_kind = CN_PAD_ALIGNED;
+		lpad_node = -1;
+	}
+
+	inline void bind_pad()
+	{
+		if(!borrowed_pad)
+			cn_pad_bind_node(lpad.as_void(), MEMORY, lpad_kind, lpad_node);
 	}
 
 	inline bool check_override()
@@ -257,8 +369,8 @@ private:
 		if(!borrowed_pad)
 		{
 			if(lpad.as_void() != nullptr)
-				boost::alignment::aligned_free(lpad.as_void());
-			if(lpad.as_void() != nullptr)
+				cn_pad_free(lpad.as_void(), MEMORY, lpad_kind);
+			if(spad.as_void() != nullptr)
 				boost::alignment::aligned_free(spad.as_void());
 		}
 
@@ -287,9 +399,17 @@ private:
 	void inner_hash_3();
 	void inner_hash_3_avx();
 
+#ifdef HAS_INTEL_HW
+	static void hardware_hash_3_multi(cn_slow_hash* const* ctx, const void* const* in, const size_t* len, void* const* out, size_t n);
+	static void inner_hash_3_avx512_x2(cn_slow_hash& a, cn_slow_hash& b);
+	static void implode_scratchpad_vaes_x4(cn_slow_hash* const* ctx, size_t n);
+#endif
+
 	cn_sptr lpad;
 	cn_sptr spad;
 	bool borrowed_pad;
+	cn_pad_kind lpad_kind;
+	int32_t lpad_node;
 };
 
 extern template class cn_v1_hash_t;
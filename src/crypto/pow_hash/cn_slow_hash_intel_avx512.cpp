@@ -0,0 +1,439 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#define CN_ADD_TARGETS_AND_HEADERS
+#define INTEL_AVX512
+
+#include "../keccak.h"
+#include "aux_hash.h"
+#include "cn_slow_hash.hpp"
+
+#ifdef HAS_INTEL_HW
+
+// Two cn-gpu hashes are packed into one zmm register, hash a in the low 256 bits and hash b in the
+// high 256 bits. Every 256 bit half goes through exactly the same operations as in inner_hash_3_avx,
+// so the float results are bit for bit identical. This file must be compiled without fp contraction.
+namespace
+{
+inline __m512 set1_ps_epi32_x2(uint32_t x)
+{
+	return _mm512_castsi512_ps(_mm512_set1_epi32(x));
+}
+
+inline __m512 and_ps_x2(const __m512& a, const __m512& b)
+{
+	return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+}
+
+inline __m512 or_ps_x2(const __m512& a, const __m512& b)
+{
+	return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+}
+
+inline void prep_dv_x2(cn_sptr& idxa, cn_sptr& idxb, __m512i& v, __m512& n)
+{
+	v = _mm512_inserti64x4(_mm512_castsi256_si512(_mm256_load_si256(idxa.as_ptr<__m256i>())),
+		_mm256_load_si256(idxb.as_ptr<__m256i>()), 1);
+	n = _mm512_cvtepi32_ps(v);
+}
+
+inline void store_dv_x2(cn_sptr& idxa, cn_sptr& idxb, const __m512i& v)
+{
+	_mm256_store_si256(idxa.as_ptr<__m256i>(), _mm512_castsi512_si256(v));
+	_mm256_store_si256(idxb.as_ptr<__m256i>(), _mm512_extracti64x4_epi64(v, 1));
+}
+
+// Selects 128 bit lanes within each hash, the _mm256_permute2f128_ps equivalents of both hashes at once
+#define CN_LANES_X2(a, b) _MM_SHUFFLE(2 + (b), 2 + (a), (b), (a))
+
+inline __m512 fma_break_x2(const __m512& x)
+{
+	// Break the dependency chain by setitng the exp to ?????01
+	__m512 xx = and_ps_x2(set1_ps_epi32_x2(0xFEFFFFFF), x);
+	return or_ps_x2(set1_ps_epi32_x2(0x00800000), xx);
+}
+
+inline void sub_round_x2(const __m512& n0, const __m512& n1, const __m512& n2, const __m512& n3, const __m512& rnd_c, __m512& n, __m512& d, __m512& c)
+{
+	__m512 nn = _mm512_mul_ps(n0, c);
+	nn = _mm512_mul_ps(_mm512_add_ps(n1, c), _mm512_mul_ps(nn, nn));
+	nn = fma_break_x2(nn);
+	n = _mm512_add_ps(n, nn);
+
+	__m512 dd = _mm512_mul_ps(n2, c);
+	dd = _mm512_mul_ps(_mm512_sub_ps(n3, c), _mm512_mul_ps(dd, dd));
+	dd = fma_break_x2(dd);
+	d = _mm512_add_ps(d, dd);
+
+	//Constant feedback
+	c = _mm512_add_ps(c, rnd_c);
+	c = _mm512_add_ps(c, _mm512_set1_ps(0.734375f));
+	__m512 r = _mm512_add_ps(nn, dd);
+	r = and_ps_x2(set1_ps_epi32_x2(0x807FFFFF), r);
+	r = or_ps_x2(set1_ps_epi32_x2(0x40000000), r);
+	c = _mm512_add_ps(c, r);
+}
+
+inline void round_compute_x2(const __m512& n0, const __m512& n1, const __m512& n2, const __m512& n3, const __m512& rnd_c, __m512& c, __m512& r)
+{
+	__m512 n = _mm512_setzero_ps(), d = _mm512_setzero_ps();
+
+	sub_round_x2(n0, n1, n2, n3, rnd_c, n, d, c);
+	sub_round_x2(n1, n2, n3, n0, rnd_c, n, d, c);
+	sub_round_x2(n2, n3, n0, n1, rnd_c, n, d, c);
+	sub_round_x2(n3, n0, n1, n2, rnd_c, n, d, c);
+	sub_round_x2(n3, n2, n1, n0, rnd_c, n, d, c);
+	sub_round_x2(n2, n1, n0, n3, rnd_c, n, d, c);
+	sub_round_x2(n1, n0, n3, n2, rnd_c, n, d, c);
+	sub_round_x2(n0, n3, n2, n1, rnd_c, n, d, c);
+
+	// Make sure abs(d) > 2.0 - this prevents division by zero and accidental overflows by division by < 1.0
+	d = and_ps_x2(set1_ps_epi32_x2(0xFF7FFFFF), d);
+	d = or_ps_x2(set1_ps_epi32_x2(0x40000000), d);
+	r = _mm512_add_ps(r, _mm512_div_ps(n, d));
+}
+
+template <bool add>
+inline __m512i double_comupte_x2(const __m512& n0, const __m512& n1, const __m512& n2, const __m512& n3,
+								 float lcnt, float hcnt, const __m512& rnd_c, __m512& sum)
+{
+	__m512 c = _mm512_setr_ps(lcnt, lcnt, lcnt, lcnt, hcnt, hcnt, hcnt, hcnt, lcnt, lcnt, lcnt, lcnt, hcnt, hcnt, hcnt, hcnt);
+	__m512 r = _mm512_setzero_ps();
+
+	round_compute_x2(n0, n1, n2, n3, rnd_c, c, r);
+	round_compute_x2(n0, n1, n2, n3, rnd_c, c, r);
+	round_compute_x2(n0, n1, n2, n3, rnd_c, c, r);
+	round_compute_x2(n0, n1, n2, n3, rnd_c, c, r);
+
+	// do a quick fmod by setting exp to 2
+	r = and_ps_x2(set1_ps_epi32_x2(0x807FFFFF), r);
+	r = or_ps_x2(set1_ps_epi32_x2(0x40000000), r);
+
+	if(add)
+		sum = _mm512_add_ps(sum, r);
+	else
+		sum = r;
+
+	r = _mm512_mul_ps(r, _mm512_set1_ps(536870880.0f)); // 35
+	return _mm512_cvttps_epi32(r);
+}
+
+template <size_t rot>
+inline void double_comupte_wrap_x2(const __m512& n0, const __m512& n1, const __m512& n2, const __m512& n3,
+								   float lcnt, float hcnt, const __m512& rnd_c, __m512& sum, __m512i& out)
+{
+	__m512i r = double_comupte_x2<rot % 2 != 0>(n0, n1, n2, n3, lcnt, hcnt, rnd_c, sum);
+	if(rot != 0)
+		r = _mm512_or_si512(_mm512_bslli_epi128(r, 16 - rot), _mm512_bsrli_epi128(r, rot));
+
+	out = _mm512_xor_si512(out, r);
+}
+
+// Per hash tail of an iteration, returns the new sum and the next scratchpad index
+inline __m128 finish_round_x2(__m128 sum, __m128i out2, uint32_t& n)
+{
+	sum = _mm_and_ps(_mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)), sum); // take abs(va) by masking the float sign bit
+	// vs range 0 - 64
+	__m128i v0 = _mm_cvttps_epi32(_mm_mul_ps(sum, _mm_set1_ps(16777216.0f)));
+	v0 = _mm_xor_si128(v0, out2);
+	__m128i v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 2, 3));
+	v0 = _mm_xor_si128(v0, v1);
+	v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 0, 1));
+	v0 = _mm_xor_si128(v0, v1);
+
+	n = _mm_cvtsi128_si32(v0);
+	// vs is now between 0 and 1
+	return _mm_div_ps(sum, _mm_set1_ps(64.0f));
+}
+
+template <uint8_t rcon>
+inline void aes_genkey_sub_x4(__m128i& xout0, __m128i& xout2)
+{
+	__m128i xout1 = _mm_aeskeygenassist_si128(xout2, rcon);
+	xout1 = _mm_shuffle_epi32(xout1, 0xFF);
+	xout0 = _mm_xor_si128(xout0, _mm_slli_si128(xout0, 0x04));
+	xout0 = _mm_xor_si128(xout0, _mm_slli_si128(xout0, 0x08));
+	xout0 = _mm_xor_si128(xout0, xout1);
+	xout1 = _mm_aeskeygenassist_si128(xout0, 0x00);
+	xout1 = _mm_shuffle_epi32(xout1, 0xAA);
+	xout2 = _mm_xor_si128(xout2, _mm_slli_si128(xout2, 0x04));
+	xout2 = _mm_xor_si128(xout2, _mm_slli_si128(xout2, 0x08));
+	xout2 = _mm_xor_si128(xout2, xout1);
+}
+
+inline void aes_genkey_x4(const __m128i* memory, __m128i* k)
+{
+	__m128i xout0 = _mm_load_si128(memory);
+	__m128i xout2 = _mm_load_si128(memory + 1);
+	k[0] = xout0;
+	k[1] = xout2;
+
+	aes_genkey_sub_x4<0x01>(xout0, xout2);
+	k[2] = xout0;
+	k[3] = xout2;
+
+	aes_genkey_sub_x4<0x02>(xout0, xout2);
+	k[4] = xout0;
+	k[5] = xout2;
+
+	aes_genkey_sub_x4<0x04>(xout0, xout2);
+	k[6] = xout0;
+	k[7] = xout2;
+
+	aes_genkey_sub_x4<0x08>(xout0, xout2);
+	k[8] = xout0;
+	k[9] = xout2;
+}
+
+inline __m512i combine_x4(const __m128i& a, const __m128i& b, const __m128i& c, const __m128i& d)
+{
+	__m512i r = _mm512_castsi128_si512(a);
+	r = _mm512_inserti32x4(r, b, 1);
+	r = _mm512_inserti32x4(r, c, 2);
+	return _mm512_inserti32x4(r, d, 3);
+}
+
+// Register j holds block j of hashes 0-3 in its four 128 bit lanes
+inline void aes_round8_x4(const __m512i& key, __m512i* x)
+{
+	x[0] = _mm512_aesenc_epi128(x[0], key);
+	x[1] = _mm512_aesenc_epi128(x[1], key);
+	x[2] = _mm512_aesenc_epi128(x[2], key);
+	x[3] = _mm512_aesenc_epi128(x[3], key);
+	x[4] = _mm512_aesenc_epi128(x[4], key);
+	x[5] = _mm512_aesenc_epi128(x[5], key);
+	x[6] = _mm512_aesenc_epi128(x[6], key);
+	x[7] = _mm512_aesenc_epi128(x[7], key);
+}
+
+inline void aes_rounds_x4(const __m512i* k, __m512i* x)
+{
+	for(size_t r = 0; r < 10; r++)
+		aes_round8_x4(k[r], x);
+}
+
+inline void xor_shift_x4(__m512i* x)
+{
+	__m512i tmp0 = x[0];
+	x[0] = _mm512_xor_si512(x[0], x[1]);
+	x[1] = _mm512_xor_si512(x[1], x[2]);
+	x[2] = _mm512_xor_si512(x[2], x[3]);
+	x[3] = _mm512_xor_si512(x[3], x[4]);
+	x[4] = _mm512_xor_si512(x[4], x[5]);
+	x[5] = _mm512_xor_si512(x[5], x[6]);
+	x[6] = _mm512_xor_si512(x[6], x[7]);
+	x[7] = _mm512_xor_si512(x[7], tmp0);
+}
+
+// Loads 4 consecutive blocks from each of the 4 scratchpads and transposes them so that
+// register j holds block j of every hash
+inline void load_transpose_x4(const __m128i* const* p, size_t i, __m512i* x)
+{
+	const __m512i r0 = _mm512_load_si512(p[0] + i);
+	const __m512i r1 = _mm512_load_si512(p[1] + i);
+	const __m512i r2 = _mm512_load_si512(p[2] + i);
+	const __m512i r3 = _mm512_load_si512(p[3] + i);
+
+	const __m512i t0 = _mm512_shuffle_i64x2(r0, r1, _MM_SHUFFLE(1, 0, 1, 0));
+	const __m512i t1 = _mm512_shuffle_i64x2(r0, r1, _MM_SHUFFLE(3, 2, 3, 2));
+	const __m512i t2 = _mm512_shuffle_i64x2(r2, r3, _MM_SHUFFLE(1, 0, 1, 0));
+	const __m512i t3 = _mm512_shuffle_i64x2(r2, r3, _MM_SHUFFLE(3, 2, 3, 2));
+
+	x[0] = _mm512_xor_si512(x[0], _mm512_shuffle_i64x2(t0, t2, _MM_SHUFFLE(2, 0, 2, 0)));
+	x[1] = _mm512_xor_si512(x[1], _mm512_shuffle_i64x2(t0, t2, _MM_SHUFFLE(3, 1, 3, 1)));
+	x[2] = _mm512_xor_si512(x[2], _mm512_shuffle_i64x2(t1, t3, _MM_SHUFFLE(2, 0, 2, 0)));
+	x[3] = _mm512_xor_si512(x[3], _mm512_shuffle_i64x2(t1, t3, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+} // namespace
+
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+void cn_slow_hash<MEMORY, ITER, VERSION>::inner_hash_3_avx512_x2(cn_slow_hash& a, cn_slow_hash& b)
+{
+	uint32_t sa = a.spad.as_dword(0) >> 8;
+	uint32_t sb = b.spad.as_dword(0) >> 8;
+	cn_sptr idx0a = a.scratchpad_ptr(sa, 0);
+	cn_sptr idx2a = a.scratchpad_ptr(sa, 2);
+	cn_sptr idx0b = b.scratchpad_ptr(sb, 0);
+	cn_sptr idx2b = b.scratchpad_ptr(sb, 2);
+	__m512 sum0 = _mm512_setzero_ps();
+
+	for(size_t i = 0; i < ITER; i++)
+	{
+		__m512i v01, v23;
+		__m512 suma, sumb, sum1;
+		__m512 rc = sum0;
+
+		__m512 n01, n23;
+		prep_dv_x2(idx0a, idx0b, v01, n01);
+		prep_dv_x2(idx2a, idx2b, v23, n23);
+
+		__m512i out, out2;
+		__m512 n10, n22, n33;
+		n10 = _mm512_shuffle_f32x4(n01, n01, CN_LANES_X2(1, 0));
+		n22 = _mm512_shuffle_f32x4(n23, n23, CN_LANES_X2(0, 0));
+		n33 = _mm512_shuffle_f32x4(n23, n23, CN_LANES_X2(1, 1));
+
+		out = _mm512_setzero_si512();
+		double_comupte_wrap_x2<0>(n01, n10, n22, n33, 1.3437500f, 1.4296875f, rc, suma, out);
+		double_comupte_wrap_x2<1>(n01, n22, n33, n10, 1.2812500f, 1.3984375f, rc, suma, out);
+		double_comupte_wrap_x2<2>(n01, n33, n10, n22, 1.3593750f, 1.3828125f, rc, sumb, out);
+		double_comupte_wrap_x2<3>(n01, n33, n22, n10, 1.3671875f, 1.3046875f, rc, sumb, out);
+		store_dv_x2(idx0a, idx0b, _mm512_xor_si512(v01, out));
+		sum0 = _mm512_add_ps(suma, sumb);
+		out2 = out;
+
+		// Lane masks pick the second source for the high 128 bits of each hash
+		__m512 n11, n02, n30;
+		n11 = _mm512_shuffle_f32x4(n01, n01, CN_LANES_X2(1, 1));
+		n02 = _mm512_mask_blend_ps(0xF0F0, _mm512_shuffle_f32x4(n01, n01, CN_LANES_X2(0, 0)), _mm512_shuffle_f32x4(n23, n23, CN_LANES_X2(0, 0)));
+		n30 = _mm512_mask_blend_ps(0xF0F0, _mm512_shuffle_f32x4(n23, n23, CN_LANES_X2(1, 1)), _mm512_shuffle_f32x4(n01, n01, CN_LANES_X2(0, 0)));
+
+		out = _mm512_setzero_si512();
+		double_comupte_wrap_x2<0>(n23, n11, n02, n30, 1.4140625f, 1.3203125f, rc, suma, out);
+		double_comupte_wrap_x2<1>(n23, n02, n30, n11, 1.2734375f, 1.3515625f, rc, suma, out);
+		double_comupte_wrap_x2<2>(n23, n30, n11, n02, 1.2578125f, 1.3359375f, rc, sumb, out);
+		double_comupte_wrap_x2<3>(n23, n30, n02, n11, 1.2890625f, 1.4609375f, rc, sumb, out);
+		store_dv_x2(idx2a, idx2b, _mm512_xor_si512(v23, out));
+		sum1 = _mm512_add_ps(suma, sumb);
+
+		out2 = _mm512_xor_si512(out2, out);
+		out2 = _mm512_xor_si512(_mm512_shuffle_i32x4(out2, out2, CN_LANES_X2(1, 0)), out2);
+		suma = _mm512_mask_blend_ps(0xF0F0, sum0, sum1);
+		sumb = _mm512_mask_blend_ps(0xF0F0, _mm512_shuffle_f32x4(sum0, sum0, CN_LANES_X2(1, 1)), _mm512_shuffle_f32x4(sum1, sum1, CN_LANES_X2(0, 0)));
+		sum0 = _mm512_add_ps(suma, sumb);
+		sum0 = _mm512_add_ps(sum0, _mm512_shuffle_f32x4(sum0, sum0, CN_LANES_X2(1, 0)));
+
+		uint32_t na, nb;
+		__m128 suma_lo = finish_round_x2(_mm512_castps512_ps128(sum0), _mm512_castsi512_si128(out2), na);
+		__m128 sumb_lo = finish_round_x2(_mm512_extractf32x4_ps(sum0, 2), _mm512_extracti32x4_epi32(out2, 2), nb);
+
+		sum0 = _mm512_broadcast_f32x4(suma_lo);
+		sum0 = _mm512_insertf32x4(sum0, sumb_lo, 2);
+		sum0 = _mm512_insertf32x4(sum0, sumb_lo, 3);
+
+		idx0a = a.scratchpad_ptr(na, 0);
+		idx2a = a.scratchpad_ptr(na, 2);
+		idx0b = b.scratchpad_ptr(nb, 0);
+		idx2b = b.scratchpad_ptr(nb, 2);
+	}
+}
+
+#undef CN_LANES_X2
+
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+void cn_slow_hash<MEMORY, ITER, VERSION>::implode_scratchpad_vaes_x4(cn_slow_hash* const* ctx, size_t n)
+{
+	// Unused lanes run over the first scratchpad and are dropped at the end
+	const __m128i* pad[4];
+	__m128i sk[4][10];
+	for(size_t h = 0; h < 4; h++)
+	{
+		cn_slow_hash* c = ctx[h < n ? h : 0];
+		pad[h] = c->lpad.template as_ptr<__m128i>();
+		aes_genkey_x4(c->spad.template as_ptr<__m128i>() + 2, sk[h]);
+	}
+
+	__m512i k[10];
+	for(size_t r = 0; r < 10; r++)
+		k[r] = combine_x4(sk[0][r], sk[1][r], sk[2][r], sk[3][r]);
+
+	__m512i x[8];
+	for(size_t j = 0; j < 8; j++)
+	{
+		x[j] = combine_x4(
+			_mm_load_si128(ctx[0]->spad.template as_ptr<__m128i>() + 4 + j),
+			_mm_load_si128(ctx[1 < n ? 1 : 0]->spad.template as_ptr<__m128i>() + 4 + j),
+			_mm_load_si128(ctx[2 < n ? 2 : 0]->spad.template as_ptr<__m128i>() + 4 + j),
+			_mm_load_si128(ctx[3 < n ? 3 : 0]->spad.template as_ptr<__m128i>() + 4 + j));
+	}
+
+	for(size_t i = 0; i < MEMORY / sizeof(__m128i); i += 8)
+	{
+		load_transpose_x4(pad, i, x);
+		load_transpose_x4(pad, i + 4, x + 4);
+		aes_rounds_x4(k, x);
+
+		if(VERSION == 2)
+			xor_shift_x4(x);
+	}
+
+	for(size_t i = 0; VERSION == 2 && i < MEMORY / sizeof(__m128i); i += 8)
+	{
+		load_transpose_x4(pad, i, x);
+		load_transpose_x4(pad, i + 4, x + 4);
+		aes_rounds_x4(k, x);
+		xor_shift_x4(x);
+	}
+
+	for(size_t i = 0; VERSION == 2 && i < 16; i++)
+	{
+		aes_rounds_x4(k, x);
+		xor_shift_x4(x);
+	}
+
+	for(size_t j = 0; j < 8; j++)
+	{
+		_mm_store_si128(ctx[0]->spad.template as_ptr<__m128i>() + 4 + j, _mm512_castsi512_si128(x[j]));
+		if(n > 1)
+			_mm_store_si128(ctx[1]->spad.template as_ptr<__m128i>() + 4 + j, _mm512_extracti32x4_epi32(x[j], 1));
+		if(n > 2)
+			_mm_store_si128(ctx[2]->spad.template as_ptr<__m128i>() + 4 + j, _mm512_extracti32x4_epi32(x[j], 2));
+		if(n > 3)
+			_mm_store_si128(ctx[3]->spad.template as_ptr<__m128i>() + 4 + j, _mm512_extracti32x4_epi32(x[j], 3));
+	}
+}
+
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+void cn_slow_hash<MEMORY, ITER, VERSION>::hardware_hash_3_multi(cn_slow_hash* const* ctx, const void* const* in, const size_t* len, void* const* out, size_t n)
+{
+	for(size_t i = 0; i < n; i++)
+	{
+		keccak((const uint8_t*)in[i], len[i], ctx[i]->spad.as_byte(), 200);
+		ctx[i]->explode_scratchpad_3();
+	}
+
+	size_t h = 0;
+	for(; h + 1 < n; h += 2)
+		inner_hash_3_avx512_x2(*ctx[h], *ctx[h + 1]);
+	if(h < n)
+		ctx[h]->inner_hash_3_avx();
+
+	implode_scratchpad_vaes_x4(ctx, n);
+
+	for(size_t i = 0; i < n; i++)
+	{
+		keccakf(ctx[i]->spad.as_uqword());
+		memcpy(out[i], ctx[i]->spad.as_byte(), 32);
+	}
+}
+
+template class cn_v1_hash_t;
+template class cn_v7l_hash_t;
+template class cn_gpu_hash_t;
+
+#endif
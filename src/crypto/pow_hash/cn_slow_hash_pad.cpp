@@ -0,0 +1,275 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cn_slow_hash.hpp"
+#include <atomic>
+#include <bitset>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace
+{
+constexpr size_t HUGE_2MB = size_t(1) << 21;
+constexpr size_t HUGE_1GB = size_t(1) << 30;
+
+std::atomic<uint8_t> g_pad_mode{CN_PAD_MODE_2MB};
+std::atomic<uint64_t> g_pads[CN_PAD_KINDS];
+std::atomic<uint64_t> g_numa_moves{0};
+
+inline size_t round_up(size_t size, size_t page)
+{
+	return (size + page - 1) & ~(page - 1);
+}
+
+#if defined(__linux__)
+constexpr int MPOL_PREFERRED_ = 1;
+constexpr unsigned MPOL_MF_MOVE_ = 1 << 1;
+constexpr unsigned long MAX_NUMA_NODES = 1024;
+
+uint32_t numa_nodes()
+{
+	static const uint32_t nodes = [] {
+		uint32_t n = 0;
+		while(n < MAX_NUMA_NODES && access(("/sys/devices/system/node/node" + std::to_string(n)).c_str(), F_OK) == 0)
+			n++;
+		return n == 0 ? 1 : n;
+	}();
+	return nodes;
+}
+
+int32_t current_node()
+{
+	unsigned cpu, node;
+	if(syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+		return -1;
+	return node;
+}
+
+bool bind_node(void* ptr, size_t size, int32_t node, unsigned flags)
+{
+	unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = {};
+	mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+	return syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_, mask, MAX_NUMA_NODES, flags) == 0;
+}
+
+void* map_huge(size_t size, int shift)
+{
+	void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+	return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+// Maps size bytes aligned to 2 MB so that the kernel can back them with transparent huge pages
+void* map_transparent(size_t size)
+{
+	uint8_t* ptr = reinterpret_cast<uint8_t*>(mmap(nullptr, size + HUGE_2MB, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if(ptr == MAP_FAILED)
+		return nullptr;
+
+	uint8_t* aligned = reinterpret_cast<uint8_t*>(round_up(reinterpret_cast<uintptr_t>(ptr), HUGE_2MB));
+	if(aligned != ptr)
+		munmap(ptr, aligned - ptr);
+	if(aligned + size != ptr + size + HUGE_2MB)
+		munmap(aligned + size, ptr + HUGE_2MB - aligned);
+#ifdef MADV_HUGEPAGE
+	madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+	return aligned;
+}
+
+// 1 GB pages are shared out in 2 MB slots, one set of pages per NUMA node
+struct pad_arena
+{
+	uint8_t* base;
+	int32_t node;
+	std::bitset<HUGE_1GB / HUGE_2MB> used;
+};
+
+std::mutex g_arena_lock;
+std::vector<pad_arena> g_arenas;
+
+void* arena_alloc(size_t size)
+{
+	if(size > HUGE_2MB)
+		return nullptr;
+
+	const int32_t node = numa_nodes() > 1 ? current_node() : -1;
+	std::lock_guard<std::mutex> lock(g_arena_lock);
+	for(pad_arena& arena : g_arenas)
+	{
+		if(arena.node != node || arena.used.all())
+			continue;
+		for(size_t i = 0; i < arena.used.size(); i++)
+		{
+			if(!arena.used[i])
+			{
+				arena.used.set(i);
+				return arena.base + i * HUGE_2MB;
+			}
+		}
+	}
+
+	void* ptr = map_huge(HUGE_1GB, 30);
+	if(ptr == nullptr)
+		return nullptr;
+	// Nothing has touched the page yet, so setting the policy is enough to place it
+	if(node >= 0)
+		bind_node(ptr, HUGE_1GB, node, 0);
+
+	g_arenas.push_back({reinterpret_cast<uint8_t*>(ptr), node, {}});
+	g_arenas.back().used.set(0);
+	return ptr;
+}
+
+void arena_free(void* ptr)
+{
+	uint8_t* p = reinterpret_cast<uint8_t*>(ptr);
+	std::lock_guard<std::mutex> lock(g_arena_lock);
+	for(auto it = g_arenas.begin(); it != g_arenas.end(); ++it)
+	{
+		if(p < it->base || p >= it->base + HUGE_1GB)
+			continue;
+		it->used.reset((p - it->base) / HUGE_2MB);
+		if(it->used.none())
+		{
+			munmap(it->base, HUGE_1GB);
+			g_arenas.erase(it);
+		}
+		return;
+	}
+}
+#endif
+} // namespace
+
+void cn_pad_set_mode(cn_pad_mode mode)
+{
+	g_pad_mode = mode;
+}
+
+cn_pad_mode cn_pad_get_mode()
+{
+	return static_cast<cn_pad_mode>(g_pad_mode.load());
+}
+
+void* cn_pad_alloc(size_t size, cn_pad_kind& kind)
+{
+	const cn_pad_mode mode = cn_pad_get_mode();
+	void* ptr = nullptr;
+
+#if defined(__linux__)
+	if(mode == CN_PAD_MODE_1GB && (ptr = arena_alloc(size)) != nullptr)
+		kind = CN_PAD_HUGE_1GB;
+	else if(mode != CN_PAD_MODE_OFF && (ptr = map_huge(round_up(size, HUGE_2MB), 21)) != nullptr)
+		kind = CN_PAD_HUGE_2MB;
+	else if(mode != CN_PAD_MODE_OFF && (ptr = map_transparent(round_up(size, HUGE_2MB))) != nullptr)
+		kind = CN_PAD_TRANSPARENT;
+#elif defined(_WIN32)
+	// Needs SeLockMemoryPrivilege, VirtualAlloc just fails without it
+	const size_t large_page = GetLargePageMinimum();
+	if(mode != CN_PAD_MODE_OFF && large_page != 0 &&
+		(ptr = VirtualAlloc(nullptr, round_up(size, large_page), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE)) != nullptr)
+		kind = CN_PAD_LARGE_WIN;
+#endif
+
+	if(ptr == nullptr)
+	{
+		ptr = boost::alignment::aligned_alloc(4096, size);
+		kind = CN_PAD_ALIGNED;
+	}
+
+	g_pads[kind]++;
+	return ptr;
+}
+
+void cn_pad_free(void* ptr, size_t size, cn_pad_kind kind)
+{
+	switch(kind)
+	{
+#if defined(__linux__)
+	case CN_PAD_HUGE_1GB:
+		arena_free(ptr);
+		break;
+	case CN_PAD_HUGE_2MB:
+	case CN_PAD_TRANSPARENT:
+		munmap(ptr, round_up(size, HUGE_2MB));
+		break;
+#elif defined(_WIN32)
+	case CN_PAD_LARGE_WIN:
+		VirtualFree(ptr, 0, MEM_RELEASE);
+		break;
+#endif
+	default:
+		boost::alignment::aligned_free(ptr);
+		break;
+	}
+	g_pads[kind]--;
+}
+
+void cn_pad_bind_node(void* ptr, size_t size, cn_pad_kind kind, int32_t& node)
+{
+#if defined(__linux__)
+	// Slots of 1 GB pages were placed on allocation and can't move on their own
+	if(ptr == nullptr || kind == CN_PAD_HUGE_1GB || numa_nodes() < 2)
+		return;
+
+	const int32_t cur = current_node();
+	if(cur < 0 || cur == node)
+		return;
+
+	if(kind != CN_PAD_ALIGNED)
+		size = round_up(size, HUGE_2MB);
+	if(bind_node(ptr, size, cur, MPOL_MF_MOVE_) && node >= 0)
+		g_numa_moves++;
+	node = cur;
+#endif
+}
+
+cn_pad_stats cn_pad_get_stats()
+{
+	cn_pad_stats stats;
+	for(size_t i = 0; i < CN_PAD_KINDS; i++)
+		stats.pads[i] = g_pads[i];
+#if defined(__linux__)
+	stats.numa_nodes = numa_nodes();
+#else
+	stats.numa_nodes = 1;
+#endif
+	stats.numa_moves = g_numa_moves;
+	return stats;
+}
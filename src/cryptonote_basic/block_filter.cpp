@@ -0,0 +1,170 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstring>
+#include <iterator>
+
+#include "common/varint.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_basic/block_filter.h"
+
+namespace cryptonote
+{
+  namespace
+  {
+    void add_tx(const transaction &tx, block_filter::tx_entry &entry)
+    {
+      // extra may be only partially parsed, use whatever keys were found
+      std::vector<tx_extra_field> fields;
+      parse_tx_extra(tx.extra, fields);
+      tx_extra_pub_key pub_key_field;
+      size_t pk_index = 0;
+      while (find_tx_extra_field_by_type(fields, pub_key_field, pk_index++))
+        entry.tx_pub_keys.push_back(pub_key_field.pub_key);
+      tx_extra_additional_pub_keys additional_pub_keys;
+      if (find_tx_extra_field_by_type(fields, additional_pub_keys))
+        entry.additional_tx_pub_keys = std::move(additional_pub_keys.data);
+
+      entry.output_keys.reserve(tx.vout.size());
+      for (const tx_out &out: tx.vout)
+      {
+        if (out.target.type() == typeid(txout_to_key))
+          entry.output_keys.push_back(boost::get<txout_to_key>(out.target).key);
+        else
+          entry.output_keys.push_back(crypto::null_pkey);
+      }
+
+      for (const txin_v &in: tx.vin)
+      {
+        if (in.type() == typeid(txin_to_key))
+          entry.key_image_fingerprints.push_back(get_key_image_fingerprint(boost::get<txin_to_key>(in).k_image));
+      }
+    }
+
+    template<typename T>
+    void write_keys(std::back_insert_iterator<blobdata> &out, const std::vector<T> &keys)
+    {
+      tools::write_varint(out, keys.size());
+      for (const T &key: keys)
+        std::copy(key.data, key.data + sizeof(key.data), out);
+    }
+
+    template<typename T>
+    bool read_keys(blobdata::const_iterator &i, const blobdata::const_iterator &end, std::vector<T> &keys)
+    {
+      uint64_t n;
+      const int read = tools::read_varint(blobdata::const_iterator(i), blobdata::const_iterator(end), n);
+      if (read <= 0)
+        return false;
+      std::advance(i, read);
+      if (n > (uint64_t)std::distance(i, end) / sizeof(T))
+        return false;
+      keys.resize(n);
+      for (T &key: keys)
+      {
+        memcpy(key.data, &*i, sizeof(key.data));
+        std::advance(i, sizeof(key.data));
+      }
+      return true;
+    }
+  }
+
+  uint64_t get_key_image_fingerprint(const crypto::key_image &key_image)
+  {
+    uint64_t fingerprint;
+    memcpy(&fingerprint, &key_image, sizeof(fingerprint));
+    return fingerprint;
+  }
+
+  void make_block_filter(const block &b, const crypto::hash &block_hash, const std::vector<const transaction*> &txs, block_filter &filter)
+  {
+    filter.block_hash = block_hash;
+    filter.txs.clear();
+    filter.txs.resize(1 + txs.size());
+    add_tx(b.miner_tx, filter.txs[0]);
+    for (size_t n = 0; n < txs.size(); ++n)
+      add_tx(*txs[n], filter.txs[n + 1]);
+  }
+
+  blobdata block_filter_to_blob(const block_filter &filter)
+  {
+    blobdata blob;
+    auto out = std::back_inserter(blob);
+    std::copy(filter.block_hash.data, filter.block_hash.data + sizeof(filter.block_hash.data), out);
+    tools::write_varint(out, filter.txs.size());
+    for (const block_filter::tx_entry &entry: filter.txs)
+    {
+      write_keys(out, entry.tx_pub_keys);
+      write_keys(out, entry.additional_tx_pub_keys);
+      write_keys(out, entry.output_keys);
+      tools::write_varint(out, entry.key_image_fingerprints.size());
+      for (uint64_t fingerprint: entry.key_image_fingerprints)
+      {
+        // the key image's own leading bytes, so fixed size
+        const char *bytes = reinterpret_cast<const char*>(&fingerprint);
+        std::copy(bytes, bytes + sizeof(fingerprint), out);
+      }
+    }
+    return blob;
+  }
+
+  bool parse_block_filter(const blobdata &blob, block_filter &filter)
+  {
+    if (blob.size() < sizeof(filter.block_hash))
+      return false;
+    memcpy(filter.block_hash.data, blob.data(), sizeof(filter.block_hash.data));
+    blobdata::const_iterator i = blob.begin() + sizeof(filter.block_hash), end = blob.end();
+
+    uint64_t n_txes;
+    int read = tools::read_varint(blobdata::const_iterator(i), blobdata::const_iterator(end), n_txes);
+    if (read <= 0 || n_txes > blob.size())
+      return false;
+    std::advance(i, read);
+    filter.txs.clear();
+    filter.txs.resize(n_txes);
+    for (block_filter::tx_entry &entry: filter.txs)
+    {
+      if (!read_keys(i, end, entry.tx_pub_keys) || !read_keys(i, end, entry.additional_tx_pub_keys) || !read_keys(i, end, entry.output_keys))
+        return false;
+      uint64_t n_fingerprints;
+      read = tools::read_varint(blobdata::const_iterator(i), blobdata::const_iterator(end), n_fingerprints);
+      if (read <= 0)
+        return false;
+      std::advance(i, read);
+      if (n_fingerprints > (uint64_t)std::distance(i, end) / sizeof(uint64_t))
+        return false;
+      entry.key_image_fingerprints.resize(n_fingerprints);
+      for (uint64_t &fingerprint: entry.key_image_fingerprints)
+      {
+        memcpy(&fingerprint, &*i, sizeof(fingerprint));
+        std::advance(i, sizeof(fingerprint));
+      }
+    }
+    return i == end;
+  }
+}
@@ -0,0 +1,72 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "cryptonote_basic/blobdatatype.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief compact summary of a block a wallet can test for its own outputs and spends
+   *
+   * Holds each tx's public keys and full output keys, which is what the usual
+   * output ownership check (subaddresses included) needs, and short
+   * fingerprints of the key images the block spends.
+   */
+  struct block_filter
+  {
+    struct tx_entry
+    {
+      std::vector<crypto::public_key> tx_pub_keys;
+      std::vector<crypto::public_key> additional_tx_pub_keys;
+      std::vector<crypto::public_key> output_keys; //!< null for outputs that aren't to a key
+      std::vector<uint64_t> key_image_fingerprints;
+    };
+
+    crypto::hash block_hash;
+    std::vector<tx_entry> txs; //!< the miner tx first, then the block's txes in order
+  };
+
+  uint64_t get_key_image_fingerprint(const crypto::key_image &key_image);
+
+  /**
+   * @brief builds the filter of a block
+   *
+   * @param txs the block's txes, in the order of its tx_hashes
+   */
+  void make_block_filter(const block &b, const crypto::hash &block_hash, const std::vector<const transaction*> &txs, block_filter &filter);
+
+  blobdata block_filter_to_blob(const block_filter &filter);
+  bool parse_block_filter(const blobdata &blob, block_filter &filter);
+}
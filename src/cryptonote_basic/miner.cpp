@@ -198,7 +198,19 @@ namespace cryptonote
         float hr = static_cast<float>(total_hr)/static_cast<float>(m_last_hash_rates.size());
         const auto flags = std::cout.flags();
         const auto precision = std::cout.precision();
-        std::cout << "hashrate: " << std::setprecision(4) << std::fixed << hr << std::setiosflags(flags) << std::setprecision(precision) << ENDL;
+        // Scratchpads on small pages lose a good part of the hashrate to TLB misses, so show the backing with it
+        const cn_pad_stats pads = cn_pad_get_stats();
+        uint64_t total_pads = 0;
+        for (uint64_t n : pads.pads)
+          total_pads += n;
+        const uint64_t huge_pads = total_pads - pads.pads[CN_PAD_ALIGNED];
+        std::cout << "hashrate: " << std::setprecision(4) << std::fixed << hr << std::setiosflags(flags) << std::setprecision(precision)
+          << ", scratchpads on huge pages: " << huge_pads << "/" << total_pads
+          << " (1GB: " << pads.pads[CN_PAD_HUGE_1GB] << ", 2MB: " << pads.pads[CN_PAD_HUGE_2MB] + pads.pads[CN_PAD_LARGE_WIN]
+          << ", transparent: " << pads.pads[CN_PAD_TRANSPARENT] << ")";
+        if (pads.numa_nodes > 1)
+          std::cout << ", NUMA nodes: " << pads.numa_nodes << ", scratchpad moves: " << pads.numa_moves;
+        std::cout << ENDL;
       }
     }
     m_last_hr_merge_time = misc_utils::get_tick_count();
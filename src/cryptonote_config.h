@@ -143,8 +143,18 @@ static_assert(STAKING_PORTIONS % 3 == 0, "Use a multiple of three, so that it di
 #define BLOCKS_SYNCHRONIZING_DEFAULT_COUNT              20     //by default, blocks count in blocks downloading
 #define BLOCKS_SYNCHRONIZING_MAX_COUNT                  2048   //must be a power of 2, greater than 128, equal to SEEDHASH_EPOCH_BLOCKS
 
+#define POW_HASH_CACHE_MAX_ENTRIES                      100000 //block PoW hashes kept in the db for reorgs and re-verification
+#define EMISSION_INDEX_BLOCKS_PER_STEP                  1000 //older blocks given emission totals per idle step
+#define OUTPUT_DISTRIBUTION_CACHE_MAX_AMOUNTS           16 //output distributions kept in memory: the rct one and the most recently used others
+#define BLOCK_TEMPLATE_REFRESH_REWARD_PERMILLE          5 //reward change that makes a waiting block template stale
+#define BLOCK_TEMPLATE_LONGPOLL_DEFAULT_TIMEOUT         30 //seconds
+#define BLOCK_TEMPLATE_LONGPOLL_MAX_TIMEOUT             120 //seconds
+#define BLOCK_TEMPLATE_LONGPOLL_MAX_WAITERS             16 //concurrent long-poll getblocktemplate calls allowed to park an RPC thread, further capped at the RPC server's threads - 1
+
 #define CRYPTONOTE_MEMPOOL_TX_LIVETIME                    (86400*3) //seconds, three days
 #define CRYPTONOTE_MEMPOOL_TX_FROM_ALT_BLOCK_LIVETIME     604800 //seconds, one week
+#define CRYPTONOTE_MEMPOOL_INPUT_CACHE_MAX_ENTRIES        65536 //check_tx_inputs results kept by the pool
+#define CRYPTONOTE_MEMPOOL_PARSED_TX_CACHE_MAX_ENTRIES    4096 //parsed transactions kept by the pool after a reorg
 
 
 #define CRYPTONOTE_DANDELIONPP_STEMS              2 // number of outgoing stem connections per epoch
@@ -165,6 +175,10 @@ static_assert(STAKING_PORTIONS % 3 == 0, "Use a multiple of three, so that it di
 #define CRYPTONOTE_MAX_FRAGMENTS                        20 // ~20 * NOISE_BYTES max payload size for covert/noise send
 
 #define COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT           1000
+#define COMMAND_RPC_GET_BLOCKS_FAST_CACHE_TIP_BLOCKS    30     // only responses starting this close to the tip are cached
+#define COMMAND_RPC_GET_BLOCKS_FAST_CACHE_MAX_ENTRIES   64
+#define COMMAND_RPC_GET_BLOCK_FILTERS_MAX_COUNT         10000
+#define COMMAND_RPC_GET_BLOCK_FILTERS_MAX_SIZE          (16*1024*1024) // 16 MB
 
 #define P2P_LOCAL_WHITE_PEERLIST_LIMIT                  1000
 #define P2P_LOCAL_GRAY_PEERLIST_LIMIT                   5000
@@ -190,7 +204,13 @@ static_assert(STAKING_PORTIONS % 3 == 0, "Use a multiple of three, so that it di
 #define P2P_IDLE_CONNECTION_KILL_INTERVAL               (5*60) //5 minutes
 
 #define P2P_SUPPORT_FLAG_FLUFFY_BLOCKS                  0x01
-#define P2P_SUPPORT_FLAGS                               P2P_SUPPORT_FLAG_FLUFFY_BLOCKS
+#define P2P_SUPPORT_FLAG_UPTIME_PROOF_BATCH             0x02
+#define P2P_SUPPORT_FLAGS                               (P2P_SUPPORT_FLAG_FLUFFY_BLOCKS | P2P_SUPPORT_FLAG_UPTIME_PROOF_BATCH)
+
+#define P2P_UPTIME_PROOF_RELAY_INTERVAL_MS              1000
+#define P2P_UPTIME_PROOF_BATCH_MAX_PROOFS               1024
+#define P2P_UPTIME_PROOF_KNOWN_LIFETIME                 UPTIME_PROOF_FREQUENCY_IN_SECONDS
+#define P2P_UPTIME_PROOF_KNOWN_MAX_PER_PEER             16384
 
 #define RPC_IP_FAILS_BEFORE_BLOCK                       3
 
@@ -36,6 +36,7 @@
 #include "common/rules.h"
 #include "include_base_utils.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
+#include "cryptonote_basic/block_filter.h"
 #include "tx_pool.h"
 #include "blockchain.h"
 #include "blockchain_db/blockchain_db.h"
@@ -101,7 +102,8 @@ Blockchain::Blockchain(tx_memory_pool& tx_pool, service_nodes::service_node_list
   m_deregister_vote_pool(deregister_vote_pool),
   m_btc_valid(false),
   m_batch_success(true),
-  m_prepare_height(0)
+  m_prepare_height(0),
+  m_output_distribution_cache(OUTPUT_DISTRIBUTION_CACHE_MAX_AMOUNTS)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
 }
@@ -562,7 +564,12 @@ void Blockchain::pop_blocks(uint64_t nblocks)
   {
     LOG_ERROR("Error when popping blocks after processing " << i << " blocks: " << e.what());
     if (stop_batch)
+    {
       m_db->batch_abort();
+      m_output_distribution_cache.clear();
+      // the list detached blocks the abort put back, reload it from the committed records
+      m_service_node_list.init();
+    }
     return;
   }
 
@@ -606,6 +613,8 @@ block Blockchain::pop_block_from_blockchain()
   // make sure the hard fork object updates its current version
   m_hardfork->on_block_popped(1);
 
+  m_output_distribution_cache.on_blocks_popped(m_db->height(), m_db->top_block_hash());
+
   // return transactions from popped block to the tx_pool
   size_t pruned = 0;
   for (transaction& tx : popped_txs)
@@ -1843,8 +1852,12 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
     crypto::hash proof_of_work = crypto::null_hash;
     memset(proof_of_work.data, 0xff, sizeof(proof_of_work.data));
 
-    get_block_longhash(bei.bl, proof_of_work, m_pow_ctx);
-    
+    if (!m_db->get_pow_hash(id, proof_of_work))
+    {
+      get_block_longhash(bei.bl, proof_of_work, m_pow_ctx);
+      cache_pow_hash(id, proof_of_work);
+    }
+
     if(!check_hash(proof_of_work, current_diff))
     {
       MERROR_VER("Block with id: " << id << std::endl << " for alternative chain, does not have enough proof of work: " << proof_of_work << std::endl << " expected difficulty: " << current_diff);
@@ -2011,41 +2024,68 @@ bool Blockchain::get_blocks(uint64_t start_offset, size_t count, std::vector<std
   return true;
 }
 //------------------------------------------------------------------
-//TODO: This function *looks* like it won't need to be rewritten
-//      to use BlockchainDB, as it calls other functions that were,
-//      but it warrants some looking into later.
-//
-//FIXME: This function appears to want to return false if any transactions
-//       that belong with blocks are missing, but not if blocks themselves
-//       are missing.
+// the hashes of a block's transactions, from the per-block index when the
+// block is in it, otherwise from the block blob
+static bool load_block_tx_hashes(const BlockchainDB *db, uint64_t height, const cryptonote::blobdata &block_blob, std::vector<crypto::hash> &tx_hashes)
+{
+  if (db->get_block_tx_hashes(height, tx_hashes))
+    return true;
+  block b;
+  if (!parse_and_validate_block_from_blob(block_blob, b))
+    return false;
+  tx_hashes = std::move(b.tx_hashes);
+  return true;
+}
+//------------------------------------------------------------------
+template<typename T>
+static bool fill_transactions_blobs(BlockchainDB *db, const std::vector<crypto::hash>& txs_ids, std::vector<T>& txs, std::vector<crypto::hash>& missed_txs, bool pruned);
+//------------------------------------------------------------------
+// Serves blocks and their txes straight from the stored blobs under a single
+// read txn. It does not take m_blockchain_lock, so peers syncing from us do
+// not hold up our own block processing.
 bool Blockchain::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
   db_rtxn_guard rtxn_guard (m_db);
-  rsp.current_blockchain_height = get_current_blockchain_height();
-  std::vector<std::pair<cryptonote::blobdata,block>> blocks;
-  get_blocks(arg.blocks, blocks, rsp.missed_ids);
+  rsp.current_blockchain_height = m_db->height();
+  const uint32_t pruning_seed = m_db->get_blockchain_pruning_seed();
 
-  for (size_t i = 0; i < blocks.size(); ++i)
+  std::vector<crypto::hash> tx_hashes;
+  for (const crypto::hash &block_hash: arg.blocks)
   {
-    auto& bl = blocks[i];
-    std::vector<crypto::hash> missed_tx_ids;
-
-    rsp.blocks.push_back(block_complete_entry());
-    block_complete_entry& e = rsp.blocks.back();
+    uint64_t height = 0;
+    block_complete_entry e;
+    try
+    {
+      if (!m_db->block_exists(block_hash, &height))
+      {
+        rsp.missed_ids.push_back(block_hash);
+        continue;
+      }
+      e.block = m_db->get_block_blob_from_height(height);
+    }
+    catch (const std::exception &ex)
+    {
+      MERROR("Failed to get block " << block_hash << ": " << ex.what());
+      return false;
+    }
+    if (!load_block_tx_hashes(m_db, height, e.block, tx_hashes))
+    {
+      LOG_ERROR("Invalid block: " << block_hash);
+      rsp.missed_ids.push_back(block_hash);
+      continue;
+    }
 
-    // FIXME: s/rsp.missed_ids/missed_tx_id/ ?  Seems like rsp.missed_ids
-    //        is for missed blocks, not missed transactions as well.
+    std::vector<crypto::hash> missed_tx_ids;
     e.pruned = arg.prune;
-    get_transactions_blobs(bl.second.tx_hashes, e.txs, missed_tx_ids, arg.prune);
+    fill_transactions_blobs(m_db, tx_hashes, e.txs, missed_tx_ids, arg.prune);
     if (missed_tx_ids.size() != 0)
     {
       // do not display an error if the peer asked for an unpruned block which we are not meant to have
-      if (tools::has_unpruned_block(get_block_height(bl.second), get_current_blockchain_height(), get_blockchain_pruning_seed()))
+      if (tools::has_unpruned_block(height, rsp.current_blockchain_height, pruning_seed))
       {
         LOG_ERROR("Error retrieving blocks, missed " << missed_tx_ids.size()
-            << " transactions for block with hash: " << get_block_hash(bl.second)
+            << " transactions for block with hash: " << block_hash
             << std::endl
         );
       }
@@ -2057,13 +2097,85 @@ bool Blockchain::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NO
       return false;
     }
 
-    //pack block
-    e.block = std::move(bl.first);
     e.block_weight = 0;
-    //if (arg.prune && m_db->block_exists(arg.blocks[i]))
-     // e.block_weight = m_db->get_block_weight(m_db->get_block_height(arg.blocks[i]));
+    rsp.blocks.push_back(std::move(e));
+  }
+  return true;
+}
+//------------------------------------------------------------------
+bool Blockchain::get_block_blob_and_tx_hashes(const crypto::hash &blkid, cryptonote::blobdata &block_blob, std::vector<crypto::hash> &tx_hashes) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  db_rtxn_guard rtxn_guard (m_db);
+  uint64_t height = 0;
+  try
+  {
+    if (!m_db->block_exists(blkid, &height))
+      return false;
+    block_blob = m_db->get_block_blob_from_height(height);
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to get block " << blkid << ": " << e.what());
+    return false;
+  }
+  return load_block_tx_hashes(m_db, height, block_blob, tx_hashes);
+}
+//------------------------------------------------------------------
+bool Blockchain::get_stored_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  db_rtxn_guard rtxn_guard (m_db);
+  return fill_transactions_blobs(m_db, txs_ids, txs, missed_txs, false);
+}
+//------------------------------------------------------------------
+bool Blockchain::get_block_filters(uint64_t start_height, size_t max_count, size_t max_size, std::vector<cryptonote::blobdata>& filters, uint64_t& current_height, size_t& built_count) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  filters.clear();
+  built_count = 0;
+  db_rtxn_guard rtxn_guard (m_db);
+  try
+  {
+    current_height = m_db->height();
+    if (start_height >= current_height)
+      return false;
+    const uint64_t end_height = start_height + std::min<uint64_t>(max_count, current_height - start_height);
+    filters.reserve(end_height - start_height);
+    size_t size = 0;
+    for (uint64_t height = start_height; height < end_height && (size < max_size || filters.empty()); ++height)
+    {
+      cryptonote::blobdata filter;
+      if (!m_db->get_block_filter(height, filter))
+      {
+        // stored before filters existed, build it from the block
+        const cryptonote::block b = m_db->get_block_from_height(height);
+        std::vector<cryptonote::transaction> txs(b.tx_hashes.size());
+        std::vector<const cryptonote::transaction*> tx_ptrs;
+        tx_ptrs.reserve(txs.size());
+        for (size_t n = 0; n < txs.size(); ++n)
+        {
+          if (!m_db->get_pruned_tx(b.tx_hashes[n], txs[n]))
+          {
+            MERROR("Tx " << b.tx_hashes[n] << " of block at height " << height << " not found");
+            return false;
+          }
+          tx_ptrs.push_back(&txs[n]);
+        }
+        block_filter bf;
+        make_block_filter(b, m_db->get_block_hash_from_height(height), tx_ptrs, bf);
+        filter = block_filter_to_blob(bf);
+        ++built_count;
+      }
+      size += filter.size();
+      filters.push_back(std::move(filter));
+    }
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to get block filters from height " << start_height << ": " << e.what());
+    return false;
   }
-
   return true;
 }
 //------------------------------------------------------------------
@@ -2437,35 +2549,89 @@ bool Blockchain::get_output_distribution(uint64_t amount, uint64_t from_height,
     return false;
   if (start_height >= db_height || to_height >= db_height)
     return false;
-  if (amount == 0)
-  {
-    std::vector<uint64_t> heights;
-    heights.reserve(to_height + 1 - start_height);
-    const uint64_t real_start_height = start_height > 0 ? start_height-1 : start_height;
-    for (uint64_t h = real_start_height; h <= to_height; ++h)
-      heights.push_back(h);
-    distribution = m_db->get_block_cumulative_rct_outputs(heights);
-    if (start_height > 0)
-    {
-      base = distribution[0];
-      distribution.erase(distribution.begin());
+  if (amount != 0 && to_height == 0)
+    to_height = db_height - 1;
+
+  output_distribution_cache::distribution_ptr d = get_cached_output_distribution(amount, to_height);
+  if (!d)
+  {
+    // this amount is not cached, go to the db
+    if (amount == 0)
+    {
+      std::vector<uint64_t> heights;
+      heights.reserve(to_height + 1 - start_height);
+      const uint64_t real_start_height = start_height > 0 ? start_height-1 : start_height;
+      for (uint64_t h = real_start_height; h <= to_height; ++h)
+        heights.push_back(h);
+      distribution = m_db->get_block_cumulative_rct_outputs(heights);
+      if (start_height > 0)
+      {
+        base = distribution[0];
+        distribution.erase(distribution.begin());
+      }
+      return true;
     }
-    return true;
+    return m_db->get_output_distribution(amount, start_height, to_height, distribution, base);
   }
-  else
+
+  d->slice(start_height, to_height, distribution);
+  // rct distributions are relative to a base, others count from genesis
+  if (amount == 0 && start_height > 0)
+    base = (*d)[start_height - 1];
+  return true;
+}
+//------------------------------------------------------------------
+output_distribution_cache::distribution_ptr Blockchain::get_cached_output_distribution(uint64_t amount, uint64_t to_height) const
+{
+  // a cached distribution still matches the chain if its top block does
+  auto usable = [this, to_height](const output_distribution_cache::distribution_ptr &d) {
+    return d && d->height() > to_height && d->height() <= m_db->height() && m_db->get_block_hash_from_height(d->height() - 1) == d->top_hash();
+  };
+
+  output_distribution_cache::distribution_ptr d = m_output_distribution_cache.get(amount);
+  if (usable(d))
+    return d;
+
+  // an amount without a slot goes straight to the db, rather than queueing behind loads
+  if (!m_output_distribution_cache.can_cache(amount))
+    return nullptr;
+
+  boost::lock_guard<boost::mutex> lock(m_output_distribution_load_lock);
+  d = m_output_distribution_cache.get(amount);
+  if (usable(d))
+    return d;
+
+  std::vector<uint64_t> cumulative;
+  crypto::hash top_hash;
   {
-    return m_db->get_output_distribution(amount, start_height, to_height, distribution, base);
+    db_rtxn_guard rtxn_guard(m_db);
+    const uint64_t db_height = m_db->height();
+    if (amount == 0)
+    {
+      std::vector<uint64_t> heights(db_height);
+      for (uint64_t h = 0; h < db_height; ++h)
+        heights[h] = h;
+      cumulative = m_db->get_block_cumulative_rct_outputs(heights);
+    }
+    else
+    {
+      uint64_t base;
+      if (!m_db->get_output_distribution(amount, 0, 0, cumulative, base))
+        return nullptr;
+    }
+    top_hash = m_db->get_block_hash_from_height(db_height - 1);
   }
+  d = m_output_distribution_cache.put(amount, cumulative, top_hash);
+  return usable(d) ? d : nullptr;
 }
 //------------------------------------------------------------------
 // This function takes a list of block hashes from another node
 // on the network to find where the split point is between us and them.
 // This is used to see what to send another node that needs to sync.
-bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, uint64_t& starter_offset) const
+// Finds the most recent block of a foreign short chain history that we have in
+// our main chain.  Callers provide the locking and/or read txn.
+static bool find_split_height(const BlockchainDB *db, const std::list<crypto::hash>& qblock_ids, uint64_t& split_height)
 {
-  LOG_PRINT_L3("Blockchain::" << __func__);
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
-
   // make sure the request includes at least the genesis block, otherwise
   // how can we expect to sync from the client that the block list came from?
   if(qblock_ids.empty())
@@ -2474,10 +2640,9 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qbloc
     return false;
   }
 
-  db_rtxn_guard rtxn_guard(m_db);
   // make sure that the last block in the request's block list matches
   // the genesis block
-  auto gen_hash = m_db->get_block_hash_from_height(0);
+  auto gen_hash = db->get_block_hash_from_height(0);
   if(qblock_ids.back() != gen_hash)
   {
     MCERROR("net.p2p", "Client sent wrong NOTIFY_REQUEST_CHAIN: genesis block mismatch: " << std::endl << "id: " << qblock_ids.back() << ", " << std::endl << "expected: " << gen_hash << "," << std::endl << " dropping connection");
@@ -2487,12 +2652,12 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qbloc
   // Find the first block the foreign chain has that we also have.
   // Assume qblock_ids is in reverse-chronological order.
   auto bl_it = qblock_ids.begin();
-  uint64_t split_height = 0;
+  split_height = 0;
   for(; bl_it != qblock_ids.end(); bl_it++)
   {
     try
     {
-      if (m_db->block_exists(*bl_it, &split_height))
+      if (db->block_exists(*bl_it, &split_height))
         break;
     }
     catch (const std::exception& e)
@@ -2510,11 +2675,19 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qbloc
     return false;
   }
 
-  //we start to put block ids INCLUDING last known id, just to make other side be sure
-  starter_offset = split_height;
   return true;
 }
 //------------------------------------------------------------------
+bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, uint64_t& starter_offset) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+  db_rtxn_guard rtxn_guard(m_db);
+  //we start to put block ids INCLUDING last known id, just to make other side be sure
+  return find_split_height(m_db, qblock_ids, starter_offset);
+}
+//------------------------------------------------------------------
 difficulty_type Blockchain::block_difficulty(uint64_t i) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -2624,18 +2797,16 @@ static bool fill(BlockchainDB *db, const crypto::hash &tx_hash, tx_blob_entry &t
 //------------------------------------------------------------------
 //TODO: return type should be void, throw on exception
 //       alternatively, return true only if no transactions missed
-bool Blockchain::get_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs, bool pruned) const
+template<typename T>
+static bool fill_transactions_blobs(BlockchainDB *db, const std::vector<crypto::hash>& txs_ids, std::vector<T>& txs, std::vector<crypto::hash>& missed_txs, bool pruned)
 {
-  LOG_PRINT_L3("Blockchain::" << __func__);
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
-
-  txs.reserve(txs_ids.size());
+  txs.reserve(txs.size() + txs_ids.size());
   for (const auto& tx_hash : txs_ids)
   {
     try
     {
-      cryptonote::blobdata tx;
-      if (fill(m_db, tx_hash, tx, pruned))
+      T tx;
+      if (fill(db, tx_hash, tx, pruned))
         txs.push_back(std::move(tx));
       else
         missed_txs.push_back(tx_hash);
@@ -2648,28 +2819,18 @@ bool Blockchain::get_transactions_blobs(const std::vector<crypto::hash>& txs_ids
   return true;
 }
 //------------------------------------------------------------------
+bool Blockchain::get_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs, bool pruned) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  return fill_transactions_blobs(m_db, txs_ids, txs, missed_txs, pruned);
+}
+//------------------------------------------------------------------
 bool Blockchain::get_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<tx_blob_entry>& txs, std::vector<crypto::hash>& missed_txs, bool pruned) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
-
-  txs.reserve(txs_ids.size());
-  for (const auto& tx_hash : txs_ids)
-  {
-    try
-    {
-      tx_blob_entry tx;
-      if (fill(m_db, tx_hash, tx, pruned))
-        txs.push_back(std::move(tx));
-      else
-        missed_txs.push_back(tx_hash);
-    }
-    catch (const std::exception& e)
-    {
-      return false;
-    }
-  }
-  return true;
+  return fill_transactions_blobs(m_db, txs_ids, txs, missed_txs, pruned);
 }
 //------------------------------------------------------------------
 size_t get_transaction_version(const cryptonote::blobdata &bd)
@@ -2843,6 +3004,114 @@ bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, cons
   return true;
 }
 //------------------------------------------------------------------
+bool Blockchain::get_blocks_fast(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, std::vector<std::vector<std::vector<uint64_t>>>& output_indices, uint64_t& total_height, uint64_t& start_height, crypto::hash& top_hash, bool pruned, bool get_miner_tx, size_t max_count) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  blocks.clear();
+  output_indices.clear();
+
+  // everything below is read from one snapshot, so no blockchain lock is needed
+  db_rtxn_guard rtxn_guard(m_db);
+  try
+  {
+    top_hash = m_db->top_block_hash(&total_height);
+    ++total_height;
+
+    // the client is already at our tip
+    if (!qblock_ids.empty() && qblock_ids.front() == top_hash)
+    {
+      start_height = 0;
+      return true;
+    }
+
+    if (req_start_block > 0)
+    {
+      if (req_start_block >= total_height)
+        return false;
+      start_height = req_start_block;
+    }
+    else if (!find_split_height(m_db, qblock_ids, start_height))
+    {
+      return false;
+    }
+
+    blocks.reserve(std::min(std::min(max_count, (size_t)10000), (size_t)(total_height - start_height)));
+    if (!m_db->get_blocks_from(start_height, 3, max_count, FIND_BLOCKCHAIN_SUPPLEMENT_MAX_SIZE, blocks, pruned, true, get_miner_tx))
+    {
+      MERROR("Error getting blocks");
+      return false;
+    }
+
+    // Tx ids are allocated sequentially as blocks are added, miner tx first,
+    // so the output indices of every tx in the range come from one cursor walk
+    // starting at the first block's miner tx.  Without miner txes, start from
+    // the miner tx of the first block that has other txes.
+    size_t first_block = 0;
+    uint64_t first_tx_id = 0;
+    if (get_miner_tx)
+    {
+      if (!blocks.empty() && !m_db->tx_exists(blocks.front().first.second, first_tx_id))
+      {
+        MERROR("Miner tx " << blocks.front().first.second << " not found");
+        return false;
+      }
+    }
+    else
+    {
+      while (first_block < blocks.size() && blocks[first_block].second.empty())
+        ++first_block;
+      if (first_block < blocks.size())
+      {
+        const crypto::hash &first_tx_hash = blocks[first_block].second.front().first;
+        if (!m_db->tx_exists(first_tx_hash, first_tx_id) || first_tx_id == 0)
+        {
+          MERROR("Tx " << first_tx_hash << " not found");
+          return false;
+        }
+        --first_tx_id;
+      }
+    }
+
+    size_t n_txes = 0;
+    for (size_t n = first_block; n < blocks.size(); ++n)
+      n_txes += 1 + blocks[n].second.size();
+    std::vector<std::vector<uint64_t>> indices;
+    if (n_txes > 0)
+      indices = m_db->get_tx_amount_output_indices(first_tx_id, n_txes);
+    if (indices.size() != n_txes)
+    {
+      MERROR("Got " << indices.size() << " tx output indices, expected " << n_txes);
+      return false;
+    }
+
+    output_indices.resize(blocks.size());
+    auto it = indices.begin();
+    for (size_t n = 0; n < blocks.size(); ++n)
+    {
+      std::vector<std::vector<uint64_t>> &block_indices = output_indices[n];
+      block_indices.reserve(1 + blocks[n].second.size());
+      if (n < first_block)
+      {
+        block_indices.emplace_back();
+        continue;
+      }
+      // the miner tx entry is left empty when it was not asked for
+      block_indices.emplace_back();
+      if (get_miner_tx)
+        block_indices.back() = std::move(*it);
+      ++it;
+      for (size_t i = 0; i < blocks[n].second.size(); ++i, ++it)
+        block_indices.push_back(std::move(*it));
+    }
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to get blocks from height " << start_height << ": " << e.what());
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------
 bool Blockchain::add_block_as_invalid(const block& bl, const crypto::hash& h)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -2872,7 +3141,11 @@ bool Blockchain::have_block(const crypto::hash& id) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
-
+  return have_block_unlocked(id);
+}
+//------------------------------------------------------------------
+bool Blockchain::have_block_unlocked(const crypto::hash& id) const
+{
   if(m_db->block_exists(id))
   {
     LOG_PRINT_L2("block " << id << " found in main chain");
@@ -3066,6 +3339,22 @@ bool Blockchain::check_tx_inputs(transaction& tx, uint64_t& max_used_block_heigh
   return true;
 }
 //------------------------------------------------------------------
+bool Blockchain::check_tx_inputs_deferred(transaction& tx, uint64_t& max_used_block_height, crypto::hash& max_used_block_id, tx_verification_context &tvc, std::vector<const rct::rctSig*> &deferred_rct, crypto::hash &top_id, uint8_t &hf_version) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+  top_id = get_tail_id();
+  hf_version = m_hardfork->get_current_version();
+  max_used_block_id = null_hash;
+  if (!check_tx_inputs(tx, tvc, &max_used_block_height, &deferred_rct))
+    return false;
+
+  CHECK_AND_ASSERT_MES(max_used_block_height < m_db->height(), false,  "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_db->height());
+  max_used_block_id = m_db->get_block_hash_from_height(max_used_block_height);
+  return true;
+}
+//------------------------------------------------------------------
 bool Blockchain::check_tx_outputs(const transaction& tx, tx_verification_context &tvc) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -3257,7 +3546,7 @@ bool Blockchain::expand_transaction_2(transaction &tx, const crypto::hash &tx_pr
 //        check_tx_input() rather than here, and use this function simply
 //        to iterate the inputs as necessary (splitting the task
 //        using threads, etc.)
-bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height) const
+bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height, std::vector<const rct::rctSig*>* deferred_rct) const
 {
 	PERF_TIMER(check_tx_inputs);
 	LOG_PRINT_L3("Blockchain::" << __func__);
@@ -3551,6 +3840,11 @@ if (tx.version == 1)
 				}
 			}
 
+			if (deferred_rct)
+			{
+				deferred_rct->push_back(&rv);
+				break;
+			}
 			if (!rct::verRctNonSemanticsSimple(rv))
 			{
 				MERROR_VER("Failed to check ringct signatures!");
@@ -4171,6 +4465,7 @@ leave:
   // validate proof_of_work versus difficulty target
   bool precomputed = false;
   bool fast_check = false;
+  bool cache_pow = false;
 #if defined(PER_BLOCK_CHECKPOINT)
   if (blockchain_height < m_blocks_hash_check.size())
   {
@@ -4198,9 +4493,15 @@ leave:
     {
       precomputed = true;
       proof_of_work = it->second;
+      cache_pow = true; // already cached ids are skipped by the db
     }
+    else if (m_db->get_pow_hash(id, proof_of_work))
+      precomputed = true;
     else
+    {
       get_block_longhash(bl, proof_of_work, m_pow_ctx);
+      cache_pow = true;
+    }
 
 
     // validate proof_of_work versus difficulty target
@@ -4256,6 +4557,10 @@ leave:
 // XXX old code adds miner tx here
 
   size_t tx_index = 0;
+  // MLSAGs of the block's simple ringct txes, checked all together once the
+  // loop below is done, and the index in txs of the tx each belongs to
+  std::vector<const rct::rctSig*> deferred_rct;
+  std::vector<size_t> deferred_rct_txs;
   // Iterate over the block's transaction hashes, grabbing each
   // from the tx_pool and validating them.  Each is then added
   // to txs.  Keys spent in each are added to <keys> by the double spend check.
@@ -4325,7 +4630,7 @@ leave:
     {
       // validate that transaction inputs and the keys spending them are correct.
       tx_verification_context tvc;
-      if(!check_tx_inputs(tx, tvc))
+      if(!check_tx_inputs(tx, tvc, NULL, &deferred_rct))
       {
         MERROR_VER("Block with id: " << id  << " has at least one transaction (id: " << tx_id << ") with wrong inputs.");
 
@@ -4338,6 +4643,7 @@ leave:
         return_tx_to_pool(txs);
         goto leave;
       }
+      deferred_rct_txs.resize(deferred_rct.size(), txs.size() - 1);
     }
 #if defined(PER_BLOCK_CHECKPOINT)
     else
@@ -4362,6 +4668,25 @@ leave:
     cumulative_block_weight += tx_weight;
   }
 
+  if (!deferred_rct.empty())
+  {
+    TIME_MEASURE_START(rct);
+    std::vector<bool> valid;
+    if (!rct::verRctNonSemanticsSimple(deferred_rct, &valid))
+    {
+      for (size_t i = 0; i < valid.size(); ++i)
+        if (!valid[i])
+          MERROR_VER("Block with id: " << id << " has at least one transaction (id: " << bl.tx_hashes[deferred_rct_txs[i]] << ") with wrong ringct signatures.");
+      add_block_as_invalid(bl, id);
+      MERROR_VER("Block with id " << id << " added as invalid because of wrong inputs in transactions");
+      bvc.m_verifivation_failed = true;
+      return_tx_to_pool(txs);
+      goto leave;
+    }
+    TIME_MEASURE_FINISH(rct);
+    t_checktx += rct;
+  }
+
   // if we were syncing pruned blocks
   if (n_pruned > 0)
   {
@@ -4416,6 +4741,9 @@ leave:
       uint64_t long_term_block_weight = get_next_long_term_block_weight(block_weight);
       cryptonote::blobdata bd = cryptonote::block_to_blob(bl);
       new_height = m_db->add_block(std::make_pair(std::move(bl), std::move(bd)), block_weight, long_term_block_weight, cumulative_difficulty, already_generated_coins, txs);
+      if (cache_pow)
+        cache_pow_hash(id, proof_of_work);
+      update_output_distribution_cache(new_height, id, bl, txs);
     }
     catch (const KEY_IMAGE_EXISTS& e)
     {
@@ -4440,8 +4768,19 @@ leave:
     LOG_ERROR("Blocks that failed verification should not reach here");
   }
 
-  for (BlockAddedHook* hook : m_block_added_hooks)
-    hook->block_added(bl, txs);
+  try
+  {
+    for (BlockAddedHook* hook : m_block_added_hooks)
+      hook->block_added(bl, txs);
+  }
+  catch (const std::exception& e)
+  {
+    // the hooks' writes share the batch txn, so the whole batch must go
+    LOG_ERROR("Error in block added hook for block with hash: " << id << ", what = " << e.what());
+    m_batch_success = false;
+    bvc.m_verifivation_failed = true;
+    return false;
+  }
   TIME_MEASURE_FINISH(addblock);
 
   // do this after updating the hard fork state since the weight limit may change due to fork
@@ -4511,6 +4850,64 @@ bool Blockchain::check_blockchain_pruning()
   return m_db->check_pruning();
 }
 //------------------------------------------------------------------
+bool Blockchain::update_emission_index(size_t max_blocks)
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+  const uint64_t db_height = m_db->height();
+  const uint64_t start_height = m_db->get_emission_index_height();
+  if (start_height >= db_height)
+    return true;
+  const uint64_t end_height = std::min<uint64_t>(db_height, start_height + max_blocks);
+
+  try
+  {
+    block_emission_totals cumulative;
+    if (start_height > 0)
+      m_db->get_block_cumulative_emission(start_height - 1, cumulative);
+
+    // only the tx prefix and rct base are needed, and those survive pruning
+    db_wtxn_guard wtxn_guard(m_db);
+    cryptonote::blobdata bd;
+    transaction tx;
+    for (uint64_t height = start_height; height < end_height; ++height)
+    {
+      const block b = m_db->get_block_from_height(height);
+      block_emission_totals totals;
+      for (const crypto::hash &tx_hash: b.tx_hashes)
+      {
+        if (!m_db->get_pruned_tx_blob(tx_hash, bd) || !parse_and_validate_tx_base_from_blob(bd, tx))
+        {
+          MERROR("Failed to load tx " << tx_hash << " of block " << height << " for the emission index");
+          return false;
+        }
+        totals.add_tx(tx, b.major_version);
+      }
+      totals.set_miner_tx(b.miner_tx);
+      cumulative += totals;
+      m_db->set_block_cumulative_emission(height, cumulative);
+    }
+  }
+  catch (const DB_ERROR_TXN_START &e)
+  {
+    // a block sync batch holds the write txn, try again later
+    MDEBUG("Postponing emission index update: " << e.what());
+    return false;
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to update emission index: " << e.what());
+    return false;
+  }
+
+  if (end_height == db_height)
+    MGINFO("Emission index is up to date at height " << db_height);
+  else
+    MDEBUG("Emission index at height " << end_height << " / " << db_height);
+  return end_height == db_height;
+}
+//------------------------------------------------------------------
 uint64_t Blockchain::get_next_long_term_block_weight(uint64_t block_weight) const
 {
   PERF_TIMER(get_next_long_term_block_weight);
@@ -4717,19 +5114,97 @@ void Blockchain::set_enforce_dns_checkpoints(bool enforce_checkpoints)
 }
 
 //------------------------------------------------------------------
-void Blockchain::block_longhash_worker(cn_gpu_hash &hash_ctx, const epee::span<const block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map) const
+void Blockchain::cache_pow_hash(const crypto::hash &id, const crypto::hash &pow_hash)
+{
+  // the db keeps at most POW_HASH_CACHE_MAX_ENTRIES anyway, older queued ones would be trimmed on write
+  if (m_pending_pow_hashes.size() >= POW_HASH_CACHE_MAX_ENTRIES)
+    m_pending_pow_hashes.erase(m_pending_pow_hashes.begin());
+  m_pending_pow_hashes.emplace_back(id, pow_hash);
+}
+//------------------------------------------------------------------
+void Blockchain::flush_pow_hashes()
+{
+  if (m_pending_pow_hashes.empty())
+    return;
+
+  // the cache only saves work, failing to fill it must not fail the batch
+  try
+  {
+    m_db->add_pow_hashes(m_pending_pow_hashes, POW_HASH_CACHE_MAX_ENTRIES);
+  }
+  catch (const std::exception &e)
+  {
+    MWARNING("Failed to cache " << m_pending_pow_hashes.size() << " PoW hashes: " << e.what());
+  }
+  m_pending_pow_hashes.clear();
+}
+//------------------------------------------------------------------
+void Blockchain::update_output_distribution_cache(uint64_t height, const crypto::hash &id, const block &bl, const std::vector<std::pair<transaction, blobdata>> &txs)
+{
+  if (m_output_distribution_cache.empty())
+    return;
+
+  // mirrors BlockchainDB::add_transaction: v2 miner outputs are stored as rct
+  std::unordered_map<uint64_t, uint64_t> counts;
+  for (const auto &vout: bl.miner_tx.vout)
+    ++counts[bl.miner_tx.version >= 2 ? 0 : vout.amount];
+  for (const auto &tx: txs)
+    for (const auto &vout: tx.first.vout)
+      ++counts[vout.amount];
+
+  const uint64_t cumulative_rct = m_db->get_block_cumulative_rct_outputs({height})[0];
+  m_output_distribution_cache.on_block_added(height, id, cumulative_rct, counts);
+}
+//------------------------------------------------------------------
+void Blockchain::block_longhash_worker(const epee::span<cn_gpu_hash> &hash_ctxes, const epee::span<const block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map) const
 {
   TIME_MEASURE_START(t);
 
+  // cn-gpu blocks are queued up and hashed side by side, older blocks go through one at a time
+  const size_t ways = std::min<size_t>(hash_ctxes.size(), cn_gpu_hash::MULTI_WAYS);
+  cn_gpu_hash *ctx[cn_gpu_hash::MULTI_WAYS];
+  crypto::hash ids[cn_gpu_hash::MULTI_WAYS], pows[cn_gpu_hash::MULTI_WAYS];
+  blobdata blobs[cn_gpu_hash::MULTI_WAYS];
+  const void *in[cn_gpu_hash::MULTI_WAYS];
+  size_t len[cn_gpu_hash::MULTI_WAYS];
+  void *out[cn_gpu_hash::MULTI_WAYS];
+  size_t queued = 0;
+
+  const auto flush = [&]() {
+    for (size_t i = 0; i < queued; ++i)
+    {
+      ctx[i] = hash_ctxes.data() + i;
+      in[i] = blobs[i].data();
+      len[i] = blobs[i].size();
+      out[i] = pows[i].data;
+    }
+    cn_gpu_hash::hash_multi(ctx, in, len, out, queued);
+    for (size_t i = 0; i < queued; ++i)
+      map.emplace(ids[i], pows[i]);
+    queued = 0;
+  };
+
 	for(const auto &block : blocks)
 	{
 		if(m_cancel)
 			break;
 		crypto::hash id = get_block_hash(block);
+		if (m_blocks_longhash_table.count(id))
+			continue;
+		if (ways > 1 && block.major_version >= 6)
+		{
+			ids[queued] = id;
+			blobs[queued] = get_block_hashing_blob(block);
+			if (++queued == ways)
+				flush();
+			continue;
+		}
 		crypto::hash pow;
-		get_block_longhash(block, pow, hash_ctx);
+		get_block_longhash(block, pow, *hash_ctxes.data());
 		map.emplace(id, pow);
 	}
+	if (queued && !m_cancel)
+		flush();
 
 	TIME_MEASURE_FINISH(t);
 }
@@ -4747,6 +5222,7 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
   {
     if (m_batch_success)
     {
+      flush_pow_hashes();
       m_db->batch_stop();
       if (m_reset_timestamps_and_difficulties_height)
       {
@@ -4755,7 +5231,13 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
       }
     }
     else
+    {
       m_db->batch_abort();
+      m_output_distribution_cache.clear();
+      m_pending_pow_hashes.clear();
+      // the list applied blocks whose records the abort dropped, reload it from the committed ones
+      m_service_node_list.init();
+    }
     success = true;
   }
   catch (const std::exception &e)
@@ -5023,77 +5505,108 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
   unsigned threads = tpool.get_max_concurrency();
   blocks.resize(blocks_entry.size());
 
-  if (1)
+  // Parse and hash the blocks and their txes, and probe for the blocks, on
+  // the thread pool; only the chain link check below is left serial. The
+  // probes read the DB, so they stay serial unless it supports that.
+  const bool threaded_probes = m_db->can_thread_bulk_indices();
+  std::vector<crypto::hash> block_hashes(blocks_entry.size());
+  std::vector<char> block_parsed(blocks_entry.size(), 0), block_known(blocks_entry.size(), 0), txes_parsed(blocks_entry.size(), 0);
+  std::vector<size_t> first_tx(blocks_entry.size() + 1, 0);
+  for (size_t i = 0; i < blocks_entry.size(); ++i)
+    first_tx[i + 1] = first_tx[i] + blocks_entry[i].txs.size();
+  std::vector<std::pair<cryptonote::transaction, crypto::hash>> txes(total_txs);
   {
-    // limit threads, default limit = 4
-    if(threads > m_max_prepare_blocks_threads)
-      threads = m_max_prepare_blocks_threads;
-
-    unsigned int batches = blocks_entry.size() / threads;
-    unsigned int extra = blocks_entry.size() % threads;
-    MDEBUG("block_batches: " << batches);
-    std::vector<std::unordered_map<crypto::hash, crypto::hash>> maps(threads);
-    auto it = blocks_entry.begin();
-    unsigned blockidx = 0;
-
-    const crypto::hash tophash = m_db->top_block_hash();
-    for (unsigned i = 0; i < threads; i++)
-    {
-      for (unsigned int j = 0; j < batches; j++, ++blockidx)
+    auto parse_blocks = [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end && !m_cancel; ++i)
       {
-        block &block = blocks[blockidx];
-        crypto::hash block_hash;
-
-        if (!parse_and_validate_block_from_blob(it->block, block, block_hash))
-          return false;
+        if (!parse_and_validate_block_from_blob(blocks_entry[i].block, blocks[i], block_hashes[i]))
+          continue;
+        block_parsed[i] = 1;
+        if (threaded_probes)
+          block_known[i] = have_block_unlocked(block_hashes[i]);
 
-        // check first block and skip all blocks if its not chained properly
-        if (blockidx == 0)
+        bool ok = true;
+        for (size_t t = 0; t < blocks_entry[i].txs.size() && ok; ++t)
         {
-          if (block.prev_id != tophash)
-          {
-            MDEBUG("Skipping prepare blocks. New blocks don't belong to chain.");
-            blocks.clear();
-            return true;
-          }
+          std::pair<cryptonote::transaction, crypto::hash> &tx = txes[first_tx[i] + t];
+          ok = parse_and_validate_tx_base_from_blob(blocks_entry[i].txs[t].blob, tx.first);
+          if (ok)
+            cryptonote::get_transaction_prefix_hash(tx.first, tx.second);
         }
-        if (have_block(block_hash))
-          blocks_exist = true;
-
-        std::advance(it, 1);
+        txes_parsed[i] = ok;
       }
-    }
+    };
 
-    for (unsigned i = 0; i < extra && !blocks_exist; i++, blockidx++)
+    const size_t ntasks = std::min<size_t>(blocks_entry.size(), threads);
+    if (ntasks > 1)
     {
-      block &block = blocks[blockidx];
-      crypto::hash block_hash;
+      tools::threadpool::waiter waiter;
+      for (size_t t = 0; t < ntasks; ++t)
+        tpool.submit(&waiter, boost::bind<void>(parse_blocks, blocks_entry.size() * t / ntasks, blocks_entry.size() * (t + 1) / ntasks), true);
+      waiter.wait(&tpool);
+    }
+    else
+    {
+      parse_blocks(0, blocks_entry.size());
+    }
+  }
+  if (m_cancel)
+    return false;
 
-      if (!parse_and_validate_block_from_blob(it->block, block, block_hash))
-        return false;
+  // skip all blocks if the first is not chained properly
+  if (!block_parsed[0])
+    return false;
+  if (blocks[0].prev_id != m_db->top_block_hash())
+  {
+    MDEBUG("Skipping prepare blocks. New blocks don't belong to chain.");
+    blocks.clear();
+    return true;
+  }
 
-      if (have_block(block_hash))
-        blocks_exist = true;
+  for (size_t i = 0; i < blocks_entry.size(); ++i)
+  {
+    if (!block_parsed[i])
+      return false;
+    if (!threaded_probes)
+      block_known[i] = have_block(block_hashes[i]);
+  }
+  blocks_exist = std::find(block_known.begin(), block_known.end(), 1) != block_known.end();
 
-      std::advance(it, 1);
-    }
+  if (1)
+  {
+    // limit threads, default limit = 4
+    if(threads > m_max_prepare_blocks_threads)
+      threads = m_max_prepare_blocks_threads;
+
+    unsigned int batches = blocks_entry.size() / threads;
+    unsigned int extra = blocks_entry.size() % threads;
+    MDEBUG("block_batches: " << batches);
+    std::vector<std::unordered_map<crypto::hash, crypto::hash>> maps(threads);
 
       if (!blocks_exist)
     {
       m_blocks_longhash_table.clear();
+      // blocks seen before, e.g. after a pop or from an alt chain, don't get hashed again
+      for (size_t i = 0; i < block_hashes.size(); ++i)
+      {
+        crypto::hash pow;
+        if (m_db->get_pow_hash(block_hashes[i], pow))
+          m_blocks_longhash_table.emplace(block_hashes[i], pow);
+      }
       uint64_t thread_height = height;
       tools::threadpool::waiter waiter;
       m_prepare_height = height;
       m_prepare_nblocks = blocks_entry.size();
       m_prepare_blocks = &blocks;
-      if(m_hash_ctxes_multi.size() < threads)
-				m_hash_ctxes_multi.resize(threads);
+      const size_t ways = cn_gpu_hash::multi_ways();
+      if(m_hash_ctxes_multi.size() < threads * ways)
+				m_hash_ctxes_multi.resize(threads * ways);
       for (unsigned int i = 0; i < threads; i++)
       {
         unsigned nblocks = batches;
         if (i < extra)
           ++nblocks;
-				tpool.submit(&waiter, boost::bind(&Blockchain::block_longhash_worker, this, std::ref(m_hash_ctxes_multi[i]),  epee::span<const block>(&blocks[thread_height - height], nblocks), std::ref(maps[i])));
+				tpool.submit(&waiter, boost::bind(&Blockchain::block_longhash_worker, this, epee::span<cn_gpu_hash>(&m_hash_ctxes_multi[i * ways], ways),  epee::span<const block>(&blocks[thread_height - height], nblocks), std::ref(maps[i])));
         thread_height += nblocks;
       }
 
@@ -5138,7 +5651,6 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
   std::map<uint64_t, std::vector<uint64_t>> offset_map;
   // [output] stores all output_data_t for each absolute_offset
   std::map<uint64_t, std::vector<output_data_t>> tx_map;
-  std::vector<std::pair<cryptonote::transaction, crypto::hash>> txes(total_txs);
 
 #define SCAN_TABLE_QUIT(m) \
         do { \
@@ -5153,19 +5665,17 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
   {
     if (m_cancel)
       return false;
+    if (!txes_parsed[block_index])
+      SCAN_TABLE_QUIT("Could not parse tx from incoming blocks.");
 
     for (const auto &tx_blob : entry.txs)
     {
       if (tx_index >= txes.size())
         SCAN_TABLE_QUIT("tx_index is out of sync");
-      transaction &tx = txes[tx_index].first;
-      crypto::hash &tx_prefix_hash = txes[tx_index].second;
+      const transaction &tx = txes[tx_index].first;
+      const crypto::hash &tx_prefix_hash = txes[tx_index].second;
       ++tx_index;
 
-      if (!parse_and_validate_tx_base_from_blob(tx_blob.blob, tx))
-        SCAN_TABLE_QUIT("Could not parse tx from incoming blocks.");
-      cryptonote::get_transaction_prefix_hash(tx, tx_prefix_hash);
-
       auto its = m_scan_table.find(tx_prefix_hash);
       if (its != m_scan_table.end())
         SCAN_TABLE_QUIT("Duplicate tx found from incoming blocks.");
@@ -60,6 +60,7 @@
 #include "checkpoints/checkpoints.h"
 #include "cryptonote_basic/hardfork.h"
 #include "blockchain_db/blockchain_db.h"
+#include "output_distribution_cache.h"
 namespace service_nodes
 {
   class service_node_list;
@@ -491,6 +492,23 @@ namespace cryptonote
      */
     bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, bool get_miner_tx_hash, size_t max_count) const;
 
+    /**
+     * @brief get recent blocks for a foreign chain, with their tx output indices
+     *
+     * Like find_blockchain_supplement, but everything is read from a single db
+     * read transaction without taking the blockchain lock, and the output
+     * indices of all returned txes are read in one pass.  If the first
+     * qblock_ids entry is our top block, no blocks are returned and
+     * start_height is 0.
+     *
+     * @param output_indices return-by-reference, per block, the output indices of the miner tx (empty unless get_miner_tx) followed by those of each tx
+     * @param top_hash return-by-reference the hash of our top block as seen by the read
+     * @param get_miner_tx whether to return the miner txes' hashes and output indices
+     *
+     * @return true if a block found in common or req_start_block specified, else false
+     */
+    bool get_blocks_fast(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, std::vector<std::vector<std::vector<uint64_t>>>& output_indices, uint64_t& total_height, uint64_t& start_height, crypto::hash& top_hash, bool pruned, bool get_miner_tx, size_t max_count) const;
+
     /**
      * @brief retrieves a set of blocks and their transactions, and possibly other transactions
      *
@@ -501,6 +519,9 @@ namespace cryptonote
      * @param arg the request
      * @param rsp return-by-reference the response to fill in
      *
+     * Blocks and transactions are served from their stored blobs under a
+     * single db read transaction, without the blockchain lock.
+     *
      * @return true unless any blocks or transactions are missing
      */
     bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp);
@@ -644,6 +665,26 @@ namespace cryptonote
      */
     bool check_tx_inputs(transaction& tx, uint64_t& pmax_used_block_height, crypto::hash& max_used_block_id, tx_verification_context &tvc, bool kept_by_block = false) const;
 
+    /**
+     * @brief validates a transaction's inputs, leaving the ringct MLSAGs to the caller
+     *
+     * Only the chain lookups run under the blockchain lock.  The MLSAGs of simple
+     * ringct transactions are handed back so they can be verified without it, and
+     * the chain state the lookups were made against is reported so the result can
+     * be rechecked cheaply should the chain move on.
+     *
+     * @param tx the transaction to validate
+     * @param max_used_block_height return-by-reference block height of most recent input
+     * @param max_used_block_id return-by-reference block hash of most recent input
+     * @param tvc returned information about tx verification
+     * @param deferred_rct return-by-reference signatures still needing rct::verRctNonSemanticsSimple
+     * @param top_id return-by-reference top block id at the time of the checks
+     * @param hf_version return-by-reference hard fork version the checks were made under
+     *
+     * @return false if any input is invalid, otherwise true
+     */
+    bool check_tx_inputs_deferred(transaction& tx, uint64_t& max_used_block_height, crypto::hash& max_used_block_id, tx_verification_context &tvc, std::vector<const rct::rctSig*> &deferred_rct, crypto::hash &top_id, uint8_t &hf_version) const;
+
     /**
      * @brief get fee quantization mask
      *
@@ -771,6 +812,45 @@ namespace cryptonote
      */
     bool get_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs, bool pruned = false) const;
     bool get_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<tx_blob_entry>& txs, std::vector<crypto::hash>& missed_txs, bool pruned = false) const;
+
+    /**
+     * @brief gets full transaction blobs under a db read transaction, without the blockchain lock
+     *
+     * @copydetails get_transactions_blobs
+     */
+    bool get_stored_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs) const;
+
+    /**
+     * @brief gets a main chain block's blob and its transaction hashes without parsing the block
+     *
+     * Reads under a db read transaction only, without the blockchain lock.
+     * The hashes come from the db's per-block index; blocks stored before
+     * it existed are parsed instead.
+     *
+     * @param blkid the block hash
+     * @param block_blob return-by-reference the block blob
+     * @param tx_hashes return-by-reference the block's transaction hashes, miner tx excluded
+     *
+     * @return false if the block is not in the main chain, else true
+     */
+    bool get_block_blob_and_tx_hashes(const crypto::hash &blkid, cryptonote::blobdata &block_blob, std::vector<crypto::hash> &tx_hashes) const;
+
+    /**
+     * @brief gets the serialized wallet filters of a range of main chain blocks
+     *
+     * Reads under a db read transaction only, without the blockchain lock.
+     * Filters of blocks stored before the db kept them are built on the fly.
+     *
+     * @param start_height the height of the first block
+     * @param max_count the max number of filters to get
+     * @param max_size stop once the filters add up to this many bytes
+     * @param filters return-by-reference the serialized block_filters, in height order
+     * @param current_height return-by-reference our current blockchain height
+     * @param built_count return-by-reference how many filters had to be built from their block
+     *
+     * @return false if start_height is above our chain or on db error, else true
+     */
+    bool get_block_filters(uint64_t start_height, size_t max_count, size_t max_size, std::vector<cryptonote::blobdata>& filters, uint64_t& current_height, size_t& built_count) const;
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     bool get_split_transactions_blobs(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) const;
     template<class t_ids_container, class t_tx_container, class t_missed_container>
@@ -852,6 +932,7 @@ namespace cryptonote
      * @param stats the new time stats setting
      */
     void set_show_time_stats(bool stats) { m_show_time_stats = stats; }
+    bool get_show_time_stats() const { return m_show_time_stats; }
 
     /**
      * @brief gets the hardfork voting state object
@@ -1028,14 +1109,56 @@ namespace cryptonote
     void output_scan_worker(const uint64_t amount,const std::vector<uint64_t> &offsets,
         std::vector<output_data_t> &outputs) const;
 
+    /**
+     * @brief queues a block's PoW hash for the db's bounded PoW hash cache
+     *
+     * The hash is written by flush_pow_hashes() inside the incoming blocks
+     * batch, so caching does not commit a write transaction of its own.
+     *
+     * @param id the block hash
+     * @param pow_hash the block's PoW hash
+     */
+    void cache_pow_hash(const crypto::hash &id, const crypto::hash &pow_hash);
+
+    /**
+     * @brief writes the queued PoW hashes to the db's PoW hash cache
+     *
+     * Failures are logged and otherwise ignored.
+     */
+    void flush_pow_hashes();
+
+    /**
+     * @brief gets an amount's cached output distribution, loading it from the db if needed
+     *
+     * @param amount the amount
+     * @param to_height the highest height the distribution must cover
+     *
+     * @return the distribution, or null if it can't be cached
+     */
+    output_distribution_cache::distribution_ptr get_cached_output_distribution(uint64_t amount, uint64_t to_height) const;
+
+    /**
+     * @brief extends the cached output distributions by a block just added to the db
+     *
+     * @param height the block's height
+     * @param id the block hash
+     * @param bl the block
+     * @param txs the block's transactions
+     */
+    void update_output_distribution_cache(uint64_t height, const crypto::hash &id, const block &bl, const std::vector<std::pair<transaction, blobdata>> &txs);
+
     /**
      * @brief computes the "short" and "long" hashes for a set of blocks
      *
-     * @param height the height of the first block
+     * When given more than one hash context, cn-gpu blocks are hashed that
+     * many at a time with cn_gpu_hash::hash_multi. Blocks already in
+     * m_blocks_longhash_table, i.e. found in the PoW hash cache, are skipped.
+     *
+     * @param hash_ctxes the hash contexts owned by this worker
      * @param blocks the blocks to be hashed
      * @param map return-by-reference the hashes for each block
      */
-    void block_longhash_worker(cn_gpu_hash &hash_ctx, const epee::span<const block> &blocks,
+    void block_longhash_worker(const epee::span<cn_gpu_hash> &hash_ctxes, const epee::span<const block> &blocks,
         std::unordered_map<crypto::hash, crypto::hash> &map) const;
 
     /**
@@ -1062,6 +1185,17 @@ namespace cryptonote
     bool update_blockchain_pruning();
     bool check_blockchain_pruning();
 
+    /**
+     * @brief fill in cumulative emission totals for blocks stored before the DB indexed them
+     *
+     * Resumes from the first unindexed block and works up the chain.
+     *
+     * @param max_blocks the most blocks to index in this call, which holds the blockchain lock
+     *
+     * @return true once every block in the chain is indexed
+     */
+    bool update_emission_index(size_t max_blocks);
+
     void lock();
     void unlock();
 
@@ -1195,7 +1329,12 @@ namespace cryptonote
     std::atomic<bool> m_cancel;
 
     cn_gpu_hash m_pow_ctx;
-    std::vector<cn_gpu_hash> m_hash_ctxes_multi;
+    std::vector<cn_gpu_hash> m_hash_ctxes_multi; // cn_gpu_hash::multi_ways() contexts per prepare thread
+
+    mutable output_distribution_cache m_output_distribution_cache;
+    mutable boost::mutex m_output_distribution_load_lock; // one db load per cache miss
+
+    std::vector<std::pair<crypto::hash, crypto::hash>> m_pending_pow_hashes; // written with the next batch
 
     // block template cache
     block m_btc;
@@ -1276,13 +1415,19 @@ namespace cryptonote
      * Currently this function calls ring signature validation for each
      * transaction.
      *
+     * If deferred_rct is not NULL, a simple ringct transaction's MLSAGs are
+     * not checked here; its rct signature is appended instead, for the caller
+     * to verify together with others (see rct::verRctNonSemanticsSimple).
+     * It points into tx, which must outlive that check.
+     *
      * @param tx the transaction to validate
      * @param tvc returned information about tx verification
      * @param pmax_related_block_height return-by-pointer the height of the most recent block in the input set
+     * @param deferred_rct return-by-pointer rct signatures left to verify
      *
      * @return false if any validation step fails, otherwise true
      */
-    bool check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height = NULL) const;
+    bool check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height = NULL, std::vector<const rct::rctSig*>* deferred_rct = NULL) const;
 
     /**
      * @brief performs a blockchain reorganization according to the longest chain rule
@@ -1587,6 +1732,14 @@ namespace cryptonote
     void check_ring_signature(const crypto::hash &tx_prefix_hash, const crypto::key_image &key_image,
         const std::vector<rct::ctkey> &pubkeys, const std::vector<crypto::signature> &sig, uint64_t &result) const;
 
+    /**
+     * @brief have_block without taking the blockchain lock
+     *
+     * For thread pool workers of a caller that holds the lock and changes
+     * nothing until they are done.
+     */
+    bool have_block_unlocked(const crypto::hash& id) const;
+
     /**
      * @brief loads block hashes from compiled-in data set
      *
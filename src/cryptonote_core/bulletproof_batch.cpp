@@ -0,0 +1,125 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+
+#include "misc_log_ex.h"
+#include "ringct/rctSigs.h"
+#include "bulletproof_batch.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "verify"
+
+namespace cryptonote
+{
+  // rvs[begin, end) is known to contain a bad proof if known_bad
+  static void bisect_bulletproofs(const std::vector<const rct::rctSig*>& rvs, size_t begin, size_t end, bool known_bad, std::vector<bool>& valid)
+  {
+    if (!known_bad && rct::verRctSemanticsSimple(std::vector<const rct::rctSig*>(rvs.begin() + begin, rvs.begin() + end)))
+      return;
+    if (end - begin == 1)
+    {
+      valid[begin] = false;
+      return;
+    }
+
+    const size_t mid = begin + (end - begin) / 2;
+    const bool left_ok = rct::verRctSemanticsSimple(std::vector<const rct::rctSig*>(rvs.begin() + begin, rvs.begin() + mid));
+    if (!left_ok)
+      bisect_bulletproofs(rvs, begin, mid, true, valid);
+    // with the left half good, the bad proof must be in the right one
+    bisect_bulletproofs(rvs, mid, end, left_ok, valid);
+  }
+
+  bool verify_bulletproof_semantics(const std::vector<const rct::rctSig*>& rvs, std::vector<bool>& valid)
+  {
+    valid.assign(rvs.size(), true);
+    if (rvs.empty() || rct::verRctSemanticsSimple(rvs))
+      return true;
+
+    MDEBUG("Bulletproof batch of " << rvs.size() << " failed, bisecting");
+    bisect_bulletproofs(rvs, 0, rvs.size(), true, valid);
+    return false;
+  }
+
+  bool bulletproof_queue::check(const std::vector<const rct::rctSig*>& rvs, std::vector<bool>& valid)
+  {
+    pending mine = {&rvs, &valid, false};
+
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_pending.push_back(&mine);
+    while (!mine.done)
+    {
+      if (m_busy)
+      {
+        m_cond.wait(lock);
+        continue;
+      }
+
+      m_busy = true;
+      if (const uint64_t window_us = m_window_us)
+      {
+        lock.unlock();
+        boost::this_thread::sleep_for(boost::chrono::microseconds(window_us));
+        lock.lock();
+      }
+      std::vector<pending*> batch;
+      batch.swap(m_pending);
+      lock.unlock();
+
+      std::vector<const rct::rctSig*> all;
+      for (const pending* p : batch)
+        all.insert(all.end(), p->rvs->begin(), p->rvs->end());
+      std::vector<bool> all_valid;
+      verify_bulletproof_semantics(all, all_valid);
+
+      lock.lock();
+      size_t offset = 0;
+      for (pending* p : batch)
+      {
+        p->valid->assign(all_valid.begin() + offset, all_valid.begin() + offset + p->rvs->size());
+        offset += p->rvs->size();
+        p->done = true;
+      }
+      if (batch.size() > 1)
+        m_window_us = std::min(MAX_WINDOW_US, m_window_us + WINDOW_STEP_US);
+      else
+        m_window_us /= 2;
+      m_busy = false;
+      m_cond.notify_all();
+    }
+    return std::find(valid.begin(), valid.end(), false) == valid.end();
+  }
+
+  uint64_t bulletproof_queue::window_us() const
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    return m_window_us;
+  }
+}
@@ -0,0 +1,90 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "ringct/rctTypes.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief checks the semantics (range proofs and sums) of Bulletproof rct
+   * signatures as one multiexp batch
+   *
+   * When the batch fails it is split in halves, and only failing halves are
+   * split further, so that a bad proof among n costs about 2 log(n) smaller
+   * batches rather than n single checks.
+   *
+   * @param rvs the rct signatures to check
+   * @param valid return-by-reference one flag per rct signature
+   *
+   * @return true if all are valid
+   */
+  bool verify_bulletproof_semantics(const std::vector<const rct::rctSig*>& rvs, std::vector<bool>& valid);
+
+  /**
+   * @brief merges the Bulletproof checks of concurrent callers (e.g. one per
+   * relayed tx message) into shared batches
+   *
+   * A caller that finds no batch running takes everything queued and checks
+   * it; the others wait for its result. When batches keep merging several
+   * callers, the one starting a batch first waits a short while for more to
+   * arrive; the wait grows while that pays off and shrinks back to nothing
+   * when callers come alone.
+   */
+  class bulletproof_queue
+  {
+  public:
+    static constexpr uint64_t MAX_WINDOW_US = 4000;
+    static constexpr uint64_t WINDOW_STEP_US = 250;
+
+    bool check(const std::vector<const rct::rctSig*>& rvs, std::vector<bool>& valid);
+
+    // current batching wait, read under the lock that guards its updates
+    uint64_t window_us() const;
+
+  private:
+    struct pending
+    {
+      const std::vector<const rct::rctSig*>* rvs;
+      std::vector<bool>* valid;
+      bool done;
+    };
+
+    mutable boost::mutex m_mutex;
+    boost::condition_variable m_cond;
+    std::vector<pending*> m_pending;
+    bool m_busy = false;
+    uint64_t m_window_us = 0;
+  };
+}
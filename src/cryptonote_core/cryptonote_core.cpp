@@ -44,9 +44,11 @@ using namespace epee;
 #include "common/command_line.h"
 #include "warnings.h"
 #include "crypto/crypto.h"
+#include "crypto/pow_hash/cn_slow_hash.hpp"
 #include "cryptonote_config.h"
 #include "misc_language.h"
 #include "file_io_utils.h"
+#include "profile_tools.h"
 #include <csignal>
 #include "checkpoints/checkpoints.h"
 #include "ringct/rctTypes.h"
@@ -221,6 +223,11 @@ namespace cryptonote
     "is acted upon."
   , ""
   };
+  static const command_line::arg_descriptor<std::string> arg_pow_huge_pages  = {
+    "pow-huge-pages"
+  , "Back proof-of-work scratchpads with huge pages: [off|2mb|1gb]. Falls back to smaller pages when the system has none reserved"
+  , "2mb"
+  };
   static const command_line::arg_descriptor<bool> arg_keep_alt_blocks  = {
     "keep-alt-blocks"
   , "Keep alternative blocks on restart"
@@ -235,6 +242,9 @@ namespace cryptonote
               m_quorum_cop(*this),
               m_miner(this),
               m_miner_address(boost::value_initialized<account_public_address>()),
+              m_template_reward_top(crypto::null_hash),
+              m_template_reward_cookie(0),
+              m_template_reward(0),
               m_starter_message_showed(false),
               m_target_blockchain_height(0),
               m_checkpoints_path(""),
@@ -347,6 +357,7 @@ namespace cryptonote
     command_line::add_arg(desc, arg_reorg_notify);
     command_line::add_arg(desc, arg_block_rate_notify);
     command_line::add_arg(desc, arg_keep_alt_blocks);
+    command_line::add_arg(desc, arg_pow_huge_pages);
 
     miner::init_options(desc);
     BlockchainDB::init_options(desc);
@@ -394,6 +405,19 @@ namespace cryptonote
 
     m_service_node = command_line::get_arg(vm, arg_service_node);
 
+    const std::string pow_huge_pages = command_line::get_arg(vm, arg_pow_huge_pages);
+    if (pow_huge_pages == "off")
+      cn_pad_set_mode(CN_PAD_MODE_OFF);
+    else if (pow_huge_pages == "2mb")
+      cn_pad_set_mode(CN_PAD_MODE_2MB);
+    else if (pow_huge_pages == "1gb")
+      cn_pad_set_mode(CN_PAD_MODE_1GB);
+    else
+    {
+      MERROR("Invalid argument to --" << arg_pow_huge_pages.name << ": " << pow_huge_pages << ", expected off, 2mb or 1gb");
+      return false;
+    }
+
     epee::debug::g_test_dbg_lock_sleep() = command_line::get_arg(vm, arg_test_dbg_lock_sleep);
 
     return true;
@@ -434,6 +458,16 @@ namespace cryptonote
     return m_blockchain_storage.get_transactions_blobs(txs_ids, txs, missed_txs);
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::get_stored_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs) const
+  {
+    return m_blockchain_storage.get_stored_transactions_blobs(txs_ids, txs, missed_txs);
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::get_block_blob_and_tx_hashes(const crypto::hash &blkid, cryptonote::blobdata &block_blob, std::vector<crypto::hash> &tx_hashes) const
+  {
+    return m_blockchain_storage.get_block_blob_and_tx_hashes(blkid, block_blob, tx_hashes);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::get_split_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<std::tuple<crypto::hash, cryptonote::blobdata, crypto::hash, cryptonote::blobdata>>& txs, std::vector<crypto::hash>& missed_txs) const
   {
     return m_blockchain_storage.get_split_transactions_blobs(txs_ids, txs, missed_txs);
@@ -924,6 +958,7 @@ namespace cryptonote
     }
 
     std::vector<const rct::rctSig*> rvv;
+    std::vector<size_t> rvv_index;
     for (size_t n = 0; n < tx_info.size(); ++n)
     {
       if (!check_tx_semantic(*tx_info[n].tx, keeped_by_block))
@@ -975,7 +1010,14 @@ namespace cryptonote
             tx_info[n].result = false;
             break;
           }
+          if (keeped_by_block)
+          {
+            boost::lock_guard<boost::mutex> lock(m_preverified_txes_lock);
+            if (m_preverified_txes.erase(tx_info[n].tx_hash))
+              break;
+          }
           rvv.push_back(&rv); // delayed batch verification
+          rvv_index.push_back(n);
           break;
         default:
           MERROR_VER("Unknown rct type: " << rv.type);
@@ -985,29 +1027,80 @@ namespace cryptonote
           break;
       }
     }
-    if (!rvv.empty() && !rct::verRctSemanticsSimple(rvv))
+    if (rvv.empty())
+      return ret;
+
+    // Relayed txes are merged with those of other relays; block txes are not
+    // held up waiting for them.
+    std::vector<bool> valid;
+    const bool all_valid = keeped_by_block ? verify_bulletproof_semantics(rvv, valid) : m_bulletproof_queue.check(rvv, valid);
+    if (!all_valid)
     {
-      LOG_PRINT_L1("One transaction among this group has bad semantics, verifying one at a time");
+      LOG_PRINT_L1("One transaction among this group has bad semantics");
       ret = false;
-      const bool assumed_bad = rvv.size() == 1; // if there's only one tx, it must be the bad one
-      for (size_t n = 0; n < tx_info.size(); ++n)
+      for (size_t i = 0; i < rvv.size(); ++i)
       {
-        if (!tx_info[n].result)
-          continue;
-        if (tx_info[n].tx->rct_signatures.type != rct::RCTTypeBulletproof && tx_info[n].tx->rct_signatures.type != rct::RCTTypeBulletproof2)
+        if (valid[i])
           continue;
-        if (assumed_bad || !rct::verRctSemanticsSimple(tx_info[n].tx->rct_signatures))
-        {
-          set_semantics_failed(tx_info[n].tx_hash);
-          tx_info[n].tvc.m_verifivation_failed = true;
-          tx_info[n].result = false;
-        }
+        const size_t n = rvv_index[i];
+        set_semantics_failed(tx_info[n].tx_hash);
+        tx_info[n].tvc.m_verifivation_failed = true;
+        tx_info[n].result = false;
       }
     }
 
     return ret;
   }
   //-----------------------------------------------------------------------------------------------
+  void core::preverify_incoming_block_txs(const std::vector<block_complete_entry> &blocks_entry)
+  {
+    if (get_blockchain_storage().is_within_compiled_block_hash_area())
+      return;
+
+    std::vector<const tx_blob_entry*> blobs;
+    for (const block_complete_entry &entry : blocks_entry)
+      for (const tx_blob_entry &tx_blob : entry.txs)
+        if (tx_blob.prunable_hash == crypto::null_hash) // pruned txes carry no proofs
+          blobs.push_back(&tx_blob);
+    // a single block's txes are batched together by handle_incoming_txs anyway
+    if (blocks_entry.size() < 2 || blobs.size() < 2)
+      return;
+
+    struct result { bool res; cryptonote::transaction tx; crypto::hash hash; };
+    std::vector<result> results(blobs.size());
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    for (size_t i = 0; i < blobs.size(); i++) {
+      tpool.submit(&waiter, [&, i] {
+        results[i].res = parse_and_validate_tx_from_blob(blobs[i]->blob, results[i].tx, results[i].hash);
+      });
+    }
+    waiter.wait(&tpool);
+
+    std::vector<const rct::rctSig*> rvv;
+    std::vector<size_t> rvv_index;
+    for (size_t i = 0; i < results.size(); i++) {
+      const transaction &tx = results[i].tx;
+      if (!results[i].res || tx.version < 2 || tx.is_deregister_tx())
+        continue;
+      if (tx.rct_signatures.type != rct::RCTTypeBulletproof && tx.rct_signatures.type != rct::RCTTypeBulletproof2)
+        continue;
+      if (!is_canonical_bulletproof_layout(tx.rct_signatures.p.bulletproofs))
+        continue;
+      rvv.push_back(&tx.rct_signatures);
+      rvv_index.push_back(i);
+    }
+
+    std::vector<bool> valid;
+    verify_bulletproof_semantics(rvv, valid);
+    MDEBUG("Checked the Bulletproofs of " << rvv.size() << " txes in " << blocks_entry.size() << " incoming blocks");
+
+    boost::lock_guard<boost::mutex> lock(m_preverified_txes_lock);
+    for (size_t i = 0; i < rvv.size(); i++)
+      if (valid[i])
+        m_preverified_txes.insert(results[rvv_index[i]].hash);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::handle_incoming_txs(const epee::span<const tx_blob_entry> tx_blobs, epee::span<tx_verification_context> tvc, relay_method tx_relay, bool relayed)
   {
     TRY_ENTRY();
@@ -1021,8 +1114,10 @@ namespace cryptonote
     struct result { bool res; cryptonote::transaction tx; crypto::hash hash; };
     std::vector<result> results(tx_blobs.size());
 
-    CRITICAL_REGION_LOCAL(m_incoming_tx_lock);
-
+    // The checks up to the semantics ones don't depend on the pool or chain,
+    // so concurrent callers run them (and share Bulletproof batches) before
+    // taking the lock to add their txes.
+    TIME_MEASURE_NS_START(parse_time);
     tools::threadpool& tpool = tools::threadpool::getInstance();
     tools::threadpool::waiter waiter;
     epee::span<tx_blob_entry>::const_iterator it = tx_blobs.begin();
@@ -1041,6 +1136,9 @@ namespace cryptonote
       });
     }
     waiter.wait(&tpool);
+    TIME_MEASURE_NS_FINISH(parse_time);
+
+    TIME_MEASURE_NS_START(semantics_time);
     it = tx_blobs.begin();
     std::vector<bool> already_have(tx_blobs.size(), false);
     for (size_t i = 0; i < tx_blobs.size(); i++, ++it) {
@@ -1083,7 +1181,46 @@ namespace cryptonote
     }
     if (!tx_info.empty())
       handle_incoming_tx_accumulated_batch(tx_info, tx_relay == relay_method::block);
+    TIME_MEASURE_NS_FINISH(semantics_time);
 
+    std::vector<uint64_t> weights(tx_blobs.size(), 0);
+    it = tx_blobs.begin();
+    for (size_t i = 0; i < tx_blobs.size(); i++, ++it) {
+      if (results[i].res && !already_have[i])
+        weights[i] = results[i].tx.pruned ? get_pruned_transaction_weight(results[i].tx) : get_transaction_weight(results[i].tx, it->blob.size());
+    }
+
+    // Inputs are checked against the chain in parallel as well, outside the pool
+    // lock. add_tx finds the results in the pool's input cache and only rechecks
+    // key images and ring members if the chain moved on in the meantime. Txes
+    // add_tx would turn away on its cheap checks skip this.
+    TIME_MEASURE_NS_START(inputs_time);
+    if (tx_relay != relay_method::block)
+    {
+      const uint8_t version = m_blockchain_storage.get_current_hard_fork_version();
+      for (size_t i = 0; i < tx_blobs.size(); i++) {
+        if (!results[i].res || already_have[i])
+          continue;
+        if (!m_mempool.may_add_tx(results[i].tx, results[i].hash, weights[i], false, version))
+          continue;
+        tpool.submit(&waiter, [&, i] {
+          try
+          {
+            m_mempool.precheck_tx_inputs(results[i].tx, results[i].hash);
+          }
+          catch (const std::exception &e)
+          {
+            // add_tx will check this one itself
+            MERROR_VER("Exception checking inputs of tx " << results[i].hash << ": " << e.what());
+          }
+        });
+      }
+      waiter.wait(&tpool);
+    }
+    TIME_MEASURE_NS_FINISH(inputs_time);
+
+    TIME_MEASURE_NS_START(add_time);
+    CRITICAL_REGION_LOCAL(m_incoming_tx_lock);
     bool ok = true;
     it = tx_blobs.begin();
     for (size_t i = 0; i < tx_blobs.size(); i++, ++it) {
@@ -1097,8 +1234,7 @@ namespace cryptonote
       if (already_have[i])
         continue;
 
-      const uint64_t weight = results[i].tx.pruned ? get_pruned_transaction_weight(results[i].tx) : get_transaction_weight(results[i].tx, it->blob.size());
-      ok &= add_new_tx(results[i].tx, results[i].hash, tx_blobs[i].blob, weight, tvc[i], tx_relay, relayed);
+      ok &= add_new_tx(results[i].tx, results[i].hash, tx_blobs[i].blob, weights[i], tvc[i], tx_relay, relayed);
 
       if(tvc[i].m_verifivation_failed)
       {MERROR_VER("Transaction verification failed: " << results[i].hash);}
@@ -1108,6 +1244,11 @@ namespace cryptonote
       if(tvc[i].m_added_to_pool)
         MDEBUG("tx added: " << results[i].hash);
     }
+    TIME_MEASURE_NS_FINISH(add_time);
+
+    if (m_blockchain_storage.get_show_time_stats())
+      MINFO("Incoming txes: " << tx_blobs.size() << ", parse " << parse_time / 1000 << " us, semantics " << semantics_time / 1000
+          << " us, inputs " << inputs_time / 1000 << " us, pool add " << add_time / 1000 << " us");
     return ok;
 
     CATCH_ENTRY_L0("core::handle_incoming_txs()", false);
@@ -1240,6 +1381,22 @@ namespace cryptonote
     if (count)
     {
       const uint64_t end = start_offset + count - 1;
+
+      // once the range is indexed the sums are the difference of two cumulative totals,
+      // read in one txn so a block added in between can't skew them
+      {
+        BlockchainDB &db = m_blockchain_storage.get_db();
+        db_rtxn_guard rtxn_guard(&db);
+        const uint64_t db_height = db.height();
+        const uint64_t top = std::min<uint64_t>(end, db_height - 1);
+        block_emission_totals hi, lo;
+        if (db_height > 0 && start_offset <= top && db.get_block_cumulative_emission(top, hi) && (start_offset == 0 || db.get_block_cumulative_emission(start_offset - 1, lo)))
+        {
+          hi -= lo;
+          return std::tuple<uint64_t, boost::multiprecision::uint128_t, boost::multiprecision::uint128_t>(hi.burned, hi.emission, hi.fees);
+        }
+      }
+
       m_blockchain_storage.for_blocks_range(start_offset, end,
         [this, &emission_amount, &total_fee_amount, &burnt_xeq](uint64_t, const crypto::hash& hash, const block& b){
 		  std::vector <transaction> txs;
@@ -1398,6 +1555,11 @@ namespace cryptonote
 	  return result;
   }
   //-----------------------------------------------------------------------------------------------
+  service_nodes::uptime_proof_stats core::get_uptime_proof_stats() const
+  {
+	  return m_quorum_cop.get_uptime_proof_stats();
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::handle_uptime_proof(const NOTIFY_UPTIME_PROOF::request &proof, bool &my_uptime_proof_confirmation)
   {
 	  return m_quorum_cop.handle_uptime_proof(proof, my_uptime_proof_confirmation);
@@ -1448,6 +1610,58 @@ namespace cryptonote
     return m_blockchain_storage.create_block_template(b, prev_block, adr, diffic, height, expected_reward, ex_nonce);
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::wait_for_block_template_change(const crypto::hash &top_id, uint64_t expected_reward, const account_public_address &adr, std::chrono::milliseconds timeout)
+  {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    uint64_t cookie = m_mempool.cookie();
+    while (true)
+    {
+      const crypto::hash tail_id = m_blockchain_storage.get_tail_id();
+      if (tail_id != top_id)
+        return true;
+
+      // the pool moved on: see whether the reward moved enough to be worth a new template,
+      // sharing the answer between waiters so a busy pool costs one template per change
+      const uint64_t current_cookie = m_mempool.cookie();
+      if (current_cookie != cookie)
+      {
+        cookie = current_cookie;
+        uint64_t reward = 0;
+        bool have_reward = false;
+        {
+          boost::lock_guard<boost::mutex> lock(m_template_reward_lock);
+          if (m_template_reward_top == tail_id && m_template_reward_cookie == cookie)
+          {
+            reward = m_template_reward;
+            have_reward = true;
+          }
+        }
+        if (!have_reward)
+        {
+          block b;
+          difficulty_type diffic;
+          uint64_t height;
+          if (get_block_template(b, adr, diffic, height, reward, blobdata()) && b.prev_id == tail_id)
+          {
+            boost::lock_guard<boost::mutex> lock(m_template_reward_lock);
+            m_template_reward_top = tail_id;
+            m_template_reward_cookie = cookie;
+            m_template_reward = reward;
+            have_reward = true;
+          }
+        }
+        const uint64_t reward_change = reward > expected_reward ? reward - expected_reward : expected_reward - reward;
+        if (have_reward && reward_change >= expected_reward / 1000 * BLOCK_TEMPLATE_REFRESH_REWARD_PERMILLE)
+          return true;
+      }
+
+      const auto now = std::chrono::steady_clock::now();
+      if (now >= deadline)
+        return false;
+      m_mempool.wait_for_change(cookie, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now));
+    }
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, bool clip_pruned, NOTIFY_RESPONSE_CHAIN_ENTRY::request& resp) const
   {
     return m_blockchain_storage.find_blockchain_supplement(qblock_ids, clip_pruned, resp);
@@ -1458,6 +1672,11 @@ namespace cryptonote
     return m_blockchain_storage.find_blockchain_supplement(req_start_block, qblock_ids, blocks, total_height, start_height, pruned, get_miner_tx_hash, max_count);
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::get_blocks_fast(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, std::vector<std::vector<std::vector<uint64_t>>>& output_indices, uint64_t& total_height, uint64_t& start_height, crypto::hash& top_hash, bool pruned, bool get_miner_tx, size_t max_count) const
+  {
+    return m_blockchain_storage.get_blocks_fast(req_start_block, qblock_ids, blocks, output_indices, total_height, start_height, top_hash, pruned, get_miner_tx, max_count);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) const
   {
 	  return m_blockchain_storage.get_random_outs_for_amounts(req, res);
@@ -1592,6 +1811,7 @@ namespace cryptonote
       cleanup_handle_incoming_blocks(false);
       return false;
     }
+    preverify_incoming_block_txs(blocks_entry);
     return true;
   }
 
@@ -1603,6 +1823,10 @@ namespace cryptonote
       success = m_blockchain_storage.cleanup_handle_incoming_blocks(force_sync);
     }
     catch (...) {}
+    {
+      boost::lock_guard<boost::mutex> lock(m_preverified_txes_lock);
+      m_preverified_txes.clear();
+    }
     m_incoming_tx_lock.unlock();
     return success;
   }
@@ -1827,6 +2051,7 @@ namespace cryptonote
 
 	  m_uptime_proof_pruner.do_call(boost::bind(&service_nodes::quorum_cop::prune_uptime_proof, &m_quorum_cop));
     m_block_rate_interval.do_call(boost::bind(&core::check_block_rate, this));
+    m_emission_index_interval.do_call([this]() { m_blockchain_storage.update_emission_index(EMISSION_INDEX_BLOCKS_PER_STEP); return true; });
     m_blockchain_pruning_interval.do_call(boost::bind(&core::update_blockchain_pruning, this));
     m_miner.on_idle();
     m_mempool.on_idle();
@@ -2139,6 +2364,27 @@ namespace cryptonote
 	  return result;
   }
   //-----------------------------------------------------------------------------------------------
+  std::shared_ptr<const service_nodes::service_node_list_view> core::get_service_node_list_view() const
+  {
+	  return m_service_node_list.get_view();
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::verify_deregister_vote_signatures(const std::vector<triton::service_node_deregister::vote>& votes) const
+  {
+	  std::vector<std::shared_ptr<const service_nodes::quorum_state>> quorum_states;
+	  std::vector<const service_nodes::quorum_state*> quorums;
+	  quorum_states.reserve(votes.size());
+	  quorums.reserve(votes.size());
+	  for (const auto& vote : votes)
+	  {
+		  quorum_states.push_back(m_service_node_list.get_quorum_state(vote.block_height));
+		  quorums.push_back(quorum_states.back().get());
+	  }
+
+	  std::vector<bool> valid;
+	  return triton::service_node_deregister::verify_votes_signatures(votes, quorums, valid);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::add_deregister_vote(const triton::service_node_deregister::vote& vote, vote_verification_context &vvc)
   {
 	  uint64_t latest_block_height = std::max(get_current_blockchain_height(), get_target_blockchain_height());
@@ -31,6 +31,7 @@
 #pragma once
 
 #include <ctime>
+#include <chrono>
 
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
@@ -46,6 +47,7 @@
 #include "blockchain.h"
 #include "service_node_list.h"
 #include "quorum_cop.h"
+#include "bulletproof_batch.h"
 #include "cryptonote_basic/miner.h"
 #include "cryptonote_basic/connection_context.h"
 #include "warnings.h"
@@ -245,6 +247,21 @@ namespace cryptonote
      virtual bool get_block_template(block& b, const account_public_address& adr, difficulty_type& diffic, uint64_t& height, uint64_t& expected_reward, const blobdata& ex_nonce);
      virtual bool get_block_template(block& b, const crypto::hash *prev_block, const account_public_address& adr, difficulty_type& diffic, uint64_t& height, uint64_t& expected_reward, const blobdata& ex_nonce);
 
+     /**
+      * @brief wait until a fresh block template would differ meaningfully from one the caller holds
+      *
+      * Returns as soon as the chain tip moves away from top_id, or the pool changes so that
+      * the expected reward drops or rises by at least BLOCK_TEMPLATE_REFRESH_REWARD_PERMILLE.
+      *
+      * @param top_id the parent of the caller's template
+      * @param expected_reward the reward of the caller's template
+      * @param adr the address templates are built for while checking the reward
+      * @param timeout how long to wait at most
+      *
+      * @return true if a new template should be built, false on timeout
+      */
+     bool wait_for_block_template_change(const crypto::hash &top_id, uint64_t expected_reward, const account_public_address &adr, std::chrono::milliseconds timeout);
+
      /**
       * @brief called when a transaction is relayed.
       * @note Should only be invoked from `levin_notify`.
@@ -400,6 +417,20 @@ namespace cryptonote
       */
      bool get_transactions(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs) const;
 
+     /**
+      * @copydoc Blockchain::get_stored_transactions_blobs
+      *
+      * @note see Blockchain::get_stored_transactions_blobs
+      */
+     bool get_stored_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs) const;
+
+     /**
+      * @copydoc Blockchain::get_block_blob_and_tx_hashes
+      *
+      * @note see Blockchain::get_block_blob_and_tx_hashes
+      */
+     bool get_block_blob_and_tx_hashes(const crypto::hash &blkid, cryptonote::blobdata &block_blob, std::vector<crypto::hash> &tx_hashes) const;
+
      /**
       * @copydoc Blockchain::get_transactions
       *
@@ -574,6 +605,13 @@ namespace cryptonote
       */
      bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, bool get_miner_tx_hash, size_t max_count) const;
 
+     /**
+      * @copydoc Blockchain::get_blocks_fast
+      *
+      * @note see Blockchain::get_blocks_fast
+      */
+     bool get_blocks_fast(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, std::vector<std::vector<std::vector<uint64_t>>>& output_indices, uint64_t& total_height, uint64_t& start_height, crypto::hash& top_hash, bool pruned, bool get_miner_tx, size_t max_count) const;
+
      /**
       * @copydoc Blockchain::get_tx_outputs_gindexs
       *
@@ -848,6 +886,12 @@ namespace cryptonote
 	*/
 	std::vector<service_nodes::service_node_pubkey_info> get_service_node_list_state(const std::vector<crypto::public_key>& service_node_pubkeys) const;
 	/**
+	* @brief Get the service node list view published after the last block, without locking the list
+	*
+	* @return the view; entries and quorum states it holds are immutable
+	*/
+	std::shared_ptr<const service_nodes::service_node_list_view> get_service_node_list_view() const;
+	/**
 	* @brief get whether `pubkey` is known as a service node
 	*
 	* @param pubkey the public key to test
@@ -863,6 +907,15 @@ namespace cryptonote
      */
     bool add_deregister_vote(const triton::service_node_deregister::vote& vote, vote_verification_context &vvc);
 
+    /**
+     * @brief Check the signatures of a set of received votes in one batch, so
+     * that add_deregister_vote finds the valid ones already verified
+     *
+     * @param votes The votes, possibly for different heights
+     * @return Whether every signature was valid
+     */
+    bool verify_deregister_vote_signatures(const std::vector<triton::service_node_deregister::vote>& votes) const;
+
     /**
     * @brief Return the account associated to this service node.
     * @param pub_key The public key for the service node, unmodified if not a service node
@@ -887,6 +940,11 @@ namespace cryptonote
    */
    uint64_t get_uptime_proof(const crypto::public_key &key) const;
 
+   /**
+   * @brief get counts and recent rates of uptime proofs accepted, rejected and expired
+   */
+   service_nodes::uptime_proof_stats get_uptime_proof_stats() const;
+
      /**
       * @brief get the blockchain pruning seed
       *
@@ -1037,6 +1095,18 @@ namespace cryptonote
      struct tx_verification_batch_info { const cryptonote::transaction *tx; crypto::hash tx_hash; tx_verification_context &tvc; bool &result; };
      bool handle_incoming_tx_accumulated_batch(std::vector<tx_verification_batch_info> &tx_info, bool keeped_by_block);
 
+     /**
+      * @brief checks the Bulletproofs of all the txes of a batch of incoming
+      * blocks together, ahead of the blocks being handled one by one
+      *
+      * Txes that pass are remembered until cleanup_handle_incoming_blocks, and
+      * their semantics check then skips the proofs. Txes that fail are left to
+      * be rejected by the usual checks.
+      *
+      * @param blocks_entry the blocks about to be handled
+      */
+     void preverify_incoming_block_txs(const std::vector<block_complete_entry> &blocks_entry);
+
      /**
       * @copydoc miner::on_block_chain_update
       *
@@ -1156,8 +1226,14 @@ namespace cryptonote
 	    epee::math_helper::once_a_time_seconds<UPTIME_PROOF_BUFFER_IN_SECONDS, true> m_check_uptime_proof_interval; //!< interval for checking our own uptime proof
 	    epee::math_helper::once_a_time_seconds<30, true> m_uptime_proof_pruner;
      epee::math_helper::once_a_time_seconds<90, false> m_block_rate_interval; //!< interval for checking block rate
+     epee::math_helper::once_a_time_seconds<1, true> m_emission_index_interval; //!< interval for filling in the emission index of older databases
      epee::math_helper::once_a_time_seconds<60*60*5, true> m_blockchain_pruning_interval; //!< interval for incremental blockchain pruning
 
+     boost::mutex m_template_reward_lock; //!< guards the expected reward shared by template waiters
+     crypto::hash m_template_reward_top; //!< chain tip the shared expected reward was computed on
+     uint64_t m_template_reward_cookie; //!< pool cookie the shared expected reward was computed at
+     uint64_t m_template_reward; //!< expected reward of a template built at the above tip and cookie
+
      std::atomic<bool> m_starter_message_showed; //!< has the "daemon will sync now" message been shown?
 
      uint64_t m_target_blockchain_height; //!< blockchain height target
@@ -1182,6 +1258,10 @@ namespace cryptonote
      std::unordered_set<crypto::hash> bad_semantics_txes[2];
      boost::mutex bad_semantics_txes_lock;
 
+     std::unordered_set<crypto::hash> m_preverified_txes; //!< txes of the incoming blocks with their Bulletproofs checked
+     boost::mutex m_preverified_txes_lock;
+     bulletproof_queue m_bulletproof_queue; //!< merges the Bulletproof checks of relayed txes
+
      enum {
        UPDATES_DISABLED,
        UPDATES_NOTIFY,
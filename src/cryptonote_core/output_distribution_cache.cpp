@@ -0,0 +1,172 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "output_distribution_cache.h"
+
+namespace cryptonote
+{
+  constexpr uint64_t output_distribution_cache::CHUNK_HEIGHTS;
+  //---------------------------------------------------------------
+  void output_distribution_cache::distribution::slice(uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &out) const
+  {
+    out.clear();
+    if (from_height > to_height)
+      return;
+    out.reserve(to_height - from_height + 1);
+    for (uint64_t h = from_height; h <= to_height; )
+    {
+      const std::vector<uint64_t> &chunk = *m_chunks[h / CHUNK_HEIGHTS];
+      const uint64_t begin = h % CHUNK_HEIGHTS;
+      const uint64_t end = std::min<uint64_t>(CHUNK_HEIGHTS, begin + to_height - h + 1);
+      out.insert(out.end(), chunk.begin() + begin, chunk.begin() + end);
+      h += end - begin;
+    }
+  }
+  //---------------------------------------------------------------
+  output_distribution_cache::distribution_ptr output_distribution_cache::get(uint64_t amount) const
+  {
+    const std::shared_ptr<const distributions_t> distributions = std::atomic_load(&m_distributions);
+    const auto i = distributions->find(amount);
+    if (i == distributions->end())
+      return nullptr;
+    i->second->m_last_used->store(++m_clock, std::memory_order_relaxed);
+    return i->second;
+  }
+  //---------------------------------------------------------------
+  output_distribution_cache::distribution_ptr output_distribution_cache::put(uint64_t amount, const std::vector<uint64_t> &cumulative, const crypto::hash &top_hash)
+  {
+    if (!can_cache(amount))
+      return nullptr;
+
+    std::shared_ptr<distribution> d = std::make_shared<distribution>();
+    for (size_t n = 0; n < cumulative.size(); n += CHUNK_HEIGHTS)
+    {
+      auto chunk = std::make_shared<std::vector<uint64_t>>();
+      chunk->reserve(CHUNK_HEIGHTS);
+      chunk->assign(cumulative.begin() + n, cumulative.begin() + std::min<size_t>(cumulative.size(), n + CHUNK_HEIGHTS));
+      d->m_chunks.push_back(std::move(chunk));
+    }
+    d->m_height = cumulative.size();
+    d->m_top_hash = top_hash;
+
+    boost::lock_guard<boost::mutex> lock(m_write_lock);
+    const std::shared_ptr<const distributions_t> old = std::atomic_load(&m_distributions);
+    auto distributions = std::make_shared<distributions_t>(*old);
+    const auto existing = distributions->find(amount);
+    if (existing != distributions->end())
+    {
+      d->m_last_used = existing->second->m_last_used;
+    }
+    else
+    {
+      d->m_last_used = std::make_shared<std::atomic<uint64_t>>(0);
+      // amount 0 has a slot of its own, the others evict the least recently used
+      if (amount != 0 && distributions->size() - distributions->count(0) >= m_max_amounts - 1)
+      {
+        auto lru = distributions->end();
+        for (auto i = distributions->begin(); i != distributions->end(); ++i)
+          if (i->first != 0 && (lru == distributions->end() || i->second->m_last_used->load(std::memory_order_relaxed) < lru->second->m_last_used->load(std::memory_order_relaxed)))
+            lru = i;
+        distributions->erase(lru);
+      }
+    }
+    d->m_last_used->store(++m_clock, std::memory_order_relaxed);
+    (*distributions)[amount] = d;
+    std::atomic_store(&m_distributions, std::shared_ptr<const distributions_t>(std::move(distributions)));
+    return d;
+  }
+  //---------------------------------------------------------------
+  void output_distribution_cache::on_block_added(uint64_t height, const crypto::hash &id, uint64_t cumulative_rct, const std::unordered_map<uint64_t, uint64_t> &counts)
+  {
+    boost::lock_guard<boost::mutex> lock(m_write_lock);
+    const std::shared_ptr<const distributions_t> old = std::atomic_load(&m_distributions);
+    if (old->empty())
+      return;
+
+    auto distributions = std::make_shared<distributions_t>();
+    for (const auto &e: *old)
+    {
+      const distribution &od = *e.second;
+      if (od.m_height != height)
+        continue;
+
+      uint64_t value = cumulative_rct;
+      if (e.first != 0)
+      {
+        const auto count = counts.find(e.first);
+        value = (height ? od[height - 1] : 0) + (count == counts.end() ? 0 : count->second);
+      }
+
+      // the top chunk may hold entries past the height after a pop, they are not copied
+      std::shared_ptr<distribution> d = std::make_shared<distribution>(od);
+      const uint64_t offset = height % CHUNK_HEIGHTS;
+      auto chunk = std::make_shared<std::vector<uint64_t>>();
+      chunk->reserve(CHUNK_HEIGHTS);
+      if (offset)
+        chunk->assign(od.m_chunks.back()->begin(), od.m_chunks.back()->begin() + offset);
+      chunk->push_back(value);
+      if (offset)
+        d->m_chunks.back() = std::move(chunk);
+      else
+        d->m_chunks.push_back(std::move(chunk));
+      d->m_height = height + 1;
+      d->m_top_hash = id;
+      (*distributions)[e.first] = std::move(d);
+    }
+    std::atomic_store(&m_distributions, std::shared_ptr<const distributions_t>(std::move(distributions)));
+  }
+  //---------------------------------------------------------------
+  void output_distribution_cache::on_blocks_popped(uint64_t height, const crypto::hash &top_hash)
+  {
+    boost::lock_guard<boost::mutex> lock(m_write_lock);
+    const std::shared_ptr<const distributions_t> old = std::atomic_load(&m_distributions);
+    if (old->empty())
+      return;
+
+    auto distributions = std::make_shared<distributions_t>();
+    for (const auto &e: *old)
+    {
+      if (e.second->m_height < height || height == 0)
+        continue;
+      std::shared_ptr<distribution> d = std::make_shared<distribution>(*e.second);
+      d->m_chunks.resize((height + CHUNK_HEIGHTS - 1) / CHUNK_HEIGHTS);
+      d->m_height = height;
+      d->m_top_hash = top_hash;
+      (*distributions)[e.first] = std::move(d);
+    }
+    std::atomic_store(&m_distributions, std::shared_ptr<const distributions_t>(std::move(distributions)));
+  }
+  //---------------------------------------------------------------
+  void output_distribution_cache::clear()
+  {
+    boost::lock_guard<boost::mutex> lock(m_write_lock);
+    std::atomic_store(&m_distributions, std::make_shared<const distributions_t>());
+  }
+}
@@ -0,0 +1,139 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "crypto/hash.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief cumulative output counts per amount and height, kept in step with
+   * the chain so that output distribution requests are slices of memory
+   *
+   * Readers take a snapshot without locking. Writers (block added or popped,
+   * or a distribution loaded from the db) publish a new snapshot; heights
+   * are stored in fixed size chunks and only the top chunk is copied when a
+   * block is added, so a snapshot costs little to replace.
+   */
+  class output_distribution_cache
+  {
+  public:
+    static constexpr uint64_t CHUNK_HEIGHTS = 4096;
+
+    /**
+     * @brief the cumulative number of outputs of one amount at each height from genesis
+     */
+    class distribution
+    {
+    public:
+      uint64_t height() const { return m_height; }
+      const crypto::hash &top_hash() const { return m_top_hash; }
+      uint64_t operator[](uint64_t height) const { return (*m_chunks[height / CHUNK_HEIGHTS])[height % CHUNK_HEIGHTS]; }
+
+      /**
+       * @brief copy the entries from one height to another, both included
+       */
+      void slice(uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &out) const;
+
+    private:
+      friend class output_distribution_cache;
+
+      std::vector<std::shared_ptr<const std::vector<uint64_t>>> m_chunks;
+      uint64_t m_height = 0;
+      crypto::hash m_top_hash = crypto::null_hash;
+      std::shared_ptr<std::atomic<uint64_t>> m_last_used; // shared by every snapshot of the amount
+    };
+    typedef std::shared_ptr<const distribution> distribution_ptr;
+
+    explicit output_distribution_cache(size_t max_amounts): m_max_amounts(max_amounts), m_distributions(std::make_shared<distributions_t>()), m_clock(0) {}
+
+    /**
+     * @brief get the cached distribution of an amount, or null
+     */
+    distribution_ptr get(uint64_t amount) const;
+
+    /**
+     * @brief whether an amount can be cached at all
+     *
+     * The rct amount 0 always has a slot of its own, other amounts share the rest.
+     */
+    bool can_cache(uint64_t amount) const { return amount == 0 || m_max_amounts > 1; }
+
+    bool empty() const { return std::atomic_load(&m_distributions)->empty(); }
+
+    /**
+     * @brief cache the distribution of an amount loaded from the db
+     *
+     * When the slots for amounts other than 0 are full, the least recently
+     * used of them is evicted.
+     *
+     * @param amount the amount
+     * @param cumulative cumulative output counts, one per height from genesis
+     * @param top_hash the hash of the block at the last height
+     *
+     * @return the cached distribution, or null if the amount can't be cached
+     */
+    distribution_ptr put(uint64_t amount, const std::vector<uint64_t> &cumulative, const crypto::hash &top_hash);
+
+    /**
+     * @brief extend every cached distribution by a block
+     *
+     * Distributions which do not end right below the block are dropped.
+     *
+     * @param height the block's height
+     * @param id the block's hash
+     * @param cumulative_rct the cumulative rct output count at the block, as stored in the db
+     * @param counts the block's number of outputs of each pre-rct amount
+     */
+    void on_block_added(uint64_t height, const crypto::hash &id, uint64_t cumulative_rct, const std::unordered_map<uint64_t, uint64_t> &counts);
+
+    /**
+     * @brief cut every cached distribution back to a new chain height
+     */
+    void on_blocks_popped(uint64_t height, const crypto::hash &top_hash);
+
+    void clear();
+
+  private:
+    typedef std::unordered_map<uint64_t, distribution_ptr> distributions_t;
+
+    const size_t m_max_amounts;
+    std::shared_ptr<const distributions_t> m_distributions;
+    boost::mutex m_write_lock;
+    mutable std::atomic<uint64_t> m_clock;
+  };
+}
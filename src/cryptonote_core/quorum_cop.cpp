@@ -38,8 +38,76 @@
 
 namespace service_nodes
 {
+	bool uptime_proof_store::add(const crypto::public_key& pubkey, uint64_t timestamp, uint64_t reject_if_seen_since)
+	{
+		shard& s = shard_for(pubkey);
+		boost::lock_guard<boost::mutex> lock(s.mutex);
+		auto inserted = s.last_seen.emplace(pubkey, timestamp);
+		if (!inserted.second)
+		{
+			if (inserted.first->second >= reject_if_seen_since)
+				return false;
+			inserted.first->second = timestamp;
+		}
+		s.buckets[timestamp - timestamp % BUCKET_SECONDS].push_back(pubkey);
+		return true;
+	}
+
+	uint64_t uptime_proof_store::get(const crypto::public_key& pubkey) const
+	{
+		const shard& s = shard_for(pubkey);
+		boost::lock_guard<boost::mutex> lock(s.mutex);
+		const auto it = s.last_seen.find(pubkey);
+		return it == s.last_seen.end() ? 0 : it->second;
+	}
+
+	size_t uptime_proof_store::expire(uint64_t older_than)
+	{
+		size_t expired = 0;
+		for (shard& s : m_shards)
+		{
+			boost::lock_guard<boost::mutex> lock(s.mutex);
+			while (!s.buckets.empty() && s.buckets.begin()->first + BUCKET_SECONDS <= older_than)
+			{
+				for (const crypto::public_key& pubkey : s.buckets.begin()->second)
+				{
+					const auto it = s.last_seen.find(pubkey);
+					if (it != s.last_seen.end() && it->second < older_than)
+					{
+						s.last_seen.erase(it);
+						++expired;
+					}
+				}
+				s.buckets.erase(s.buckets.begin());
+			}
+		}
+		return expired;
+	}
+
+	void uptime_proof_store::clear()
+	{
+		for (shard& s : m_shards)
+		{
+			boost::lock_guard<boost::mutex> lock(s.mutex);
+			s.last_seen.clear();
+			s.buckets.clear();
+		}
+	}
+
+	size_t uptime_proof_store::size() const
+	{
+		size_t result = 0;
+		for (const shard& s : m_shards)
+		{
+			boost::lock_guard<boost::mutex> lock(s.mutex);
+			result += s.last_seen.size();
+		}
+		return result;
+	}
+
 	quorum_cop::quorum_cop(cryptonote::core& core)
-		: m_core(core), m_last_height(0)
+		: m_core(core), m_last_height(0), m_proofs_accepted(0), m_proofs_rejected(0), m_proofs_expired(0),
+		m_last_stats(), m_last_stats_time(std::chrono::steady_clock::now())
 	{
 		init();
 	}
@@ -47,7 +115,7 @@ namespace service_nodes
 	void quorum_cop::init()
 	{
 		m_last_height = 0;
-		m_uptime_proof_seen.clear();
+		m_uptime_proofs.clear();
 	}
 
 	void quorum_cop::blockchain_detached(uint64_t height)
@@ -118,8 +186,7 @@ namespace service_nodes
 			{
 				const crypto::public_key &node_key = state->nodes_to_test[node_index];
 
-				CRITICAL_REGION_LOCAL(m_lock);
-				bool vote_off_node = (m_uptime_proof_seen.find(node_key) == m_uptime_proof_seen.end());
+				bool vote_off_node = (m_uptime_proofs.get(node_key) == 0);
 
 				if (!vote_off_node)
 					continue;
@@ -163,10 +230,16 @@ namespace service_nodes
 
 
 		if ((timestamp < now - UPTIME_PROOF_BUFFER_IN_SECONDS) || (timestamp > now + UPTIME_PROOF_BUFFER_IN_SECONDS))
+		{
+			++m_proofs_rejected;
 			return false;
+		}
 
 		if (!m_core.is_service_node(pubkey) )
-			return false;    
+		{
+			++m_proofs_rejected;
+			return false;
+		}
 
 		if(pubkey == my_pubkey)
 		{
@@ -179,15 +252,28 @@ namespace service_nodes
    			LOG_PRINT_L2("Accepted uptime proof from " << proof.pubkey);
 		}
 
-		CRITICAL_REGION_LOCAL(m_lock);
-		if (m_uptime_proof_seen[pubkey] >= now - (UPTIME_PROOF_FREQUENCY_IN_SECONDS / 2))
+		const uint64_t recent = now - (UPTIME_PROOF_FREQUENCY_IN_SECONDS / 2);
+		if (m_uptime_proofs.get(pubkey) >= recent)
+		{
+			++m_proofs_rejected;
 			return false; // already received one uptime proof for this node recently.
+		}
 
 		crypto::hash hash = make_hash(pubkey, timestamp);
-		if (!crypto::check_signature(hash, pubkey, sig))
+		if (!m_uptime_proof_signatures.check(hash, pubkey, sig))
+		{
+			++m_proofs_rejected;
+			return false;
+		}
+
+		// another connection may have delivered the same proof while this one was verified
+		if (!m_uptime_proofs.add(pubkey, now, recent))
+		{
+			++m_proofs_rejected;
 			return false;
+		}
 
-		m_uptime_proof_seen[pubkey] = now;
+		++m_proofs_accepted;
 		return true;
 	}
 
@@ -211,29 +297,40 @@ namespace service_nodes
 		if(m_core.get_hard_fork_version(latest_height) >= 10)
 			prune_from_timestamp = now - UPTIME_PROOF_MAX_TIME_IN_SECONDS_V2;
 
-		CRITICAL_REGION_LOCAL(m_lock);
-
-		for (auto it = m_uptime_proof_seen.begin(); it != m_uptime_proof_seen.end();)
+		m_proofs_expired += m_uptime_proofs.expire(prune_from_timestamp);
+
+		// Pruning runs on a fixed interval, so it also rolls the per-second rates
+		CRITICAL_REGION_LOCAL(m_stats_lock);
+		const auto stats_time = std::chrono::steady_clock::now();
+		const double seconds = std::chrono::duration<double>(stats_time - m_last_stats_time).count();
+		uptime_proof_stats stats = {};
+		stats.accepted = m_proofs_accepted;
+		stats.rejected = m_proofs_rejected;
+		stats.expired = m_proofs_expired;
+		if (seconds > 0)
 		{
-			if (it->second < prune_from_timestamp)
-				it = m_uptime_proof_seen.erase(it);
-			else
-				it++;
+			stats.accepted_per_sec = (stats.accepted - m_last_stats.accepted) / seconds;
+			stats.rejected_per_sec = (stats.rejected - m_last_stats.rejected) / seconds;
+			stats.expired_per_sec = (stats.expired - m_last_stats.expired) / seconds;
 		}
+		m_last_stats = stats;
+		m_last_stats_time = stats_time;
 
 		return true;
 	}
 
 	uint64_t quorum_cop::get_uptime_proof(const crypto::public_key &pubkey) const
 	{
-		CRITICAL_REGION_LOCAL(m_lock);
-
-		const auto& it = m_uptime_proof_seen.find(pubkey);
-		if (it == m_uptime_proof_seen.end())
-		{
-			return 0;
-		}
+		return m_uptime_proofs.get(pubkey);
+	}
 
-		return (*it).second;
+	uptime_proof_stats quorum_cop::get_uptime_proof_stats() const
+	{
+		CRITICAL_REGION_LOCAL(m_stats_lock);
+		uptime_proof_stats stats = m_last_stats;
+		stats.accepted = m_proofs_accepted;
+		stats.rejected = m_proofs_rejected;
+		stats.expired = m_proofs_expired;
+		return stats;
 	}
 }
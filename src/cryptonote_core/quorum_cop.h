@@ -28,7 +28,12 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+
 #include "blockchain.h"
+#include "service_node_signatures.h"
 #include "cryptonote_protocol/cryptonote_protocol_handler_common.h"
 
 namespace triton
@@ -43,6 +48,58 @@ namespace cryptonote
 
 namespace service_nodes
 {
+	/// The time of the last uptime proof from each service node. Split into
+	/// shards by pubkey, each with its own lock, so proofs handled on many
+	/// connections at once rarely contend. Each shard also files its proofs in
+	/// time buckets, so expiring them only visits the expired ones.
+	class uptime_proof_store
+	{
+	public:
+		static constexpr size_t NUM_SHARDS = 16;
+		static constexpr uint64_t BUCKET_SECONDS = 60;
+
+		/// Records a proof at `timestamp`, unless there is already one at or after
+		/// `reject_if_seen_since`.
+		bool add(const crypto::public_key& pubkey, uint64_t timestamp, uint64_t reject_if_seen_since);
+
+		/// @return the time of the last proof, 0 if none
+		uint64_t get(const crypto::public_key& pubkey) const;
+
+		/// Forgets proofs older than `older_than`; those sharing a time bucket
+		/// with newer proofs may be kept up to BUCKET_SECONDS longer.
+		/// @return the number of proofs forgotten
+		size_t expire(uint64_t older_than);
+
+		void clear();
+		size_t size() const;
+
+	private:
+		struct shard
+		{
+			mutable boost::mutex mutex;
+			std::unordered_map<crypto::public_key, uint64_t> last_seen;
+			// bucket start time -> nodes with a proof in it; a node whose last
+			// proof has since moved to a later bucket is skipped on expiry
+			std::map<uint64_t, std::vector<crypto::public_key>> buckets;
+		};
+
+		shard& shard_for(const crypto::public_key& pubkey) { return m_shards[std::hash<crypto::public_key>()(pubkey) % NUM_SHARDS]; }
+		const shard& shard_for(const crypto::public_key& pubkey) const { return m_shards[std::hash<crypto::public_key>()(pubkey) % NUM_SHARDS]; }
+
+		std::array<shard, NUM_SHARDS> m_shards;
+	};
+
+	struct uptime_proof_stats
+	{
+		uint64_t accepted;
+		uint64_t rejected;
+		uint64_t expired;
+		// over the interval between the last two prune_uptime_proof() calls
+		double accepted_per_sec;
+		double rejected_per_sec;
+		double expired_per_sec;
+	};
+
 	class quorum_cop
 		: public cryptonote::Blockchain::BlockAddedHook,
 		public cryptonote::Blockchain::BlockchainDetachedHook,
@@ -63,15 +120,26 @@ namespace service_nodes
 		bool prune_uptime_proof();
 
 		uint64_t get_uptime_proof(const crypto::public_key &pubkey) const;
+		uptime_proof_stats get_uptime_proof_stats() const;
 
 	private:
 
 		cryptonote::core& m_core;
 		uint64_t m_last_height;
 
-		using timestamp = uint64_t;
-		std::unordered_map<crypto::public_key, timestamp> m_uptime_proof_seen;
-		mutable epee::critical_section m_lock;
+		uptime_proof_store m_uptime_proofs;
+
+		// Proofs arriving on several connections at once are verified together
+		signature_queue m_uptime_proof_signatures;
+
+		std::atomic<uint64_t> m_proofs_accepted;
+		std::atomic<uint64_t> m_proofs_rejected;
+		std::atomic<uint64_t> m_proofs_expired;
+
+		// counter values as of the last prune, to work out the rates
+		mutable epee::critical_section m_stats_lock;
+		uptime_proof_stats m_last_stats;
+		std::chrono::steady_clock::time_point m_last_stats_time;
 	};
 	void generate_uptime_proof_request(const crypto::public_key& pubkey, const crypto::secret_key& seckey, cryptonote::NOTIFY_UPTIME_PROOF::request& req);
 
@@ -34,6 +34,7 @@
 #include "cryptonote_basic/connection_context.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "cryptonote_core/service_node_list.h"
+#include "cryptonote_core/service_node_signatures.h"
 #include "cryptonote_core/blockchain.h"
 
 #include "misc_log_ex.h"
@@ -79,15 +80,32 @@ namespace triton
 	bool service_node_deregister::verify_votes_signature(uint64_t block_height, uint32_t service_node_index, const std::vector<std::pair<crypto::public_key, crypto::signature>>& keys_and_sigs)
 	{
 		crypto::hash hash = make_hash_from(block_height, service_node_index);
+		service_nodes::signature_batch batch;
 		for (auto& key_and_sig : keys_and_sigs)
+			batch.add(hash, key_and_sig.first, key_and_sig.second);
+
+		return batch.check();
+	}
+
+	bool service_node_deregister::verify_votes_signatures(const std::vector<vote>& votes, const std::vector<const service_nodes::quorum_state*>& quorums, std::vector<bool>& valid)
+	{
+		service_nodes::signature_batch batch;
+		std::vector<size_t> batch_index(votes.size(), votes.size());
+		for (size_t i = 0; i < votes.size(); ++i)
 		{
-			if (!crypto::check_signature(hash, key_and_sig.first, key_and_sig.second))
-			{
-				return false;
-			}
+			const vote& v = votes[i];
+			if (!quorums[i] || v.voters_quorum_index >= quorums[i]->quorum_nodes.size())
+				continue;
+			batch_index[i] = batch.size();
+			batch.add(make_hash_from(v.block_height, v.service_node_index), quorums[i]->quorum_nodes[v.voters_quorum_index], v.signature);
 		}
 
-		return true;
+		std::vector<bool> batch_valid;
+		const bool result = batch.check(&batch_valid);
+		valid.resize(votes.size());
+		for (size_t i = 0; i < votes.size(); ++i)
+			valid[i] = batch_index[i] < batch_valid.size() && batch_valid[batch_index[i]];
+		return result && batch.size() == votes.size();
 	}
 
 	static bool verify_votes_helper(cryptonote::network_type nettype, const cryptonote::tx_extra_service_node_deregister& deregister,
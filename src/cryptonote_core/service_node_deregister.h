@@ -71,6 +71,11 @@ namespace triton
 		bool verify_vote_signature(uint64_t block_height, uint32_t service_node_index, crypto::public_key p, crypto::signature s);
 		bool verify_votes_signature(uint64_t block_height, uint32_t service_node_index, const std::vector<std::pair<crypto::public_key, crypto::signature>>& keys_and_sigs);
 
+		// Checks the signatures of votes for any heights in one batch; quorums[i] is
+		// the quorum for votes[i], or null if unknown (the vote is then invalid).
+		// Valid signatures are remembered, so verifying the votes again is cheap.
+		bool verify_votes_signatures(const std::vector<vote>& votes, const std::vector<const service_nodes::quorum_state*>& quorums, std::vector<bool>& valid);
+
 		bool verify_deregister(cryptonote::network_type nettype, const cryptonote::tx_extra_service_node_deregister& deregister,
 			cryptonote::vote_verification_context& vvc,
 			const service_nodes::quorum_state &quorum);
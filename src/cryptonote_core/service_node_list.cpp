@@ -29,6 +29,7 @@
 #include <functional>
 #include <random>
 #include <algorithm>
+#include <chrono>
 
 #include "ringct/rctSigs.h"
 #include "wallet/wallet2.h"
@@ -39,6 +40,7 @@
 #include "common/i18n.h"
 #include "quorum_cop.h"
 #include "common/exp2.h"
+#include "common/threadpool.h"
 #include "rapidjson/document.h"
 #include "rapidjson/pointer.h"
 
@@ -64,9 +66,226 @@ namespace service_nodes
 		return result;
 	}
 
+	// Rollback event ids grow in both directions from here so that events pushed
+	// to either end of m_rollback_events keep their list order as record keys.
+	static constexpr uint64_t ROLLBACK_EVENT_ID_BASE = 1ull << 63;
+
+	// Bump when the keyed record layout changes incompatibly.
+	static constexpr uint8_t SERVICE_NODE_RECORDS_VERSION = 2;
+
 	service_node_list::service_node_list(cryptonote::Blockchain& blockchain)
-		: m_blockchain(blockchain), m_hooks_registered(false), m_height(0), m_db(nullptr), m_service_node_pubkey(nullptr)
+		: m_blockchain(blockchain), m_hooks_registered(false), m_height(0), m_db(nullptr), m_service_node_pubkey(nullptr),
+		m_store_full(true), m_first_event_id(ROLLBACK_EVENT_ID_BASE), m_next_event_id(ROLLBACK_EVENT_ID_BASE), m_index_rebuild(true),
+		m_view(std::make_shared<service_node_list_view>()), m_view_rebuild(true), m_view_delta_floor(0)
+	{
+	}
+
+	void service_node_index::clear(bool allow_partially_funded)
+	{
+		m_allow_partially_funded = allow_partially_funded;
+		m_entries.clear();
+		m_active.clear();
+		m_by_registration_height.clear();
+	}
+
+	bool service_node_index::is_active(const service_node_info& info) const
+	{
+		return (info.is_valid() && m_allow_partially_funded) || info.is_fully_funded();
+	}
+
+	void service_node_index::insert_sorted(std::vector<crypto::public_key>& keys, const crypto::public_key& key)
+	{
+		keys.insert(std::lower_bound(keys.begin(), keys.end(), key, pubkey_less()), key);
+	}
+
+	void service_node_index::erase_sorted(std::vector<crypto::public_key>& keys, const crypto::public_key& key)
+	{
+		auto it = std::lower_bound(keys.begin(), keys.end(), key, pubkey_less());
+		if (it != keys.end() && *it == key)
+			keys.erase(it);
+	}
+
+	void service_node_index::update(const crypto::public_key& key, const service_node_info* info)
+	{
+		auto it = m_entries.find(key);
+		if (it != m_entries.end())
+		{
+			const entry& old_entry = it->second;
+			if (info && old_entry.active == is_active(*info) && old_entry.registration_height == info->registration_height)
+				return;
+
+			if (old_entry.active)
+				erase_sorted(m_active, key);
+
+			m_by_registration_height.erase(std::make_pair(old_entry.registration_height, key));
+			m_entries.erase(it);
+		}
+
+		if (!info)
+			return;
+
+		const entry new_entry = { is_active(*info), info->registration_height };
+		if (new_entry.active)
+			insert_sorted(m_active, key);
+		m_by_registration_height.insert(std::make_pair(new_entry.registration_height, key));
+		m_entries.emplace(key, new_entry);
+	}
+
+	bool quorum_history::chunk::is_valid() const
+	{
+		if (first_height % CHUNK_HEIGHTS != 0 || quorums.size() > CHUNK_HEIGHTS)
+			return false;
+		for (const compact_quorum& quorum : quorums)
+		{
+			if (quorum.num_quorum_nodes > quorum.nodes.size())
+				return false;
+			for (uint32_t node : quorum.nodes)
+				if (node >= nodes.size())
+					return false;
+		}
+		return true;
+	}
+
+	static std::shared_ptr<const quorum_state> expand_quorum(const quorum_history::chunk& c, uint64_t height)
+	{
+		if (height - c.first_height >= c.quorums.size())
+			return nullptr;
+
+		const quorum_history::compact_quorum& quorum = c.quorums[height - c.first_height];
+		auto result = std::make_shared<quorum_state>();
+		result->quorum_nodes.reserve(quorum.num_quorum_nodes);
+		result->nodes_to_test.reserve(quorum.nodes.size() - quorum.num_quorum_nodes);
+		for (size_t i = 0; i < quorum.nodes.size(); ++i)
+			(i < quorum.num_quorum_nodes ? result->quorum_nodes : result->nodes_to_test).push_back(c.nodes[quorum.nodes[i]]);
+		return result;
+	}
+
+	std::shared_ptr<const quorum_state> quorum_history::get(const chunk_map& chunks, uint64_t height)
+	{
+		const auto it = chunks.find(chunk_start(height));
+		return it == chunks.end() ? nullptr : expand_quorum(*it->second, height);
+	}
+
+	std::shared_ptr<const quorum_state> quorum_history::get(uint64_t height) const
+	{
+		const auto it = m_chunks.find(chunk_start(height));
+		return it == m_chunks.end() ? nullptr : expand_quorum(*it->second, height);
+	}
+
+	const quorum_history::compact_quorum* quorum_history::find(uint64_t height) const
+	{
+		const auto it = m_chunks.find(chunk_start(height));
+		if (it == m_chunks.end() || height - it->first >= it->second->quorums.size())
+			return nullptr;
+		return &it->second->quorums[height - it->first];
+	}
+
+	quorum_history::chunk_map quorum_history::share() const
+	{
+		return chunk_map(m_chunks.begin(), m_chunks.end());
+	}
+
+	quorum_history::chunk& quorum_history::writable_chunk(uint64_t first_height)
+	{
+		std::shared_ptr<chunk>& c = m_chunks[first_height];
+		if (!c)
+		{
+			c = std::make_shared<chunk>();
+			c->first_height = first_height;
+		}
+		else if (c.use_count() > 1)
+		{
+			// a published view still reads this one
+			c = std::make_shared<chunk>(*c);
+		}
+		return *c;
+	}
+
+	void quorum_history::set(uint64_t height, const quorum_state& state)
+	{
+		const uint64_t first_height = chunk_start(height);
+		chunk& c = writable_chunk(first_height);
+		if (m_lookup_chunk != first_height)
+		{
+			m_lookup.clear();
+			for (uint32_t i = 0; i < c.nodes.size(); ++i)
+				m_lookup.emplace(c.nodes[i], i);
+			m_lookup_chunk = first_height;
+		}
+
+		if (c.quorums.size() <= height - first_height)
+			c.quorums.resize(height - first_height + 1);
+		compact_quorum& quorum = c.quorums[height - first_height];
+		quorum.num_quorum_nodes = state.quorum_nodes.size();
+		quorum.nodes.clear();
+		quorum.nodes.reserve(state.quorum_nodes.size() + state.nodes_to_test.size());
+
+		auto add_node = [&](const crypto::public_key& key) {
+			const auto inserted = m_lookup.emplace(key, c.nodes.size());
+			if (inserted.second)
+				c.nodes.push_back(key);
+			quorum.nodes.push_back(inserted.first->second);
+		};
+		for (const crypto::public_key& key : state.quorum_nodes)
+			add_node(key);
+		for (const crypto::public_key& key : state.nodes_to_test)
+			add_node(key);
+	}
+
+	void quorum_history::set_chunk(std::shared_ptr<chunk> new_chunk)
+	{
+		if (m_lookup_chunk == new_chunk->first_height)
+			m_lookup_chunk = UINT64_MAX;
+		m_chunks[new_chunk->first_height] = std::move(new_chunk);
+	}
+
+	void quorum_history::erase_from(uint64_t height)
+	{
+		for (auto it = m_chunks.lower_bound(chunk_start(height)); it != m_chunks.end(); ++it)
+		{
+			const size_t keep = height > it->first ? height - it->first : 0;
+			if (it->second->quorums.size() > keep)
+				writable_chunk(it->first).quorums.resize(keep);
+		}
+	}
+
+	void quorum_history::evict_below(uint64_t height)
+	{
+		while (!m_chunks.empty() && m_chunks.begin()->first + CHUNK_HEIGHTS <= height)
+		{
+			if (m_lookup_chunk == m_chunks.begin()->first)
+				m_lookup_chunk = UINT64_MAX;
+			m_chunks.erase(m_chunks.begin());
+		}
+	}
+
+	void quorum_history::clear()
 	{
+		m_chunks.clear();
+		m_lookup_chunk = UINT64_MAX;
+		m_lookup.clear();
+	}
+
+	const service_node_index& service_node_list::index() const
+	{
+		const bool allow_partially_funded = m_blockchain.get_hard_fork_version(m_height) > 9;
+		if (m_index_rebuild || allow_partially_funded != m_index.allows_partially_funded())
+		{
+			m_index.clear(allow_partially_funded);
+			for (const auto& kv_pair : m_service_nodes_infos)
+				m_index.update(kv_pair.first, &kv_pair.second);
+			m_index_rebuild = false;
+		}
+		else
+		{
+			for (const crypto::public_key& key : m_index_stale)
+			{
+				const auto it = m_service_nodes_infos.find(key);
+				m_index.update(key, it == m_service_nodes_infos.end() ? nullptr : &it->second);
+			}
+		}
+		m_index_stale.clear();
+		return m_index;
 	}
 
 	void service_node_list::register_hooks(service_nodes::quorum_cop &quorum_cop)
@@ -90,6 +309,12 @@ namespace service_nodes
 	void service_node_list::init()
 	{
 		std::lock_guard<boost::recursive_mutex> lock(m_sn_mutex);
+		init_locked();
+		publish_view();
+	}
+
+	void service_node_list::init_locked()
+	{
 		if (m_blockchain.get_current_hard_fork_version() < 5)
 		{
 			clear(true);
@@ -102,97 +327,212 @@ namespace service_nodes
 
 		if (loaded && m_height == current_height) return;
 
-		if (!loaded || m_height > current_height) clear(true);
+		if (!loaded || m_height > current_height)
+		{
+			clear(true);
+			load_snapshot(current_height);
+		}
 
 		LOG_PRINT_L0("Recalculating service nodes list, scanning blockchain from height " << m_height);
 		LOG_PRINT_L0("This may take some time...");
 
-		std::vector<std::pair<cryptonote::blobdata, cryptonote::block>> blocks;
-		while (m_height < current_height)
+		if (!rebuild(current_height))
 		{
-			blocks.clear();
-			if (!m_blockchain.get_blocks(m_height, 1000, blocks))
+			LOG_ERROR("Unable to initialize service nodes list");
+			return;
+		}
+	}
+
+	namespace
+	{
+		constexpr size_t REBUILD_BATCH_SIZE = 1000;
+		constexpr size_t REBUILD_TASK_SIZE = 50;
+		constexpr uint64_t REBUILD_PROGRESS_INTERVAL_MS = 10000;
+
+		struct rebuild_block
+		{
+			cryptonote::block block;
+			std::vector<std::pair<cryptonote::transaction, cryptonote::blobdata>> txs;
+			bool ok;
+		};
+
+		// Only txs carrying a service node pubkey (registrations and contributions)
+		// or flagged as deregistrations can change the list.
+		bool tx_may_affect_service_nodes(const cryptonote::transaction_prefix& tx)
+		{
+			crypto::public_key pubkey;
+			return tx.is_deregister_tx() || cryptonote::get_service_node_pubkey_from_tx_extra(tx.extra, pubkey);
+		}
+
+		bool load_rebuild_block(const cryptonote::BlockchainDB& db, uint64_t height, rebuild_block& entry)
+		{
+			if (!cryptonote::parse_and_validate_block_from_blob(db.get_block_blob_from_height(height), entry.block))
 			{
-				LOG_ERROR("Unable to initialize service nodes list");
-				return;
+				LOG_ERROR("Unable to parse block at height " << height);
+				return false;
 			}
 
-			std::vector<cryptonote::transaction> txs;
-			std::vector<crypto::hash> missed_txs;
-			for (const auto& block_pair : blocks)
+			// Txs that cannot affect the list are left as empty placeholders so
+			// that the tx index seen by block_added_generic stays correct. The
+			// pruned blob is enough, contributions only need the rct base.
+			entry.txs.resize(entry.block.tx_hashes.size());
+			cryptonote::transaction_prefix prefix;
+			for (size_t i = 0; i < entry.block.tx_hashes.size(); i++)
 			{
-				txs.clear();
-				missed_txs.clear();
+				cryptonote::blobdata blob;
+				if (!db.get_pruned_tx_blob(entry.block.tx_hashes[i], blob))
+				{
+					LOG_ERROR("Unable to get transaction " << entry.block.tx_hashes[i] << " for block at height " << height);
+					return false;
+				}
 
-				const cryptonote::block& block = block_pair.second;
-				std::vector<cryptonote::transaction> txs;
-				std::vector<crypto::hash> missed_txs;
-				if (!m_blockchain.get_transactions(block.tx_hashes, txs, missed_txs))
+				if (!cryptonote::parse_and_validate_tx_prefix_from_blob(blob, prefix))
 				{
-					LOG_ERROR("Unable to get transactions for block " << block.hash);
-					return;
+					LOG_ERROR("Unable to parse transaction " << entry.block.tx_hashes[i] << " for block at height " << height);
+					return false;
 				}
 
-				std::vector<std::pair<cryptonote::transaction, cryptonote::blobdata>> txwbs;
-				txwbs.reserve(txs.size());
-				for(const cryptonote::transaction tx : txs) {
-					cryptonote::blobdata bl;
-					t_serializable_object_to_blob(tx, bl);
-					txwbs.push_back(std::make_pair(std::move(tx), std::move(bl)));
+				if (!tx_may_affect_service_nodes(prefix))
+					continue;
+
+				if (!cryptonote::parse_and_validate_tx_base_from_blob(blob, entry.txs[i].first))
+				{
+					LOG_ERROR("Unable to parse transaction " << entry.block.tx_hashes[i] << " for block at height " << height);
+					return false;
 				}
+				entry.txs[i].second = std::move(blob);
+			}
+			return true;
+		}
 
-				block_added_generic(block, txwbs);
+		void prepare_rebuild_batch(const cryptonote::BlockchainDB& db, uint64_t start_height, size_t count, std::vector<rebuild_block>& batch,
+			tools::threadpool& tpool, tools::threadpool::waiter& waiter)
+		{
+			batch.clear();
+			batch.resize(count);
+			for (size_t offset = 0; offset < count; offset += REBUILD_TASK_SIZE)
+			{
+				const size_t end = std::min(offset + REBUILD_TASK_SIZE, count);
+				tpool.submit(&waiter, [&db, &batch, start_height, offset, end]() {
+					for (size_t i = offset; i < end; i++)
+					{
+						try
+						{
+							batch[i].ok = load_rebuild_block(db, start_height + i, batch[i]);
+						}
+						catch (const std::exception& e)
+						{
+							LOG_ERROR("Exception loading block at height " << start_height + i << ": " << e.what());
+							batch[i].ok = false;
+						}
+					}
+				}, true);
 			}
 		}
 	}
 
-	std::vector<crypto::public_key> service_node_list::get_service_nodes_pubkeys() const
+	// Rebuilds the list from m_height up to current_height. Blocks are read and
+	// parsed on the thread pool one batch ahead of the batch being applied, and
+	// only the apply step runs serially on this thread.
+	bool service_node_list::rebuild(uint64_t current_height)
 	{
-		int hard_fork_version = m_blockchain.get_hard_fork_version(m_height);
-		std::vector<crypto::public_key> result;
-		for (const auto& iter : m_service_nodes_infos) {
-			//if(iter.second.is_valid())
-			if ((iter.second.is_valid() && hard_fork_version > 9) || iter.second.is_fully_funded())
-				result.push_back(iter.first);
+		if (m_height >= current_height)
+			return true;
+
+		tools::threadpool& tpool = tools::threadpool::getInstance();
+		tools::threadpool::waiter waiter;
+		const cryptonote::BlockchainDB& db = m_blockchain.get_db();
+
+		const uint64_t start_height = m_height;
+		const auto start_time = std::chrono::steady_clock::now();
+		auto last_report = start_time;
+
+		std::vector<rebuild_block> current, next;
+		// workers write into the batches, so they must be done before we leave, even on a throw
+		const auto waiter_guard = epee::misc_utils::create_scope_leave_handler([&]() { waiter.wait(&tpool); });
+		uint64_t batch_height = m_height;
+		prepare_rebuild_batch(db, batch_height, std::min<uint64_t>(REBUILD_BATCH_SIZE, current_height - batch_height), current, tpool, waiter);
+		waiter.wait(&tpool);
+
+		while (!current.empty())
+		{
+			const uint64_t next_height = batch_height + current.size();
+			prepare_rebuild_batch(db, next_height, std::min<uint64_t>(REBUILD_BATCH_SIZE, current_height - next_height), next, tpool, waiter);
+
+			for (const rebuild_block& entry : current)
+			{
+				if (!entry.ok)
+					return false;
+				block_added_generic(entry.block, entry.txs);
+			}
+
+			waiter.wait(&tpool);
+			std::swap(current, next);
+			batch_height = next_height;
+
+			const auto now = std::chrono::steady_clock::now();
+			if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_report).count() >= REBUILD_PROGRESS_INTERVAL_MS)
+			{
+				const uint64_t elapsed_ms = std::max<uint64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count());
+				const uint64_t done = batch_height - start_height;
+				MGINFO("Rebuilding service node list: height " << batch_height << "/" << current_height
+					<< " (" << (100 * done / std::max<uint64_t>(1, current_height - start_height)) << "%), "
+					<< (done * 1000 / elapsed_ms) << " blocks/s");
+				last_report = now;
+			}
 		}
 
-		std::sort(result.begin(), result.end(),
-			[](const crypto::public_key &a, const crypto::public_key &b) {
-			return memcmp(reinterpret_cast<const void*>(&a), reinterpret_cast<const void*>(&b), sizeof(a)) < 0;
-		});
-		return result;
+		const uint64_t elapsed_ms = std::max<uint64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count());
+		MGINFO("Service node list rebuilt from height " << start_height << " to " << batch_height << " in " << elapsed_ms / 1000 << "s ("
+			<< ((batch_height - start_height) * 1000 / elapsed_ms) << " blocks/s)");
+		return true;
 	}
 
-	const std::shared_ptr<const quorum_state> service_node_list::get_quorum_state(uint64_t height) const
+	std::vector<crypto::public_key> service_node_list::get_service_nodes_pubkeys() const
 	{
 		std::lock_guard<boost::recursive_mutex> lock(m_sn_mutex);
-		const auto &it = m_quorum_states.find(height);
-		if (it == m_quorum_states.end())
+		return index().active();
+	}
+
+	std::shared_ptr<const quorum_state> service_node_list::find_quorum_state(uint64_t height) const
+	{
+		std::shared_ptr<const quorum_state> result = m_quorum_history.get(height);
+		if (!result)
 		{
 			// TODO(triton): Not being able to find the quorum is going to be a fatal error.
+			return std::make_shared<quorum_state>();
 		}
-		else
+
+		return result;
+	}
+
+	const std::shared_ptr<const quorum_state> service_node_list::get_quorum_state(uint64_t height) const
+	{
+		const std::shared_ptr<const service_node_list_view> view = get_view();
+		std::shared_ptr<const quorum_state> result = quorum_history::get(view->quorum_chunks, height);
+		if (!result)
 		{
-			return it->second;
+			// TODO(triton): Not being able to find the quorum is going to be a fatal error.
+			return std::make_shared<quorum_state>();
 		}
 
-		return std::make_shared<quorum_state>();
+		return result;
 	}
 
 	std::vector<service_node_pubkey_info> service_node_list::get_service_node_list_state(const std::vector<crypto::public_key> &service_node_pubkeys) const
 	{
-		std::lock_guard<boost::recursive_mutex> lock(m_sn_mutex);
+		const std::shared_ptr<const service_node_list_view> view = get_view();
 		std::vector<service_node_pubkey_info> result;
 
 		if (service_node_pubkeys.empty())
 		{
-			result.reserve(m_service_nodes_infos.size());
+			result.reserve(view->entries.size());
 
-			for (const auto &it : m_service_nodes_infos)
+			for (const auto &it : view->entries)
 			{
 				service_node_pubkey_info entry = {};
-				entry.pubkey = it.first;
-				entry.info = it.second;
+				entry.pubkey = it.pubkey;
+				entry.info = *it.info;
 				result.push_back(entry);
 			}
 		}
@@ -201,13 +541,13 @@ namespace service_nodes
 			result.reserve(service_node_pubkeys.size());
 			for (const auto &it : service_node_pubkeys)
 			{
-				const auto &find_it = m_service_nodes_infos.find(it);
-				if (find_it == m_service_nodes_infos.end())
+				const service_node_list_view::entry *found = view->find(it);
+				if (!found)
 					continue;
 
 				service_node_pubkey_info entry = {};
-				entry.pubkey = (*find_it).first;
-				entry.info = (*find_it).second;
+				entry.pubkey = found->pubkey;
+				entry.info = *found->info;
 				result.push_back(entry);
 			}
 		}
@@ -215,6 +555,78 @@ namespace service_nodes
 		return result;
 	}
 
+	std::shared_ptr<const service_node_list_view> service_node_list::get_view() const
+	{
+		return std::atomic_load(&m_view);
+	}
+
+	const service_node_list_view::entry* service_node_list_view::find(const crypto::public_key& pubkey) const
+	{
+		const auto it = std::lower_bound(entries.begin(), entries.end(), pubkey, [](const entry& e, const crypto::public_key& key) {
+			return pubkey_less()(e.pubkey, key);
+		});
+		return it != entries.end() && it->pubkey == pubkey ? &*it : nullptr;
+	}
+
+	void service_node_list::publish_view()
+	{
+		const std::shared_ptr<const service_node_list_view> prev = get_view();
+		std::shared_ptr<service_node_list_view> view = std::make_shared<service_node_list_view>();
+		view->height = m_height;
+		view->quorum_chunks = m_quorum_history.share();
+
+		if (m_view_rebuild)
+		{
+			view->entries.reserve(m_service_nodes_infos.size());
+			for (const auto& kv_pair : m_service_nodes_infos)
+				view->entries.push_back({kv_pair.first, std::make_shared<const service_node_info>(kv_pair.second), m_height});
+			std::sort(view->entries.begin(), view->entries.end(), [](const service_node_list_view::entry& a, const service_node_list_view::entry& b) {
+				return pubkey_less()(a.pubkey, b.pubkey);
+			});
+			// nothing is known about what changed or left before this
+			m_view_delta_floor = std::max(m_view_delta_floor, m_height);
+		}
+		else
+		{
+			// Merge the changed nodes into the previous view's sorted entries; the
+			// infos of all other nodes are shared rather than copied.
+			std::vector<crypto::public_key> changed(m_view_stale.begin(), m_view_stale.end());
+			std::sort(changed.begin(), changed.end(), pubkey_less());
+
+			view->entries.reserve(prev->entries.size() + changed.size());
+			view->removed = prev->removed;
+			auto prev_it = prev->entries.begin();
+			for (const crypto::public_key& key : changed)
+			{
+				for (; prev_it != prev->entries.end() && pubkey_less()(prev_it->pubkey, key); ++prev_it)
+					view->entries.push_back(*prev_it);
+
+				const bool existed = prev_it != prev->entries.end() && prev_it->pubkey == key;
+				if (existed)
+					++prev_it;
+
+				const auto it = m_service_nodes_infos.find(key);
+				if (it != m_service_nodes_infos.end())
+					view->entries.push_back({key, std::make_shared<const service_node_info>(it->second), m_height});
+				else if (existed)
+					view->removed.emplace_back(m_height, key);
+			}
+			view->entries.insert(view->entries.end(), prev_it, prev->entries.end());
+		}
+
+		const uint64_t removed_cutoff = m_height < VIEW_REMOVED_HISTORY ? 0 : m_height - VIEW_REMOVED_HISTORY;
+		while (!view->removed.empty() && view->removed.front().first <= removed_cutoff)
+		{
+			m_view_delta_floor = std::max(m_view_delta_floor, view->removed.front().first);
+			view->removed.pop_front();
+		}
+		view->delta_floor = m_view_delta_floor;
+
+		std::atomic_store(&m_view, std::shared_ptr<const service_node_list_view>(std::move(view)));
+		m_view_stale.clear();
+		m_view_rebuild = false;
+	}
+
 	void service_node_list::set_db_pointer(cryptonote::BlockchainDB* db)
 	{
 		std::lock_guard<boost::recursive_mutex> lock(m_sn_mutex);
@@ -229,8 +641,7 @@ namespace service_nodes
 
 	bool service_node_list::is_service_node(const crypto::public_key& pubkey) const
 	{
-		std::lock_guard<boost::recursive_mutex> lock(m_sn_mutex);
-		return m_service_nodes_infos.find(pubkey) != m_service_nodes_infos.end();
+		return get_view()->find(pubkey) != nullptr;
 	}
 
 	bool service_node_list::contribution_tx_output_has_correct_unlock_time(const cryptonote::transaction& tx, size_t i, uint64_t block_height) const
@@ -314,7 +725,7 @@ namespace service_nodes
 			return false;
 		}
 
-		const auto state = get_quorum_state(deregister.block_height);
+		const auto state = find_quorum_state(deregister.block_height);
 
 		if (!state)
 		{
@@ -344,7 +755,7 @@ namespace service_nodes
 			LOG_PRINT_L1("Deregistration for service node: " << key);
 		}
 
-		m_rollback_events.push_back(std::unique_ptr<rollback_event>(new rollback_change(block_height, key, iter->second)));
+		push_rollback_event(new rollback_change(block_height, key, iter->second));
 		m_service_nodes_infos.erase(iter);
 
 		return true;
@@ -521,7 +932,9 @@ namespace service_nodes
 		uint64_t seed = 0;
 		std::memcpy(&seed, hash.data, sizeof(seed));
 
-		/// Gather existing swarms from infos
+		/// Gather existing swarms from infos. The member order feeds
+		/// calc_swarm_changes and is consensus, so it must stay the map's
+		/// iteration order over all nodes.
 		std::map<swarm_id_t, std::vector<crypto::public_key>> existing_swarms;
 
 		for (const auto& entry : m_service_nodes_infos) {
@@ -543,7 +956,7 @@ namespace service_nodes
 				if (sn_info.swarm_id == swarm_id) continue; /// nothing changed for this snode
 
 															/// modify info and record the change
-				m_rollback_events.push_back(std::unique_ptr<rollback_event>(new rollback_change(height, snode, sn_info)));
+				push_rollback_event(new rollback_change(height, snode, sn_info));
 				sn_info.swarm_id = swarm_id;
 			}
 
@@ -700,7 +1113,7 @@ namespace service_nodes
 			LOG_PRINT_L1("New service node registered: " << key << " at block height: " << block_height);
 		}
 
-		m_rollback_events.push_back(std::unique_ptr<rollback_event>(new rollback_new(block_height, key)));
+		push_rollback_event(new rollback_new(block_height, key));
 		m_service_nodes_infos[key] = info;
 
 		return true;
@@ -818,7 +1231,7 @@ namespace service_nodes
 				return;
 		}
 
-		m_rollback_events.push_back(std::unique_ptr<rollback_event>(new rollback_change(block_height, pubkey, info)));
+		push_rollback_event(new rollback_change(block_height, pubkey, info));
 
 		if (contrib_iter == contributors.end())
 		{
@@ -855,7 +1268,12 @@ namespace service_nodes
 	{
 		std::lock_guard<boost::recursive_mutex> lock(m_sn_mutex);
 		block_added_generic(block, txs);
-		store();
+		// inside a batch the abort above is deferred to the batch owner, so
+		// let it know the batch now holds a partial write; it aborts the batch
+		// and reloads the list, dropping this block from memory as well
+		if (!store())
+			throw std::runtime_error("Failed to store service node list");
+		publish_view();
 	}
 
 
@@ -875,9 +1293,9 @@ namespace service_nodes
 
 			while (!m_rollback_events.empty() && m_rollback_events.front()->m_block_height < cull_height)
 			{
-				m_rollback_events.pop_front();
+				pop_rollback_event_front();
 			}
-			m_rollback_events.push_front(std::unique_ptr<rollback_event>(new prevent_rollback(cull_height)));
+			push_rollback_event_front(new prevent_rollback(cull_height));
 		}
 
 		size_t expired_count = 0;
@@ -896,7 +1314,7 @@ namespace service_nodes
 					LOG_PRINT_L1("Service node expired: " << pubkey << " at block height: " << block_height);
 				}
 
-				m_rollback_events.push_back(std::unique_ptr<rollback_event>(new rollback_change(block_height, pubkey, i->second)));
+				push_rollback_event(new rollback_change(block_height, pubkey, i->second));
 
 				expired_count++;
 				m_service_nodes_infos.erase(i);
@@ -908,11 +1326,7 @@ namespace service_nodes
 		crypto::public_key winner_pubkey = cryptonote::get_service_node_winner_from_tx_extra(block.miner_tx.extra);
 		if (m_service_nodes_infos.count(winner_pubkey) == 1)
 		{
-			m_rollback_events.push_back(
-				std::unique_ptr<rollback_event>(
-					new rollback_change(block_height, winner_pubkey, m_service_nodes_infos[winner_pubkey])
-					)
-			);
+			push_rollback_event(new rollback_change(block_height, winner_pubkey, m_service_nodes_infos[winner_pubkey]));
 			// set the winner as though it was re-registering at transaction index=UINT32_MAX for this block
 			m_service_nodes_infos[winner_pubkey].last_reward_block_height = block_height;
 			m_service_nodes_infos[winner_pubkey].last_reward_transaction_index = UINT32_MAX;
@@ -951,33 +1365,51 @@ namespace service_nodes
 
 		store_quorum_state_from_rewards_list(block_height);
 
-		while (!m_quorum_states.empty() && m_quorum_states.begin()->first < cache_state_from_height)
-		{
-			m_quorum_states.erase(m_quorum_states.begin());
-		}
+		// Old quorums go a whole chunk at a time; store() drops their records
+		m_quorum_history.evict_below(cache_state_from_height);
+
+		if (m_height % SNAPSHOT_INTERVAL == 0)
+			take_snapshot();
 	}
 
 	void service_node_list::blockchain_detached(uint64_t height)
 	{
 		std::lock_guard<boost::recursive_mutex> lock(m_sn_mutex);
+		remove_snapshots_above(height);
+
+		// Clients that have seen any of the popped blocks can't be sent a delta
+		m_view_delta_floor = std::max(m_view_delta_floor, m_height + 1);
+
 		while (!m_rollback_events.empty() && m_rollback_events.back()->m_block_height >= height)
 		{
-			if (!m_rollback_events.back()->apply(m_service_nodes_infos))
+			const rollback_event *event = m_rollback_events.back().get();
+			if (event->type == rollback_event::change_type)
+				mark_info_dirty(static_cast<const rollback_change *>(event)->m_key);
+			else if (event->type == rollback_event::new_type)
+				mark_info_dirty(static_cast<const rollback_new *>(event)->m_key);
+
+			if (!event->apply(m_service_nodes_infos))
 			{
-				init();
+				// Deeper than the rollback events reach: replay forward from the
+				// newest snapshot at or below the new height instead, or from the
+				// start of the service node era when there is none.
+				clear(false);
+				load_snapshot(height);
+				if (!rebuild(height))
+					init();
 				break;
 			}
-			m_rollback_events.pop_back();
+			pop_rollback_event_back();
 		}
 
-		while (!m_quorum_states.empty() && (--m_quorum_states.end())->first >= height)
-		{
-			m_quorum_states.erase(--m_quorum_states.end());
-		}
+		for (uint64_t quorum_height = height; quorum_height < m_height; ++quorum_height)
+			mark_quorum_dirty(quorum_height);
+		m_quorum_history.erase_from(height);
 
 		m_height = height;
 
 		store();
+		publish_view();
 	}
 
 	std::vector<crypto::public_key> service_node_list::get_expired_nodes(uint64_t block_height) const
@@ -994,16 +1426,12 @@ namespace service_nodes
 
 		if (hard_fork_version >= 5)
 		{
-			for (auto &it : m_service_nodes_infos)
+			for (const auto& entry : index().by_registration_height())
 			{
-				crypto::public_key const &pubkey = it.first;
-				service_node_info  const &info = it.second;
-
-				uint64_t node_expiry_height = info.registration_height + lock_blocks;
-				if (block_height > node_expiry_height)
-				{
-					expired_nodes.push_back(pubkey);
-				}
+				uint64_t node_expiry_height = entry.first + lock_blocks;
+				if (block_height <= node_expiry_height)
+					break;
+				expired_nodes.push_back(entry.second);
 			}
 		}
 		else
@@ -1198,7 +1626,7 @@ namespace service_nodes
 			return;
 		}
 
-		std::vector<crypto::public_key> full_node_list = get_service_nodes_pubkeys();
+		const std::vector<crypto::public_key>& full_node_list = index().active();
 		std::vector<size_t>                              pub_keys_indexes(full_node_list.size());
 		{
 			size_t index = 0;
@@ -1245,7 +1673,8 @@ namespace service_nodes
 			}
 		}
 
-		m_quorum_states[height] = new_state;
+		m_quorum_history.set(height, *new_state);
+		mark_quorum_dirty(height);
 	}
 
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1292,68 +1721,534 @@ namespace service_nodes
 		return false;
 	}
 
-	bool service_node_list::store()
+	void service_node_list::push_rollback_event(rollback_event *event)
 	{
+		event->m_id = m_next_event_id++;
+		if (!m_store_full)
+			m_dirty_events.insert(event->m_id);
 
-		CHECK_AND_ASSERT_MES(m_db != nullptr, false, "Failed to store service node info, m_db == nullptr");
-		data_members_for_serialization data_to_store;
+		if (event->type == rollback_event::change_type)
+			mark_info_dirty(static_cast<rollback_change *>(event)->m_key);
+		else if (event->type == rollback_event::new_type)
+			mark_info_dirty(static_cast<rollback_new *>(event)->m_key);
+
+		m_rollback_events.push_back(std::unique_ptr<rollback_event>(event));
+	}
+
+	void service_node_list::push_rollback_event_front(rollback_event *event)
+	{
+		event->m_id = --m_first_event_id;
+		if (!m_store_full)
+			m_dirty_events.insert(event->m_id);
+		m_rollback_events.push_front(std::unique_ptr<rollback_event>(event));
+	}
+
+	void service_node_list::pop_rollback_event_front()
+	{
+		if (!m_store_full)
+			m_dirty_events.insert(m_rollback_events.front()->m_id);
+		m_rollback_events.pop_front();
+	}
+
+	void service_node_list::pop_rollback_event_back()
+	{
+		if (!m_store_full)
+			m_dirty_events.insert(m_rollback_events.back()->m_id);
+		m_rollback_events.pop_back();
+	}
+
+	void service_node_list::mark_info_dirty(const crypto::public_key& key)
+	{
+		m_index_stale.insert(key);
+		m_view_stale.insert(key);
+		if (!m_store_full)
+			m_dirty_infos.insert(key);
+	}
+
+	void service_node_list::mark_quorum_dirty(uint64_t height)
+	{
+		if (!m_store_full)
+			m_dirty_quorums.insert(height);
+	}
+
+	template <typename T>
+	static bool serialize_record(T& object, std::string& blob)
+	{
+		std::stringstream ss;
+		binary_archive<true> ba(ss);
+		if (!::serialization::serialize(ba, object))
+			return false;
+		blob = ss.str();
+		return true;
+	}
+
+	template <typename T>
+	static bool parse_record(const std::string& blob, T& object)
+	{
+		std::stringstream ss;
+		ss << blob;
+		binary_archive<false> ba(ss);
+		return ::serialization::serialize(ba, object);
+	}
+
+	// Heights and event ids are stored big-endian so that the database's
+	// lexicographic key order matches numeric order.
+	static std::string uint64_record_key(uint64_t value)
+	{
+		std::string key(sizeof(value), '\0');
+		for (size_t i = 0; i < sizeof(value); i++)
+			key[i] = static_cast<char>((value >> (8 * (sizeof(value) - 1 - i))) & 0xff);
+		return key;
+	}
+
+	static bool uint64_from_record_key(const std::string& key, uint64_t& value)
+	{
+		if (key.size() != sizeof(value))
+			return false;
+		value = 0;
+		for (size_t i = 0; i < sizeof(value); i++)
+			value = (value << 8) | static_cast<uint8_t>(key[i]);
+		return true;
+	}
+
+	static std::string pubkey_record_key(const crypto::public_key& pubkey)
+	{
+		return std::string(reinterpret_cast<const char *>(&pubkey), sizeof(pubkey));
+	}
+
+	// Quorum node table entries: big-endian chunk height, then big-endian index
+	static std::string quorum_node_record_key(uint64_t first_height, uint32_t index)
+	{
+		std::string key = uint64_record_key(first_height);
+		for (size_t i = 0; i < sizeof(index); i++)
+			key.push_back(static_cast<char>((index >> (8 * (sizeof(index) - 1 - i))) & 0xff));
+		return key;
+	}
+
+	static bool quorum_node_from_record_key(const std::string& key, uint64_t& first_height, uint32_t& index)
+	{
+		if (key.size() != sizeof(first_height) + sizeof(index) || !uint64_from_record_key(key.substr(0, sizeof(first_height)), first_height))
+			return false;
+		index = 0;
+		for (size_t i = sizeof(first_height); i < key.size(); i++)
+			index = (index << 8) | static_cast<uint8_t>(key[i]);
+		return true;
+	}
+
+	static bool to_rollback_event_variant(const service_node_list::rollback_event& event, service_node_list::rollback_event_variant& variant)
+	{
+		switch (event.type)
 		{
-			std::lock_guard<boost::recursive_mutex> lock(m_sn_mutex);
+		case service_node_list::rollback_event::change_type:
+			variant = static_cast<const service_node_list::rollback_change &>(event);
+			return true;
+		case service_node_list::rollback_event::new_type:
+			variant = static_cast<const service_node_list::rollback_new &>(event);
+			return true;
+		case service_node_list::rollback_event::prevent_type:
+			variant = static_cast<const service_node_list::prevent_rollback &>(event);
+			return true;
+		default:
+			MERROR("On storing service node data, unknown rollback event type encountered");
+			return false;
+		}
+	}
 
-			quorum_state_for_serialization quorum;
-			for (const auto& kv_pair : m_quorum_states)
+	static std::unique_ptr<service_node_list::rollback_event> from_rollback_event_variant(const service_node_list::rollback_event_variant& event)
+	{
+		if (event.type() == typeid(service_node_list::rollback_change))
+		{
+			service_node_list::rollback_change *i = new service_node_list::rollback_change();
+			const service_node_list::rollback_change& from = boost::get<service_node_list::rollback_change>(event);
+			i->m_block_height = from.m_block_height;
+			i->m_key = from.m_key;
+			i->m_info = from.m_info;
+			i->type = service_node_list::rollback_event::change_type;
+			return std::unique_ptr<service_node_list::rollback_event>(i);
+		}
+		else if (event.type() == typeid(service_node_list::rollback_new))
+		{
+			service_node_list::rollback_new *i = new service_node_list::rollback_new();
+			const service_node_list::rollback_new& from = boost::get<service_node_list::rollback_new>(event);
+			i->m_block_height = from.m_block_height;
+			i->m_key = from.m_key;
+			i->type = service_node_list::rollback_event::new_type;
+			return std::unique_ptr<service_node_list::rollback_event>(i);
+		}
+		else if (event.type() == typeid(service_node_list::prevent_rollback))
+		{
+			service_node_list::prevent_rollback *i = new service_node_list::prevent_rollback();
+			const service_node_list::prevent_rollback& from = boost::get<service_node_list::prevent_rollback>(event);
+			i->m_block_height = from.m_block_height;
+			i->type = service_node_list::rollback_event::prevent_type;
+			return std::unique_ptr<service_node_list::rollback_event>(i);
+		}
+
+		MERROR("Unhandled rollback event type in restoring data to service node list.");
+		return nullptr;
+	}
+
+	void service_node_list::take_snapshot()
+	{
+		snapshot_for_serialization snapshot;
+		snapshot.height = m_height;
+		snapshot.top_block_hash = m_blockchain.get_block_id_by_height(m_height - 1);
+
+		snapshot.infos.reserve(m_service_nodes_infos.size());
+		for (const auto& kv_pair : m_service_nodes_infos)
+			snapshot.infos.push_back({kv_pair.first, kv_pair.second});
+
+		snapshot.quorum_chunks.reserve(m_quorum_history.chunks().size());
+		for (const auto& kv_pair : m_quorum_history.chunks())
+			snapshot.quorum_chunks.push_back(*kv_pair.second);
+
+		std::string blob;
+		if (!serialize_record(snapshot, blob))
+		{
+			MERROR("Failed to serialize service node snapshot at height " << m_height);
+			return;
+		}
+
+		m_pending_snapshots[m_height] = std::move(blob);
+		while (m_pending_snapshots.size() > MAX_SNAPSHOTS)
+			m_pending_snapshots.erase(m_pending_snapshots.begin());
+	}
+
+	// Loads the newest stored snapshot at or below max_height that still
+	// matches the chain. The list must have been cleared by the caller.
+	bool service_node_list::load_snapshot(uint64_t max_height)
+	{
+		if (!m_db)
+			return false;
+
+		uint64_t snapshot_height;
+		std::string blob;
+		while (m_db->get_service_node_snapshot(max_height, snapshot_height, blob))
+		{
+			snapshot_for_serialization snapshot;
+			if (!parse_record(blob, snapshot) || snapshot.height != snapshot_height || snapshot_height == 0)
 			{
-				quorum.height = kv_pair.first;
-				quorum.state = *kv_pair.second;
-				data_to_store.quorum_states.push_back(quorum);
+				MERROR("Failed to parse service node snapshot at height " << snapshot_height);
+				return false;
 			}
 
-			node_info_for_serialization info;
-			for (const auto& kv_pair : m_service_nodes_infos)
+			if (snapshot.top_block_hash != m_blockchain.get_block_id_by_height(snapshot_height - 1))
 			{
-				info.key = kv_pair.first;
-				info.info = kv_pair.second;
-				data_to_store.infos.push_back(info);
+				MWARNING("Service node snapshot at height " << snapshot_height << " does not match the chain, skipping it");
+				max_height = snapshot_height - 1;
+				continue;
 			}
 
-			rollback_event_variant event;
-			for (const auto& event_ptr : m_rollback_events)
+			for (const auto& quorum_chunk : snapshot.quorum_chunks)
 			{
-				switch (event_ptr->type)
+				if (!quorum_chunk.is_valid())
 				{
-				case rollback_event::change_type:
-					event = *reinterpret_cast<rollback_change *>(event_ptr.get());
-					data_to_store.events.push_back(*reinterpret_cast<rollback_change *>(event_ptr.get()));
-					break;
-				case rollback_event::new_type:
-					event = *reinterpret_cast<rollback_new *>(event_ptr.get());
-					data_to_store.events.push_back(*reinterpret_cast<rollback_new *>(event_ptr.get()));
-					break;
-				case rollback_event::prevent_type:
-					event = *reinterpret_cast<prevent_rollback *>(event_ptr.get());
-					data_to_store.events.push_back(*reinterpret_cast<prevent_rollback *>(event_ptr.get()));
-					break;
-				default:
-					MERROR("On storing service node data, unknown rollback event type encountered");
+					MERROR("Invalid quorum data in service node snapshot at height " << snapshot_height);
+					clear(false);
 					return false;
 				}
+				m_quorum_history.set_chunk(std::make_shared<quorum_history::chunk>(quorum_chunk));
 			}
+			for (const auto& info : snapshot.infos)
+				m_service_nodes_infos[info.key] = info.info;
+			m_height = snapshot_height;
 
+			// The blocks below the snapshot left no rollback events, so a detach
+			// under it has to go back to an older snapshot or rescan.
+			push_rollback_event(new prevent_rollback(snapshot_height - 1));
+
+			MGINFO("Loaded service node list snapshot at height " << m_height << " with " << m_service_nodes_infos.size() << " nodes");
+			return true;
 		}
+		return false;
+	}
 
-		data_to_store.height = m_height;
+	void service_node_list::remove_snapshots_above(uint64_t height)
+	{
+		m_pending_snapshots.erase(m_pending_snapshots.upper_bound(height), m_pending_snapshots.end());
+		if (!m_db)
+			return;
 
-		std::stringstream ss;
-		binary_archive<true> ba(ss);
+		m_db->block_wtxn_start();
+		for (uint64_t snapshot_height : m_db->get_service_node_snapshot_heights())
+		{
+			if (snapshot_height > height)
+				m_db->remove_service_node_snapshot(snapshot_height);
+		}
+		m_db->block_wtxn_stop();
+	}
 
-		bool r = ::serialization::serialize(ba, data_to_store);
-		CHECK_AND_ASSERT_MES(r, false, "Failed to store service node info: failed to serialize data");
+	bool service_node_list::store()
+	{
+		CHECK_AND_ASSERT_MES(m_db != nullptr, false, "Failed to store service node info, m_db == nullptr");
+		std::lock_guard<boost::recursive_mutex> lock(m_sn_mutex);
 
-		std::string blob = ss.str();
+		// A partial delta must never be committed: drop the txn instead and
+		// leave m_store_full set so the next store rewrites every record.
 		m_db->block_wtxn_start();
-		m_db->set_service_node_data(blob);
+		bool r = false;
+		try
+		{
+			r = store_records();
+		}
+		catch (const std::exception& e)
+		{
+			MERROR("Failed to store service node info: " << e.what());
+		}
+
+		if (!r)
+		{
+			m_store_full = true;
+			m_db->block_wtxn_abort();
+			return false;
+		}
+
 		m_db->block_wtxn_stop();
+		return true;
+	}
+
+	bool service_node_list::store_records()
+	{
+		std::string blob;
+
+		if (m_store_full)
+		{
+			m_db->clear_service_node_data();
 
+			for (auto& kv_pair : m_service_nodes_infos)
+			{
+				CHECK_AND_ASSERT_MES(serialize_record(kv_pair.second, blob), false, "Failed to store service node info: failed to serialize info");
+				m_db->set_service_node_record(cryptonote::service_node_record_type::info, pubkey_record_key(kv_pair.first), blob);
+			}
+
+			m_stored_quorum_nodes.clear();
+			for (const auto& kv_pair : m_quorum_history.chunks())
+			{
+				const quorum_history::chunk& quorum_chunk = *kv_pair.second;
+				for (uint32_t i = 0; i < quorum_chunk.nodes.size(); i++)
+					m_db->set_service_node_record(cryptonote::service_node_record_type::quorum_node, quorum_node_record_key(kv_pair.first, i), pubkey_record_key(quorum_chunk.nodes[i]));
+				m_stored_quorum_nodes[kv_pair.first] = quorum_chunk.nodes.size();
+
+				for (size_t i = 0; i < quorum_chunk.quorums.size(); i++)
+				{
+					quorum_history::compact_quorum quorum = quorum_chunk.quorums[i];
+					CHECK_AND_ASSERT_MES(serialize_record(quorum, blob), false, "Failed to store service node info: failed to serialize quorum state");
+					m_db->set_service_node_record(cryptonote::service_node_record_type::quorum, uint64_record_key(kv_pair.first + i), blob);
+				}
+			}
+
+			rollback_event_variant event;
+			for (const auto& event_ptr : m_rollback_events)
+			{
+				if (!to_rollback_event_variant(*event_ptr, event))
+					return false;
+				CHECK_AND_ASSERT_MES(serialize_record(event, blob), false, "Failed to store service node info: failed to serialize rollback event");
+				m_db->set_service_node_record(cryptonote::service_node_record_type::rollback_event, uint64_record_key(event_ptr->m_id), blob);
+			}
+		}
+		else
+		{
+			// Any record that failed to write leaves the stored state inconsistent,
+			// so fall back to a full rewrite on the next store.
+			m_store_full = true;
+
+			for (const crypto::public_key& key : m_dirty_infos)
+			{
+				auto it = m_service_nodes_infos.find(key);
+				if (it == m_service_nodes_infos.end())
+				{
+					m_db->remove_service_node_record(cryptonote::service_node_record_type::info, pubkey_record_key(key));
+					continue;
+				}
+				CHECK_AND_ASSERT_MES(serialize_record(it->second, blob), false, "Failed to store service node info: failed to serialize info");
+				m_db->set_service_node_record(cryptonote::service_node_record_type::info, pubkey_record_key(key), blob);
+			}
+
+			// Evicted chunks take their node tables and heights with them
+			for (auto it = m_stored_quorum_nodes.begin(); it != m_stored_quorum_nodes.end();)
+			{
+				if (m_quorum_history.chunks().count(it->first))
+				{
+					++it;
+					continue;
+				}
+				for (uint32_t i = 0; i < it->second; i++)
+					m_db->remove_service_node_record(cryptonote::service_node_record_type::quorum_node, quorum_node_record_key(it->first, i));
+				for (uint64_t height = it->first; height < it->first + quorum_history::CHUNK_HEIGHTS; height++)
+					m_db->remove_service_node_record(cryptonote::service_node_record_type::quorum, uint64_record_key(height));
+				it = m_stored_quorum_nodes.erase(it);
+			}
+
+			// Node tables only grow, so only their new tails need writing
+			for (const auto& kv_pair : m_quorum_history.chunks())
+			{
+				const quorum_history::chunk& quorum_chunk = *kv_pair.second;
+				size_t& stored = m_stored_quorum_nodes[kv_pair.first];
+				for (uint32_t i = stored; i < quorum_chunk.nodes.size(); i++)
+					m_db->set_service_node_record(cryptonote::service_node_record_type::quorum_node, quorum_node_record_key(kv_pair.first, i), pubkey_record_key(quorum_chunk.nodes[i]));
+				stored = quorum_chunk.nodes.size();
+			}
+
+			for (uint64_t height : m_dirty_quorums)
+			{
+				const quorum_history::compact_quorum* stored_quorum = m_quorum_history.find(height);
+				if (!stored_quorum)
+				{
+					m_db->remove_service_node_record(cryptonote::service_node_record_type::quorum, uint64_record_key(height));
+					continue;
+				}
+				quorum_history::compact_quorum quorum = *stored_quorum;
+				CHECK_AND_ASSERT_MES(serialize_record(quorum, blob), false, "Failed to store service node info: failed to serialize quorum state");
+				m_db->set_service_node_record(cryptonote::service_node_record_type::quorum, uint64_record_key(height), blob);
+			}
+
+			if (!m_dirty_events.empty())
+			{
+				rollback_event_variant event;
+				for (const auto& event_ptr : m_rollback_events)
+				{
+					if (m_dirty_events.erase(event_ptr->m_id) == 0)
+						continue;
+					if (!to_rollback_event_variant(*event_ptr, event))
+						return false;
+					CHECK_AND_ASSERT_MES(serialize_record(event, blob), false, "Failed to store service node info: failed to serialize rollback event");
+					m_db->set_service_node_record(cryptonote::service_node_record_type::rollback_event, uint64_record_key(event_ptr->m_id), blob);
+				}
+
+				// whatever is left was popped before it could be stored, or after
+				for (uint64_t id : m_dirty_events)
+					m_db->remove_service_node_record(cryptonote::service_node_record_type::rollback_event, uint64_record_key(id));
+			}
+		}
+
+		if (!m_pending_snapshots.empty())
+		{
+			for (const auto& snapshot : m_pending_snapshots)
+				m_db->set_service_node_snapshot(snapshot.first, snapshot.second);
+			m_pending_snapshots.clear();
+
+			const std::vector<uint64_t> heights = m_db->get_service_node_snapshot_heights();
+			for (size_t i = 0; i + MAX_SNAPSHOTS < heights.size(); i++)
+				m_db->remove_service_node_snapshot(heights[i]);
+		}
+
+		header_for_serialization header;
+		header.version = SERVICE_NODE_RECORDS_VERSION;
+		header.height = m_height;
+		CHECK_AND_ASSERT_MES(serialize_record(header, blob), false, "Failed to store service node info: failed to serialize header");
+		m_db->set_service_node_record(cryptonote::service_node_record_type::header, "", blob);
+
+		m_store_full = false;
+		m_dirty_infos.clear();
+		m_dirty_quorums.clear();
+		m_dirty_events.clear();
+		return true;
+	}
+
+	bool service_node_list::load_records()
+	{
+		std::string blob;
+		if (!m_db->get_service_node_record(cryptonote::service_node_record_type::header, "", blob))
+			return false;
+
+		header_for_serialization header;
+		CHECK_AND_ASSERT_MES(parse_record(blob, header), false, "Failed to parse service node data header");
+		if (header.version != SERVICE_NODE_RECORDS_VERSION && header.version != 1)
+		{
+			MWARNING("Unsupported service node data version " << (unsigned)header.version << ", rebuilding");
+			return false;
+		}
+
+		bool r = m_db->for_all_service_node_records(cryptonote::service_node_record_type::info, [this](const std::string& key, const std::string& data) {
+			crypto::public_key pubkey;
+			service_node_info info;
+			if (key.size() != sizeof(pubkey) || !parse_record(data, info))
+				return false;
+			memcpy(&pubkey, key.data(), sizeof(pubkey));
+			m_service_nodes_infos.emplace(pubkey, std::move(info));
+			return true;
+		});
+		CHECK_AND_ASSERT_MES(r, false, "Failed to parse service node info records");
+
+		if (header.version == 1)
+		{
+			// Version 1 stored each quorum in full; it is rewritten compactly on the next store
+			r = m_db->for_all_service_node_records(cryptonote::service_node_record_type::quorum, [this](const std::string& key, const std::string& data) {
+				uint64_t height;
+				quorum_state state;
+				if (!uint64_from_record_key(key, height) || !parse_record(data, state))
+					return false;
+				m_quorum_history.set(height, state);
+				return true;
+			});
+			CHECK_AND_ASSERT_MES(r, false, "Failed to parse service node quorum records");
+		}
+		else
+		{
+			std::map<uint64_t, std::shared_ptr<quorum_history::chunk>> chunks;
+			r = m_db->for_all_service_node_records(cryptonote::service_node_record_type::quorum_node, [&chunks](const std::string& key, const std::string& data) {
+				uint64_t first_height;
+				uint32_t index;
+				if (!quorum_node_from_record_key(key, first_height, index) || data.size() != sizeof(crypto::public_key))
+					return false;
+				std::shared_ptr<quorum_history::chunk>& quorum_chunk = chunks[first_height];
+				if (!quorum_chunk)
+				{
+					quorum_chunk = std::make_shared<quorum_history::chunk>();
+					quorum_chunk->first_height = first_height;
+				}
+				// records come in key order, so each table is read front to back
+				if (index != quorum_chunk->nodes.size())
+					return false;
+				quorum_chunk->nodes.emplace_back();
+				memcpy(&quorum_chunk->nodes.back(), data.data(), data.size());
+				return true;
+			});
+			CHECK_AND_ASSERT_MES(r, false, "Failed to parse service node quorum node records");
+
+			r = m_db->for_all_service_node_records(cryptonote::service_node_record_type::quorum, [&chunks](const std::string& key, const std::string& data) {
+				uint64_t height;
+				quorum_history::compact_quorum quorum;
+				if (!uint64_from_record_key(key, height) || !parse_record(data, quorum))
+					return false;
+				auto it = chunks.find(quorum_history::chunk_start(height));
+				if (it == chunks.end())
+					return false;
+				std::vector<quorum_history::compact_quorum>& quorums = it->second->quorums;
+				if (quorums.size() <= height - it->first)
+					quorums.resize(height - it->first + 1);
+				quorums[height - it->first] = std::move(quorum);
+				return true;
+			});
+			CHECK_AND_ASSERT_MES(r, false, "Failed to parse service node quorum records");
+
+			for (auto& kv_pair : chunks)
+			{
+				CHECK_AND_ASSERT_MES(kv_pair.second->is_valid(), false, "Invalid service node quorum records at height " << kv_pair.first);
+				m_stored_quorum_nodes[kv_pair.first] = kv_pair.second->nodes.size();
+				m_quorum_history.set_chunk(std::move(kv_pair.second));
+			}
+		}
+
+		r = m_db->for_all_service_node_records(cryptonote::service_node_record_type::rollback_event, [this](const std::string& key, const std::string& data) {
+			uint64_t id;
+			rollback_event_variant event;
+			if (!uint64_from_record_key(key, id) || !parse_record(data, event))
+				return false;
+			std::unique_ptr<rollback_event> event_ptr = from_rollback_event_variant(event);
+			if (!event_ptr)
+				return false;
+			event_ptr->m_id = id;
+			if (m_rollback_events.empty())
+				m_first_event_id = id;
+			m_next_event_id = id + 1;
+			m_rollback_events.push_back(std::move(event_ptr));
+			return true;
+		});
+		CHECK_AND_ASSERT_MES(r, false, "Failed to parse service node rollback event records");
+
+		m_height = header.height;
+		m_store_full = header.version != SERVICE_NODE_RECORDS_VERSION;
 		return true;
 	}
 
@@ -1365,6 +2260,23 @@ namespace service_nodes
 		{
 			return false;
 		}
+
+		m_db->block_wtxn_start();
+		bool loaded = load_records();
+		m_db->block_wtxn_stop();
+
+		if (loaded)
+		{
+			MGINFO("Service node data loaded successfully, m_height: " << m_height);
+			MGINFO(m_service_nodes_infos.size() << " nodes and " << m_rollback_events.size() << " rollback events loaded.");
+
+			LOG_PRINT_L1("service_node_list::load() returning success");
+			return true;
+		}
+		clear(false);
+
+		// Fall back to the single blob written by older versions; m_store_full
+		// stays set so the next store() migrates it to keyed records.
 		std::stringstream ss;
 
 		data_members_for_serialization data_in;
@@ -1387,7 +2299,7 @@ namespace service_nodes
 
 		for (const auto& quorum : data_in.quorum_states)
 		{
-			m_quorum_states[quorum.height] = std::make_shared<quorum_state>(quorum.state);
+			m_quorum_history.set(quorum.height, quorum.state);
 		}
 
 		for (const auto& info : data_in.infos)
@@ -1397,38 +2309,11 @@ namespace service_nodes
 
 		for (const auto& event : data_in.events)
 		{
-			if (event.type() == typeid(rollback_change))
-			{
-				rollback_change *i = new rollback_change();
-				const rollback_change& from = boost::get<rollback_change>(event);
-				i->m_block_height = from.m_block_height;
-				i->m_key = from.m_key;
-				i->m_info = from.m_info;
-				i->type = rollback_event::change_type;
-				m_rollback_events.push_back(std::unique_ptr<rollback_event>(i));
-			}
-			else if (event.type() == typeid(rollback_new))
-			{
-				rollback_new *i = new rollback_new();
-				const rollback_new& from = boost::get<rollback_new>(event);
-				i->m_block_height = from.m_block_height;
-				i->m_key = from.m_key;
-				i->type = rollback_event::new_type;
-				m_rollback_events.push_back(std::unique_ptr<rollback_event>(i));
-			}
-			else if (event.type() == typeid(prevent_rollback))
-			{
-				prevent_rollback *i = new prevent_rollback();
-				const prevent_rollback& from = boost::get<prevent_rollback>(event);
-				i->m_block_height = from.m_block_height;
-				i->type = rollback_event::prevent_type;
-				m_rollback_events.push_back(std::unique_ptr<rollback_event>(i));
-			}
-			else
-			{
-				MERROR("Unhandled rollback event type in restoring data to service node list.");
+			std::unique_ptr<rollback_event> event_ptr = from_rollback_event_variant(event);
+			if (!event_ptr)
 				return false;
-			}
+			event_ptr->m_id = m_next_event_id++;
+			m_rollback_events.push_back(std::move(event_ptr));
 		}
 
 		MGINFO("Service node data loaded successfully, m_height: " << m_height);
@@ -1443,6 +2328,18 @@ namespace service_nodes
 		m_service_nodes_infos.clear();
 		m_rollback_events.clear();
 
+		m_index_rebuild = true;
+		m_index_stale.clear();
+		m_view_rebuild = true;
+		m_view_stale.clear();
+
+		m_store_full = true;
+		m_dirty_infos.clear();
+		m_dirty_quorums.clear();
+		m_dirty_events.clear();
+		m_first_event_id = ROLLBACK_EVENT_ID_BASE;
+		m_next_event_id = ROLLBACK_EVENT_ID_BASE;
+
 		if (m_db && delete_db_entry)
 		{
 			m_db->block_wtxn_start();
@@ -1450,7 +2347,8 @@ namespace service_nodes
 			m_db->block_wtxn_stop();
 		}
 
-		m_quorum_states.clear();
+		m_quorum_history.clear();
+		m_stored_quorum_nodes.clear();
 
 		uint64_t hardfork_5_from_height = 0;
 		{
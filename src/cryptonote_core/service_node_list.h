@@ -33,7 +33,10 @@
 #include "serialization/serialization.h"
 #include "cryptonote_core/service_node_rules.h"
 // #include "eth_adapter/eth_adapter.h"
+#include <deque>
 #include <list>
+#include <set>
+#include <unordered_set>
 namespace service_nodes
 {
 	constexpr size_t QUORUM_SIZE = 10;
@@ -49,6 +52,15 @@ namespace service_nodes
 	// and nearby swarms will mirror it's data. It will disappear, and is already considered gone.
 	constexpr size_t MIN_SWARM_SIZE = 5;
 
+	// A snapshot of the whole list is stored every SNAPSHOT_INTERVAL blocks
+	// (about a day) and the newest MAX_SNAPSHOTS of them are kept.
+	constexpr uint64_t SNAPSHOT_INTERVAL = 720;
+	constexpr size_t MAX_SNAPSHOTS = 4;
+
+	// Published views remember removed nodes for this many blocks, which bounds
+	// how far back a "changed since" query can be answered with a delta.
+	constexpr uint64_t VIEW_REMOVED_HISTORY = 720;
+
 	class quorum_cop;
 
 	struct quorum_state
@@ -155,6 +167,159 @@ namespace service_nodes
 	template<typename T>
 	void triton_shuffle(std::vector<T>& a, uint64_t seed);
 
+	struct pubkey_less
+	{
+		bool operator()(const crypto::public_key& a, const crypto::public_key& b) const
+		{
+			return memcmp(reinterpret_cast<const void*>(&a), reinterpret_cast<const void*>(&b), sizeof(a)) < 0;
+		}
+	};
+
+	struct registration_height_less
+	{
+		bool operator()(const std::pair<uint64_t, crypto::public_key>& a, const std::pair<uint64_t, crypto::public_key>& b) const
+		{
+			return a.first != b.first ? a.first < b.first : pubkey_less()(a.second, b.second);
+		}
+	};
+
+	/// Views of the service node list that are updated one node at a time, so
+	/// quorum selection and expiry don't have to scan and sort the
+	/// whole list every block.
+	class service_node_index
+	{
+	public:
+		/// Empties the index. Whether partially funded (but valid) nodes count
+		/// as active depends on the hard fork, so it is fixed per index.
+		void clear(bool allow_partially_funded);
+
+		/// Re-indexes one node; info is null if the node has left the list.
+		void update(const crypto::public_key& key, const service_node_info* info);
+
+		bool allows_partially_funded() const { return m_allow_partially_funded; }
+
+		/// Active nodes, sorted by pubkey
+		const std::vector<crypto::public_key>& active() const { return m_active; }
+
+		/// All nodes ordered by registration height, and so by expiry height
+		const std::set<std::pair<uint64_t, crypto::public_key>, registration_height_less>& by_registration_height() const { return m_by_registration_height; }
+
+	private:
+		struct entry
+		{
+			bool active;
+			uint64_t registration_height;
+		};
+
+		bool is_active(const service_node_info& info) const;
+		static void insert_sorted(std::vector<crypto::public_key>& keys, const crypto::public_key& key);
+		static void erase_sorted(std::vector<crypto::public_key>& keys, const crypto::public_key& key);
+
+		bool m_allow_partially_funded = false;
+		std::unordered_map<crypto::public_key, entry> m_entries;
+		std::vector<crypto::public_key> m_active;
+		std::set<std::pair<uint64_t, crypto::public_key>, registration_height_less> m_by_registration_height;
+	};
+
+	/// Quorum states for a window of heights, kept compactly: heights are
+	/// grouped into chunks, and each chunk stores its quorums as indices into a
+	/// table of the node pubkeys used within it. The table only grows while
+	/// the chunk exists, so indices stay valid (and can be stored) for its
+	/// lifetime. Chunks referenced elsewhere (by a published view) are copied
+	/// before being changed.
+	class quorum_history
+	{
+	public:
+		static constexpr uint64_t CHUNK_HEIGHTS = 256;
+
+		struct compact_quorum
+		{
+			uint32_t num_quorum_nodes = 0;
+			std::vector<uint32_t> nodes; // quorum nodes, then nodes to test
+
+			BEGIN_SERIALIZE()
+				VARINT_FIELD(num_quorum_nodes)
+				FIELD(nodes)
+			END_SERIALIZE()
+		};
+
+		struct chunk
+		{
+			uint64_t first_height = 0; // a multiple of CHUNK_HEIGHTS
+			std::vector<crypto::public_key> nodes;
+			std::vector<compact_quorum> quorums; // by height - first_height
+
+			bool is_valid() const;
+
+			BEGIN_SERIALIZE()
+				VARINT_FIELD(first_height)
+				FIELD(nodes)
+				FIELD(quorums)
+			END_SERIALIZE()
+		};
+
+		using chunk_map = std::map<uint64_t, std::shared_ptr<const chunk>>;
+
+		static uint64_t chunk_start(uint64_t height) { return height - height % CHUNK_HEIGHTS; }
+
+		/// @return the quorum at height, or null if none is stored
+		static std::shared_ptr<const quorum_state> get(const chunk_map& chunks, uint64_t height);
+		std::shared_ptr<const quorum_state> get(uint64_t height) const;
+		const compact_quorum* find(uint64_t height) const;
+
+		/// Shares the current chunks, e.g. with a published view
+		chunk_map share() const;
+		const std::map<uint64_t, std::shared_ptr<chunk>>& chunks() const { return m_chunks; }
+
+		void set(uint64_t height, const quorum_state& state);
+		/// Adds a whole chunk (when loading); the caller checks it with is_valid()
+		void set_chunk(std::shared_ptr<chunk> new_chunk);
+		/// Forgets the quorums at height and above; node tables are kept
+		void erase_from(uint64_t height);
+		/// Drops chunks that lie entirely below height. Heights below it that
+		/// share a chunk with later ones stay until the whole chunk goes.
+		void evict_below(uint64_t height);
+		void clear();
+
+	private:
+		chunk& writable_chunk(uint64_t first_height);
+
+		std::map<uint64_t, std::shared_ptr<chunk>> m_chunks;
+
+		// pubkey -> index in the node table of chunk m_lookup_chunk, the one
+		// last added to
+		uint64_t m_lookup_chunk = UINT64_MAX;
+		std::unordered_map<crypto::public_key, uint32_t> m_lookup;
+	};
+
+	/// An immutable copy of the list as of one height. A new view is published
+	/// after every block, sharing the infos of unchanged nodes with the previous
+	/// one, so readers such as RPC never wait on the list's mutex.
+	struct service_node_list_view
+	{
+		struct entry
+		{
+			crypto::public_key pubkey;
+			std::shared_ptr<const service_node_info> info;
+			uint64_t last_changed_height; // view height at which this info was published
+		};
+
+		uint64_t height = 0;
+		std::vector<entry> entries; // sorted by pubkey
+		quorum_history::chunk_map quorum_chunks;
+
+		// Nodes removed from the list, by the view height at which they went.
+		// A node that came back also has an entry with a later last_changed_height.
+		std::deque<std::pair<uint64_t, crypto::public_key>> removed;
+
+		// Changes since a height are only complete for since_height >= delta_floor;
+		// older clients (or clients that saw blocks since popped) need the full list.
+		uint64_t delta_floor = 0;
+
+		const entry* find(const crypto::public_key& pubkey) const;
+		bool can_delta_since(uint64_t since_height) const { return since_height >= delta_floor && since_height <= height; }
+	};
+
 	static constexpr uint64_t QUEUE_SWARM_ID = 0;
 
 	class service_node_list
@@ -181,6 +346,9 @@ namespace service_nodes
 		const std::shared_ptr<const quorum_state> get_quorum_state(uint64_t height) const;
 		std::vector<service_node_pubkey_info> get_service_node_list_state(const std::vector<crypto::public_key> &service_node_pubkeys) const;
 
+		/// The most recently published view; never null. Doesn't take the list's mutex.
+		std::shared_ptr<const service_node_list_view> get_view() const;
+
 		void set_db_pointer(cryptonote::BlockchainDB* db);
 		void set_my_service_node_keys(crypto::public_key const *pub_key);
 		bool store();
@@ -203,6 +371,10 @@ namespace service_nodes
 
 			uint64_t m_block_height;
 
+			// sequence id of the stored record for this event; not serialized,
+			// it is the record key itself
+			uint64_t m_id = 0;
+
 			BEGIN_SERIALIZE()
 				VARINT_FIELD(m_block_height)
 			END_SERIALIZE()
@@ -288,6 +460,37 @@ namespace service_nodes
 			END_SERIALIZE()		
 		};
 
+		// Stored under service_node_record_type::header; the remaining state is
+		// kept as one record per node, per quorum height and per rollback event.
+		struct header_for_serialization
+		{
+			uint8_t version;
+			uint64_t height;
+
+			BEGIN_SERIALIZE()
+				VARINT_FIELD(version)
+				VARINT_FIELD(height)
+			END_SERIALIZE()
+		};
+
+		// The whole list as of a height, taken every SNAPSHOT_INTERVAL blocks so
+		// that rollbacks and recovery can replay from it instead of from the
+		// start of the service node era.
+		struct snapshot_for_serialization
+		{
+			uint64_t height;
+			crypto::hash top_block_hash; // hash of block height - 1, to detect a changed chain
+			std::vector<node_info_for_serialization> infos;
+			std::vector<quorum_history::chunk> quorum_chunks;
+
+			BEGIN_SERIALIZE()
+				VARINT_FIELD(height)
+				FIELD(top_block_hash)
+				FIELD(infos)
+				FIELD(quorum_chunks)
+			END_SERIALIZE()
+		};
+
 		struct data_members_for_serialization
 		{
 			std::vector<quorum_state_for_serialization> quorum_states;
@@ -317,16 +520,39 @@ namespace service_nodes
 		bool process_deregistration_tx(const cryptonote::transaction& tx, uint64_t block_height);
 		bool process_swap_tx(const cryptonote::transaction& tx, uint64_t block_height, uint32_t index);
 		void block_added_generic(const cryptonote::block& blck, const std::vector<std::pair<cryptonote::transaction, cryptonote::blobdata>>& txs);
+		void init_locked();
+		bool rebuild(uint64_t current_height);
 
 		bool contribution_tx_output_has_correct_unlock_time(const cryptonote::transaction& tx, size_t i, uint64_t block_height) const;
 
 		void store_quorum_state_from_rewards_list(uint64_t height);
+		std::shared_ptr<const quorum_state> find_quorum_state(uint64_t height) const;
 
 		bool is_registration_tx(const cryptonote::transaction& tx, uint64_t block_timestamp, uint64_t block_height, uint32_t index, crypto::public_key& key, service_node_info& info) const;
 		std::vector<crypto::public_key> get_expired_nodes(uint64_t block_height) const;
 
 		void clear(bool delete_db_entry = false);
 		bool load();
+		bool load_records();
+		bool store_records();
+		void take_snapshot();
+		bool load_snapshot(uint64_t max_height);
+		void remove_snapshots_above(uint64_t height);
+
+		// Every change to m_service_nodes_infos is preceded by a rollback event
+		// naming the changed key, so pushing an event also marks the key dirty.
+		void push_rollback_event(rollback_event *event);
+		void push_rollback_event_front(rollback_event *event);
+		void pop_rollback_event_front();
+		void pop_rollback_event_back();
+		void mark_info_dirty(const crypto::public_key& key);
+		void mark_quorum_dirty(uint64_t height);
+
+		// Brings m_index up to date with m_service_nodes_infos and returns it
+		const service_node_index& index() const;
+
+		// Builds a view of the current state from the previous one and swaps it in
+		void publish_view();
 
 		mutable boost::recursive_mutex m_sn_mutex;
 
@@ -342,7 +568,34 @@ namespace service_nodes
 
 		cryptonote::BlockchainDB* m_db;
 
-		std::map<block_height, std::shared_ptr<const quorum_state>> m_quorum_states;
+		quorum_history m_quorum_history;
+
+		// Records touched since the last store(). When m_store_full is set the
+		// stored state is rewritten from scratch instead and these are not kept.
+		bool m_store_full;
+		std::unordered_set<crypto::public_key> m_dirty_infos;
+		std::set<block_height> m_dirty_quorums;
+		// number of node table entries stored for each quorum chunk
+		std::map<block_height, size_t> m_stored_quorum_nodes;
+		std::set<uint64_t> m_dirty_events;
+		uint64_t m_first_event_id;
+		uint64_t m_next_event_id;
+
+		// snapshots taken since the last store(), by height
+		std::map<block_height, std::string> m_pending_snapshots;
+
+		// Nodes changed since m_index was last brought up to date; after bulk
+		// changes (clear, load) m_index_rebuild is set instead.
+		mutable service_node_index m_index;
+		mutable std::unordered_set<crypto::public_key> m_index_stale;
+		mutable bool m_index_rebuild;
+
+		// Read with std::atomic_load, replaced with std::atomic_store. Nodes changed
+		// since it was published are in m_view_stale, or m_view_rebuild is set.
+		std::shared_ptr<const service_node_list_view> m_view;
+		std::unordered_set<crypto::public_key> m_view_stale;
+		bool m_view_rebuild;
+		uint64_t m_view_delta_floor;
 
 		std::vector<contract> m_contracts;
 	};
@@ -0,0 +1,210 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "common/threadpool.h"
+#include "service_node_signatures.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "service_nodes"
+
+namespace service_nodes
+{
+	namespace
+	{
+		// Below this many signatures handing them to the thread pool costs more than it saves
+		constexpr size_t PARALLEL_CHECK_MIN_SIGNATURES = 8;
+		constexpr size_t VERIFIED_SIGNATURES_CACHE_SIZE = 16384;
+
+		crypto::hash item_digest(const signature_batch::item& item)
+		{
+			static_assert(sizeof(signature_batch::item) == sizeof(crypto::hash) + sizeof(crypto::public_key) + sizeof(crypto::signature), "Unexpected padding");
+			crypto::hash result;
+			crypto::cn_fast_hash(&item, sizeof(item), result);
+			return result;
+		}
+
+		// Digests of recently checked valid signatures. A quorum's votes are
+		// checked when each vote arrives, again when they make up a deregister
+		// tx, and again when that tx is mined.
+		class verified_signatures
+		{
+		public:
+			bool contains(const crypto::hash& digest)
+			{
+				boost::lock_guard<boost::mutex> lock(m_mutex);
+				return m_digests.find(digest) != m_digests.end();
+			}
+
+			void insert(const std::vector<crypto::hash>& digests)
+			{
+				boost::lock_guard<boost::mutex> lock(m_mutex);
+				for (const crypto::hash& digest : digests)
+				{
+					if (!m_digests.insert(digest).second)
+						continue;
+					m_order.push_back(digest);
+					if (m_order.size() > VERIFIED_SIGNATURES_CACHE_SIZE)
+					{
+						m_digests.erase(m_order.front());
+						m_order.pop_front();
+					}
+				}
+			}
+
+		private:
+			boost::mutex m_mutex;
+			std::unordered_set<crypto::hash> m_digests;
+			std::deque<crypto::hash> m_order;
+		};
+
+		verified_signatures& get_verified_signatures()
+		{
+			static verified_signatures instance;
+			return instance;
+		}
+	}
+
+	void signature_batch::add(const crypto::hash& hash, const crypto::public_key& pubkey, const crypto::signature& sig)
+	{
+		m_items.push_back({hash, pubkey, sig});
+	}
+
+	bool signature_batch::check(std::vector<bool>* valid) const
+	{
+		verified_signatures& cache = get_verified_signatures();
+
+		// results[i] is only written for the first of each set of duplicates;
+		// same_as[i] points duplicates (and cache hits, at themselves) to it
+		std::vector<uint8_t> results(m_items.size(), 0);
+		std::vector<size_t> same_as(m_items.size());
+		std::vector<crypto::hash> digests(m_items.size());
+		std::vector<size_t> to_check;
+		std::unordered_map<crypto::hash, size_t> first_with_digest;
+		for (size_t i = 0; i < m_items.size(); ++i)
+		{
+			digests[i] = item_digest(m_items[i]);
+			same_as[i] = i;
+			if (cache.contains(digests[i]))
+			{
+				results[i] = 1;
+				continue;
+			}
+
+			const auto inserted = first_with_digest.emplace(digests[i], i);
+			same_as[i] = inserted.first->second;
+			if (inserted.second)
+				to_check.push_back(i);
+		}
+
+		auto check_range = [this, &results, &to_check](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; ++k)
+			{
+				const item& it = m_items[to_check[k]];
+				results[to_check[k]] = crypto::check_signature(it.hash, it.pubkey, it.sig) ? 1 : 0;
+			}
+		};
+
+		if (to_check.size() < PARALLEL_CHECK_MIN_SIGNATURES)
+		{
+			check_range(0, to_check.size());
+		}
+		else
+		{
+			tools::threadpool& tpool = tools::threadpool::getInstance();
+			tools::threadpool::waiter waiter;
+			const size_t threads = std::max<size_t>(1, tpool.get_max_concurrency());
+			const size_t chunk = (to_check.size() + threads - 1) / threads;
+			for (size_t begin = 0; begin < to_check.size(); begin += chunk)
+			{
+				const size_t end = std::min(to_check.size(), begin + chunk);
+				tpool.submit(&waiter, [&check_range, begin, end] { check_range(begin, end); }, true);
+			}
+			waiter.wait(&tpool);
+		}
+
+		bool all_valid = true;
+		std::vector<crypto::hash> newly_verified;
+		for (size_t i = 0; i < m_items.size(); ++i)
+		{
+			results[i] = results[same_as[i]];
+			if (!results[i])
+				all_valid = false;
+			else if (same_as[i] == i && first_with_digest.count(digests[i]))
+				newly_verified.push_back(digests[i]);
+		}
+		if (m_remember_valid)
+			cache.insert(newly_verified);
+
+		if (valid)
+			valid->assign(results.begin(), results.end());
+		return all_valid;
+	}
+
+	bool signature_queue::check(const crypto::hash& hash, const crypto::public_key& pubkey, const crypto::signature& sig)
+	{
+		pending mine = {{hash, pubkey, sig}, false, false};
+
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		m_pending.push_back(&mine);
+		while (!mine.done)
+		{
+			if (m_busy)
+			{
+				m_cond.wait(lock);
+				continue;
+			}
+
+			// Check everything queued, including the ones that arrive while this
+			// batch runs on the next pass
+			m_busy = true;
+			std::vector<pending*> batch;
+			batch.swap(m_pending);
+			lock.unlock();
+
+			signature_batch signatures;
+			for (const pending* p : batch)
+				signatures.add(p->item.hash, p->item.pubkey, p->item.sig);
+			std::vector<bool> valid;
+			signatures.check(&valid);
+
+			lock.lock();
+			for (size_t i = 0; i < batch.size(); ++i)
+			{
+				batch[i]->valid = valid[i];
+				batch[i]->done = true;
+			}
+			m_busy = false;
+			m_cond.notify_all();
+		}
+		return mine.valid;
+	}
+}
@@ -0,0 +1,94 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+
+namespace service_nodes
+{
+	/// Signatures made by service node keys (deregister votes and uptime
+	/// proofs), checked together: exact duplicates are checked once, signatures
+	/// already seen to be valid are not checked again, and the rest are spread
+	/// over the thread pool.
+	class signature_batch
+	{
+	public:
+		struct item
+		{
+			crypto::hash hash;
+			crypto::public_key pubkey;
+			crypto::signature sig;
+		};
+
+		/// remember_valid: whether valid signatures are remembered, so that later
+		/// batches don't check them again
+		explicit signature_batch(bool remember_valid = true) : m_remember_valid(remember_valid) {}
+
+		void add(const crypto::hash& hash, const crypto::public_key& pubkey, const crypto::signature& sig);
+		size_t size() const { return m_items.size(); }
+		bool empty() const { return m_items.empty(); }
+		void clear() { m_items.clear(); }
+
+		/// @return true if every signature is valid. If valid is given it gets one
+		/// flag per signature, in the order they were added.
+		bool check(std::vector<bool>* valid = nullptr) const;
+
+	private:
+		std::vector<item> m_items;
+		bool m_remember_valid;
+	};
+
+	/// Lets threads that each have a single signature to check (one per p2p
+	/// message) have them checked as one batch: whichever caller finds no batch
+	/// running takes everything queued so far, the others wait for its result.
+	class signature_queue
+	{
+	public:
+		bool check(const crypto::hash& hash, const crypto::public_key& pubkey, const crypto::signature& sig);
+
+	private:
+		struct pending
+		{
+			signature_batch::item item;
+			bool valid;
+			bool done;
+		};
+
+		boost::mutex m_mutex;
+		boost::condition_variable m_cond;
+		std::vector<pending*> m_pending;
+		bool m_busy = false;
+	};
+}
@@ -47,6 +47,7 @@
 #include "common/perf_timer.h"
 #include "crypto/hash.h"
 #include "crypto/duration.h"
+#include "ringct/rctSigs.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "txpool"
@@ -119,7 +120,7 @@ namespace cryptonote
   }
   //---------------------------------------------------------------------------------
   //---------------------------------------------------------------------------------
-  tx_memory_pool::tx_memory_pool(Blockchain& bchs): m_blockchain(bchs), m_cookie(0), m_txpool_max_weight(DEFAULT_TXPOOL_MAX_WEIGHT), m_txpool_weight(0), m_mine_stem_txes(false)
+  tx_memory_pool::tx_memory_pool(Blockchain& bchs): m_blockchain(bchs), m_cookie(0), m_txpool_max_weight(DEFAULT_TXPOOL_MAX_WEIGHT), m_txpool_weight(0), m_mine_stem_txes(false), m_input_cache(CRYPTONOTE_MEMPOOL_INPUT_CACHE_MAX_ENTRIES), m_parsed_tx_cache(CRYPTONOTE_MEMPOOL_PARSED_TX_CACHE_MAX_ENTRIES)
   {
 
   }
@@ -176,71 +177,16 @@ namespace cryptonote
       return false;
     }
 
-    // we do not accept transactions that timed out before, unless they're
-    // kept_by_block
-    if (!kept_by_block && m_timed_out_transactions.find(id) != m_timed_out_transactions.end())
-    {
-      // not clear if we should set that, since verifivation (sic) did not fail before, since
-      // the tx was accepted before timing out.
-      tvc.m_verifivation_failed = true;
-      return false;
-    }
-
-    if(!check_inputs_types_supported(tx))
-    {
-      tvc.m_verifivation_failed = true;
-      tvc.m_invalid_input = true;
-      return false;
-    }
-
     // fee per kilobyte, size rounded up.
     uint64_t fee;
 
-    if (!get_tx_miner_fee(tx, fee, version >= HF_VERSION_FEE_BURNING))
-    {
-      tvc.m_verifivation_failed = true;
-      tvc.m_fee_too_low = true;
-    }
-
-	if (!kept_by_block && !tx.is_deregister_tx() && !m_blockchain.check_fee(tx_weight, fee))
-    {
-      tvc.m_verifivation_failed = true;
-      tvc.m_fee_too_low = true;
-      return false;
-    }
-
-    size_t tx_weight_limit = get_transaction_weight_limit(version);
-    if ((!kept_by_block || version >= HF_VERSION_PER_BYTE_FEE) && tx_weight > tx_weight_limit)
+    if (!check_tx_admission(tx, id, tx_weight, kept_by_block, version, fee, tvc))
     {
-      LOG_PRINT_L1("transaction is too heavy: " << tx_weight << " bytes, maximum weight: " << tx_weight_limit);
-      tvc.m_verifivation_failed = true;
-      tvc.m_too_big = true;
+      if (tvc.m_double_spend)
+        mark_double_spend(tx);
       return false;
     }
 
-    // if the transaction came from a block popped from the chain,
-    // don't check if we have its key images as spent.
-    // TODO: Investigate why not?
-    if(!kept_by_block)
-    {
-      if(have_tx_keyimges_as_spent(tx, id))
-      {
-        mark_double_spend(tx);
-        LOG_PRINT_L1("Transaction with id= "<< id << " used already spent key images");
-        tvc.m_verifivation_failed = true;
-        tvc.m_double_spend = true;
-        return false;
-      }
-	  if (have_deregister_tx_already(tx))
-	  {
-		  mark_double_spend(tx);
-		  LOG_PRINT_L1("Transaction version 3 with id= " << id << " already has a deregister for height");
-		  tvc.m_verifivation_failed = true;
-		  tvc.m_double_spend = true;
-		  return false;
-	  }
-   }
-
 
     if (!m_blockchain.check_tx_outputs(tx, tvc))
     {
@@ -283,7 +229,7 @@ namespace cryptonote
         try
         {
           if (kept_by_block)
-            m_parsed_tx_cache.insert(std::make_pair(id, tx));
+            m_parsed_tx_cache.put(id, tx);
           CRITICAL_REGION_LOCAL1(m_blockchain);
           LockedTXN lock(m_blockchain.get_db());
           if (!insert_key_images(tx, id, tx_relay))
@@ -291,6 +237,7 @@ namespace cryptonote
 
           m_blockchain.add_txpool_tx(id, blob, meta);
           m_txs_by_fee_and_receive_time.emplace(std::tuple<bool, double, std::time_t>(tx.is_deregister_tx(), fee / (double)(tx_weight), receive_time), id);
+          add_template_candidate(id, tx, meta);
           lock.commit();
         }
         catch (const std::exception &e)
@@ -312,7 +259,7 @@ namespace cryptonote
       try
       {
         if (kept_by_block)
-          m_parsed_tx_cache.insert(std::make_pair(id, tx));
+          m_parsed_tx_cache.put(id, tx);
         CRITICAL_REGION_LOCAL1(m_blockchain);
         LockedTXN lock(m_blockchain.get_db());
 
@@ -354,6 +301,7 @@ namespace cryptonote
           m_blockchain.remove_txpool_tx(id);
           m_blockchain.add_txpool_tx(id, blob, meta);
           m_txs_by_fee_and_receive_time.emplace(std::tuple<bool, double, std::time_t>(tx.is_deregister_tx(), fee / (double)(tx_weight), receive_time), id);
+          add_template_candidate(id, tx, meta);
         }
         lock.commit();
       }
@@ -372,7 +320,7 @@ namespace cryptonote
     tvc.m_verifivation_failed = false;
     m_txpool_weight += tx_weight;
 
-    ++m_cookie;
+    bump_cookie();
 
     MINFO("Transaction added to pool: txid " << id << " weight: " << tx_weight << " fee/byte: " << (fee / (double)(tx_weight ? tx_weight : 1)));
 
@@ -381,6 +329,79 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------------------------
+  bool tx_memory_pool::check_tx_admission(const transaction &tx, const crypto::hash &id, size_t tx_weight, bool kept_by_block, uint8_t version, uint64_t &fee, tx_verification_context& tvc) const
+  {
+    // we do not accept transactions that timed out before, unless they're
+    // kept_by_block
+    if (!kept_by_block && m_timed_out_transactions.find(id) != m_timed_out_transactions.end())
+    {
+      // not clear if we should set that, since verifivation (sic) did not fail before, since
+      // the tx was accepted before timing out.
+      tvc.m_verifivation_failed = true;
+      return false;
+    }
+
+    if(!check_inputs_types_supported(tx))
+    {
+      tvc.m_verifivation_failed = true;
+      tvc.m_invalid_input = true;
+      return false;
+    }
+
+    if (!get_tx_miner_fee(tx, fee, version >= HF_VERSION_FEE_BURNING))
+    {
+      tvc.m_verifivation_failed = true;
+      tvc.m_fee_too_low = true;
+    }
+
+	if (!kept_by_block && !tx.is_deregister_tx() && !m_blockchain.check_fee(tx_weight, fee))
+    {
+      tvc.m_verifivation_failed = true;
+      tvc.m_fee_too_low = true;
+      return false;
+    }
+
+    size_t tx_weight_limit = get_transaction_weight_limit(version);
+    if ((!kept_by_block || version >= HF_VERSION_PER_BYTE_FEE) && tx_weight > tx_weight_limit)
+    {
+      LOG_PRINT_L1("transaction is too heavy: " << tx_weight << " bytes, maximum weight: " << tx_weight_limit);
+      tvc.m_verifivation_failed = true;
+      tvc.m_too_big = true;
+      return false;
+    }
+
+    // if the transaction came from a block popped from the chain,
+    // don't check if we have its key images as spent.
+    // TODO: Investigate why not?
+    if(!kept_by_block)
+    {
+      if(have_tx_keyimges_as_spent(tx, id))
+      {
+        LOG_PRINT_L1("Transaction with id= "<< id << " used already spent key images");
+        tvc.m_verifivation_failed = true;
+        tvc.m_double_spend = true;
+        return false;
+      }
+	  if (have_deregister_tx_already(tx))
+	  {
+		  LOG_PRINT_L1("Transaction version 3 with id= " << id << " already has a deregister for height");
+		  tvc.m_verifivation_failed = true;
+		  tvc.m_double_spend = true;
+		  return false;
+	  }
+   }
+
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool tx_memory_pool::may_add_tx(const transaction &tx, const crypto::hash &id, size_t tx_weight, bool kept_by_block, uint8_t version) const
+  {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    uint64_t fee;
+    tx_verification_context tvc{};
+    return tx.version != transaction::version_0 && check_tx_admission(tx, id, tx_weight, kept_by_block, version, fee, tvc);
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::add_tx(transaction &tx, tx_verification_context& tvc, relay_method tx_relay, bool relayed, uint8_t version)
   {
     crypto::hash h = null_hash;
@@ -464,7 +485,7 @@ namespace cryptonote
     }
     lock.commit();
     if (changed)
-      ++m_cookie;
+      bump_cookie();
     if (m_txpool_weight > bytes)
       MINFO("Pool weight after pruning is larger than limit: " << m_txpool_weight << "/" << bytes);
   }
@@ -493,7 +514,7 @@ namespace cryptonote
         !m_blockchain.txpool_tx_matches_category(id, relay_category::legacy);
       CHECK_AND_ASSERT_MES(new_or_previously_private, false, "internal error: try to insert duplicate iterator in key_image set");
     }
-    ++m_cookie;
+    bump_cookie();
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -504,6 +525,8 @@ namespace cryptonote
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
+    // every way out of the pool goes through here
+    m_template_candidates.erase(actual_hash);
     // ND: Speedup
     for(const txin_v& vi: tx.vin)
     {
@@ -526,7 +549,7 @@ namespace cryptonote
       }
 
     }
-    ++m_cookie;
+    bump_cookie();
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -547,10 +570,10 @@ namespace cryptonote
         return false;
       }
       txblob = m_blockchain.get_txpool_tx_blob(id, relay_category::all);
-      auto ci = m_parsed_tx_cache.find(id);
-      if (ci != m_parsed_tx_cache.end())
+      if (m_parsed_tx_cache.get(id, tx))
       {
-        tx = ci->second;
+        // leaving the pool, so no one will look for it here again
+        m_parsed_tx_cache.erase(id);
       }
       else if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(txblob, tx) : parse_and_validate_tx_from_blob(txblob, tx)))
       {
@@ -582,7 +605,7 @@ namespace cryptonote
 
     if (sorted_it != m_txs_by_fee_and_receive_time.end())
       m_txs_by_fee_and_receive_time.erase(sorted_it);
-    ++m_cookie;
+    bump_cookie();
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -602,18 +625,13 @@ namespace cryptonote
         return false;
       }
       cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(txid, relay_category::all);
-      auto ci = m_parsed_tx_cache.find(txid);
-      if (ci != m_parsed_tx_cache.end())
-      {
-        td.tx = ci->second;
-      }
-      else if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(txblob, td.tx) : parse_and_validate_tx_from_blob(txblob, td.tx)))
-      {
-        MERROR("Failed to parse tx from txpool");
-        return false;
-      }
-      else
+      if (!m_parsed_tx_cache.get(txid, td.tx))
       {
+        if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(txblob, td.tx) : parse_and_validate_tx_from_blob(txblob, td.tx)))
+        {
+          MERROR("Failed to parse tx from txpool");
+          return false;
+        }
         td.tx.set_hash(txid);
       }
       td.blob_size = txblob.size();
@@ -744,7 +762,7 @@ namespace cryptonote
         }
       }
       lock.commit();
-      ++m_cookie;
+      bump_cookie();
     }
     return true;
   }
@@ -813,6 +831,7 @@ namespace cryptonote
             meta.last_relayed_time = std::chrono::system_clock::to_time_t(now);
 
           m_blockchain.update_txpool_tx(hash, meta);
+          update_template_candidate(hash, meta);
         }
       }
       catch (const std::exception &e)
@@ -910,6 +929,17 @@ namespace cryptonote
       return true;
     }, false, category);
 
+    const auto input_cache_stats = m_input_cache.get_stats();
+    stats.input_cache_hits = input_cache_stats.hits;
+    stats.input_cache_misses = input_cache_stats.misses;
+    stats.input_cache_evictions = input_cache_stats.evictions;
+    stats.input_cache_size = input_cache_stats.size;
+    const auto parsed_tx_cache_stats = m_parsed_tx_cache.get_stats();
+    stats.parsed_tx_cache_hits = parsed_tx_cache_stats.hits;
+    stats.parsed_tx_cache_misses = parsed_tx_cache_stats.misses;
+    stats.parsed_tx_cache_evictions = parsed_tx_cache_stats.evictions;
+    stats.parsed_tx_cache_size = parsed_tx_cache_stats.size;
+
     stats.bytes_med = epee::misc_utils::median(weights);
     if (stats.txs_total > 1)
     {
@@ -1108,19 +1138,85 @@ namespace cryptonote
   bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const crypto::hash& top_block_id)
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
-    m_input_cache.clear();
-    m_parsed_tx_cache.clear();
+
+    // a tx ready on top of the parent stays ready unless the new block spent one of its key
+    // images; deregisters expire by height, so those get a full check again, and so does
+    // everything when the new block starts a fork since the input rules depend on it
+    if (new_block_height > 0 && !m_template_candidates.empty())
+    {
+      const crypto::hash parent_id = m_blockchain.get_block_id_by_height(new_block_height - 1);
+      const bool same_fork = m_blockchain.get_hard_fork_version(new_block_height) == m_blockchain.get_hard_fork_version(new_block_height - 1);
+      for (auto &e: m_template_candidates)
+      {
+        template_candidate &c = e.second;
+        if (!same_fork)
+        {
+          c.ready = false;
+          c.checked_top = crypto::null_hash;
+          continue;
+        }
+        if (!c.ready || !c.parsed || c.checked_top != parent_id || c.meta.is_deregister)
+          continue;
+        bool spent = false;
+        for (const crypto::key_image &ki: c.key_images)
+        {
+          if (m_blockchain.have_tx_keyimg_as_spent(ki))
+          {
+            spent = true;
+            break;
+          }
+        }
+        if (!spent)
+          c.checked_top = top_block_id;
+      }
+    }
+    bump_cookie();
     return true;
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::add_template_candidate(const crypto::hash &txid, const transaction_prefix &tx, const txpool_tx_meta_t &meta)
+  {
+    template_candidate &c = m_template_candidates[txid];
+    c.meta = meta;
+    c.key_images.clear();
+    c.key_images.reserve(tx.vin.size());
+    for (const txin_v &vi: tx.vin)
+      if (vi.type() == typeid(txin_to_key))
+        c.key_images.push_back(boost::get<txin_to_key>(vi).k_image);
+    c.parsed = true;
+    c.checked_top = crypto::null_hash;
+    c.ready = false;
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::update_template_candidate(const crypto::hash &txid, const txpool_tx_meta_t &meta)
+  {
+    auto it = m_template_candidates.find(txid);
+    if (it != m_template_candidates.end())
+      it->second.meta = meta;
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_dec(uint64_t new_block_height, const crypto::hash& top_block_id)
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
-    m_input_cache.clear();
-    m_parsed_tx_cache.clear();
+    bump_cookie();
     return true;
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::bump_cookie()
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(m_change_lock);
+      ++m_cookie;
+    }
+    m_change_cond.notify_all();
+  }
+  //---------------------------------------------------------------------------------
+  bool tx_memory_pool::wait_for_change(uint64_t cookie, std::chrono::milliseconds timeout) const
+  {
+    boost::unique_lock<boost::mutex> lock(m_change_lock);
+    return m_change_cond.wait_for(lock, boost::chrono::milliseconds(timeout.count()), [&]{ return m_cookie != cookie; });
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::have_tx(const crypto::hash &id, relay_category tx_category) const
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
@@ -1168,23 +1264,85 @@ namespace cryptonote
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::check_tx_inputs(const std::function<cryptonote::transaction&(void)> &get_tx, const crypto::hash &txid, uint64_t &max_used_block_height, crypto::hash &max_used_block_id, tx_verification_context &tvc, bool kept_by_block) const
   {
+    const crypto::hash top_id = m_blockchain.get_tail_id();
+    const uint8_t hf_version = m_blockchain.get_current_hard_fork_version();
     if (!kept_by_block)
     {
-      const std::unordered_map<crypto::hash, std::tuple<bool, tx_verification_context, uint64_t, crypto::hash>>::const_iterator i = m_input_cache.find(txid);
-      if (i != m_input_cache.end())
+      // callers hold m_transactions_lock, so the chain lookups under the cache shard lock can't
+      // deadlock against anything else taking the shard lock
+      input_check cached;
+      const bool hit = m_input_cache.get(txid, cached, [&](input_check &c) {
+        if (c.checked_top == top_id)
+          return true;
+        // a passing result stays good on a new tip while its ring members are still on the
+        // chain and no key image got spent; failures and deregisters depend on the height
+        if (!c.ret || c.is_deregister || c.hf_version != hf_version)
+          return false;
+        if (c.max_used_block_id != crypto::null_hash)
+        {
+          if (c.max_used_block_height >= m_blockchain.get_current_blockchain_height())
+            return false;
+          if (m_blockchain.get_block_id_by_height(c.max_used_block_height) != c.max_used_block_id)
+            return false;
+        }
+        for (const crypto::key_image &ki: c.key_images)
+          if (m_blockchain.have_tx_keyimg_as_spent(ki))
+            return false;
+        c.checked_top = top_id;
+        return true;
+      });
+      if (hit)
       {
-        max_used_block_height = std::get<2>(i->second);
-        max_used_block_id = std::get<3>(i->second);
-        tvc = std::get<1>(i->second);
-        return std::get<0>(i->second);
+        max_used_block_height = cached.max_used_block_height;
+        max_used_block_id = cached.max_used_block_id;
+        tvc = cached.tvc;
+        return cached.ret;
       }
     }
-    bool ret = m_blockchain.check_tx_inputs(get_tx(), max_used_block_height, max_used_block_id, tvc, kept_by_block);
+    cryptonote::transaction &tx = get_tx();
+    bool ret = m_blockchain.check_tx_inputs(tx, max_used_block_height, max_used_block_id, tvc, kept_by_block);
     if (!kept_by_block)
-      m_input_cache.insert(std::make_pair(txid, std::make_tuple(ret, tvc, max_used_block_height, max_used_block_id)));
+    {
+      input_check entry;
+      entry.ret = ret;
+      entry.tvc = tvc;
+      entry.max_used_block_height = max_used_block_height;
+      entry.max_used_block_id = max_used_block_id;
+      entry.key_images.reserve(tx.vin.size());
+      for (const txin_v &vi: tx.vin)
+        if (vi.type() == typeid(txin_to_key))
+          entry.key_images.push_back(boost::get<txin_to_key>(vi).k_image);
+      entry.checked_top = top_id;
+      entry.hf_version = hf_version;
+      entry.is_deregister = tx.is_deregister_tx();
+      m_input_cache.put(txid, std::move(entry));
+    }
     return ret;
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::precheck_tx_inputs(transaction &tx, const crypto::hash &txid) const
+  {
+    input_check entry;
+    entry.tvc = tx_verification_context{};
+    entry.max_used_block_height = 0;
+    std::vector<const rct::rctSig*> deferred_rct;
+    entry.ret = m_blockchain.check_tx_inputs_deferred(tx, entry.max_used_block_height, entry.max_used_block_id, entry.tvc, deferred_rct, entry.checked_top, entry.hf_version);
+    for (const rct::rctSig *rv: deferred_rct)
+    {
+      if (entry.ret && !rct::verRctNonSemanticsSimple(*rv))
+      {
+        MCERROR("verify", "Failed to check ringct signatures for tx " << txid);
+        entry.ret = false;
+      }
+    }
+    entry.key_images.reserve(tx.vin.size());
+    for (const txin_v &vi: tx.vin)
+      if (vi.type() == typeid(txin_to_key))
+        entry.key_images.push_back(boost::get<txin_to_key>(vi).k_image);
+    entry.is_deregister = tx.is_deregister_tx();
+    m_input_cache.put(txid, std::move(entry));
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::is_transaction_ready_to_go(txpool_tx_meta_t& txd, const crypto::hash &txid, const cryptonote::blobdata &txblob, transaction &tx) const
   {
     struct transction_parser
@@ -1335,6 +1493,7 @@ namespace cryptonote
             try
             {
               m_blockchain.update_txpool_tx(txid, meta);
+              update_template_candidate(txid, meta);
             }
             catch (const std::exception &e)
             {
@@ -1347,7 +1506,7 @@ namespace cryptonote
     }
     lock.commit();
     if (changed)
-      ++m_cookie;
+      bump_cookie();
   }
   //---------------------------------------------------------------------------------
   std::string tx_memory_pool::print_pool(bool short_format) const
@@ -1413,15 +1572,26 @@ namespace cryptonote
 
     LockedTXN lock(m_blockchain.get_db());
 
+    // readiness found at this top still holds, so only txes not yet checked against it are read back
+    const crypto::hash top_id = m_blockchain.get_tail_id();
+    const uint64_t empty_block_reward = best_coinbase;
+
     auto sorted_it = m_txs_by_fee_and_receive_time.begin();
     for (; sorted_it != m_txs_by_fee_and_receive_time.end(); ++sorted_it)
     {
-      txpool_tx_meta_t meta;
-      if (!m_blockchain.get_txpool_tx_meta(sorted_it->second, meta))
+      auto cit = m_template_candidates.find(sorted_it->second);
+      if (cit == m_template_candidates.end())
       {
-        MERROR("  failed to find tx meta");
-        continue;
+        template_candidate c{};
+        if (!m_blockchain.get_txpool_tx_meta(sorted_it->second, c.meta))
+        {
+          MERROR("  failed to find tx meta");
+          continue;
+        }
+        cit = m_template_candidates.emplace(sorted_it->second, std::move(c)).first;
       }
+      template_candidate &candidate = cit->second;
+      txpool_tx_meta_t &meta = candidate.meta;
       LOG_PRINT_L2("Considering " << sorted_it->second << ", weight " << meta.weight << ", current block weight " << total_weight << "/" << max_total_weight << ", current coinbase " << print_money(best_coinbase) << ", relay method " << (unsigned)meta.get_relay_method());
 
       if (!meta.matches(relay_category::legacy) && !(m_mine_stem_txes && meta.get_relay_method() == relay_method::stem))
@@ -1445,14 +1615,18 @@ namespace cryptonote
       // start using the optimal filling algorithm from v5
       if (version >= SERVICE_NODE_VERSION)
       {
-		  block_reward_parts reward_parts_other = {};
-		  if (!get_triton_block_reward(median_weight, total_weight + meta.weight, already_generated_coins, version, reward_parts_other, block_reward_context, MAINNET))
-
+        // up to the median there is no penalty, so the reward is the empty block's
+        uint64_t block_reward = empty_block_reward;
+        if (total_weight + meta.weight > median_weight)
         {
-          LOG_PRINT_L2("  would exceed maximum block weight");
-          continue;
+          block_reward_parts reward_parts_other = {};
+          if (!get_triton_block_reward(median_weight, total_weight + meta.weight, already_generated_coins, version, reward_parts_other, block_reward_context, MAINNET))
+          {
+            LOG_PRINT_L2("  would exceed maximum block weight");
+            continue;
+          }
+          block_reward = reward_parts_other.base_miner;
         }
-		uint64_t block_reward = reward_parts_other.base_miner;
         coinbase = block_reward + fee + meta.fee;
         if (coinbase < template_accept_threshold(best_coinbase))
         {
@@ -1471,43 +1645,56 @@ namespace cryptonote
         }
       }
 
-      // "local" and "stem" txes are filtered above
-      cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(sorted_it->second, relay_category::all);
+      if (candidate.checked_top != top_id)
+      {
+        // "local" and "stem" txes are filtered above
+        cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(sorted_it->second, relay_category::all);
 
-      cryptonote::transaction tx;
+        cryptonote::transaction tx;
 
-      // Skip transactions that are not ready to be
-      // included into the blockchain or that are
-      // missing key images
-      const cryptonote::txpool_tx_meta_t original_meta = meta;
-      bool ready = false;
-      try
-      {
-        ready = is_transaction_ready_to_go(meta, sorted_it->second, txblob, tx);
-      }
-      catch (const std::exception &e)
-      {
-        MERROR("Failed to check transaction readiness: " << e.what());
-        // continue, not fatal
-      }
-      if (memcmp(&original_meta, &meta, sizeof(meta)))
-      {
+        // Skip transactions that are not ready to be
+        // included into the blockchain or that are
+        // missing key images
+        const cryptonote::txpool_tx_meta_t original_meta = meta;
+        bool ready = false;
         try
-	{
-	  m_blockchain.update_txpool_tx(sorted_it->second, meta);
-	}
+        {
+          ready = is_transaction_ready_to_go(meta, sorted_it->second, txblob, tx);
+        }
         catch (const std::exception &e)
-	{
-	  MERROR("Failed to update tx meta: " << e.what());
-	  // continue, not fatal
-	}
+        {
+          MERROR("Failed to check transaction readiness: " << e.what());
+          // continue, not fatal
+        }
+        if (memcmp(&original_meta, &meta, sizeof(meta)))
+        {
+          try
+          {
+            m_blockchain.update_txpool_tx(sorted_it->second, meta);
+          }
+          catch (const std::exception &e)
+          {
+            MERROR("Failed to update tx meta: " << e.what());
+            // continue, not fatal
+          }
+        }
+        // a ready tx has been parsed for its key images
+        if (ready && !candidate.parsed)
+        {
+          for (const txin_v &vi: tx.vin)
+            if (vi.type() == typeid(txin_to_key))
+              candidate.key_images.push_back(boost::get<txin_to_key>(vi).k_image);
+          candidate.parsed = true;
+        }
+        candidate.checked_top = top_id;
+        candidate.ready = ready;
       }
-      if (!ready)
+      if (!candidate.ready)
       {
         LOG_PRINT_L2("  not ready to go");
         continue;
       }
-      if (have_key_images(k_images, tx))
+      if (std::any_of(candidate.key_images.begin(), candidate.key_images.end(), [&k_images](const crypto::key_image &ki) { return k_images.count(ki) != 0; }))
       {
         LOG_PRINT_L2("  key images already seen");
         continue;
@@ -1517,7 +1704,7 @@ namespace cryptonote
       total_weight += meta.weight;
       fee += meta.fee;
       best_coinbase = coinbase;
-      append_key_images(k_images, tx);
+      k_images.insert(candidate.key_images.begin(), candidate.key_images.end());
       LOG_PRINT_L2("  added, new block weight " << total_weight << "/" << max_total_weight << ", coinbase " << print_money(best_coinbase));
     }
     lock.commit();
@@ -1589,7 +1776,7 @@ namespace cryptonote
       lock.commit();
     }
     if (n_removed > 0)
-      ++m_cookie;
+      bump_cookie();
     return n_removed;
   }
   //---------------------------------------------------------------------------------
@@ -1601,6 +1788,7 @@ namespace cryptonote
     m_txpool_max_weight = max_txpool_weight ? max_txpool_weight : DEFAULT_TXPOOL_MAX_WEIGHT;
     m_txs_by_fee_and_receive_time.clear();
     m_spent_key_images.clear();
+    m_template_candidates.clear();
     m_txpool_weight = 0;
     std::vector<crypto::hash> remove;
 
@@ -1625,6 +1813,7 @@ namespace cryptonote
           return false;
         }
 		m_txs_by_fee_and_receive_time.emplace(std::tuple<bool, double, std::time_t>(tx.is_deregister_tx(), meta.fee / (double)meta.weight, meta.receive_time), txid);
+        add_template_candidate(txid, tx, meta);
 
         m_txpool_weight += meta.weight;
         return true;
@@ -36,11 +36,14 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <queue>
+#include <chrono>
 #include <boost/serialization/version.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/utility.hpp>
 
 #include "span.h"
 #include "string_tools.h"
+#include "common/lru_cache.h"
 #include "syncobj.h"
 #include "math_helper.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
@@ -146,6 +149,35 @@ namespace cryptonote
      */
     bool take_tx(const crypto::hash &id, transaction &tx, cryptonote::blobdata &txblob, size_t& tx_weight, uint64_t& fee, bool &relayed, bool &do_not_relay, bool &double_spend_seen, bool &pruned);
 
+    /**
+     * @brief verify a transaction's inputs ahead of add_tx, without the pool lock
+     *
+     * Several transactions may be checked at once from different threads.  The
+     * result goes into the input check cache, where add_tx picks it up and only
+     * rechecks key images and ring members if the chain moved on meanwhile.
+     *
+     * @param tx the transaction, whose rct signatures get expanded
+     * @param txid the transaction's hash
+     */
+    void precheck_tx_inputs(transaction &tx, const crypto::hash &txid) const;
+
+    /**
+     * @brief runs the cheap rejections add_tx makes before checking inputs
+     *
+     * Used to skip the costly input precheck for transactions add_tx would
+     * turn away anyway: timed out, unsupported inputs, low fee, too heavy or
+     * spending key images already in the pool.
+     *
+     * @param tx the transaction
+     * @param id the transaction's hash
+     * @param tx_weight the transaction's weight
+     * @param kept_by_block whether the transaction came from a popped block
+     * @param version the hard fork version to check against
+     *
+     * @return false if add_tx would reject the transaction before its inputs
+     */
+    bool may_add_tx(const transaction &tx, const crypto::hash &id, size_t tx_weight, bool kept_by_block, uint8_t version) const;
+
     /**
      * @brief checks if the pool has a transaction with the given hash
      *
@@ -377,6 +409,16 @@ namespace cryptonote
       */
     uint64_t cookie() const { return m_cookie; }
 
+    /**
+     * @brief wait for the pool or the chain tip to change
+     *
+     * @param cookie the cookie() value the caller last saw
+     * @param timeout how long to wait at most
+     *
+     * @return true if the cookie moved away from the given value, false on timeout
+     */
+    bool wait_for_change(uint64_t cookie, std::chrono::milliseconds timeout) const;
+
     /**
      * @brief get the cumulative txpool weight in bytes
      *
@@ -496,6 +538,18 @@ namespace cryptonote
      */
     bool have_tx_keyimges_as_spent(const transaction& tx, const crypto::hash& txid) const;
 
+    /**
+     * @brief add_tx's rejections that need neither the chain's outputs nor signatures
+     *
+     * The pool lock must be held.  Key image or deregister conflicts set
+     * tvc.m_double_spend, leaving the caller to mark the conflict.
+     *
+     * @param fee return-by-reference the transaction's fee
+     *
+     * @return false if the transaction must be rejected, with tvc filled in
+     */
+    bool check_tx_admission(const transaction &tx, const crypto::hash &id, size_t tx_weight, bool kept_by_block, uint8_t version, uint64_t &fee, tx_verification_context& tvc) const;
+
     /**
      * @brief forget a transaction's spent key images
      *
@@ -580,6 +634,11 @@ namespace cryptonote
     sorted_tx_container m_txs_by_fee_and_receive_time;
 
     std::atomic<uint64_t> m_cookie; //!< incremented at each change
+    mutable boost::mutex m_change_lock; //!< guards cookie bumps against waiters going to sleep
+    mutable boost::condition_variable m_change_cond; //!< signalled on each cookie bump
+
+    //! bump the cookie and wake anything waiting in wait_for_change
+    void bump_cookie();
 
     /**
      * @brief get an iterator to a transaction in the sorted container
@@ -605,9 +664,51 @@ namespace cryptonote
     size_t m_txpool_weight;
     bool m_mine_stem_txes;
 
-    mutable std::unordered_map<crypto::hash, std::tuple<bool, tx_verification_context, uint64_t, crypto::hash>> m_input_cache;
+    /**
+     * @brief a cached Blockchain::check_tx_inputs result
+     */
+    struct input_check
+    {
+      bool ret;
+      tx_verification_context tvc;
+      uint64_t max_used_block_height;
+      crypto::hash max_used_block_id;
+      std::vector<crypto::key_image> key_images;  //!< rechecked against the chain once the tip moves
+      crypto::hash checked_top;                   //!< the top block id the result was last confirmed at
+      uint8_t hf_version;
+      bool is_deregister;
+    };
+
+    //! check_tx_inputs results, kept across blocks while their ring members and key images allow
+    mutable tools::lru_cache<crypto::hash, input_check> m_input_cache;
+
+    /**
+     * @brief a pool transaction as seen by the block template builder
+     */
+    struct template_candidate
+    {
+      txpool_tx_meta_t meta;                      //!< mirrors the meta stored in the db
+      std::vector<crypto::key_image> key_images;  //!< the key images the tx spends, valid once parsed
+      bool parsed;
+      crypto::hash checked_top;                   //!< the top block id when readiness was last checked
+      bool ready;
+    };
+
+    /**
+     * @brief start tracking a pool transaction as a block template candidate
+     */
+    void add_template_candidate(const crypto::hash &txid, const transaction_prefix &tx, const txpool_tx_meta_t &meta);
+
+    /**
+     * @brief keep a candidate's copy of the meta in step with the db
+     */
+    void update_template_candidate(const crypto::hash &txid, const txpool_tx_meta_t &meta);
+
+    //! block template candidates, so templates don't read back and parse every pool tx
+    std::unordered_map<crypto::hash, template_candidate> m_template_candidates;
 
-    std::unordered_map<crypto::hash, transaction> m_parsed_tx_cache;
+    //! transactions returned to the pool by a reorg, so they needn't be parsed again
+    mutable tools::lru_cache<crypto::hash, transaction> m_parsed_tx_cache;
   };
 }
 
@@ -420,5 +420,34 @@ namespace cryptonote
     typedef epee::misc_utils::struct_init<request_t> request;
   };
 
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  struct NOTIFY_UPTIME_PROOF_BATCH
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 13;
+
+#pragma pack(push, 1)
+    struct proof
+    {
+      uint16_t snode_version_major;
+      uint16_t snode_version_minor;
+      uint16_t snode_version_patch;
+      uint64_t timestamp;
+      crypto::public_key pubkey;
+      crypto::signature sig;
+    };
+#pragma pack(pop)
+
+    struct request_t
+    {
+      std::vector<proof> proofs;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(proofs)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+  };
     
 }
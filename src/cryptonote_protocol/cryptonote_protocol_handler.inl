@@ -793,34 +793,39 @@ namespace cryptonote
   int t_cryptonote_protocol_handler<t_core>::handle_uptime_proof(int command, NOTIFY_UPTIME_PROOF::request& arg, cryptonote_connection_context& context)
  {
     MLOG_P2P_MESSAGE("Received NOTIFY_UPTIME_PROOF");
-    // NOTE: Don't relay your own uptime proof, otherwise we have the following situation
-
-    // Node1 sends uptime ->
-    // Node2 receives uptime and relays it back to Node1 for acknowledgement ->
-    // Node1 receives it, handle_uptime_proof returns true to acknowledge, Node1 tries to resend to the same peers again
-
-    // Instead, if we receive our own uptime proof, then acknowledge but don't
-    // send on. If the we are missing an uptime proof it will have been
-    // submitted automatically by the daemon itself instead of
-    // using my own proof relayed by other nodes.
-
-    (void)context;
-    bool my_uptime_proof_confirmation = false;
-    if (m_core.handle_uptime_proof(arg, my_uptime_proof_confirmation))
+    process_uptime_proof(make_uptime_proof_entry(arg), context);
+    return 1;
+ }
+ //------------------------------------------------------------------------------------------------------------------------
+ template<class t_core>
+  int t_cryptonote_protocol_handler<t_core>::handle_uptime_proof_batch(int command, NOTIFY_UPTIME_PROOF_BATCH::request& arg, cryptonote_connection_context& context)
+ {
+    MLOG_P2P_MESSAGE("Received NOTIFY_UPTIME_PROOF_BATCH (" << arg.proofs.size() << " proofs)");
+    if (arg.proofs.size() > P2P_UPTIME_PROOF_BATCH_MAX_PROOFS)
     {
-      if (!my_uptime_proof_confirmation)
-      {
-        // NOTE: The default exclude context contains the peer who sent us this
-        // uptime proof, we want to ensure we relay it back so they know that the
-        // peer they relayed to received their uptime and confirm it, so send in an
-        // empty context so we don't omit the source peer from the relay back.
-        cryptonote_connection_context empty_context = {};
-        relay_uptime_proof(arg, empty_context);
-      }
+      LOG_ERROR_CCONTEXT("Received uptime proof batch with " << arg.proofs.size() << " proofs, dropping connection");
+      drop_connection(context, false, false);
+      return 1;
     }
+    for (const uptime_proof_entry &entry: arg.proofs)
+      process_uptime_proof(entry, context);
     return 1;
  }
  //------------------------------------------------------------------------------------------------------------------------
+ template<class t_core>
+  void t_cryptonote_protocol_handler<t_core>::process_uptime_proof(const uptime_proof_entry &entry, cryptonote_connection_context& context)
+ {
+    // The sender has this proof, so it is never relayed back to it. If we
+    // receive our own proof, acknowledge it but don't send it on again.
+    const crypto::hash id = get_uptime_proof_id(entry);
+    m_uptime_proof_relay.mark_known(context.m_connection_id, id, time(nullptr));
+
+    NOTIFY_UPTIME_PROOF::request proof = make_uptime_proof_request(entry);
+    bool my_uptime_proof_confirmation = false;
+    if (m_core.handle_uptime_proof(proof, my_uptime_proof_confirmation) && !my_uptime_proof_confirmation)
+      m_uptime_proof_relay.queue(id, entry);
+ }
+ //------------------------------------------------------------------------------------------------------------------------
  template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_request_fluffy_missing_tx(int command, NOTIFY_REQUEST_FLUFFY_MISSING_TX::request& arg, cryptonote_connection_context& context)
   {
@@ -835,8 +840,10 @@ namespace cryptonote
     std::vector<std::pair<cryptonote::blobdata, block>> local_blocks;
     std::vector<cryptonote::blobdata> local_txs;
 
-    block b;
-    if (!m_core.get_block_by_hash(arg.block_hash, b))
+    // served from the stored blobs, nothing is parsed or re-serialized
+    std::vector<crypto::hash> tx_hashes;
+    NOTIFY_NEW_FLUFFY_BLOCK::request fluffy_response;
+    if (!m_core.get_block_blob_and_tx_hashes(arg.block_hash, fluffy_response.b.block, tx_hashes))
     {
       LOG_ERROR_CCONTEXT("failed to find block: " << arg.block_hash << ", dropping connection");
       drop_connection(context, false, false);
@@ -844,29 +851,27 @@ namespace cryptonote
     }
 
     std::vector<crypto::hash> txids;
-    NOTIFY_NEW_FLUFFY_BLOCK::request fluffy_response;
-    fluffy_response.b.block = t_serializable_object_to_blob(b);
     fluffy_response.current_blockchain_height = arg.current_blockchain_height;
-    std::vector<bool> seen(b.tx_hashes.size(), false);
+    std::vector<bool> seen(tx_hashes.size(), false);
     for(auto& tx_idx: arg.missing_tx_indices)
     {
-      if(tx_idx < b.tx_hashes.size())
+      if(tx_idx < tx_hashes.size())
       {
-        MDEBUG("  tx " << b.tx_hashes[tx_idx]);
+        MDEBUG("  tx " << tx_hashes[tx_idx]);
         if (seen[tx_idx])
         {
           LOG_ERROR_CCONTEXT
           (
             "Failed to handle request NOTIFY_REQUEST_FLUFFY_MISSING_TX"
             << ", request is asking for duplicate tx "
-            << ", tx index = " << tx_idx << ", block tx count " << b.tx_hashes.size()
+            << ", tx index = " << tx_idx << ", block tx count " << tx_hashes.size()
             << ", block_height = " << arg.current_blockchain_height
             << ", dropping connection"
           );
           drop_connection(context, true, false);
           return 1;
         }
-        txids.push_back(b.tx_hashes[tx_idx]);
+        txids.push_back(tx_hashes[tx_idx]);
         seen[tx_idx] = true;
       }
       else
@@ -875,7 +880,7 @@ namespace cryptonote
         (
           "Failed to handle request NOTIFY_REQUEST_FLUFFY_MISSING_TX"
           << ", request is asking for a tx whose index is out of bounds "
-          << ", tx index = " << tx_idx << ", block tx count " << b.tx_hashes.size()
+          << ", tx index = " << tx_idx << ", block tx count " << tx_hashes.size()
           << ", block_height = " << arg.current_blockchain_height
           << ", dropping connection"
         );
@@ -885,9 +890,9 @@ namespace cryptonote
       }
     }
 
-    std::vector<cryptonote::transaction> txs;
+    std::vector<cryptonote::blobdata> txs;
     std::vector<crypto::hash> missed;
-    if (!m_core.get_transactions(txids, txs, missed))
+    if (!m_core.get_stored_transactions_blobs(txids, txs, missed))
     {
       LOG_ERROR_CCONTEXT("Failed to handle request NOTIFY_REQUEST_FLUFFY_MISSING_TX, "
         << "failed to get requested transactions");
@@ -902,9 +907,10 @@ namespace cryptonote
       return 1;
     }
 
+    fluffy_response.b.txs.reserve(txs.size());
     for(auto& tx: txs)
     {
-      fluffy_response.b.txs.push_back({t_serializable_object_to_blob(tx), crypto::null_hash});
+      fluffy_response.b.txs.push_back({std::move(tx), crypto::null_hash});
     }
 
     MLOG_P2P_MESSAGE
@@ -932,6 +938,10 @@ namespace cryptonote
       return 1;
     }
 
+    // Check all the signatures together first; any that fail are checked (and
+    // reported) one at a time by add_deregister_vote below
+    m_core.verify_deregister_vote_signatures(arg.votes);
+
     for(auto it = arg.votes.begin(); it != arg.votes.end();)
     {
       cryptonote::vote_verification_context vvc = {};
@@ -1716,6 +1726,8 @@ skip:
     m_idle_peer_kicker.do_call(boost::bind(&t_cryptonote_protocol_handler<t_core>::kick_idle_peers, this));
     m_standby_checker.do_call(boost::bind(&t_cryptonote_protocol_handler<t_core>::check_standby_peers, this));
     m_sync_search_checker.do_call(boost::bind(&t_cryptonote_protocol_handler<t_core>::update_sync_search, this));
+    m_uptime_proof_relay_timer.do_call(boost::bind(&t_cryptonote_protocol_handler<t_core>::flush_uptime_proofs, this));
+    m_uptime_proof_filter_pruner.do_call(boost::bind(&t_cryptonote_protocol_handler<t_core>::prune_uptime_proof_filters, this));
     return m_core.on_idle();
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -2616,8 +2628,42 @@ skip:
  template<class t_core>
  bool t_cryptonote_protocol_handler<t_core>::relay_uptime_proof(NOTIFY_UPTIME_PROOF::request& arg, cryptonote_connection_context& exclude_context)
  {
-    bool result = relay_to_synchronized_peers<NOTIFY_UPTIME_PROOF>(arg, exclude_context);
-    return result;
+    // queued and sent with the next batch, see flush_uptime_proofs()
+    const uptime_proof_entry entry = make_uptime_proof_entry(arg);
+    const crypto::hash id = get_uptime_proof_id(entry);
+    if (!exclude_context.m_connection_id.is_nil())
+      m_uptime_proof_relay.mark_known(exclude_context.m_connection_id, id, time(nullptr));
+    m_uptime_proof_relay.queue(id, entry);
+    return true;
+  }
+ //------------------------------------------------------------------------------------------------------------------------
+ template<class t_core>
+  bool t_cryptonote_protocol_handler<t_core>::flush_uptime_proofs()
+  {
+    if (!m_uptime_proof_relay.pending())
+      return true;
+
+    std::vector<uptime_proof_relay::peer> peers;
+    m_p2p->for_each_connection([&peers](cryptonote_connection_context& context, nodetool::peerid_type peer_id, uint32_t support_flags)
+    {
+      if (peer_id && context.m_state > cryptonote_connection_context::state_synchronizing)
+        peers.push_back({context.m_remote_address.get_zone(), context.m_connection_id, (support_flags & P2P_SUPPORT_FLAG_UPTIME_PROOF_BATCH) != 0});
+      return true;
+    });
+
+    for (uptime_proof_relay::message &msg: m_uptime_proof_relay.flush(peers, time(nullptr)))
+    {
+      LOG_PRINT_L2("-->>" << (msg.command == NOTIFY_UPTIME_PROOF_BATCH::ID ? "NOTIFY_UPTIME_PROOF_BATCH" : "NOTIFY_UPTIME_PROOF") << " to " << msg.connections.size() << " peers, " << msg.blob.size() << " bytes");
+      m_p2p->relay_notify_to_list(msg.command, epee::strspan<uint8_t>(msg.blob), std::move(msg.connections));
+    }
+    return true;
+  }
+ //------------------------------------------------------------------------------------------------------------------------
+ template<class t_core>
+  bool t_cryptonote_protocol_handler<t_core>::prune_uptime_proof_filters()
+  {
+    m_uptime_proof_relay.prune(time(nullptr));
+    return true;
   }
  //------------------------------------------------------------------------------------------------------------------------
  template<class t_core>
@@ -2752,6 +2798,7 @@ skip:
     }
 
     m_block_queue.flush_spans(context.m_connection_id, false);
+    m_uptime_proof_relay.forget_peer(context.m_connection_id);
     MLOG_PEER_STATE("closed");
   }
 
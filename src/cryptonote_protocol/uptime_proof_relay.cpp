@@ -0,0 +1,234 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <map>
+
+#include <boost/thread/locks.hpp>
+
+#include "misc_log_ex.h"
+#include "net/levin_base.h"
+#include "storages/portable_storage_template_helper.h"
+#include "cryptonote_config.h"
+#include "uptime_proof_relay.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "net.cn"
+
+namespace cryptonote
+{
+  uptime_proof_entry make_uptime_proof_entry(const NOTIFY_UPTIME_PROOF::request &proof)
+  {
+    uptime_proof_entry entry;
+    entry.snode_version_major = proof.snode_version_major;
+    entry.snode_version_minor = proof.snode_version_minor;
+    entry.snode_version_patch = proof.snode_version_patch;
+    entry.timestamp = proof.timestamp;
+    entry.pubkey = proof.pubkey;
+    entry.sig = proof.sig;
+    return entry;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  NOTIFY_UPTIME_PROOF::request make_uptime_proof_request(const uptime_proof_entry &entry)
+  {
+    NOTIFY_UPTIME_PROOF::request proof;
+    proof.snode_version_major = entry.snode_version_major;
+    proof.snode_version_minor = entry.snode_version_minor;
+    proof.snode_version_patch = entry.snode_version_patch;
+    proof.timestamp = entry.timestamp;
+    proof.pubkey = entry.pubkey;
+    proof.sig = entry.sig;
+    return proof;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  crypto::hash get_uptime_proof_id(const uptime_proof_entry &entry)
+  {
+    return crypto::cn_fast_hash(&entry, sizeof(entry));
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  uptime_proof_relay::uptime_proof_relay(): m_stats{}
+  {
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  bool uptime_proof_relay::mark_known_locked(known_set &known, const crypto::hash &id, uint64_t now)
+  {
+    if (known.size() >= P2P_UPTIME_PROOF_KNOWN_MAX_PER_PEER && known.find(id) == known.end())
+    {
+      // worst case we send this peer a few proofs it already has
+      MDEBUG("Uptime proof filter full, resetting it");
+      known.clear();
+    }
+    return known.emplace(id, now).second;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  bool uptime_proof_relay::mark_known(const boost::uuids::uuid &connection_id, const crypto::hash &id, uint64_t now)
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    return mark_known_locked(m_known[connection_id], id, now);
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  bool uptime_proof_relay::queue(const crypto::hash &id, const uptime_proof_entry &proof)
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    if (!m_pending_ids.insert(id).second)
+      return false;
+    m_pending.emplace_back(id, proof);
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  size_t uptime_proof_relay::pending() const
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    return m_pending.size();
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  std::vector<uptime_proof_relay::message> uptime_proof_relay::flush(const std::vector<peer> &peers, uint64_t now)
+  {
+    std::vector<message> messages;
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    if (m_pending.empty())
+      return messages;
+
+    std::vector<std::pair<crypto::hash, uptime_proof_entry>> pending;
+    pending.swap(m_pending);
+    m_pending_ids.clear();
+
+    // the legacy encoding is what every proof would have cost without batching
+    const size_t header_size = sizeof(epee::levin::bucket_head2);
+    std::vector<std::string> legacy_blobs(pending.size());
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+      NOTIFY_UPTIME_PROOF::request proof = make_uptime_proof_request(pending[i].second);
+      epee::serialization::store_t_to_binary(proof, legacy_blobs[i]);
+    }
+
+    // peers needing the same proofs share a single serialized batch
+    std::map<std::vector<uint32_t>, std::vector<std::pair<epee::net_utils::zone, boost::uuids::uuid>>> batch_groups;
+    std::vector<std::vector<std::pair<epee::net_utils::zone, boost::uuids::uuid>>> legacy_targets(pending.size());
+    for (const peer &p: peers)
+    {
+      known_set &known = m_known[p.connection_id];
+      std::vector<uint32_t> needed;
+      for (uint32_t i = 0; i < pending.size(); ++i)
+      {
+        if (mark_known_locked(known, pending[i].first, now))
+        {
+          needed.push_back(i);
+          continue;
+        }
+        ++m_stats.proofs_suppressed;
+        ++m_stats.messages_saved;
+        m_stats.bytes_saved += legacy_blobs[i].size() + header_size;
+      }
+      if (needed.empty())
+        continue;
+
+      m_stats.proofs_relayed += needed.size();
+      if (p.supports_batch)
+        batch_groups[std::move(needed)].emplace_back(p.zone, p.connection_id);
+      else
+        for (uint32_t i: needed)
+          legacy_targets[i].emplace_back(p.zone, p.connection_id);
+    }
+
+    for (auto &group: batch_groups)
+    {
+      const std::vector<uint32_t> &indices = group.first;
+      const uint64_t npeers = group.second.size();
+      for (size_t start = 0; start < indices.size(); start += P2P_UPTIME_PROOF_BATCH_MAX_PROOFS)
+      {
+        const size_t end = std::min<size_t>(indices.size(), start + P2P_UPTIME_PROOF_BATCH_MAX_PROOFS);
+        NOTIFY_UPTIME_PROOF_BATCH::request req;
+        req.proofs.reserve(end - start);
+        size_t legacy_size = 0;
+        for (size_t k = start; k < end; ++k)
+        {
+          req.proofs.push_back(pending[indices[k]].second);
+          legacy_size += legacy_blobs[indices[k]].size() + header_size;
+        }
+
+        message msg;
+        msg.command = NOTIFY_UPTIME_PROOF_BATCH::ID;
+        epee::serialization::store_t_to_binary(req, msg.blob);
+        msg.connections = group.second;
+
+        const size_t batch_size = msg.blob.size() + header_size;
+        m_stats.batches_sent += npeers;
+        m_stats.messages_saved += (end - start - 1) * npeers;
+        if (legacy_size > batch_size)
+          m_stats.bytes_saved += (legacy_size - batch_size) * npeers;
+        messages.push_back(std::move(msg));
+      }
+    }
+
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+      if (legacy_targets[i].empty())
+        continue;
+      message msg;
+      msg.command = NOTIFY_UPTIME_PROOF::ID;
+      msg.blob = std::move(legacy_blobs[i]);
+      msg.connections = std::move(legacy_targets[i]);
+      messages.push_back(std::move(msg));
+    }
+
+    return messages;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  void uptime_proof_relay::forget_peer(const boost::uuids::uuid &connection_id)
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    m_known.erase(connection_id);
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  void uptime_proof_relay::prune(uint64_t now)
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    for (auto it = m_known.begin(); it != m_known.end(); )
+    {
+      known_set &known = it->second;
+      for (auto k = known.begin(); k != known.end(); )
+      {
+        if (k->second + P2P_UPTIME_PROOF_KNOWN_LIFETIME < now)
+          k = known.erase(k);
+        else
+          ++k;
+      }
+      if (known.empty())
+        it = m_known.erase(it);
+      else
+        ++it;
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  uptime_proof_relay_stats uptime_proof_relay::get_stats() const
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    return m_stats;
+  }
+}
@@ -0,0 +1,112 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include "crypto/hash.h"
+#include "net/enums.h"
+#include "cryptonote_protocol_defs.h"
+
+namespace cryptonote
+{
+  typedef NOTIFY_UPTIME_PROOF_BATCH::proof uptime_proof_entry;
+
+  uptime_proof_entry make_uptime_proof_entry(const NOTIFY_UPTIME_PROOF::request &proof);
+  NOTIFY_UPTIME_PROOF::request make_uptime_proof_request(const uptime_proof_entry &entry);
+  crypto::hash get_uptime_proof_id(const uptime_proof_entry &entry);
+
+  struct uptime_proof_relay_stats
+  {
+    uint64_t batches_sent;      // NOTIFY_UPTIME_PROOF_BATCH messages sent
+    uint64_t proofs_relayed;    // proof deliveries, batched or not
+    uint64_t proofs_suppressed; // deliveries skipped because the peer already had the proof
+    uint64_t messages_saved;    // compared to one NOTIFY_UPTIME_PROOF per proof per peer
+    uint64_t bytes_saved;
+  };
+
+  /**
+   * Queues uptime proofs for relay and remembers, per connection, which proofs
+   * the peer already has (because it sent them to us or we sent them to it),
+   * so a proof crosses each link at most once. The protocol handler calls
+   * flush() on a short timer to turn the queue into relay messages: one batch
+   * per peer that understands NOTIFY_UPTIME_PROOF_BATCH, and the legacy
+   * per-proof message for the others.
+   */
+  class uptime_proof_relay
+  {
+  public:
+    struct peer
+    {
+      epee::net_utils::zone zone;
+      boost::uuids::uuid connection_id;
+      bool supports_batch;
+    };
+
+    struct message
+    {
+      int command;
+      std::string blob;
+      std::vector<std::pair<epee::net_utils::zone, boost::uuids::uuid>> connections;
+    };
+
+    uptime_proof_relay();
+
+    // returns false if the peer was already known to have the proof
+    bool mark_known(const boost::uuids::uuid &connection_id, const crypto::hash &id, uint64_t now);
+    // returns false if the proof is already queued
+    bool queue(const crypto::hash &id, const uptime_proof_entry &proof);
+    size_t pending() const;
+
+    std::vector<message> flush(const std::vector<peer> &peers, uint64_t now);
+    void forget_peer(const boost::uuids::uuid &connection_id);
+    void prune(uint64_t now);
+
+    uptime_proof_relay_stats get_stats() const;
+
+  private:
+    typedef std::unordered_map<crypto::hash, uint64_t> known_set;
+
+    bool mark_known_locked(known_set &known, const crypto::hash &id, uint64_t now);
+
+    mutable boost::mutex m_lock;
+    std::vector<std::pair<crypto::hash, uptime_proof_entry>> m_pending;
+    std::unordered_set<crypto::hash> m_pending_ids;
+    std::unordered_map<boost::uuids::uuid, known_set, boost::hash<boost::uuids::uuid>> m_known;
+    uptime_proof_relay_stats m_stats;
+  };
+}
@@ -127,6 +127,24 @@ namespace daemon_args
   , "Disable ZMQ RPC server"
   };
 
+  const command_line::arg_descriptor<std::string> arg_zmq_pub_bind_port = {
+    "zmq-pub-bind-port"
+  , "Port on the ZMQ RPC IP to publish block templates on, none if empty"
+  , ""
+  };
+
+  const command_line::arg_descriptor<std::string> arg_zmq_pub_template_address = {
+    "zmq-pub-template-address"
+  , "Address published block templates pay to"
+  , ""
+  };
+
+  const command_line::arg_descriptor<uint64_t> arg_zmq_pub_template_reserve_size = {
+    "zmq-pub-template-reserve-size"
+  , "Bytes of extra nonce reserved in published block templates, maximum 255"
+  , 8
+  };
+
 }  // namespace daemon_args
 
 #endif // DAEMON_COMMAND_LINE_ARGS_H
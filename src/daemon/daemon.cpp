@@ -107,6 +107,9 @@ t_daemon::t_daemon(
   zmq_rpc_bind_port = command_line::get_arg(vm, daemon_args::arg_zmq_rpc_bind_port);
   zmq_rpc_bind_address = command_line::get_arg(vm, daemon_args::arg_zmq_rpc_bind_ip);
   zmq_rpc_disabled = command_line::get_arg(vm, daemon_args::arg_zmq_rpc_disabled);
+  zmq_pub_bind_port = command_line::get_arg(vm, daemon_args::arg_zmq_pub_bind_port);
+  zmq_pub_template_address = command_line::get_arg(vm, daemon_args::arg_zmq_pub_template_address);
+  zmq_pub_template_reserve_size = command_line::get_arg(vm, daemon_args::arg_zmq_pub_template_reserve_size);
 }
 
 t_daemon::~t_daemon() = default;
@@ -189,6 +192,27 @@ bool t_daemon::run(bool interactive)
         return false;
       }
 
+      if (!zmq_pub_bind_port.empty())
+      {
+        cryptonote::address_parse_info info;
+        if (!cryptonote::get_account_address_from_str(info, mp_internals->core.get().get_nettype(), zmq_pub_template_address) || info.is_subaddress
+            || zmq_pub_template_reserve_size > 255 || !zmq_server.addPubSocket(zmq_rpc_bind_address, zmq_pub_bind_port))
+        {
+          LOG_ERROR(std::string("Failed to publish block templates on ZMQ port ") + zmq_pub_bind_port
+              + ": need a valid --" + daemon_args::arg_zmq_pub_template_address.name + " and a reserve size of at most 255");
+
+          if (rpc_commands)
+            rpc_commands->stop_handling();
+
+          for(auto& rpc : mp_internals->rpcs)
+            rpc->stop();
+
+          return false;
+        }
+        rpc_daemon_handler.set_block_template_address(info.address, zmq_pub_template_reserve_size);
+        MINFO(std::string("Publishing block templates on ZMQ port ") + zmq_pub_bind_port);
+      }
+
       MINFO("Starting ZMQ server...");
       zmq_server.run();
 
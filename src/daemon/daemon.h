@@ -47,6 +47,9 @@ private:
   std::string zmq_rpc_bind_address;
   std::string zmq_rpc_bind_port;
   bool zmq_rpc_disabled;
+  std::string zmq_pub_bind_port;
+  std::string zmq_pub_template_address;
+  uint64_t zmq_pub_template_reserve_size;
 public:
   t_daemon(
       boost::program_options::variables_map const & vm,
@@ -142,6 +142,9 @@ int main(int argc, char const * argv[])
       command_line::add_arg(core_settings, daemon_args::arg_zmq_rpc_bind_ip);
       command_line::add_arg(core_settings, daemon_args::arg_zmq_rpc_bind_port);
       command_line::add_arg(core_settings, daemon_args::arg_zmq_rpc_disabled);
+      command_line::add_arg(core_settings, daemon_args::arg_zmq_pub_bind_port);
+      command_line::add_arg(core_settings, daemon_args::arg_zmq_pub_template_address);
+      command_line::add_arg(core_settings, daemon_args::arg_zmq_pub_template_reserve_size);
 
       daemonizer::init_options(hidden_options, visible_options);
       daemonize::t_executor::init_options(core_settings);
@@ -760,6 +760,22 @@ bool t_rpc_command_executor::print_net_stats()
     % percent
     % tools::get_human_readable_bytes(limit);
 
+  tools::success_msg_writer() << boost::format("Uptime proofs: %u accepted (%.2f/s), %u rejected (%.2f/s), %u expired (%.2f/s)")
+    % net_stats_res.uptime_proofs_accepted
+    % net_stats_res.uptime_proofs_accepted_per_sec
+    % net_stats_res.uptime_proofs_rejected
+    % net_stats_res.uptime_proofs_rejected_per_sec
+    % net_stats_res.uptime_proofs_expired
+    % net_stats_res.uptime_proofs_expired_per_sec;
+
+  tools::success_msg_writer() << boost::format("Uptime proof relay: %u proofs relayed in %u batches, %u already known; saved %u messages, %u bytes (%s)")
+    % net_stats_res.uptime_proofs_relayed
+    % net_stats_res.uptime_proof_batches_sent
+    % net_stats_res.uptime_proofs_suppressed
+    % net_stats_res.uptime_proof_messages_saved
+    % net_stats_res.uptime_proof_bytes_saved
+    % tools::get_human_readable_bytes(net_stats_res.uptime_proof_bytes_saved);
+
   return true;
 }
 
@@ -1372,7 +1388,9 @@ bool t_rpc_command_executor::print_transaction_pool_stats() {
 
   tools::msg_writer() << n_transactions << " tx(es), " << res.pool_stats.bytes_total << " bytes total (min " << res.pool_stats.bytes_min << ", max " << res.pool_stats.bytes_max << ", avg " << avg_bytes << ", median " << res.pool_stats.bytes_med << ")" << std::endl
       << "fees " << cryptonote::print_money(res.pool_stats.fee_total) << " (avg " << cryptonote::print_money(n_transactions ? res.pool_stats.fee_total / n_transactions : 0) << " per tx" << ", " << cryptonote::print_money(res.pool_stats.bytes_total ? res.pool_stats.fee_total / res.pool_stats.bytes_total : 0) << " per byte)" << std::endl
-      << res.pool_stats.num_double_spends << " double spends, " << res.pool_stats.num_not_relayed << " not relayed, " << res.pool_stats.num_failing << " failing, " << res.pool_stats.num_10m << " older than 10 minutes (oldest " << (res.pool_stats.oldest == 0 ? "-" : get_human_time_ago(res.pool_stats.oldest, now)) << "), " << backlog_message;
+      << res.pool_stats.num_double_spends << " double spends, " << res.pool_stats.num_not_relayed << " not relayed, " << res.pool_stats.num_failing << " failing, " << res.pool_stats.num_10m << " older than 10 minutes (oldest " << (res.pool_stats.oldest == 0 ? "-" : get_human_time_ago(res.pool_stats.oldest, now)) << "), " << backlog_message << std::endl
+      << "input check cache: " << res.pool_stats.input_cache_size << " entries, " << res.pool_stats.input_cache_hits << " hits, " << res.pool_stats.input_cache_misses << " misses, " << res.pool_stats.input_cache_evictions << " evictions; "
+      << "parsed tx cache: " << res.pool_stats.parsed_tx_cache_size << " entries, " << res.pool_stats.parsed_tx_cache_hits << " hits, " << res.pool_stats.parsed_tx_cache_misses << " misses, " << res.pool_stats.parsed_tx_cache_evictions << " evictions";
 
   if (n_transactions > 1 && res.pool_stats.histo.size())
   {
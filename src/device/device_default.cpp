@@ -123,6 +123,12 @@ namespace hw {
             return crypto::derive_subaddress_public_key(out_key, derivation, output_index,derived_key);
         }
 
+        bool device_default::derive_subaddress_public_keys(const std::vector<crypto::public_key> &out_keys, const std::vector<crypto::key_derivation> &derivations, const std::vector<std::size_t> &output_indices, std::vector<crypto::public_key> &derived_keys, std::vector<bool> &valid) {
+            CHECK_AND_ASSERT_MES(derivations.size() == out_keys.size() && output_indices.size() == out_keys.size(), false, "Mismatched batch sizes");
+            crypto::derive_subaddress_public_keys(out_keys, derivations, output_indices, derived_keys, valid);
+            return true;
+        }
+
         crypto::public_key device_default::get_subaddress_spend_public_key(const cryptonote::account_keys& keys, const cryptonote::subaddress_index &index) {
             if (index.is_zero())
               return keys.m_account_address.m_spend_public_key;
@@ -239,6 +245,11 @@ namespace hw {
             return crypto::generate_key_derivation(key1, key2, derivation);
         }
 
+        bool device_default::generate_key_derivations(const std::vector<crypto::public_key> &keys, const crypto::secret_key &key2, std::vector<crypto::key_derivation> &derivations, std::vector<bool> &valid) {
+            crypto::generate_key_derivations(keys, key2, derivations, valid);
+            return true;
+        }
+
         bool device_default::derivation_to_scalar(const crypto::key_derivation &derivation, const size_t output_index, crypto::ec_scalar &res){
             crypto::derivation_to_scalar(derivation,output_index, res);
             return true;
@@ -1090,58 +1090,74 @@ namespace rct {
 
     //ver RingCT simple
     //assumes only post-rct style inputs (at least for max anonymity)
-    bool verRctNonSemanticsSimple(const rctSig & rv) {
-      try
-      {
+    // Checks the MLSAGs of a whole batch of transactions (e.g. all of a block's)
+    // as one pool of work, so that many small transactions keep every core as
+    // busy as one large one would. valid, if given, gets one result per rctSig.
+    bool verRctNonSemanticsSimple(const std::vector<const rctSig*> & rvs, std::vector<bool> *valid) {
         PERF_TIMER(verRctNonSemanticsSimple);
-        CHECK_AND_ASSERT_MES(rv.type == RCTTypeSimple || rv.type == RCTTypeBulletproof || rv.type == RCTTypeBulletproof2,
-            false, "verRctNonSemanticsSimple called on non simple rctSig");
-        const bool bulletproof = is_rct_bulletproof(rv.type);
-        // semantics check is early, and mixRing/MGs aren't resolved yet
-        if (bulletproof)
-          CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.p.pseudoOuts and mixRing");
-        else
-          CHECK_AND_ASSERT_MES(rv.pseudoOuts.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.pseudoOuts and mixRing");
+        std::vector<char> rv_ok(rvs.size(), 1);
+        std::vector<key> messages(rvs.size());
+        std::vector<std::pair<size_t, size_t>> mgs; // (rctSig, input)
 
-        const size_t threads = std::max(rv.outPk.size(), rv.mixRing.size());
-
-        std::deque<bool> results(threads);
         tools::threadpool& tpool = tools::threadpool::getInstance();
         tools::threadpool::waiter waiter;
 
-        const keyV &pseudoOuts = bulletproof ? rv.p.pseudoOuts : rv.pseudoOuts;
-
-        const key message = get_pre_mlsag_hash(rv, hw::get_device("default"));
+        for (size_t n = 0; n < rvs.size(); ++n) {
+          const rctSig &rv = *rvs[n];
+          if (rv.type != RCTTypeSimple && rv.type != RCTTypeBulletproof && rv.type != RCTTypeBulletproof2) {
+            LOG_PRINT_L1("verRctNonSemanticsSimple called on non simple rctSig");
+            rv_ok[n] = 0;
+            continue;
+          }
+          // semantics check is early, and mixRing/MGs aren't resolved yet
+          const size_t npseudo = is_rct_bulletproof(rv.type) ? rv.p.pseudoOuts.size() : rv.pseudoOuts.size();
+          if (npseudo != rv.mixRing.size() || rv.p.MGs.size() != rv.mixRing.size()) {
+            LOG_PRINT_L1("Mismatched sizes of pseudoOuts, MGs and mixRing");
+            rv_ok[n] = 0;
+            continue;
+          }
+          for (size_t i = 0; i < rv.mixRing.size(); ++i)
+            mgs.push_back(std::make_pair(n, i));
+          tpool.submit(&waiter, [&, n] {
+            try { messages[n] = get_pre_mlsag_hash(*rvs[n], hw::get_device("default")); }
+            catch (...) { rv_ok[n] = 0; }
+          });
+        }
+        waiter.wait(&tpool);
 
-        results.clear();
-        results.resize(rv.mixRing.size());
-        for (size_t i = 0 ; i < rv.mixRing.size() ; i++) {
-          tpool.submit(&waiter, [&, i] {
-              results[i] = verRctMGSimple(message, rv.p.MGs[i], rv.mixRing[i], pseudoOuts[i]);
+        // contiguous runs of signatures per task, a few tasks per thread to even out ring sizes
+        std::vector<char> results(mgs.size(), 0);
+        const size_t ntasks = std::min<size_t>(mgs.size(), std::max<size_t>(1, tpool.get_max_concurrency()) * 4);
+        for (size_t t = 0; t < ntasks; ++t) {
+          const size_t begin = mgs.size() * t / ntasks, end = mgs.size() * (t + 1) / ntasks;
+          tpool.submit(&waiter, [&, begin, end] {
+            for (size_t k = begin; k < end; ++k) {
+              const size_t n = mgs[k].first, i = mgs[k].second;
+              if (!rv_ok[n])
+                continue;
+              const rctSig &rv = *rvs[n];
+              const keyV &pseudoOuts = is_rct_bulletproof(rv.type) ? rv.p.pseudoOuts : rv.pseudoOuts;
+              results[k] = verRctMGSimple(messages[n], rv.p.MGs[i], rv.mixRing[i], pseudoOuts[i]);
+            }
           });
         }
         waiter.wait(&tpool);
 
-        for (size_t i = 0; i < results.size(); ++i) {
-          if (!results[i]) {
-            LOG_PRINT_L1("verRctMGSimple failed for input " << i);
-            return false;
+        for (size_t k = 0; k < mgs.size(); ++k) {
+          if (!results[k] && rv_ok[mgs[k].first]) {
+            LOG_PRINT_L1("verRctMGSimple failed for input " << mgs[k].second);
+            rv_ok[mgs[k].first] = 0;
           }
         }
 
-        return true;
-      }
-      // we can get deep throws from ge_frombytes_vartime if input isn't valid
-      catch (const std::exception &e)
-      {
-        LOG_PRINT_L1("Error in verRctNonSemanticsSimple: " << e.what());
-        return false;
-      }
-      catch (...)
-      {
-        LOG_PRINT_L1("Error in verRctNonSemanticsSimple, but not an actual exception");
-        return false;
-      }
+        if (valid)
+          valid->assign(rv_ok.begin(), rv_ok.end());
+        return std::find(rv_ok.begin(), rv_ok.end(), 0) == rv_ok.end();
+    }
+
+    bool verRctNonSemanticsSimple(const rctSig & rv)
+    {
+      return verRctNonSemanticsSimple(std::vector<const rctSig*>(1, &rv));
     }
 
     //RingCT protocol
@@ -169,8 +169,10 @@ namespace cryptonote
     : m_core(cr)
     , m_p2p(p2p)
     , m_was_bootstrap_ever_used(false)
+    , m_longpoll_waiters(0)
     , disable_rpc_ban(false)
     , m_rpc_payment_allow_free_loopback(false)
+    , m_get_blocks_cache(COMMAND_RPC_GET_BLOCKS_FAST_CACHE_MAX_ENTRIES, 4)
   {}
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::set_bootstrap_daemon(const std::string &address, const std::string &username_password)
@@ -502,6 +504,19 @@ namespace cryptonote
       CRITICAL_REGION_LOCAL(epee::net_utils::network_throttle_manager::m_lock_get_global_throttle_out);
       epee::net_utils::network_throttle_manager::get_global_throttle_out().get_stats(res.total_packets_out, res.total_bytes_out);
     }
+    const service_nodes::uptime_proof_stats proof_stats = m_core.get_uptime_proof_stats();
+    res.uptime_proofs_accepted = proof_stats.accepted;
+    res.uptime_proofs_rejected = proof_stats.rejected;
+    res.uptime_proofs_expired = proof_stats.expired;
+    res.uptime_proofs_accepted_per_sec = proof_stats.accepted_per_sec;
+    res.uptime_proofs_rejected_per_sec = proof_stats.rejected_per_sec;
+    res.uptime_proofs_expired_per_sec = proof_stats.expired_per_sec;
+    const cryptonote::uptime_proof_relay_stats relay_stats = m_p2p.get_payload_object().get_uptime_proof_relay_stats();
+    res.uptime_proof_batches_sent = relay_stats.batches_sent;
+    res.uptime_proofs_relayed = relay_stats.proofs_relayed;
+    res.uptime_proofs_suppressed = relay_stats.proofs_suppressed;
+    res.uptime_proof_messages_saved = relay_stats.messages_saved;
+    res.uptime_proof_bytes_saved = relay_stats.bytes_saved;
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
@@ -516,6 +531,35 @@ namespace cryptonote
     END_SERIALIZE()
   };
   //------------------------------------------------------------------------------------------------------------------------------
+  static void fill_get_blocks_response(std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > > &bs, std::vector<std::vector<std::vector<uint64_t>>> &indices, bool pruned, COMMAND_RPC_GET_BLOCKS_FAST::response& res)
+  {
+    // sizes are all known up front, and blobs are moved rather than copied
+    size_t size = 0, ntxes = 0;
+    res.blocks.resize(bs.size());
+    res.output_indices.resize(bs.size());
+    for (size_t n = 0; n < bs.size(); ++n)
+    {
+      auto &bd = bs[n];
+      block_complete_entry &e = res.blocks[n];
+      e.pruned = pruned;
+      size += bd.first.first.size();
+      e.block = std::move(bd.first.first);
+      ntxes += bd.second.size();
+      e.txs.reserve(bd.second.size());
+      for (auto &tx: bd.second)
+      {
+        size += tx.second.size();
+        e.txs.push_back({std::move(tx.second), crypto::null_hash});
+      }
+
+      auto &block_indices = res.output_indices[n].indices;
+      block_indices.resize(indices[n].size());
+      for (size_t i = 0; i < indices[n].size(); ++i)
+        block_indices[i].indices = std::move(indices[n][i]);
+    }
+    MDEBUG("on_get_blocks: " << bs.size() << " blocks, " << ntxes << " txes, size " << size);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res, const connection_context *ctx)
   {
     RPC_TRACKER(get_blocks);
@@ -529,23 +573,22 @@ namespace cryptonote
     if (!req.block_ids.empty())
     {
       uint64_t last_block_height;
-      crypto::hash last_block_hash;
-      m_core.get_blockchain_top(last_block_height, last_block_hash);
+      const crypto::hash last_block_hash = m_core.get_blockchain_storage().get_db().top_block_hash(&last_block_height);
       if (last_block_hash == req.block_ids.front())
       {
         res.start_height = 0;
-        res.current_height = m_core.get_current_blockchain_height();
+        res.current_height = last_block_height + 1;
         res.status = CORE_RPC_STATUS_OK;
         return true;
       }
     }
 
     size_t max_blocks = COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT;
+    if (req.max_block_count && req.max_block_count < max_blocks)
+      max_blocks = req.max_block_count;
     if (m_rpc_payment)
     {
-      max_blocks = res.credits / COST_PER_BLOCK;
-      if (max_blocks > COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT)
-        max_blocks = COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT;
+      max_blocks = std::min<size_t>(max_blocks, res.credits / COST_PER_BLOCK);
       if (max_blocks == 0)
       {
         res.status = CORE_RPC_STATUS_PAYMENT_REQUIRED;
@@ -554,7 +597,9 @@ namespace cryptonote
     }
 
     std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > > bs;
-    if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, req.prune, !req.no_miner_tx, max_blocks))
+    std::vector<std::vector<std::vector<uint64_t>>> indices;
+    crypto::hash top_hash;
+    if(!m_core.get_blocks_fast(req.start_height, req.block_ids, bs, indices, res.current_height, res.start_height, top_hash, req.prune, !req.no_miner_tx, max_blocks))
     {
       res.status = "Failed";
       add_host_fail(ctx);
@@ -563,51 +608,97 @@ namespace cryptonote
 
     CHECK_PAYMENT_SAME_TS(req, res, bs.size() * COST_PER_BLOCK);
 
-    size_t size = 0, ntxes = 0;
-    res.blocks.reserve(bs.size());
-    res.output_indices.reserve(bs.size());
-    for(auto& bd: bs)
+    fill_get_blocks_response(bs, indices, req.prune, res);
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  static crypto::hash get_blocks_cache_key(const crypto::hash &top_hash, const std::string &request_body)
+  {
+    std::string data;
+    data.reserve(sizeof(top_hash) + request_body.size());
+    data.append(reinterpret_cast<const char*>(&top_hash), sizeof(top_hash));
+    data.append(request_body);
+    return crypto::cn_fast_hash(data.data(), data.size());
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_blocks_bin(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response_info, const connection_context *ctx)
+  {
+    COMMAND_RPC_GET_BLOCKS_FAST::request req = AUTO_VAL_INIT(req);
+    if (!epee::serialization::load_t_from_binary(req, epee::strspan<uint8_t>(query_info.m_body)))
     {
-      res.blocks.resize(res.blocks.size()+1);
-      res.blocks.back().pruned = req.prune;
-      res.blocks.back().block = bd.first.first;
-      size += bd.first.first.size();
-      res.output_indices.push_back(COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices());
-      ntxes += bd.second.size();
-      res.output_indices.back().indices.reserve(1 + bd.second.size());
-      if (req.no_miner_tx)
-        res.output_indices.back().indices.push_back(COMMAND_RPC_GET_BLOCKS_FAST::tx_output_indices());
-      res.blocks.back().txs.reserve(bd.second.size());
-      for (std::vector<std::pair<crypto::hash, cryptonote::blobdata>>::iterator i = bd.second.begin(); i != bd.second.end(); ++i)
+      MERROR("Failed to parse bin body data, body size=" << query_info.m_body.size());
+      response_info.m_response_code = 400;
+      response_info.m_response_comment = "Bad Request";
+      return true;
+    }
+    response_info.m_mime_tipe = " application/octet-stream";
+    response_info.m_header_info.m_content_type = " application/octet-stream";
+
+    // Responses carrying payment or bootstrap daemon state are per client, so they
+    // take the regular path.  Otherwise a response depends only on the request and
+    // our top block, and most wallets ask for the same range near the tip.
+    bool shared = !m_rpc_payment;
+    if (shared)
+    {
+      boost::shared_lock<boost::shared_mutex> lock(m_bootstrap_daemon_mutex);
+      shared = m_bootstrap_daemon.get() == nullptr;
+    }
+
+    COMMAND_RPC_GET_BLOCKS_FAST::response res = AUTO_VAL_INIT(res);
+    if (!shared)
+    {
+      if (!on_get_blocks(req, res, ctx))
       {
-        res.blocks.back().txs.push_back({std::move(i->second), crypto::null_hash});
-        i->second.clear();
-        i->second.shrink_to_fit();
-        size += res.blocks.back().txs.back().blob.size();
+        MERROR("Failed to on_get_blocks()");
+        response_info.m_response_code = 500;
+        response_info.m_response_comment = "Internal Server Error";
+        return true;
       }
+      epee::serialization::store_t_to_binary(res, response_info.m_body);
+      return true;
+    }
 
-      const size_t n_txes_to_lookup = bd.second.size() + (req.no_miner_tx ? 0 : 1);
-      if (n_txes_to_lookup > 0)
+    RPC_TRACKER(get_blocks);
+    std::shared_ptr<const std::string> body;
+    try
+    {
+      const crypto::hash top_hash = m_core.get_blockchain_storage().get_db().top_block_hash();
+      if (m_get_blocks_cache.get(get_blocks_cache_key(top_hash, query_info.m_body), body))
       {
-        std::vector<std::vector<uint64_t>> indices;
-        bool r = m_core.get_tx_outputs_gindexs(req.no_miner_tx ? bd.second.front().first : bd.first.second, n_txes_to_lookup, indices);
-        if (!r)
-        {
-          res.status = "Failed";
-          return false;
-        }
-        if (indices.size() != n_txes_to_lookup || res.output_indices.back().indices.size() != (req.no_miner_tx ? 1 : 0))
-        {
-          res.status = "Failed";
-          return false;
-        }
-        for (size_t i = 0; i < indices.size(); ++i)
-          res.output_indices.back().indices.push_back({std::move(indices[i])});
+        response_info.m_body = *body;
+        return true;
       }
     }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to get top block hash: " << e.what());
+    }
 
-    MDEBUG("on_get_blocks: " << bs.size() << " blocks, " << ntxes << " txes, size " << size);
+    size_t max_blocks = COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT;
+    if (req.max_block_count && req.max_block_count < max_blocks)
+      max_blocks = req.max_block_count;
+
+    std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > > bs;
+    std::vector<std::vector<std::vector<uint64_t>>> indices;
+    crypto::hash top_hash;
+    if(!m_core.get_blocks_fast(req.start_height, req.block_ids, bs, indices, res.current_height, res.start_height, top_hash, req.prune, !req.no_miner_tx, max_blocks))
+    {
+      add_host_fail(ctx);
+      MERROR("Failed to on_get_blocks()");
+      response_info.m_response_code = 500;
+      response_info.m_response_comment = "Internal Server Error";
+      return true;
+    }
+    fill_get_blocks_response(bs, indices, req.prune, res);
     res.status = CORE_RPC_STATUS_OK;
+
+    std::shared_ptr<std::string> blob = std::make_shared<std::string>();
+    epee::serialization::store_t_to_binary(res, *blob);
+    // key on the top block the response was read against, which may have moved on since the lookup above
+    if (res.blocks.empty() || res.start_height + COMMAND_RPC_GET_BLOCKS_FAST_CACHE_TIP_BLOCKS >= res.current_height)
+      m_get_blocks_cache.put(get_blocks_cache_key(top_hash, query_info.m_body), blob);
+    response_info.m_body = *blob;
     return true;
   }
     bool core_rpc_server::on_get_alt_blocks_hashes(const COMMAND_RPC_GET_ALT_BLOCKS_HASHES::request& req, COMMAND_RPC_GET_ALT_BLOCKS_HASHES::response& res, const connection_context *ctx)
@@ -702,6 +793,34 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_block_filters(const COMMAND_RPC_GET_BLOCK_FILTERS::request& req, COMMAND_RPC_GET_BLOCK_FILTERS::response& res, const connection_context *ctx)
+  {
+    RPC_TRACKER(get_block_filters);
+    bool r;
+    if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_BLOCK_FILTERS>(invoke_http_mode::BIN, "/get_block_filters.bin", req, res, r))
+      return r;
+
+    CHECK_PAYMENT(req, res, 1);
+
+    const size_t count = std::min<uint64_t>(req.count, COMMAND_RPC_GET_BLOCK_FILTERS_MAX_COUNT);
+    std::vector<cryptonote::blobdata> filters;
+    size_t built_count;
+    if (!m_core.get_blockchain_storage().get_block_filters(req.start_height, count, COMMAND_RPC_GET_BLOCK_FILTERS_MAX_SIZE, filters, res.current_height, built_count))
+    {
+      res.status = "Failed";
+      return false;
+    }
+
+    // a filter built on the fly costs us a full block read
+    CHECK_PAYMENT_SAME_TS(req, res, (filters.size() - built_count) * COST_PER_BLOCK_FILTER + built_count * COST_PER_BLOCK);
+
+    res.start_height = req.start_height;
+    res.built_count = built_count;
+    res.filters = std::move(filters);
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res, const connection_context *ctx)
   {
 	  PERF_TIMER(on_get_random_outs);
@@ -1979,6 +2098,28 @@ namespace cryptonote
         return false;
       }
     }
+    if (!req.longpoll_id.empty())
+    {
+      crypto::hash longpoll_prev;
+      uint64_t longpoll_reward;
+      if (!rpc::RpcHandler::parse_block_template_id(req.longpoll_id, longpoll_prev, longpoll_reward))
+      {
+        error_resp.code = CORE_RPC_ERROR_CODE_WRONG_PARAM;
+        error_resp.message = "Invalid longpoll_id";
+        return false;
+      }
+      // a long poll parks this RPC thread, so waiters are kept below the server's thread
+      // count to leave one thread serving everything else; the rest get a template right away
+      const size_t threads = m_net_server.get_threads_count();
+      const size_t max_waiters = std::min<size_t>(BLOCK_TEMPLATE_LONGPOLL_MAX_WAITERS, threads > 0 ? threads - 1 : 0);
+      const unsigned int waiters = ++m_longpoll_waiters;
+      auto waiters_release = epee::misc_utils::create_scope_leave_handler([this](){ --m_longpoll_waiters; });
+      if (waiters <= max_waiters)
+      {
+        const uint64_t timeout = std::min<uint64_t>(req.longpoll_timeout, BLOCK_TEMPLATE_LONGPOLL_MAX_TIMEOUT);
+        m_core.wait_for_block_template_change(longpoll_prev, longpoll_reward, info.address, std::chrono::seconds(timeout));
+      }
+    }
     uint64_t seed_height;
     crypto::hash seed_hash, next_seed_hash;
     if (!get_block_template(info.address, req.prev_block.empty() ? NULL : &prev_block, blob_reserve, reserved_offset, wdiff, res.height, res.expected_reward, b, res.seed_height, seed_hash, next_seed_hash, error_resp))
@@ -1997,6 +2138,7 @@ namespace cryptonote
     res.prev_hash = string_tools::pod_to_hex(b.prev_id);
     res.blocktemplate_blob = string_tools::buff_to_hex_nodelimer(block_blob);
     res.blockhashing_blob =  string_tools::buff_to_hex_nodelimer(hashing_blob);
+    res.template_id = rpc::RpcHandler::get_block_template_id(b.prev_id, res.expected_reward);
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
@@ -3199,7 +3341,7 @@ namespace cryptonote
       const uint64_t req_to_height = req.to_height ? req.to_height : (m_core.get_current_blockchain_height() - 1);
       for (uint64_t amount: req.amounts)
       {
-        auto data = rpc::RpcHandler::get_output_distribution([this](uint64_t amount, uint64_t from, uint64_t to, uint64_t &start_height, std::vector<uint64_t> &distribution, uint64_t &base) { return m_core.get_output_distribution(amount, from, to, start_height, distribution, base); }, amount, req.from_height, req_to_height, [this](uint64_t height) { return m_core.get_blockchain_storage().get_db().get_block_hash_from_height(height); }, req.cumulative, m_core.get_current_blockchain_height());
+        auto data = rpc::RpcHandler::get_output_distribution([this](uint64_t amount, uint64_t from, uint64_t to, uint64_t &start_height, std::vector<uint64_t> &distribution, uint64_t &base) { return m_core.get_output_distribution(amount, from, to, start_height, distribution, base); }, amount, req.from_height, req_to_height, req.cumulative);
         if (!data)
         {
           error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
@@ -3247,7 +3389,7 @@ namespace cryptonote
       const uint64_t req_to_height = req.to_height ? req.to_height : (m_core.get_current_blockchain_height() - 1);
       for (uint64_t amount: req.amounts)
       {
-        auto data = rpc::RpcHandler::get_output_distribution([this](uint64_t amount, uint64_t from, uint64_t to, uint64_t &start_height, std::vector<uint64_t> &distribution, uint64_t &base) { return m_core.get_output_distribution(amount, from, to, start_height, distribution, base); }, amount, req.from_height, req_to_height, [this](uint64_t height) { return m_core.get_blockchain_storage().get_db().get_block_hash_from_height(height); }, req.cumulative, m_core.get_current_blockchain_height());
+        auto data = rpc::RpcHandler::get_output_distribution([this](uint64_t amount, uint64_t from, uint64_t to, uint64_t &start_height, std::vector<uint64_t> &distribution, uint64_t &base) { return m_core.get_output_distribution(amount, from, to, start_height, distribution, base); }, amount, req.from_height, req_to_height, req.cumulative);
         if (!data)
         {
           res.status = "Failed to get output distribution";
@@ -3449,23 +3591,61 @@ namespace cryptonote
 		  }
 	  }
 
-	  std::vector<service_nodes::service_node_pubkey_info> pubkey_info_list = m_core.get_service_node_list_state(pubkeys);
+	  // Read from the view published after the last block, so this doesn't
+	  // hold up (or wait on) block processing
+	  const std::shared_ptr<const service_nodes::service_node_list_view> view = m_core.get_service_node_list_view();
+	  const bool is_delta = req.since_height && view->can_delta_since(req.since_height);
+
+	  std::vector<const service_nodes::service_node_list_view::entry *> view_entries;
+	  if (pubkeys.empty())
+	  {
+		  view_entries.reserve(view->entries.size());
+		  for (const auto &view_entry : view->entries)
+			  view_entries.push_back(&view_entry);
+	  }
+	  else
+	  {
+		  for (const auto &pubkey : pubkeys)
+			  if (const auto *view_entry = view->find(pubkey))
+				  view_entries.push_back(view_entry);
+	  }
+
+	  if (is_delta)
+	  {
+		  view_entries.erase(std::remove_if(view_entries.begin(), view_entries.end(), [&req](const service_nodes::service_node_list_view::entry *view_entry) {
+			  return view_entry->last_changed_height <= req.since_height;
+		  }), view_entries.end());
+
+		  for (const auto &removed : view->removed)
+		  {
+			  if (removed.first <= req.since_height)
+				  continue;
+			  if (!pubkeys.empty() && std::find(pubkeys.begin(), pubkeys.end(), removed.second) == pubkeys.end())
+				  continue;
+			  res.removed_service_node_pubkeys.push_back(string_tools::pod_to_hex(removed.second));
+		  }
+	  }
 
 	  res.status = CORE_RPC_STATUS_OK;
-	  res.service_node_states.reserve(pubkey_info_list.size());
-	  for (const auto &pubkey_info : pubkey_info_list)
+	  res.height = view->height;
+	  res.is_delta = is_delta;
+	  res.service_node_states.reserve(view_entries.size());
+	  for (const auto *view_entry : view_entries)
 	  {
+		  const crypto::public_key &pubkey = view_entry->pubkey;
+		  const service_nodes::service_node_info &info = *view_entry->info;
+
 		  COMMAND_RPC_GET_SERVICE_NODES::response::entry entry = {};
-		  entry.service_node_pubkey = string_tools::pod_to_hex(pubkey_info.pubkey);
-		  entry.registration_height = pubkey_info.info.registration_height;
-		  entry.last_reward_block_height = pubkey_info.info.last_reward_block_height;
-		  entry.last_reward_transaction_index = pubkey_info.info.last_reward_transaction_index;
-		  entry.last_uptime_proof = m_core.get_uptime_proof(pubkey_info.pubkey);
+		  entry.service_node_pubkey = string_tools::pod_to_hex(pubkey);
+		  entry.registration_height = info.registration_height;
+		  entry.last_reward_block_height = info.last_reward_block_height;
+		  entry.last_reward_transaction_index = info.last_reward_transaction_index;
+		  entry.last_uptime_proof = m_core.get_uptime_proof(pubkey);
       entry.is_pool = entry.contributors.size() > 0;
       
 
-		  entry.contributors.reserve(pubkey_info.info.contributors.size());
-		  for (service_nodes::service_node_info::contribution const &contributor : pubkey_info.info.contributors)
+		  entry.contributors.reserve(info.contributors.size());
+		  for (service_nodes::service_node_info::contribution const &contributor : info.contributors)
 		  {
 			  COMMAND_RPC_GET_SERVICE_NODES::response::contribution new_contributor = {};
 			  new_contributor.amount = contributor.amount;
@@ -3474,11 +3654,11 @@ namespace cryptonote
 			  entry.contributors.push_back(new_contributor);
 		  }
 
-		  entry.total_contributed = pubkey_info.info.total_contributed;
-		  entry.total_reserved = pubkey_info.info.total_reserved;
-		  entry.staking_requirement = pubkey_info.info.staking_requirement;
-		  entry.portions_for_operator = pubkey_info.info.portions_for_operator;
-		  entry.operator_address = cryptonote::get_account_address_as_str(nettype(), false/*is_subaddress*/, pubkey_info.info.operator_address);
+		  entry.total_contributed = info.total_contributed;
+		  entry.total_reserved = info.total_reserved;
+		  entry.staking_requirement = info.staking_requirement;
+		  entry.portions_for_operator = info.portions_for_operator;
+		  entry.operator_address = cryptonote::get_account_address_as_str(nettype(), false/*is_subaddress*/, info.operator_address);
 
 		  res.service_node_states.push_back(entry);
 	  }
@@ -91,7 +91,7 @@ namespace cryptonote
 // advance which version they will stop working with
 // Don't go over 32767 for any of these
 #define CORE_RPC_VERSION_MAJOR 3
-#define CORE_RPC_VERSION_MINOR 1
+#define CORE_RPC_VERSION_MINOR 7
 #define MAKE_CORE_RPC_VERSION(major,minor) (((major)<<16)|(minor))
 #define CORE_RPC_VERSION MAKE_CORE_RPC_VERSION(CORE_RPC_VERSION_MAJOR, CORE_RPC_VERSION_MINOR)
 
@@ -171,12 +171,14 @@ namespace cryptonote
       uint64_t    start_height;
       bool        prune;
       bool        no_miner_tx;
+      uint64_t    max_block_count; // 0 for the daemon's default
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_request_base)
         KV_SERIALIZE_CONTAINER_POD_AS_BLOB(block_ids)
         KV_SERIALIZE(start_height)
         KV_SERIALIZE(prune)
         KV_SERIALIZE_OPT(no_miner_tx, false)
+        KV_SERIALIZE_OPT(max_block_count, (uint64_t)0)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<request_t> request;
@@ -293,6 +295,43 @@ namespace cryptonote
     typedef epee::misc_utils::struct_init<response_t> response;
   };
 
+  //-----------------------------------------------
+  // Get the compact wallet filters (see cryptonote::block_filter) of a range of blocks, so a
+  // wallet can fetch full blocks only where it may have received or spent something. Long
+  // ranges are served a page at a time: ask again from start_height + filters.size().
+  struct COMMAND_RPC_GET_BLOCK_FILTERS
+  {
+    struct request_t: public rpc_access_request_base
+    {
+      uint64_t start_height; // Height of the first block to get the filter of
+      uint64_t count;        // Max number of filters to return, capped by the daemon
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_access_request_base)
+        KV_SERIALIZE(start_height)
+        KV_SERIALIZE(count)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+
+    struct response_t: public rpc_access_response_base
+    {
+      uint64_t start_height;            // Height of the first returned filter's block
+      uint64_t current_height;          // The daemon's blockchain height
+      std::vector<std::string> filters; // Serialized block filters, in height order
+      uint64_t built_count;             // How many filters were built from their block, charged like a block
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_access_response_base)
+        KV_SERIALIZE(start_height)
+        KV_SERIALIZE(current_height)
+        KV_SERIALIZE(filters)
+        KV_SERIALIZE_OPT(built_count, (uint64_t)0)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<response_t> response;
+  };
+
   //-----------------------------------------------
   struct COMMAND_RPC_GET_ADDRESS_TXS
   {
@@ -1234,6 +1273,17 @@ namespace cryptonote
       uint64_t total_bytes_in;
       uint64_t total_packets_out;
       uint64_t total_bytes_out;
+      uint64_t uptime_proofs_accepted;
+      uint64_t uptime_proofs_rejected;
+      uint64_t uptime_proofs_expired;
+      double uptime_proofs_accepted_per_sec;
+      double uptime_proofs_rejected_per_sec;
+      double uptime_proofs_expired_per_sec;
+      uint64_t uptime_proof_batches_sent;
+      uint64_t uptime_proofs_relayed;
+      uint64_t uptime_proofs_suppressed;
+      uint64_t uptime_proof_messages_saved;
+      uint64_t uptime_proof_bytes_saved;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_response_base)
@@ -1242,6 +1292,17 @@ namespace cryptonote
         KV_SERIALIZE(total_bytes_in)
         KV_SERIALIZE(total_packets_out)
         KV_SERIALIZE(total_bytes_out)
+        KV_SERIALIZE(uptime_proofs_accepted)
+        KV_SERIALIZE(uptime_proofs_rejected)
+        KV_SERIALIZE(uptime_proofs_expired)
+        KV_SERIALIZE(uptime_proofs_accepted_per_sec)
+        KV_SERIALIZE(uptime_proofs_rejected_per_sec)
+        KV_SERIALIZE(uptime_proofs_expired_per_sec)
+        KV_SERIALIZE_OPT(uptime_proof_batches_sent, (uint64_t)0)
+        KV_SERIALIZE_OPT(uptime_proofs_relayed, (uint64_t)0)
+        KV_SERIALIZE_OPT(uptime_proofs_suppressed, (uint64_t)0)
+        KV_SERIALIZE_OPT(uptime_proof_messages_saved, (uint64_t)0)
+        KV_SERIALIZE_OPT(uptime_proof_bytes_saved, (uint64_t)0)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -1374,6 +1435,8 @@ namespace cryptonote
       std::string wallet_address;
       std::string prev_block;
       std::string extra_nonce;
+      std::string longpoll_id;     // template_id of a template already held: wait until a better one exists. Only RPC threads - 1 calls wait at once, others return at once
+      uint64_t longpoll_timeout;   // seconds to wait at most when longpoll_id is given
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_request_base)
@@ -1381,6 +1444,8 @@ namespace cryptonote
         KV_SERIALIZE(wallet_address)
         KV_SERIALIZE(prev_block)
         KV_SERIALIZE(extra_nonce)
+        KV_SERIALIZE(longpoll_id)
+        KV_SERIALIZE_OPT(longpoll_timeout, (uint64_t)BLOCK_TEMPLATE_LONGPOLL_DEFAULT_TIMEOUT)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<request_t> request;
@@ -1399,6 +1464,7 @@ namespace cryptonote
       std::string next_seed_hash;
       blobdata blocktemplate_blob;
       blobdata blockhashing_blob;
+      std::string template_id;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_response_base)
@@ -1414,6 +1480,7 @@ namespace cryptonote
         KV_SERIALIZE(blockhashing_blob)
         KV_SERIALIZE(seed_hash)
         KV_SERIALIZE(next_seed_hash)
+        KV_SERIALIZE(template_id)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -1990,8 +2057,17 @@ namespace cryptonote
     uint64_t histo_98pc;
     std::vector<txpool_histo> histo;
     uint32_t num_double_spends;
-
-    txpool_stats(): bytes_total(0), bytes_min(0), bytes_max(0), bytes_med(0), fee_total(0), oldest(0), txs_total(0), num_failing(0), num_10m(0), num_not_relayed(0), histo_98pc(0), num_double_spends(0) {}
+    uint64_t input_cache_hits;
+    uint64_t input_cache_misses;
+    uint64_t input_cache_evictions;
+    uint64_t input_cache_size;
+    uint64_t parsed_tx_cache_hits;
+    uint64_t parsed_tx_cache_misses;
+    uint64_t parsed_tx_cache_evictions;
+    uint64_t parsed_tx_cache_size;
+
+    txpool_stats(): bytes_total(0), bytes_min(0), bytes_max(0), bytes_med(0), fee_total(0), oldest(0), txs_total(0), num_failing(0), num_10m(0), num_not_relayed(0), histo_98pc(0), num_double_spends(0),
+      input_cache_hits(0), input_cache_misses(0), input_cache_evictions(0), input_cache_size(0), parsed_tx_cache_hits(0), parsed_tx_cache_misses(0), parsed_tx_cache_evictions(0), parsed_tx_cache_size(0) {}
 
     BEGIN_KV_SERIALIZE_MAP()
       KV_SERIALIZE(bytes_total)
@@ -2007,6 +2083,14 @@ namespace cryptonote
       KV_SERIALIZE(histo_98pc)
       KV_SERIALIZE(histo)
       KV_SERIALIZE(num_double_spends)
+      KV_SERIALIZE(input_cache_hits)
+      KV_SERIALIZE(input_cache_misses)
+      KV_SERIALIZE(input_cache_evictions)
+      KV_SERIALIZE(input_cache_size)
+      KV_SERIALIZE(parsed_tx_cache_hits)
+      KV_SERIALIZE(parsed_tx_cache_misses)
+      KV_SERIALIZE(parsed_tx_cache_evictions)
+      KV_SERIALIZE(parsed_tx_cache_size)
     END_KV_SERIALIZE_MAP()
   };
 
@@ -3150,8 +3234,10 @@ namespace cryptonote
     struct request_t: public rpc_request_base
 	  {
 		  std::vector<std::string> service_node_pubkeys; // pass empty vector to get all the service nodes
+		  uint64_t since_height; // the height of a previous response to get only what changed since, 0 for everything
 		  BEGIN_KV_SERIALIZE_MAP()
 			  KV_SERIALIZE(service_node_pubkeys);
+			  KV_SERIALIZE_OPT(since_height, (uint64_t)0)
 		  END_KV_SERIALIZE_MAP()
 	  };
 
@@ -3203,11 +3289,17 @@ namespace cryptonote
 			  END_KV_SERIALIZE_MAP()
 		  };
 
-		  std::vector<entry> service_node_states;
-		  std::string        status;
+		  std::vector<entry>       service_node_states;
+		  uint64_t                 height;       // pass back as since_height to get the next delta
+		  bool                     is_delta;     // if false, service_node_states is the whole list
+		  std::vector<std::string> removed_service_node_pubkeys; // delta only; apply before service_node_states
+		  std::string              status;
 
 		  BEGIN_KV_SERIALIZE_MAP()
 			  KV_SERIALIZE(service_node_states)
+			  KV_SERIALIZE(height)
+			  KV_SERIALIZE(is_delta)
+			  KV_SERIALIZE(removed_service_node_pubkeys)
 			  KV_SERIALIZE(status)
 		  END_KV_SERIALIZE_MAP()
 	  };
@@ -110,7 +110,7 @@ namespace rpc
   } // anonymous
 
   DaemonHandler::DaemonHandler(cryptonote::core& c, t_p2p& p2p)
-    : m_core(c), m_p2p(p2p)
+    : m_core(c), m_p2p(p2p), m_template_reserve_size(0)
   {
     const auto last_sorted = std::is_sorted_until(std::begin(handlers), std::end(handlers));
     if (last_sorted != std::end(handlers))
@@ -608,6 +608,61 @@ namespace rpc
     res.error_details = "RPC method not yet implemented.";
   }
 
+  void DaemonHandler::set_block_template_address(const account_public_address& address, size_t reserve_size)
+  {
+    m_template_address = address;
+    m_template_reserve_size = reserve_size;
+  }
+
+  bool DaemonHandler::next_block_template(std::string& template_id, std::string& message, std::chrono::milliseconds timeout)
+  {
+    if (!m_template_address)
+      return false;
+
+    crypto::hash prev_id;
+    uint64_t prev_reward;
+    if (parse_block_template_id(template_id, prev_id, prev_reward) && !m_core.wait_for_block_template_change(prev_id, prev_reward, *m_template_address, timeout))
+      return false;
+
+    block b = boost::value_initialized<block>();
+    difficulty_type difficulty;
+    cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response res = AUTO_VAL_INIT(res);
+    const blobdata extra_nonce(m_template_reserve_size, 0);
+    if (!m_core.get_block_template(b, *m_template_address, difficulty, res.height, res.expected_reward, extra_nonce))
+    {
+      MERROR("Failed to create block template to publish");
+      return false;
+    }
+
+    const blobdata block_blob = t_serializable_object_to_blob(b);
+    if (!extra_nonce.empty())
+    {
+      const crypto::public_key tx_pub_key = get_tx_pub_key_from_extra(b.miner_tx);
+      const char* const pub_key_begin = reinterpret_cast<const char*>(&tx_pub_key);
+      const auto found = std::search(block_blob.begin(), block_blob.end(), pub_key_begin, pub_key_begin + sizeof(tx_pub_key));
+      if (tx_pub_key == crypto::null_pkey || found == block_blob.end())
+      {
+        MERROR("Failed to find tx pub key in published block template");
+        return false;
+      }
+      res.reserved_offset = (found - block_blob.begin()) + sizeof(tx_pub_key) + 2; // TX_EXTRA_NONCE tag and size
+    }
+
+    res.difficulty = (difficulty & 0xffffffffffffffff).convert_to<uint64_t>();
+    res.wide_difficulty = cryptonote::hex(difficulty);
+    res.difficulty_top64 = ((difficulty >> 64) & 0xffffffffffffffff).convert_to<uint64_t>();
+    res.prev_hash = epee::string_tools::pod_to_hex(b.prev_id);
+    res.blocktemplate_blob = epee::string_tools::buff_to_hex_nodelimer(block_blob);
+    res.blockhashing_blob = epee::string_tools::buff_to_hex_nodelimer(get_block_hashing_blob(b));
+    res.template_id = get_block_template_id(b.prev_id, res.expected_reward);
+    res.status = CORE_RPC_STATUS_OK;
+
+    if (!epee::serialization::store_t_to_json(res, message))
+      return false;
+    template_id = res.template_id;
+    return true;
+  }
+
   void DaemonHandler::handle(const SubmitBlock::Request& req, SubmitBlock::Response& res)
   {
     res.status = Message::STATUS_FAILED;
@@ -852,7 +907,7 @@ namespace rpc
       const uint64_t req_to_height = req.to_height ? req.to_height : (m_core.get_current_blockchain_height() - 1);
       for (std::uint64_t amount : req.amounts)
       {
-        auto data = rpc::RpcHandler::get_output_distribution([this](uint64_t amount, uint64_t from, uint64_t to, uint64_t &start_height, std::vector<uint64_t> &distribution, uint64_t &base) { return m_core.get_output_distribution(amount, from, to, start_height, distribution, base); }, amount, req.from_height, req_to_height, [this](uint64_t height) { return m_core.get_blockchain_storage().get_db().get_block_hash_from_height(height); }, req.cumulative, m_core.get_current_blockchain_height());
+        auto data = rpc::RpcHandler::get_output_distribution([this](uint64_t amount, uint64_t from, uint64_t to, uint64_t &start_height, std::vector<uint64_t> &distribution, uint64_t &base) { return m_core.get_output_distribution(amount, from, to, start_height, distribution, base); }, amount, req.from_height, req_to_height, req.cumulative);
         if (!data)
         {
           res.distributions.clear();
@@ -135,6 +135,11 @@ class DaemonHandler : public RpcHandler
 
     epee::byte_slice handle(const std::string& request) override final;
 
+    //! build published block templates for address, leaving reserve_size bytes of extra nonce
+    void set_block_template_address(const account_public_address& address, size_t reserve_size);
+
+    bool next_block_template(std::string& template_id, std::string& message, std::chrono::milliseconds timeout) override final;
+
   private:
 
     bool getBlockHeaderByHash(const crypto::hash& hash_in, cryptonote::rpc::BlockHeaderResponse& response);
@@ -143,6 +148,9 @@ class DaemonHandler : public RpcHandler
 
     cryptonote::core& m_core;
     t_p2p& m_p2p;
+
+    boost::optional<account_public_address> m_template_address;
+    size_t m_template_reserve_size;
 };
 
 }  // namespace rpc
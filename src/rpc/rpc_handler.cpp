@@ -1,9 +1,10 @@
 
 #include <algorithm>
-#include <boost/thread/locks.hpp>
-#include <boost/thread/mutex.hpp>
+#include <cstring>
 
 #include "cryptonote_core/cryptonote_core.h"
+#include "int-util.h"
+#include "string_tools.h"
 
 namespace cryptonote
 {
@@ -26,67 +27,13 @@ namespace rpc
   }
 
   boost::optional<output_distribution_data>
-    RpcHandler::get_output_distribution(const std::function<bool(uint64_t, uint64_t, uint64_t, uint64_t&, std::vector<uint64_t>&, uint64_t&)> &f, uint64_t amount, uint64_t from_height, uint64_t to_height, const std::function<crypto::hash(uint64_t)> &get_hash, bool cumulative, uint64_t blockchain_height)
+    RpcHandler::get_output_distribution(const std::function<bool(uint64_t, uint64_t, uint64_t, uint64_t&, std::vector<uint64_t>&, uint64_t&)> &f, uint64_t amount, uint64_t from_height, uint64_t to_height, bool cumulative)
   {
-      static struct D
-      {
-        boost::mutex mutex;
-        std::vector<std::uint64_t> cached_distribution;
-        std::uint64_t cached_from, cached_to, cached_start_height, cached_base;
-        crypto::hash cached_m10_hash;
-        crypto::hash cached_top_hash;
-        bool cached;
-        D(): cached_from(0), cached_to(0), cached_start_height(0), cached_base(0), cached_m10_hash(crypto::null_hash), cached_top_hash(crypto::null_hash), cached(false) {}
-      } d;
-      const boost::unique_lock<boost::mutex> lock(d.mutex);
-
-      crypto::hash top_hash = crypto::null_hash;
-      if (d.cached_to < blockchain_height)
-        top_hash = get_hash(d.cached_to);
-      if (d.cached && amount == 0 && d.cached_from == from_height && d.cached_to == to_height && d.cached_top_hash == top_hash)
-        return process_distribution(cumulative, d.cached_start_height, d.cached_distribution, d.cached_base);
-
+      // the blockchain keeps distributions cached per amount, so this is a slice of memory
       std::vector<std::uint64_t> distribution;
       std::uint64_t start_height, base;
-
-      // see if we can extend the cache - a common case
-      bool can_extend = d.cached && amount == 0 && d.cached_from == from_height && to_height > d.cached_to && top_hash == d.cached_top_hash;
-      if (!can_extend)
-      {
-        // we kept track of the hash 10 blocks below, if it exists, so if it matches,
-        // we can still pop the last 10 cached slots and try again
-        if (d.cached && amount == 0 && d.cached_from == from_height && d.cached_to - d.cached_from >= 10 && to_height > d.cached_to - 10)
-        {
-          crypto::hash hash10 = get_hash(d.cached_to - 10);
-          if (hash10 == d.cached_m10_hash)
-          {
-            d.cached_to -= 10;
-            d.cached_top_hash = hash10;
-            d.cached_m10_hash = crypto::null_hash;
-            CHECK_AND_ASSERT_MES(d.cached_distribution.size() >= 10, boost::none, "Cached distribution size does not match cached bounds");
-            for (int p = 0; p < 10; ++p)
-              d.cached_distribution.pop_back();
-            can_extend = true;
-          }
-        }
-      }
-      if (can_extend)
-      {
-        std::vector<std::uint64_t> new_distribution;
-        if (!f(amount, d.cached_to + 1, to_height, start_height, new_distribution, base))
-          return boost::none;
-        distribution = d.cached_distribution;
-        distribution.reserve(distribution.size() + new_distribution.size());
-        for (const auto &e: new_distribution)
-          distribution.push_back(e);
-        start_height = d.cached_start_height;
-        base = d.cached_base;
-      }
-      else
-      {
-        if (!f(amount, from_height, to_height, start_height, distribution, base))
-          return boost::none;
-      }
+      if (!f(amount, from_height, to_height, start_height, distribution, base))
+        return boost::none;
 
       if (to_height > 0 && to_height >= from_height)
       {
@@ -95,19 +42,26 @@ namespace rpc
           distribution.resize(to_height - offset + 1);
       }
 
-      if (amount == 0)
-      {
-        d.cached_from = from_height;
-        d.cached_to = to_height;
-        d.cached_top_hash = get_hash(d.cached_to);
-        d.cached_m10_hash = d.cached_to >= 10 ? get_hash(d.cached_to - 10) : crypto::null_hash;
-        d.cached_distribution = distribution;
-        d.cached_start_height = start_height;
-        d.cached_base = base;
-        d.cached = true;
-      }
-
       return process_distribution(cumulative, start_height, std::move(distribution), base);
   }
+
+  std::string RpcHandler::get_block_template_id(const crypto::hash &prev_id, uint64_t expected_reward)
+  {
+    const uint64_t reward_le = SWAP64LE(expected_reward);
+    std::string blob(reinterpret_cast<const char*>(&prev_id), sizeof(prev_id));
+    blob.append(reinterpret_cast<const char*>(&reward_le), sizeof(reward_le));
+    return epee::string_tools::buff_to_hex_nodelimer(blob);
+  }
+
+  bool RpcHandler::parse_block_template_id(const std::string &template_id, crypto::hash &prev_id, uint64_t &expected_reward)
+  {
+    std::string blob;
+    if (!epee::string_tools::parse_hexstr_to_binbuff(template_id, blob) || blob.size() != sizeof(prev_id) + sizeof(expected_reward))
+      return false;
+    memcpy(&prev_id, blob.data(), sizeof(prev_id));
+    memcpy(&expected_reward, blob.data() + sizeof(prev_id), sizeof(expected_reward));
+    expected_reward = SWAP64LE(expected_reward);
+    return true;
+  }
 } // rpc
 } // cryptonote
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <boost/optional/optional.hpp>
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -57,8 +58,23 @@ class RpcHandler
 
     virtual epee::byte_slice handle(const std::string& request) = 0;
 
+    /**
+     * @brief wait for a block template better than the one identified by template_id
+     *
+     * @param template_id the last template published, empty for none; updated on success
+     * @param message filled with the new template on success
+     * @param timeout how long to wait at most
+     *
+     * @return true if a new template was produced, false on timeout or if not supported
+     */
+    virtual bool next_block_template(std::string& template_id, std::string& message, std::chrono::milliseconds timeout) { return false; }
+
     static boost::optional<output_distribution_data>
-      get_output_distribution(const std::function<bool(uint64_t, uint64_t, uint64_t, uint64_t&, std::vector<uint64_t>&, uint64_t&)> &f, uint64_t amount, uint64_t from_height, uint64_t to_height, const std::function<crypto::hash(uint64_t)> &get_hash, bool cumulative, uint64_t blockchain_height);
+      get_output_distribution(const std::function<bool(uint64_t, uint64_t, uint64_t, uint64_t&, std::vector<uint64_t>&, uint64_t&)> &f, uint64_t amount, uint64_t from_height, uint64_t to_height, bool cumulative);
+
+    //! opaque id of a block template: what long-poll callers hand back to wait for a better one
+    static std::string get_block_template_id(const crypto::hash &prev_id, uint64_t expected_reward);
+    static bool parse_block_template_id(const std::string &template_id, crypto::hash &prev_id, uint64_t &expected_reward);
 };
 
 
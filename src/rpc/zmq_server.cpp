@@ -42,6 +42,22 @@ namespace
   constexpr const int num_zmq_threads = 1;
   constexpr const std::int64_t max_message_size = 10 * 1024 * 1024; // 10 MiB
   constexpr const std::chrono::seconds linger_timeout{2}; // wait period for pending out messages
+  constexpr const std::chrono::seconds publish_poll_interval{1}; // how often the publisher checks for shutdown
+  constexpr const char block_template_topic[] = "json-full-block_template:";
+
+  std::string make_tcp_address(boost::string_ref address, boost::string_ref port)
+  {
+    if (address.empty())
+      address = "*";
+    if (port.empty())
+      port = "*";
+
+    std::string bind_address = "tcp://";
+    bind_address.append(address.data(), address.size());
+    bind_address += ":";
+    bind_address.append(port.data(), port.size());
+    return bind_address;
+  }
 }
 
 namespace rpc
@@ -49,7 +65,8 @@ namespace rpc
 
 ZmqServer::ZmqServer(RpcHandler& h) :
     handler(h),
-    context(zmq_init(num_zmq_threads))
+    context(zmq_init(num_zmq_threads)),
+    stopping(false)
 {
     if (!context)
         MONERO_ZMQ_THROW("Unable to create ZMQ context");
@@ -131,16 +148,7 @@ bool ZmqServer::addTCPSocket(boost::string_ref address, boost::string_ref port)
     return false;
   }
 
-  if (address.empty())
-    address = "*";
-  if (port.empty())
-    port = "*";
-
-  std::string bind_address = "tcp://";
-  bind_address.append(address.data(), address.size());
-  bind_address += ":";
-  bind_address.append(port.data(), port.size());
-
+  const std::string bind_address = make_tcp_address(address, port);
   if (zmq_bind(rep_socket.get(), bind_address.c_str()) < 0)
   {
     MONERO_LOG_ZMQ_ERROR("ZMQ RPC Server bind failed");
@@ -149,9 +157,79 @@ bool ZmqServer::addTCPSocket(boost::string_ref address, boost::string_ref port)
   return true;
 }
 
+bool ZmqServer::addPubSocket(boost::string_ref address, boost::string_ref port)
+{
+  if (!context)
+  {
+    MERROR("ZMQ RPC Server already shutdown");
+    return false;
+  }
+
+  pub_socket.reset(zmq_socket(context.get(), ZMQ_PUB));
+  if (!pub_socket)
+  {
+    MONERO_LOG_ZMQ_ERROR("ZMQ publish socket create failed");
+    return false;
+  }
+
+  static constexpr const int linger_value = std::chrono::milliseconds{linger_timeout}.count();
+  if (zmq_setsockopt(pub_socket.get(), ZMQ_LINGER, std::addressof(linger_value), sizeof(linger_value)) != 0)
+  {
+    MONERO_LOG_ZMQ_ERROR("Failed to set linger timeout");
+    return false;
+  }
+
+  const std::string bind_address = make_tcp_address(address, port);
+  if (zmq_bind(pub_socket.get(), bind_address.c_str()) < 0)
+  {
+    MONERO_LOG_ZMQ_ERROR("ZMQ publish socket bind failed");
+    return false;
+  }
+  return true;
+}
+
+void ZmqServer::publish()
+{
+  try
+  {
+    // socket must close before `zmq_term` will exit.
+    const net::zmq::socket socket = std::move(pub_socket);
+
+    // subscribers only hear about templates that differ meaningfully from the last one sent
+    std::string template_id;
+    while (!stopping)
+    {
+      std::string message;
+      if (!handler.next_block_template(template_id, message, publish_poll_interval))
+      {
+        // a timeout already waited; this only throttles retries after a failed build
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+        continue;
+      }
+      MDEBUG("Publishing block template " << template_id);
+      MONERO_UNWRAP(net::zmq::send(epee::byte_slice{std::string{block_template_topic} + message}, socket.get()));
+    }
+  }
+  catch (const std::system_error& e)
+  {
+    if (e.code() != net::zmq::make_error_code(ETERM))
+      MERROR("ZMQ publisher error: " << e.what());
+  }
+  catch (const std::exception& e)
+  {
+    MERROR("ZMQ publisher error: " << e.what());
+  }
+  catch (...)
+  {
+    MERROR("Unknown error in ZMQ publisher");
+  }
+}
+
 void ZmqServer::run()
 {
   run_thread = boost::thread(boost::bind(&ZmqServer::serve, this));
+  if (pub_socket)
+    pub_thread = boost::thread(boost::bind(&ZmqServer::publish, this));
 }
 
 void ZmqServer::stop()
@@ -159,8 +237,11 @@ void ZmqServer::stop()
   if (!run_thread.joinable())
     return;
 
+  stopping = true;
   context.reset(); // destroying context terminates all calls
   run_thread.join();
+  if (pub_thread.joinable())
+    pub_thread.join();
 }
 
 
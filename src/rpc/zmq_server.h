@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <boost/thread/thread.hpp>
 #include <boost/utility/string_ref.hpp>
 
@@ -52,10 +53,14 @@ class ZmqServer
     static void init_options(boost::program_options::options_description& desc);
 
     void serve();
+    void publish();
 
     bool addIPCSocket(boost::string_ref address, boost::string_ref port);
     bool addTCPSocket(boost::string_ref address, boost::string_ref port);
 
+    //! bind a PUB socket on which new block templates are published as the handler produces them
+    bool addPubSocket(boost::string_ref address, boost::string_ref port);
+
     void run();
     void stop();
 
@@ -65,8 +70,11 @@ class ZmqServer
     net::zmq::context context;
 
     boost::thread run_thread;
+    boost::thread pub_thread;
+    std::atomic<bool> stopping;
 
     net::zmq::socket rep_socket;
+    net::zmq::socket pub_socket;
 };
 
 
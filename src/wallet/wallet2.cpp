@@ -134,6 +134,12 @@ using namespace cryptonote;
 
 #define FIRST_REFRESH_GRANULARITY     1024
 
+#define KEY_DERIVATION_BATCH_SIZE 64 // tx pubkeys derived per device call while refreshing
+#define OUTPUT_SCAN_BATCH_TXES 32 // txes whose outputs are checked per device call while refreshing
+
+#define BLOCK_FILTER_PAGE_SIZE 1000 // block filters asked for per request
+#define BLOCK_FILTER_MIN_SKIP 20 // fewer unflagged blocks than this aren't worth skipping over
+
 #define GAMMA_SHAPE 19.28
 #define GAMMA_SCALE (1/1.61)
 
@@ -1146,6 +1152,7 @@ wallet_keys_unlocker::wallet_keys_unlocker(wallet2 &w, const boost::optional<too
     m_refresh_type(RefreshOptimizeCoinbase),
     m_auto_refresh(true),
     m_first_refresh_done(false),
+    m_refresh_stop_height(0),
     m_refresh_from_block_height(0),
     m_explicit_refresh_from_block_height(true),
     m_confirm_non_default_ring_size(true),
@@ -1164,6 +1171,7 @@ wallet_keys_unlocker::wallet_keys_unlocker(wallet2 &w, const boost::optional<too
     m_ignore_outputs_above(MONEY_SUPPLY),
     m_ignore_outputs_below(0),
     m_track_uses(false),
+    m_use_block_filters(false),
     m_inactivity_lock_timeout(DEFAULT_INACTIVITY_LOCK_TIMEOUT),
     m_setup_background_mining(BackgroundMiningMaybe),
     m_persistent_rpc_client_id(false),
@@ -2656,7 +2664,7 @@ void wallet2::parse_block_round(const cryptonote::blobdata &blob, cryptonote::bl
   error = !cryptonote::parse_and_validate_block_from_blob(blob, bl, bl_id);
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::pull_blocks(uint64_t start_height, uint64_t &blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, uint64_t &current_height)
+void wallet2::pull_blocks(uint64_t start_height, uint64_t &blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, uint64_t &current_height, uint64_t max_block_count)
 {
   cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::request req = AUTO_VAL_INIT(req);
   cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response res = AUTO_VAL_INIT(res);
@@ -2667,6 +2675,7 @@ void wallet2::pull_blocks(uint64_t start_height, uint64_t &blocks_start_height,
   req.prune = true;
   req.start_height = start_height;
   req.no_miner_tx = m_refresh_type == RefreshNoCoinbase;
+  req.max_block_count = max_block_count;
 
   {
     const boost::lock_guard<boost::recursive_mutex> lock{m_daemon_rpc_mutex};
@@ -2753,50 +2762,109 @@ void wallet2::process_parsed_blocks(uint64_t start_height, const std::vector<cry
   hwdev.set_mode(hw::device::TRANSACTION_PARSE);
   const cryptonote::account_keys &keys = m_account.get_keys();
 
-  auto gender = [&](wallet2::is_out_data &iod) {
-    if (!hwdev.generate_key_derivation(iod.pkey, keys.m_view_secret_key, iod.derivation))
-    {
-      MWARNING("Failed to generate key derivation from tx pubkey, skipping");
-      static_assert(sizeof(iod.derivation) == sizeof(rct::key), "Mismatched sizes of key_derivation and rct::key");
-      memcpy(&iod.derivation, rct::identity().bytes, sizeof(iod.derivation));
-    }
-  };
-
-  for (size_t i = 0; i < tx_cache_data.size(); ++i)
+  // derive in batches, which lets the software device share work between keys
+  std::vector<wallet2::is_out_data*> iods;
+  for (auto &slot: tx_cache_data)
   {
-    if (tx_cache_data[i].empty())
-      continue;
-    tpool.submit(&waiter, [&hwdev, &gender, &tx_cache_data, i]() {
-      auto &slot = tx_cache_data[i];
-      boost::unique_lock<hw::device> hwdev_lock(hwdev);
-      for (auto &iod: slot.primary)
-        gender(iod);
-      for (auto &iod: slot.additional)
-        gender(iod);
+    for (auto &iod: slot.primary)
+      iods.push_back(&iod);
+    for (auto &iod: slot.additional)
+      iods.push_back(&iod);
+  }
+  const size_t threads = std::max<size_t>(1, tpool.get_max_concurrency());
+  const size_t derivation_batch = std::max<size_t>(1, std::min<size_t>(KEY_DERIVATION_BATCH_SIZE, (iods.size() + threads - 1) / threads));
+  for (size_t begin = 0; begin < iods.size(); begin += derivation_batch)
+  {
+    const size_t end = std::min(iods.size(), begin + derivation_batch);
+    tpool.submit(&waiter, [&hwdev, &keys, &iods, begin, end]() {
+      std::vector<crypto::public_key> pkeys;
+      pkeys.reserve(end - begin);
+      for (size_t n = begin; n < end; ++n)
+        pkeys.push_back(iods[n]->pkey);
+      std::vector<crypto::key_derivation> derivations;
+      std::vector<bool> valid;
+      {
+        boost::unique_lock<hw::device> hwdev_lock(hwdev);
+        if (!hwdev.generate_key_derivations(pkeys, keys.m_view_secret_key, derivations, valid))
+          valid.assign(pkeys.size(), false);
+      }
+      for (size_t n = begin; n < end; ++n)
+      {
+        wallet2::is_out_data &iod = *iods[n];
+        if (valid[n - begin])
+        {
+          iod.derivation = derivations[n - begin];
+          continue;
+        }
+        MWARNING("Failed to generate key derivation from tx pubkey, skipping");
+        static_assert(sizeof(iod.derivation) == sizeof(rct::key), "Mismatched sizes of key_derivation and rct::key");
+        memcpy(&iod.derivation, rct::identity().bytes, sizeof(iod.derivation));
+      }
     }, true);
   }
   waiter.wait(&tpool);
 
-  auto geniod = [&](const cryptonote::transaction &tx, size_t n_vouts, size_t txidx) {
-    for (size_t k = 0; k < n_vouts; ++k)
-    {
-      const auto &o = tx.vout[k];
-      if (o.target.type() == typeid(cryptonote::txout_to_key))
-      {
-        std::vector<crypto::key_derivation> additional_derivations;
-        additional_derivations.reserve(tx_cache_data[txidx].additional.size());
-        for (const auto &iod: tx_cache_data[txidx].additional)
-          additional_derivations.push_back(iod.derivation);
-        const auto &key = boost::get<txout_to_key>(o.target).key;
-        for (size_t l = 0; l < tx_cache_data[txidx].primary.size(); ++l)
+  // the txes whose outputs to check, and how many outputs of each
+  struct output_scan
+  {
+    const cryptonote::transaction *tx;
+    size_t n_vouts;
+    size_t txidx;
+  };
+  std::vector<output_scan> output_scans;
+  output_scans.reserve(tx_cache_data.size());
+
+  // checks all the outputs of output_scans[begin, end) in one device call, trying
+  // the additional derivation only with the first tx pubkey, as is_out_to_acc_precomp does
+  auto geniod = [&](size_t begin, size_t end) {
+    std::vector<crypto::public_key> out_keys;
+    std::vector<crypto::key_derivation> derivations;
+    std::vector<size_t> output_indices;
+    auto for_each_check = [&](const std::function<void(const crypto::public_key&, const crypto::key_derivation&, size_t, boost::optional<cryptonote::subaddress_receive_info>&)> &check) {
+      for (size_t s = begin; s < end; ++s)
+      {
+        const output_scan &scan = output_scans[s];
+        auto &cache = tx_cache_data[scan.txidx];
+        for (size_t l = 0; l < cache.primary.size(); ++l)
         {
-          THROW_WALLET_EXCEPTION_IF(tx_cache_data[txidx].primary[l].received.size() != n_vouts,
+          THROW_WALLET_EXCEPTION_IF(cache.primary[l].received.size() != scan.n_vouts,
               error::wallet_internal_error, "Unexpected received array size");
-          tx_cache_data[txidx].primary[l].received[k] = is_out_to_acc_precomp(m_subaddresses, key, tx_cache_data[txidx].primary[l].derivation, additional_derivations, k, hwdev);
-          additional_derivations.clear();
+          for (size_t k = 0; k < scan.n_vouts; ++k)
+          {
+            const auto &o = scan.tx->vout[k];
+            if (o.target.type() != typeid(cryptonote::txout_to_key))
+              continue;
+            const auto &key = boost::get<txout_to_key>(o.target).key;
+            auto &received = cache.primary[l].received[k];
+            check(key, cache.primary[l].derivation, k, received);
+            if (l == 0 && k < cache.additional.size())
+              check(key, cache.additional[k].derivation, k, received);
+          }
         }
       }
+    };
+
+    for_each_check([&](const crypto::public_key &key, const crypto::key_derivation &derivation, size_t k, boost::optional<cryptonote::subaddress_receive_info>&) {
+      out_keys.push_back(key);
+      derivations.push_back(derivation);
+      output_indices.push_back(k);
+    });
+    std::vector<crypto::public_key> derived;
+    std::vector<bool> valid;
+    {
+      boost::unique_lock<hw::device> hwdev_lock(hwdev);
+      if (!hwdev.derive_subaddress_public_keys(out_keys, derivations, output_indices, derived, valid))
+        valid.assign(out_keys.size(), false);
     }
+    size_t n = 0;
+    for_each_check([&](const crypto::public_key&, const crypto::key_derivation &derivation, size_t, boost::optional<cryptonote::subaddress_receive_info> &received) {
+      const size_t idx = n++;
+      if (received || !valid[idx])
+        return;
+      auto found = m_subaddresses.find(derived[idx]);
+      if (found != m_subaddresses.end())
+        received = cryptonote::subaddress_receive_info{ found->second, derivation };
+    });
   };
 
   txidx = 0;
@@ -2812,17 +2880,23 @@ void wallet2::process_parsed_blocks(uint64_t start_height, const std::vector<cry
     {
       THROW_WALLET_EXCEPTION_IF(txidx >= tx_cache_data.size(), error::wallet_internal_error, "txidx out of range");
       const size_t n_vouts = m_refresh_type == RefreshType::RefreshOptimizeCoinbase ? 1 : parsed_blocks[i].block.miner_tx.vout.size();
-      tpool.submit(&waiter, [&, i, n_vouts, txidx](){ geniod(parsed_blocks[i].block.miner_tx, n_vouts, txidx); }, true);
+      output_scans.push_back({&parsed_blocks[i].block.miner_tx, n_vouts, txidx});
     }
     ++txidx;
     for (size_t j = 0; j < parsed_blocks[i].txes.size(); ++j)
     {
       THROW_WALLET_EXCEPTION_IF(txidx >= tx_cache_data.size(), error::wallet_internal_error, "txidx out of range");
-      tpool.submit(&waiter, [&, i, j, txidx](){ geniod(parsed_blocks[i].txes[j], parsed_blocks[i].txes[j].vout.size(), txidx); }, true);
+      output_scans.push_back({&parsed_blocks[i].txes[j], parsed_blocks[i].txes[j].vout.size(), txidx});
       ++txidx;
     }
   }
   THROW_WALLET_EXCEPTION_IF(txidx != tx_cache_data.size(), error::wallet_internal_error, "txidx did not reach expected value");
+  const size_t scan_batch = std::max<size_t>(1, std::min<size_t>(OUTPUT_SCAN_BATCH_TXES, (output_scans.size() + threads - 1) / threads));
+  for (size_t begin = 0; begin < output_scans.size(); begin += scan_batch)
+  {
+    const size_t end = std::min(output_scans.size(), begin + scan_batch);
+    tpool.submit(&waiter, [&, begin, end](){ geniod(begin, end); }, true);
+  }
   waiter.wait(&tpool);
   hwdev.set_mode(hw::device::NONE);
 
@@ -2891,7 +2965,15 @@ void wallet2::pull_and_parse_next_blocks(uint64_t start_height, uint64_t &blocks
     // pull the new blocks
     std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> o_indices;
     uint64_t current_height;
-    pull_blocks(start_height, blocks_start_height, short_chain_history, blocks, o_indices, current_height);
+    uint64_t max_block_count = 0;
+    if (m_refresh_stop_height)
+    {
+      // the daemon starts from the newest block we already have
+      uint64_t from = prev_parsed_blocks.empty() ? m_blockchain.size() - 1 : cryptonote::get_block_height(prev_parsed_blocks.back().block);
+      from = std::max(from, start_height);
+      max_block_count = m_refresh_stop_height > from ? m_refresh_stop_height - from : 1;
+    }
+    pull_blocks(start_height, blocks_start_height, short_chain_history, blocks, o_indices, current_height, max_block_count);
     THROW_WALLET_EXCEPTION_IF(blocks.size() != o_indices.size(), error::wallet_internal_error, "Mismatched sizes of blocks and o_indices");
 
     tools::threadpool& tpool = tools::threadpool::getInstance();
@@ -2929,7 +3011,11 @@ void wallet2::pull_and_parse_next_blocks(uint64_t start_height, uint64_t &blocks
       }
     }
     waiter.wait(&tpool);
-    last = !blocks.empty() && cryptonote::get_block_height(parsed_blocks.back().block) + 1 == current_height;
+    if (!blocks.empty())
+    {
+      const uint64_t next_height = cryptonote::get_block_height(parsed_blocks.back().block) + 1;
+      last = next_height == current_height || (m_refresh_stop_height && next_height >= m_refresh_stop_height);
+    }
   }
   catch(...)
   {
@@ -3267,6 +3353,154 @@ void wallet2::fast_refresh(uint64_t stop_height, uint64_t &blocks_start_height,
     }
   }
 }
+//----------------------------------------------------------------------------------------------------
+bool wallet2::block_filter_may_match(const cryptonote::block_filter &filter, const std::unordered_set<uint64_t> &key_image_fingerprints) const
+{
+  hw::device &hwdev = m_account.get_device();
+  const cryptonote::account_keys &keys = m_account.get_keys();
+  auto derive = [&](const crypto::public_key &pkey, crypto::key_derivation &derivation) {
+    if (!hwdev.generate_key_derivation(pkey, keys.m_view_secret_key, derivation))
+    {
+      MWARNING("Failed to generate key derivation from tx pubkey, skipping");
+      static_assert(sizeof(derivation) == sizeof(rct::key), "Mismatched sizes of key_derivation and rct::key");
+      memcpy(&derivation, rct::identity().bytes, sizeof(derivation));
+    }
+  };
+
+  for (size_t t = 0; t < filter.txs.size(); ++t)
+  {
+    const cryptonote::block_filter::tx_entry &tx = filter.txs[t];
+    for (uint64_t fp: tx.key_image_fingerprints)
+      if (key_image_fingerprints.find(fp) != key_image_fingerprints.end())
+        return true;
+
+    // the miner tx comes first, and we don't look at it at all in that mode
+    if (t == 0 && m_refresh_type == RefreshNoCoinbase)
+      continue;
+
+    std::vector<crypto::key_derivation> additional_derivations(tx.additional_tx_pub_keys.size());
+    for (size_t i = 0; i < tx.additional_tx_pub_keys.size(); ++i)
+      derive(tx.additional_tx_pub_keys[i], additional_derivations[i]);
+
+    // as in process_parsed_blocks, additional keys only go with the first tx pubkey
+    for (const crypto::public_key &pkey: tx.tx_pub_keys)
+    {
+      crypto::key_derivation derivation;
+      derive(pkey, derivation);
+      for (size_t i = 0; i < tx.output_keys.size(); ++i)
+      {
+        if (tx.output_keys[i] == crypto::null_pkey)
+          continue;
+        if (is_out_to_acc_precomp(m_subaddresses, tx.output_keys[i], derivation, additional_derivations, i, hwdev))
+          return true;
+      }
+      additional_derivations.clear();
+    }
+  }
+  return false;
+}
+//----------------------------------------------------------------------------------------------------
+uint64_t wallet2::skip_blocks_with_filters(std::list<crypto::hash> &short_chain_history)
+{
+  uint64_t stop_height = 0;
+  try
+  {
+    // partial key images mean we can't tell a multisig wallet's spends from the filters
+    if (m_multisig || m_light_wallet)
+      return 0;
+
+    uint32_t rpc_version;
+    boost::optional<std::string> result = m_node_rpc_proxy.get_rpc_version(rpc_version);
+    if (result || rpc_version < MAKE_CORE_RPC_VERSION(3, 7))
+    {
+      MDEBUG("Daemon does not serve block filters, refreshing normally");
+      return 0;
+    }
+    uint64_t daemon_height;
+    result = m_node_rpc_proxy.get_height(daemon_height);
+    if (result || daemon_height < m_blockchain.size() + BLOCK_FILTER_MIN_SKIP)
+      return 0;
+
+    std::unordered_set<uint64_t> key_image_fingerprints;
+    key_image_fingerprints.reserve(m_key_images.size());
+    for (const auto &ki: m_key_images)
+      key_image_fingerprints.insert(cryptonote::get_key_image_fingerprint(ki.first));
+
+    hw::device &hwdev = m_account.get_device();
+    hw::reset_mode rst(hwdev);
+    hwdev.set_mode(hw::device::TRANSACTION_PARSE);
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+
+    while (m_run.load(std::memory_order_relaxed) && !stop_height)
+    {
+      // ask from our top block so we notice if the daemon is on another chain
+      cryptonote::COMMAND_RPC_GET_BLOCK_FILTERS::request req = AUTO_VAL_INIT(req);
+      cryptonote::COMMAND_RPC_GET_BLOCK_FILTERS::response res = AUTO_VAL_INIT(res);
+      req.start_height = m_blockchain.size() - 1;
+      req.count = BLOCK_FILTER_PAGE_SIZE;
+      {
+        const boost::lock_guard<boost::recursive_mutex> lock{m_daemon_rpc_mutex};
+        uint64_t pre_call_credits = m_rpc_payment_state.credits;
+        req.client = get_client_signature();
+        bool r = net_utils::invoke_http_bin("/get_block_filters.bin", req, res, *m_http_client, rpc_timeout);
+        THROW_ON_RPC_RESPONSE_ERROR(r, {}, res, "get_block_filters.bin", error::get_blocks_error, get_rpc_status(res.status));
+        const uint64_t built_count = std::min<uint64_t>(res.built_count, res.filters.size());
+        check_rpc_cost("/get_block_filters.bin", res.credits, pre_call_credits, 1 + (res.filters.size() - built_count) * COST_PER_BLOCK_FILTER + built_count * COST_PER_BLOCK);
+      }
+
+      std::vector<cryptonote::block_filter> filters(res.filters.size());
+      for (size_t i = 0; i < res.filters.size(); ++i)
+        THROW_WALLET_EXCEPTION_IF(!cryptonote::parse_block_filter(res.filters[i], filters[i]), error::wallet_internal_error, "Failed to parse block filter");
+      if (filters.size() < 2 || res.start_height != req.start_height || filters[0].block_hash != m_blockchain[req.start_height])
+        break;
+
+      std::unique_ptr<bool[]> match(new bool[filters.size()]);
+      for (size_t i = 1; i < filters.size(); ++i)
+      {
+        tpool.submit(&waiter, [&, i](){
+          boost::unique_lock<hw::device> hwdev_lock(hwdev);
+          match[i] = block_filter_may_match(filters[i], key_image_fingerprints);
+        }, true);
+      }
+      waiter.wait(&tpool);
+
+      size_t n = 1;
+      for (; n < filters.size() && !match[n]; ++n)
+      {
+        m_blockchain.push_back(filters[n].block_hash);
+        if (0 != m_callback)
+        { // FIXME: this isn't right, but simplewallet just logs that we got a block.
+          cryptonote::block dummy;
+          m_callback->on_new_block(req.start_height + n, dummy);
+        }
+      }
+      if (n == filters.size())
+        continue;
+
+      // fetch the flagged block in full, along with any others flagged soon after it
+      size_t end = n + 1;
+      for (size_t k = end; k < filters.size() && k < end + BLOCK_FILTER_MIN_SKIP; ++k)
+        if (match[k])
+          end = k + 1;
+      stop_height = req.start_height + end;
+      MDEBUG("Block filters skipped to height " << m_blockchain.size() << ", fetching blocks up to " << stop_height);
+    }
+  }
+  catch (const error::payment_required&)
+  {
+    throw;
+  }
+  catch (const std::exception &e)
+  {
+    MWARNING("Failed to skip blocks with filters, refreshing normally: " << e.what());
+    stop_height = 0;
+  }
+
+  short_chain_history.clear();
+  get_short_chain_history(short_chain_history);
+  return stop_height;
+}
 
 
 bool wallet2::add_address_book_row(const cryptonote::account_public_address &address, const crypto::hash8 *payment_id, const std::string &description, bool is_subaddress)
@@ -3392,6 +3626,11 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
     // and then fall through to regular refresh processing
   }
 
+  // skip over blocks the daemon's filters show can't involve us
+  m_refresh_stop_height = 0;
+  if (m_use_block_filters && start_height == 0 && m_run.load(std::memory_order_relaxed))
+    m_refresh_stop_height = skip_blocks_with_filters(short_chain_history);
+
   // If stop() is called during fast refresh we don't need to continue
   if(!m_run.load(std::memory_order_relaxed))
     return;
@@ -3434,6 +3673,14 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
       added_blocks = 0;
       if (!first && blocks.empty())
       {
+        if (m_refresh_stop_height)
+        {
+          // done with the blocks the filters flagged, look for the next ones
+          m_refresh_stop_height = skip_blocks_with_filters(short_chain_history);
+          first = true;
+          last = false;
+          continue;
+        }
         m_node_rpc_proxy.set_height(m_blockchain.size());
         break;
       }
@@ -3940,6 +4187,9 @@ boost::optional<wallet2::keys_file_data> wallet2::get_keys_file_data(const epee:
   value2.SetInt(m_track_uses ? 1 : 0);
   json.AddMember("track_uses", value2, json.GetAllocator());
 
+  value2.SetInt(m_use_block_filters ? 1 : 0);
+  json.AddMember("use_block_filters", value2, json.GetAllocator());
+
   value2.SetInt(m_inactivity_lock_timeout);
   json.AddMember("inactivity_lock_timeout", value2, json.GetAllocator());
 
@@ -4123,6 +4373,7 @@ bool wallet2::load_keys_buf(const std::string& keys_buf, const epee::wipeable_st
     m_ignore_outputs_above = MONEY_SUPPLY;
     m_ignore_outputs_below = 0;
     m_track_uses = false;
+    m_use_block_filters = false;
     m_inactivity_lock_timeout = DEFAULT_INACTIVITY_LOCK_TIMEOUT;
     m_setup_background_mining = BackgroundMiningMaybe;
     m_subaddress_lookahead_major = SUBADDRESS_LOOKAHEAD_MAJOR;
@@ -4294,6 +4545,8 @@ bool wallet2::load_keys_buf(const std::string& keys_buf, const epee::wipeable_st
     m_ignore_outputs_below = field_ignore_outputs_below;
     GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, track_uses, int, Int, false, false);
     m_track_uses = field_track_uses;
+    GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, use_block_filters, int, Int, false, false);
+    m_use_block_filters = field_use_block_filters;
     GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, inactivity_lock_timeout, uint32_t, Uint, false, DEFAULT_INACTIVITY_LOCK_TIMEOUT);
     m_inactivity_lock_timeout = field_inactivity_lock_timeout;
     GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, setup_background_mining, BackgroundMiningSetupType, Int, false, BackgroundMiningMaybe);
@@ -65,6 +65,7 @@ public:
                         , const cryptonote::difficulty_type& cumulative_difficulty
                         , const uint64_t& coins_generated
                         , uint64_t num_rct_outs
+                        , const cryptonote::block_emission_totals& emission
                         , const crypto::hash& blk_hash
                         ) override {
     blocks.push_back({block_weight, long_term_block_weight});
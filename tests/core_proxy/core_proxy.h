@@ -99,6 +99,8 @@ namespace tests
     bool get_blocks(uint64_t start_offset, size_t count, std::vector<std::pair<cryptonote::blobdata, cryptonote::block>>& blocks, std::vector<cryptonote::blobdata>& txs) const { return false; }
     bool get_transactions(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::transaction>& txs, std::vector<crypto::hash>& missed_txs) const { return false; }
     bool get_block_by_hash(const crypto::hash &h, cryptonote::block &blk, bool *orphan = NULL) const { return false; }
+    bool get_block_blob_and_tx_hashes(const crypto::hash &blkid, cryptonote::blobdata &block_blob, std::vector<crypto::hash> &tx_hashes) const { return false; }
+    bool get_stored_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs) const { return false; }
     uint8_t get_ideal_hard_fork_version() const { return 0; }
     uint8_t get_ideal_hard_fork_version(uint64_t height) const { return 0; }
     uint8_t get_hard_fork_version(uint64_t height) const { return 0; }
@@ -108,6 +110,7 @@ namespace tests
     // TODO(triton): Write tests
     virtual void set_deregister_votes_relayed(const std::vector<triton::service_node_deregister::vote>& votes) {}
     bool add_deregister_vote(const triton::service_node_deregister::vote& vote, cryptonote::vote_verification_context &vvc) { return false; }
+    bool verify_deregister_vote_signatures(const std::vector<triton::service_node_deregister::vote>& votes) const { return false; }
     uint64_t prevalidate_block_hashes(uint64_t height, const std::vector<crypto::hash> &hashes, const std::vector<uint64_t> &weights) { return 0; }
     bool has_block_weights(uint64_t height, uint64_t nblocks) const { return false; }
     bool is_within_compiled_block_hash_area(uint64_t height) const { return false; }
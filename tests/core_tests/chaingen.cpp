@@ -87,6 +87,7 @@ namespace
         , const cryptonote::difficulty_type& cumulative_difficulty
         , const uint64_t& coins_generated
         , uint64_t num_rct_outs
+        , const cryptonote::block_emission_totals& emission
         , const crypto::hash& blk_hash
     ) override
     {
@@ -33,6 +33,7 @@
 #include "common/util.h"
 #include "common/command_line.h"
 #include "tx_pool.h"
+#include "get_blocks.h"
 #include "transaction_tests.h"
 
 namespace po = boost::program_options;
@@ -164,6 +165,9 @@ int main(int argc, char* argv[])
     GENERATE_AND_PLAY(txpool_double_spend_keyimage);
     GENERATE_AND_PLAY(txpool_stem_loop);
 
+    // Wallet sync RPC
+    GENERATE_AND_PLAY(gen_get_blocks_fast);
+
     // Double spend
     GENERATE_AND_PLAY(gen_double_spend_in_tx<false>);
     GENERATE_AND_PLAY(gen_double_spend_in_tx<true>);
@@ -0,0 +1,181 @@
+// Copyright (c) 2019, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "get_blocks.h"
+
+namespace
+{
+  typedef std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata>>>> block_list;
+}
+
+gen_get_blocks_fast::gen_get_blocks_fast()
+{
+  REGISTER_CALLBACK_METHOD(gen_get_blocks_fast, check_get_blocks_fast);
+  REGISTER_CALLBACK_METHOD(gen_get_blocks_fast, check_get_blocks_bin);
+}
+
+bool gen_get_blocks_fast::generate(std::vector<test_event_entry>& events) const
+{
+  uint64_t ts_start = 1338224400;
+
+  GENERATE_ACCOUNT(miner);
+  GENERATE_ACCOUNT(alice);
+
+  // blocks with several txes, one tx and none, so the output indices of
+  // blocks without txes sit between those of blocks with them
+  MAKE_GENESIS_BLOCK(events, blk_0, miner, ts_start);
+  REWIND_BLOCKS(events, blk_0r, blk_0, miner);
+  MAKE_TX_LIST_START(events, txlist_0, miner, alice, MK_COINS(1), blk_0);
+  MAKE_TX_LIST(events, txlist_0, miner, alice, MK_COINS(2), blk_0);
+  MAKE_TX_LIST(events, txlist_0, miner, alice, MK_COINS(4), blk_0);
+  MAKE_NEXT_BLOCK_TX_LIST(events, blk_1, blk_0r, miner, txlist_0);
+  REWIND_BLOCKS(events, blk_1r, blk_1, miner);
+  MAKE_TX(events, tx_0, miner, alice, MK_COINS(8), blk_1);
+  MAKE_NEXT_BLOCK_TX1(events, blk_2, blk_1r, miner, tx_0);
+  MAKE_NEXT_BLOCK(events, blk_3, blk_2, miner);
+
+  DO_CALLBACK(events, "check_get_blocks_fast");
+  DO_CALLBACK(events, "check_get_blocks_bin");
+
+  // a new top block must not be answered from the cache
+  MAKE_NEXT_BLOCK(events, blk_4, blk_3, miner);
+  DO_CALLBACK(events, "check_get_blocks_bin");
+
+  return true;
+}
+
+bool gen_get_blocks_fast::check_get_blocks_fast(cryptonote::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& /*events*/)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_get_blocks_fast::check_get_blocks_fast");
+
+  const cryptonote::Blockchain& bc = c.get_blockchain_storage();
+  const uint64_t height = bc.get_current_blockchain_height();
+  const crypto::hash top_id = bc.get_block_id_by_height(height - 1);
+  const std::list<crypto::hash> genesis_ids{bc.get_block_id_by_height(0)};
+
+  for (bool get_miner_tx : {true, false})
+  for (bool pruned : {false, true})
+  for (uint64_t req_start : {(uint64_t)0, (uint64_t)1, height - 4, height - 3, height - 1})
+  for (size_t max_count : {(size_t)1, (size_t)2, (size_t)1000})
+  {
+    const std::list<crypto::hash>& qblock_ids = req_start ? std::list<crypto::hash>() : genesis_ids;
+
+    block_list expected_blocks;
+    uint64_t expected_total_height, expected_start_height;
+    CHECK_TEST_CONDITION(bc.find_blockchain_supplement(req_start, qblock_ids, expected_blocks, expected_total_height, expected_start_height, pruned, get_miner_tx, max_count));
+
+    block_list blocks;
+    std::vector<std::vector<std::vector<uint64_t>>> output_indices;
+    uint64_t total_height, start_height;
+    crypto::hash top_hash;
+    CHECK_TEST_CONDITION(bc.get_blocks_fast(req_start, qblock_ids, blocks, output_indices, total_height, start_height, top_hash, pruned, get_miner_tx, max_count));
+
+    CHECK_EQ(expected_total_height, total_height);
+    CHECK_EQ(expected_start_height, start_height);
+    CHECK_EQ(top_id, top_hash);
+    CHECK_TEST_CONDITION(expected_blocks == blocks);
+    CHECK_EQ(blocks.size(), output_indices.size());
+
+    for (size_t n = 0; n < blocks.size(); ++n)
+    {
+      CHECK_EQ(1 + blocks[n].second.size(), output_indices[n].size());
+      // the miner tx entry stays empty when it wasn't asked for
+      std::vector<uint64_t> miner_indices;
+      if (get_miner_tx)
+        CHECK_TEST_CONDITION(bc.get_tx_outputs_gindexs(blocks[n].first.second, miner_indices));
+      CHECK_TEST_CONDITION(miner_indices == output_indices[n][0]);
+      for (size_t i = 0; i < blocks[n].second.size(); ++i)
+      {
+        std::vector<uint64_t> indices;
+        CHECK_TEST_CONDITION(bc.get_tx_outputs_gindexs(blocks[n].second[i].first, indices));
+        CHECK_TEST_CONDITION(indices == output_indices[n][1 + i]);
+      }
+    }
+  }
+
+  // a client already at our tip gets nothing
+  block_list blocks;
+  std::vector<std::vector<std::vector<uint64_t>>> output_indices;
+  uint64_t total_height, start_height;
+  crypto::hash top_hash;
+  CHECK_TEST_CONDITION(bc.get_blocks_fast(0, std::list<crypto::hash>{top_id}, blocks, output_indices, total_height, start_height, top_hash, false, true, 1000));
+  CHECK_EQ(height, total_height);
+  CHECK_EQ(0u, start_height);
+  CHECK_TEST_CONDITION(blocks.empty());
+
+  return true;
+}
+
+bool gen_get_blocks_fast::check_get_blocks_bin(cryptonote::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& /*events*/)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_get_blocks_fast::check_get_blocks_bin");
+
+  if (!m_rpc)
+  {
+    m_protocol.reset(new t_protocol(c, nullptr));
+    m_p2p.reset(new nodetool::node_server<t_protocol>(*m_protocol));
+    m_rpc.reset(new cryptonote::core_rpc_server(c, *m_p2p));
+  }
+
+  // near the tip, so the response is cached; the second request is served from it
+  const uint64_t height = c.get_blockchain_storage().get_current_blockchain_height();
+  for (bool no_miner_tx : {false, true})
+  {
+    cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::request req = AUTO_VAL_INIT(req);
+    req.start_height = height - 3;
+    req.prune = true;
+    req.no_miner_tx = no_miner_tx;
+    epee::net_utils::http::http_request_info query_info;
+    CHECK_TEST_CONDITION(epee::serialization::store_t_to_binary(req, query_info.m_body));
+
+    cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response expected = AUTO_VAL_INIT(expected);
+    CHECK_TEST_CONDITION(m_rpc->on_get_blocks(req, expected));
+    CHECK_EQ(3u, expected.blocks.size());
+    std::string expected_body;
+    CHECK_TEST_CONDITION(epee::serialization::store_t_to_binary(expected, expected_body));
+
+    for (int i = 0; i < 2; ++i)
+    {
+      epee::net_utils::http::http_response_info response_info;
+      response_info.m_response_code = 200;
+      CHECK_TEST_CONDITION(m_rpc->on_get_blocks_bin(query_info, response_info));
+      CHECK_EQ(200, response_info.m_response_code);
+      CHECK_TEST_CONDITION(response_info.m_body == expected_body);
+    }
+  }
+
+  // a body we can't parse is a bad request, not a missing endpoint
+  epee::net_utils::http::http_request_info query_info;
+  query_info.m_body = "not a portable storage blob";
+  epee::net_utils::http::http_response_info response_info;
+  response_info.m_response_code = 200;
+  CHECK_TEST_CONDITION(m_rpc->on_get_blocks_bin(query_info, response_info));
+  CHECK_EQ(400, response_info.m_response_code);
+
+  return true;
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2019, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <memory>
+
+#include "chaingen.h"
+#include "cryptonote_protocol/cryptonote_protocol_handler.h"
+#include "p2p/net_node.h"
+#include "rpc/core_rpc_server.h"
+
+/// Checks Blockchain::get_blocks_fast against find_blockchain_supplement and
+/// per-tx output index lookups, and the cached getblocks.bin responses
+/// against the uncached handler.
+class gen_get_blocks_fast : public test_chain_unit_base
+{
+public:
+  gen_get_blocks_fast();
+
+  bool generate(std::vector<test_event_entry>& events) const;
+  bool check_get_blocks_fast(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_get_blocks_bin(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+
+private:
+  typedef cryptonote::t_cryptonote_protocol_handler<cryptonote::core> t_protocol;
+
+  // kept across callbacks so the later ones see what the earlier ones cached
+  std::unique_ptr<t_protocol> m_protocol;
+  std::unique_ptr<nodetool::node_server<t_protocol>> m_p2p;
+  std::unique_ptr<cryptonote::core_rpc_server> m_rpc;
+};
@@ -0,0 +1,99 @@
+// Copyright (c) 2014-2019, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "device/device.hpp"
+#include "ringct/rctSigs.h"
+#include "cryptonote_core/bulletproof_batch.h"
+
+// Checks the Bulletproofs of ntxs two-output txes, nbad of them invalid, as a
+// sync batch or a burst of relayed txes would bring them: either one tx at a
+// time, or as one batch that is bisected when it fails
+template<size_t ntxs, size_t nbad, bool batched>
+class test_bulletproof_batch
+{
+public:
+  static const size_t loop_count = ntxs < 64 ? 50 : 10;
+
+  bool init()
+  {
+    static_assert(nbad <= ntxs, "more bad txes than txes");
+    m_sigs.resize(ntxs);
+    for (size_t n = 0; n < ntxs; ++n)
+    {
+      rct::ctkeyV sc, pc;
+      rct::ctkey sctmp, pctmp;
+      std::tie(sctmp, pctmp) = rct::ctskpkGen(6000);
+      sc.push_back(sctmp);
+      pc.push_back(pctmp);
+      rct::keyV destinations(2), amount_keys(2);
+      for (size_t i = 0; i < 2; ++i)
+      {
+        rct::key sk;
+        rct::skpkGen(sk, destinations[i]);
+        amount_keys[i] = rct::hash_to_scalar(rct::zero());
+      }
+      const rct::RCTConfig rct_config { rct::RangeProofPaddedBulletproof, 2 };
+      m_sigs[n] = rct::genRctSimple(rct::zero(), sc, pc, destinations, {6000}, {1000, 4000}, amount_keys, NULL, NULL, 1000, 3, rct_config, hw::get_device("default"));
+    }
+    // spread the bad ones out, so bisection can't find them together
+    for (size_t n = 0; n < nbad; ++n)
+      m_sigs[(n + 1) * ntxs / (nbad + 1)].p.bulletproofs[0].t = rct::skGen();
+    for (const rct::rctSig &sig : m_sigs)
+      m_sig_ptrs.push_back(&sig);
+    return true;
+  }
+
+  bool test()
+  {
+    size_t nvalid = 0;
+    if (batched)
+    {
+      std::vector<bool> valid;
+      cryptonote::verify_bulletproof_semantics(m_sig_ptrs, valid);
+      nvalid = std::count(valid.begin(), valid.end(), true);
+    }
+    else
+    {
+      for (const rct::rctSig *sig : m_sig_ptrs)
+        nvalid += rct::verRctSemanticsSimple(*sig);
+    }
+    return nvalid == ntxs - nbad;
+  }
+
+private:
+  std::vector<rct::rctSig> m_sigs;
+  std::vector<const rct::rctSig*> m_sig_ptrs;
+};
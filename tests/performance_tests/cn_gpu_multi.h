@@ -0,0 +1,76 @@
+// Copyright (c) 2014-2019, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include "crypto/pow_hash/cn_slow_hash.hpp"
+
+// Hashes cn_gpu_hash::MULTI_WAYS block hashing blobs per test, one after the other or interleaved
+template<bool multi>
+class test_cn_gpu_multi
+{
+public:
+  static const size_t loop_count = 4;
+  static const size_t ways = cn_gpu_hash::MULTI_WAYS;
+
+  bool init()
+  {
+    for (size_t i = 0; i < ways; ++i)
+    {
+      memset(m_data[i], 0, sizeof(m_data[i]));
+      m_data[i][0] = 6;
+      m_data[i][39] = i;
+      m_ctx[i] = &m_hash_ctxes[i];
+      m_in[i] = m_data[i];
+      m_len[i] = sizeof(m_data[i]);
+      m_out[i] = m_hashes[i];
+    }
+    return true;
+  }
+
+  bool test()
+  {
+    if (multi)
+      cn_gpu_hash::hash_multi(m_ctx, m_in, m_len, m_out, ways);
+    else
+      for (size_t i = 0; i < ways; ++i)
+        m_hash_ctxes[i].hash(m_in[i], m_len[i], m_out[i]);
+    return true;
+  }
+
+private:
+  cn_gpu_hash m_hash_ctxes[ways];
+  cn_gpu_hash *m_ctx[ways];
+  unsigned char m_data[ways][76];
+  unsigned char m_hashes[ways][32];
+  const void *m_in[ways];
+  size_t m_len[ways];
+  void *m_out[ways];
+};
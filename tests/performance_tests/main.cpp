@@ -40,6 +40,7 @@
 #include "check_tx_signature.h"
 #include "check_hash.h"
 #include "cn_slow_hash.h"
+#include "cn_gpu_multi.h"
 #include "derive_public_key.h"
 #include "derive_secret_key.h"
 #include "ge_frombytes_vartime.h"
@@ -48,7 +49,9 @@
 #include "generate_key_image_helper.h"
 #include "generate_keypair.h"
 #include "signature.h"
+#include "signature_batch.h"
 #include "is_out_to_acc.h"
+#include "scan_outputs.h"
 #include "subaddress_expand.h"
 #include "sc_reduce32.h"
 #include "cn_fast_hash.h"
@@ -56,6 +59,7 @@
 #include "equality.h"
 #include "range_proof.h"
 #include "bulletproof.h"
+#include "bulletproof_batch.h"
 #include "crypto_ops.h"
 #include "multiexp.h"
 
@@ -189,6 +193,10 @@ int main(int argc, char** argv)
 
   TEST_PERFORMANCE0(filter, p, test_is_out_to_acc);
   TEST_PERFORMANCE0(filter, p, test_is_out_to_acc_precomp);
+  TEST_PERFORMANCE2(filter, p, test_scan_outputs, 64, false);
+  TEST_PERFORMANCE2(filter, p, test_scan_outputs, 64, true);
+  TEST_PERFORMANCE2(filter, p, test_scan_outputs, 512, false);
+  TEST_PERFORMANCE2(filter, p, test_scan_outputs, 512, true);
   TEST_PERFORMANCE0(filter, p, test_generate_key_image_helper);
   TEST_PERFORMANCE0(filter, p, test_generate_key_derivation);
   TEST_PERFORMANCE0(filter, p, test_generate_key_image);
@@ -199,6 +207,10 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE0(filter, p, test_sc_reduce32);
   TEST_PERFORMANCE1(filter, p, test_signature, false);
   TEST_PERFORMANCE1(filter, p, test_signature, true);
+  TEST_PERFORMANCE2(filter, p, test_signature_batch, 16, false);
+  TEST_PERFORMANCE2(filter, p, test_signature_batch, 16, true);
+  TEST_PERFORMANCE2(filter, p, test_signature_batch, 256, false);
+  TEST_PERFORMANCE2(filter, p, test_signature_batch, 256, true);
 
   TEST_PERFORMANCE2(filter, p, test_wallet2_expand_subaddresses, 50, 200);
 
@@ -206,6 +218,8 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_cn_slow_hash, 1);
   TEST_PERFORMANCE1(filter, p, test_cn_slow_hash, 2);
   TEST_PERFORMANCE1(filter, p, test_cn_slow_hash, 4);
+  TEST_PERFORMANCE1(filter, p, test_cn_gpu_multi, false);
+  TEST_PERFORMANCE1(filter, p, test_cn_gpu_multi, true);
   TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 32);
   TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 16384);
 
@@ -240,6 +254,14 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE6(filter, p, test_aggregated_bulletproof, false, 2, 1, 1, 0, 64);
   TEST_PERFORMANCE6(filter, p, test_aggregated_bulletproof, true, 2, 1, 1, 0, 64); // 64 proof, each with 2 amounts
 
+  TEST_PERFORMANCE3(filter, p, test_bulletproof_batch, 16, 0, false);
+  TEST_PERFORMANCE3(filter, p, test_bulletproof_batch, 16, 0, true);
+  TEST_PERFORMANCE3(filter, p, test_bulletproof_batch, 16, 1, false);
+  TEST_PERFORMANCE3(filter, p, test_bulletproof_batch, 16, 1, true); // a bad proof among 16, found by bisection
+  TEST_PERFORMANCE3(filter, p, test_bulletproof_batch, 128, 0, false);
+  TEST_PERFORMANCE3(filter, p, test_bulletproof_batch, 128, 0, true); // a sync batch worth of txes
+  TEST_PERFORMANCE3(filter, p, test_bulletproof_batch, 128, 2, true);
+
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_sc_add);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_sc_sub);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_sc_mul);
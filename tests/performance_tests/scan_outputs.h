@@ -0,0 +1,116 @@
+// Copyright (c) 2014-2019, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "device/device.hpp"
+
+// Scans txes the way wallet2 refresh does, deriving each tx pubkey with the view key and
+// checking each output against the wallet's subaddresses. Each call scans txes * 2 outputs,
+// one tx pubkey call at a time, or in one batch per step
+template<size_t txes, bool batched>
+class test_scan_outputs
+{
+public:
+  static const size_t loop_count = 100;
+  static const size_t outputs_per_tx = 2;
+
+  bool init()
+  {
+    m_account.generate();
+    m_subaddresses[m_account.get_keys().m_account_address.m_spend_public_key] = {0, 0};
+    for (size_t i = 0; i < txes; ++i)
+    {
+      crypto::public_key pub;
+      crypto::secret_key sec;
+      crypto::generate_keys(pub, sec);
+      m_tx_pub_keys.push_back(pub);
+      for (size_t k = 0; k < outputs_per_tx; ++k)
+      {
+        crypto::generate_keys(pub, sec);
+        m_out_keys.push_back(pub);
+      }
+    }
+    return true;
+  }
+
+  bool test()
+  {
+    hw::device &hwdev = hw::get_device("default");
+    const crypto::secret_key &view_secret_key = m_account.get_keys().m_view_secret_key;
+    const std::vector<crypto::key_derivation> additional_derivations;
+    size_t received = 0;
+    if (batched)
+    {
+      std::vector<crypto::key_derivation> derivations;
+      std::vector<bool> valid;
+      if (!hwdev.generate_key_derivations(m_tx_pub_keys, view_secret_key, derivations, valid))
+        return false;
+      std::vector<crypto::key_derivation> out_derivations;
+      std::vector<size_t> output_indices;
+      for (size_t i = 0; i < m_out_keys.size(); ++i)
+      {
+        out_derivations.push_back(derivations[i / outputs_per_tx]);
+        output_indices.push_back(i % outputs_per_tx);
+      }
+      std::vector<crypto::public_key> derived;
+      if (!hwdev.derive_subaddress_public_keys(m_out_keys, out_derivations, output_indices, derived, valid))
+        return false;
+      for (size_t i = 0; i < derived.size(); ++i)
+        if (valid[i] && m_subaddresses.find(derived[i]) != m_subaddresses.end())
+          ++received;
+    }
+    else
+    {
+      for (size_t i = 0; i < txes; ++i)
+      {
+        crypto::key_derivation derivation;
+        if (!hwdev.generate_key_derivation(m_tx_pub_keys[i], view_secret_key, derivation))
+          return false;
+        for (size_t k = 0; k < outputs_per_tx; ++k)
+          if (cryptonote::is_out_to_acc_precomp(m_subaddresses, m_out_keys[i * outputs_per_tx + k], derivation, additional_derivations, k, hwdev))
+            ++received;
+      }
+    }
+    return received == 0;
+  }
+
+private:
+  cryptonote::account_base m_account;
+  std::unordered_map<crypto::public_key, cryptonote::subaddress_index> m_subaddresses;
+  std::vector<crypto::public_key> m_tx_pub_keys;
+  std::vector<crypto::public_key> m_out_keys;
+};
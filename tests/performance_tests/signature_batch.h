@@ -0,0 +1,80 @@
+// Copyright (c) 2014-2019, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#pragma once
+
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_core/service_node_signatures.h"
+
+// Checks nsigs signatures by distinct keys, as a burst of uptime proofs or
+// votes would arrive, either one at a time or as a service_nodes::signature_batch
+template<size_t nsigs, bool batched>
+class test_signature_batch
+{
+public:
+  static const size_t loop_count = nsigs < 64 ? 1000 : 100;
+
+  bool init()
+  {
+    m_items.resize(nsigs);
+    for (auto &item : m_items)
+    {
+      cryptonote::keypair keys = cryptonote::keypair::generate(hw::get_device("default"));
+      item.hash = crypto::rand<crypto::hash>();
+      item.pubkey = keys.pub;
+      crypto::generate_signature(item.hash, keys.pub, keys.sec, item.sig);
+    }
+    return true;
+  }
+
+  bool test()
+  {
+    if (!batched)
+    {
+      for (const auto &item : m_items)
+        if (!crypto::check_signature(item.hash, item.pubkey, item.sig))
+          return false;
+      return true;
+    }
+
+    // not remembering valid signatures, or every run after the first would be free
+    service_nodes::signature_batch batch(false);
+    for (const auto &item : m_items)
+      batch.add(item.hash, item.pubkey, item.sig);
+    return batch.check();
+  }
+
+private:
+  std::vector<service_nodes::signature_batch::item> m_items;
+};
@@ -0,0 +1,120 @@
+// Copyright (c)      2019, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_basic/block_filter.h"
+
+namespace
+{
+  crypto::public_key random_pkey()
+  {
+    return crypto::rand<crypto::public_key>();
+  }
+
+  cryptonote::block make_block(cryptonote::transaction &tx)
+  {
+    cryptonote::block b;
+    b.miner_tx.vin.push_back(cryptonote::txin_gen{10});
+    b.miner_tx.vout.push_back({1, cryptonote::txout_to_key{random_pkey()}});
+    cryptonote::add_tx_pub_key_to_extra(b.miner_tx, random_pkey());
+
+    cryptonote::txin_to_key in;
+    in.k_image = crypto::rand<crypto::key_image>();
+    tx.vin.push_back(in);
+    tx.vout.push_back({0, cryptonote::txout_to_key{random_pkey()}});
+    tx.vout.push_back({0, cryptonote::txout_to_scripthash{}});
+    tx.vout.push_back({0, cryptonote::txout_to_key{random_pkey()}});
+    cryptonote::add_tx_pub_key_to_extra(tx, random_pkey());
+    cryptonote::add_additional_tx_pub_keys_to_extra(tx.extra, {random_pkey(), random_pkey(), random_pkey()});
+    b.tx_hashes.push_back(crypto::rand<crypto::hash>());
+    return b;
+  }
+}
+
+TEST(block_filter, contents)
+{
+  cryptonote::transaction tx;
+  const cryptonote::block b = make_block(tx);
+  const crypto::hash block_hash = crypto::rand<crypto::hash>();
+  cryptonote::block_filter filter;
+  cryptonote::make_block_filter(b, block_hash, {&tx}, filter);
+
+  ASSERT_EQ(filter.block_hash, block_hash);
+  ASSERT_EQ(filter.txs.size(), 2);
+  ASSERT_EQ(filter.txs[0].tx_pub_keys.size(), 1);
+  ASSERT_EQ(filter.txs[0].tx_pub_keys[0], cryptonote::get_tx_pub_key_from_extra(b.miner_tx));
+  ASSERT_EQ(filter.txs[0].output_keys.size(), 1);
+  ASSERT_TRUE(filter.txs[0].key_image_fingerprints.empty());
+
+  const cryptonote::block_filter::tx_entry &entry = filter.txs[1];
+  ASSERT_EQ(entry.tx_pub_keys.size(), 1);
+  ASSERT_EQ(entry.additional_tx_pub_keys.size(), 3);
+  ASSERT_EQ(entry.output_keys.size(), 3);
+  ASSERT_EQ(entry.output_keys[0], boost::get<cryptonote::txout_to_key>(tx.vout[0].target).key);
+  ASSERT_EQ(entry.output_keys[1], crypto::null_pkey);
+  ASSERT_EQ(entry.output_keys[2], boost::get<cryptonote::txout_to_key>(tx.vout[2].target).key);
+  ASSERT_EQ(entry.key_image_fingerprints.size(), 1);
+  ASSERT_EQ(entry.key_image_fingerprints[0], cryptonote::get_key_image_fingerprint(boost::get<cryptonote::txin_to_key>(tx.vin[0]).k_image));
+}
+
+TEST(block_filter, round_trip)
+{
+  cryptonote::transaction tx;
+  const cryptonote::block b = make_block(tx);
+  cryptonote::block_filter filter;
+  cryptonote::make_block_filter(b, crypto::rand<crypto::hash>(), {&tx}, filter);
+
+  const cryptonote::blobdata blob = cryptonote::block_filter_to_blob(filter);
+  cryptonote::block_filter parsed;
+  ASSERT_TRUE(cryptonote::parse_block_filter(blob, parsed));
+  ASSERT_EQ(parsed.block_hash, filter.block_hash);
+  ASSERT_EQ(parsed.txs.size(), filter.txs.size());
+  for (size_t i = 0; i < filter.txs.size(); ++i)
+  {
+    ASSERT_EQ(parsed.txs[i].tx_pub_keys, filter.txs[i].tx_pub_keys);
+    ASSERT_EQ(parsed.txs[i].additional_tx_pub_keys, filter.txs[i].additional_tx_pub_keys);
+    ASSERT_EQ(parsed.txs[i].output_keys, filter.txs[i].output_keys);
+    ASSERT_EQ(parsed.txs[i].key_image_fingerprints, filter.txs[i].key_image_fingerprints);
+  }
+}
+
+TEST(block_filter, truncated)
+{
+  cryptonote::transaction tx;
+  const cryptonote::block b = make_block(tx);
+  cryptonote::block_filter filter;
+  cryptonote::make_block_filter(b, crypto::rand<crypto::hash>(), {&tx}, filter);
+  const cryptonote::blobdata blob = cryptonote::block_filter_to_blob(filter);
+
+  cryptonote::block_filter parsed;
+  for (size_t size = 0; size < blob.size(); ++size)
+    ASSERT_FALSE(cryptonote::parse_block_filter(blob.substr(0, size), parsed));
+  ASSERT_FALSE(cryptonote::parse_block_filter(blob + "x", parsed));
+}
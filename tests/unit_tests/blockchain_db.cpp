@@ -341,4 +341,162 @@ TYPED_TEST(BlockchainDBTest, RetrieveBlockData)
   ASSERT_HASH_EQ(get_block_hash(this->m_blocks[1].first), hashes[1]);
 }
 
+TYPED_TEST(BlockchainDBTest, BlockTxHashes)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  db_wtxn_guard guard(this->m_db);
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+
+  std::vector<crypto::hash> tx_hashes;
+  for (uint64_t height = 0; height < 2; ++height)
+  {
+    ASSERT_TRUE(this->m_db->get_block_tx_hashes(height, tx_hashes));
+    ASSERT_EQ(this->m_blocks[height].first.tx_hashes, tx_hashes);
+  }
+  ASSERT_FALSE(this->m_db->get_block_tx_hashes(2, tx_hashes));
+
+  // popping a block drops its entry
+  block b;
+  std::vector<transaction> txs;
+  ASSERT_NO_THROW(this->m_db->pop_block(b, txs));
+  ASSERT_FALSE(this->m_db->get_block_tx_hashes(1, tx_hashes));
+  ASSERT_TRUE(this->m_db->get_block_tx_hashes(0, tx_hashes));
+}
+
+TYPED_TEST(BlockchainDBTest, ServiceNodeRecords)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+
+  db_wtxn_guard guard(this->m_db);
+
+  ASSERT_NO_THROW(this->m_db->set_service_node_record(service_node_record_type::quorum, std::string("\x00\x02", 2), "b"));
+  ASSERT_NO_THROW(this->m_db->set_service_node_record(service_node_record_type::quorum, std::string("\x00\x01", 2), "a"));
+  ASSERT_NO_THROW(this->m_db->set_service_node_record(service_node_record_type::info, "key", "info"));
+  ASSERT_NO_THROW(this->m_db->set_service_node_record(service_node_record_type::rollback_event, "event", "event"));
+
+  // records are visited in key order, and only for the requested type
+  std::vector<std::string> seen;
+  ASSERT_TRUE(this->m_db->for_all_service_node_records(service_node_record_type::quorum, [&seen](const std::string &key, const std::string &data) {
+    seen.push_back(data);
+    return true;
+  }));
+  ASSERT_EQ(2u, seen.size());
+  ASSERT_EQ("a", seen[0]);
+  ASSERT_EQ("b", seen[1]);
+
+  std::string data;
+  ASSERT_TRUE(this->m_db->get_service_node_record(service_node_record_type::info, "key", data));
+  ASSERT_EQ("info", data);
+  ASSERT_FALSE(this->m_db->get_service_node_record(service_node_record_type::quorum, "key", data));
+
+  ASSERT_NO_THROW(this->m_db->remove_service_node_record(service_node_record_type::info, "key"));
+  ASSERT_NO_THROW(this->m_db->remove_service_node_record(service_node_record_type::info, "key"));
+  ASSERT_FALSE(this->m_db->get_service_node_record(service_node_record_type::info, "key", data));
+  ASSERT_TRUE(this->m_db->get_service_node_record(service_node_record_type::rollback_event, "event", data));
+
+  ASSERT_NO_THROW(this->m_db->clear_service_node_data());
+  ASSERT_FALSE(this->m_db->get_service_node_record(service_node_record_type::rollback_event, "event", data));
+}
+
+TYPED_TEST(BlockchainDBTest, EmissionIndex)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  db_wtxn_guard guard(this->m_db);
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+  ASSERT_EQ(2u, this->m_db->get_emission_index_height());
+
+  // each block's totals are added on top of its parent's
+  block_emission_totals expected;
+  for (size_t i = 0; i < 2; ++i)
+  {
+    block_emission_totals block_totals;
+    for (const auto &tx: this->m_txs[i])
+      block_totals.add_tx(tx.first, this->m_blocks[i].first.major_version);
+    block_totals.set_miner_tx(this->m_blocks[i].first.miner_tx);
+    expected += block_totals;
+
+    block_emission_totals totals;
+    ASSERT_TRUE(this->m_db->get_block_cumulative_emission(i, totals));
+    ASSERT_EQ(expected.emission, totals.emission);
+    ASSERT_EQ(expected.fees, totals.fees);
+    ASSERT_EQ(expected.burned, totals.burned);
+  }
+
+  block_emission_totals replaced;
+  replaced.emission = 7;
+  ASSERT_NO_THROW(this->m_db->set_block_cumulative_emission(1, replaced));
+  block_emission_totals totals;
+  ASSERT_TRUE(this->m_db->get_block_cumulative_emission(1, totals));
+  ASSERT_EQ(7u, totals.emission);
+  ASSERT_THROW(this->m_db->get_block_cumulative_emission(2, totals), BLOCK_DNE);
+}
+
+TYPED_TEST(BlockchainDBTest, PowHashCache)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+
+  std::vector<std::pair<crypto::hash, crypto::hash>> hashes(5);
+  for (size_t i = 0; i < hashes.size(); ++i)
+  {
+    hashes[i].first = crypto::cn_fast_hash(&i, sizeof(i));
+    hashes[i].second = crypto::cn_fast_hash(&hashes[i].first, sizeof(hashes[i].first));
+  }
+
+  {
+    db_wtxn_guard guard(this->m_db);
+    ASSERT_NO_THROW(this->m_db->add_pow_hashes({hashes[0], hashes[1], hashes[2]}, 4));
+    // cached ids are left alone and don't count twice
+    ASSERT_NO_THROW(this->m_db->add_pow_hashes({{hashes[0].first, crypto::null_hash}}, 4));
+    ASSERT_EQ(3u, this->m_db->get_pow_hash_count());
+
+    // going over the bound evicts the oldest entries
+    ASSERT_NO_THROW(this->m_db->add_pow_hashes({hashes[3], hashes[4]}, 4));
+  }
+  ASSERT_EQ(4u, this->m_db->get_pow_hash_count());
+
+  crypto::hash pow;
+  ASSERT_FALSE(this->m_db->get_pow_hash(hashes[0].first, pow));
+  for (size_t i = 1; i < hashes.size(); ++i)
+  {
+    ASSERT_TRUE(this->m_db->get_pow_hash(hashes[i].first, pow));
+    ASSERT_EQ(hashes[i].second, pow);
+  }
+
+  ASSERT_NO_THROW(this->m_db->drop_pow_hashes());
+  ASSERT_EQ(0u, this->m_db->get_pow_hash_count());
+  ASSERT_FALSE(this->m_db->get_pow_hash(hashes[1].first, pow));
+}
+
 }  // anonymous namespace
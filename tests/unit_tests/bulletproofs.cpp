@@ -37,6 +37,7 @@
 #include "cryptonote_basic/blobdatatype.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "device/device.hpp"
+#include "cryptonote_core/bulletproof_batch.h"
 #include "misc_log_ex.h"
 
 TEST(bulletproofs, valid_zero)
@@ -162,6 +163,40 @@ TEST(bulletproofs, valid_aggregated)
   ASSERT_TRUE(rct::bulletproof_VERIFY(proofs));
 }
 
+TEST(bulletproofs, batch_bisection)
+{
+  static const size_t N_SIGS = 7;
+  std::vector<rct::rctSig> sigs(N_SIGS);
+  std::vector<const rct::rctSig*> ptrs;
+  for (size_t n = 0; n < N_SIGS; ++n)
+  {
+    rct::ctkeyV sc, pc;
+    rct::ctkey sctmp, pctmp;
+    std::tie(sctmp, pctmp) = rct::ctskpkGen(6000);
+    sc.push_back(sctmp);
+    pc.push_back(pctmp);
+    rct::keyV destinations(2), amount_keys(2);
+    for (size_t i = 0; i < 2; ++i)
+    {
+      rct::key sk;
+      rct::skpkGen(sk, destinations[i]);
+      amount_keys[i] = rct::hash_to_scalar(rct::zero());
+    }
+    const rct::RCTConfig rct_config { rct::RangeProofPaddedBulletproof, 2 };
+    sigs[n] = rct::genRctSimple(rct::zero(), sc, pc, destinations, {6000}, {1000, 4000}, amount_keys, NULL, NULL, 1000, 3, rct_config, hw::get_device("default"));
+    ptrs.push_back(&sigs[n]);
+  }
+
+  std::vector<bool> valid;
+  ASSERT_TRUE(cryptonote::verify_bulletproof_semantics(ptrs, valid));
+  ASSERT_EQ(std::vector<bool>(N_SIGS, true), valid);
+
+  sigs[1].p.bulletproofs[0].t = rct::skGen();
+  sigs[5].p.bulletproofs[0].t = rct::skGen();
+  ASSERT_FALSE(cryptonote::verify_bulletproof_semantics(ptrs, valid));
+  ASSERT_EQ((std::vector<bool>{true, false, true, true, true, false, true}), valid);
+}
+
 
 TEST(bulletproofs, invalid_8)
 {
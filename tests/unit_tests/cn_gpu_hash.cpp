@@ -0,0 +1,114 @@
+// Copyright (c)      2019, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "string_tools.h"
+#include "crypto/hash.h"
+#include "crypto/pow_hash/cn_slow_hash.hpp"
+
+namespace
+{
+  // input i of a given length, so no two lanes hash the same data
+  std::string make_input(size_t i, size_t length)
+  {
+    std::string data(length, 0);
+    for (size_t k = 0; k < length; ++k)
+      data[k] = (char)(i * 31 + k * 7 + length);
+    return data;
+  }
+}
+
+TEST(cn_gpu_hash, known_vector)
+{
+  crypto::hash expected;
+  ASSERT_TRUE(epee::string_tools::hex_to_pod("855b724b3d4b3f98a2bdddcf42f110ee6489d01a2ca66bc5e5ebc691f65d46c0", expected));
+  const std::string data = "This is a test This is a test This is a test";
+
+  cn_gpu_hash hash_ctx;
+  crypto::hash hash;
+  hash_ctx.hash(data.data(), data.size(), &hash);
+  ASSERT_EQ(hash, expected);
+
+  // every lane of the interleaved path gives the same
+  cn_gpu_hash hash_ctxes[cn_gpu_hash::MULTI_WAYS];
+  cn_gpu_hash *ctx[cn_gpu_hash::MULTI_WAYS];
+  const void *in[cn_gpu_hash::MULTI_WAYS];
+  size_t len[cn_gpu_hash::MULTI_WAYS];
+  crypto::hash hashes[cn_gpu_hash::MULTI_WAYS];
+  void *out[cn_gpu_hash::MULTI_WAYS];
+  for (size_t i = 0; i < cn_gpu_hash::MULTI_WAYS; ++i)
+  {
+    ctx[i] = &hash_ctxes[i];
+    in[i] = data.data();
+    len[i] = data.size();
+    out[i] = &hashes[i];
+  }
+  cn_gpu_hash::hash_multi(ctx, in, len, out, cn_gpu_hash::MULTI_WAYS);
+  for (size_t i = 0; i < cn_gpu_hash::MULTI_WAYS; ++i)
+    ASSERT_EQ(hashes[i], expected) << "lane " << i;
+}
+
+TEST(cn_gpu_hash, hash_multi_matches_hash)
+{
+  // short, a block hashing blob, and longer than a keccak block
+  static const size_t lengths[] = {43, 76, 200};
+
+  cn_gpu_hash hash_ctxes[cn_gpu_hash::MULTI_WAYS];
+  cn_gpu_hash *ctx[cn_gpu_hash::MULTI_WAYS];
+  for (size_t i = 0; i < cn_gpu_hash::MULTI_WAYS; ++i)
+    ctx[i] = &hash_ctxes[i];
+
+  for (size_t length: lengths)
+  {
+    std::string data[cn_gpu_hash::MULTI_WAYS];
+    crypto::hash expected[cn_gpu_hash::MULTI_WAYS];
+    for (size_t i = 0; i < cn_gpu_hash::MULTI_WAYS; ++i)
+    {
+      data[i] = make_input(i, length);
+      hash_ctxes[0].hash(data[i].data(), data[i].size(), &expected[i]);
+    }
+
+    for (size_t n = 1; n <= cn_gpu_hash::MULTI_WAYS; ++n)
+    {
+      const void *in[cn_gpu_hash::MULTI_WAYS];
+      size_t len[cn_gpu_hash::MULTI_WAYS];
+      crypto::hash hashes[cn_gpu_hash::MULTI_WAYS];
+      void *out[cn_gpu_hash::MULTI_WAYS];
+      for (size_t i = 0; i < n; ++i)
+      {
+        in[i] = data[i].data();
+        len[i] = data[i].size();
+        out[i] = &hashes[i];
+      }
+      cn_gpu_hash::hash_multi(ctx, in, len, out, n);
+      for (size_t i = 0; i < n; ++i)
+        ASSERT_EQ(hashes[i], expected[i]) << "length " << length << ", n " << n << ", lane " << i;
+    }
+  }
+}
@@ -99,3 +99,72 @@ TEST(Crypto, verify_32)
     }
   }
 }
+
+TEST(Crypto, generate_key_derivations)
+{
+  crypto::public_key pub;
+  crypto::secret_key sec;
+  crypto::generate_keys(pub, sec);
+
+  std::vector<crypto::public_key> keys;
+  for (size_t i = 0; i < 16; ++i)
+  {
+    crypto::public_key tx_pub;
+    crypto::secret_key tx_sec;
+    crypto::generate_keys(tx_pub, tx_sec);
+    keys.push_back(tx_pub);
+  }
+  crypto::public_key bad;
+  do bad = crypto::rand<crypto::public_key>(); while (crypto::check_key(bad));
+  keys.insert(keys.begin() + 5, bad);
+
+  std::vector<crypto::key_derivation> derivations;
+  std::vector<bool> valid;
+  crypto::generate_key_derivations(keys, sec, derivations, valid);
+  ASSERT_EQ(derivations.size(), keys.size());
+  ASSERT_EQ(valid.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    crypto::key_derivation derivation;
+    ASSERT_EQ(valid[i], crypto::generate_key_derivation(keys[i], sec, derivation));
+    if (valid[i])
+      ASSERT_EQ(memcmp(&derivations[i], &derivation, sizeof(derivation)), 0);
+  }
+}
+
+TEST(Crypto, derive_subaddress_public_keys)
+{
+  std::vector<crypto::public_key> out_keys;
+  std::vector<crypto::key_derivation> derivations;
+  std::vector<size_t> output_indices;
+  crypto::public_key bad;
+  do bad = crypto::rand<crypto::public_key>(); while (crypto::check_key(bad));
+  for (size_t i = 0; i < 16; ++i)
+  {
+    crypto::public_key out_key;
+    crypto::secret_key out_sec;
+    crypto::generate_keys(out_key, out_sec);
+    if (i == 7)
+      out_key = bad;
+    // each key twice in a row, as the wallet does with additional tx pubkeys
+    for (size_t j = 0; j < 2; ++j)
+    {
+      out_keys.push_back(out_key);
+      derivations.push_back(crypto::rand<crypto::key_derivation>());
+      output_indices.push_back(i);
+    }
+  }
+
+  std::vector<crypto::public_key> derived;
+  std::vector<bool> valid;
+  crypto::derive_subaddress_public_keys(out_keys, derivations, output_indices, derived, valid);
+  ASSERT_EQ(derived.size(), out_keys.size());
+  ASSERT_EQ(valid.size(), out_keys.size());
+  for (size_t i = 0; i < out_keys.size(); ++i)
+  {
+    crypto::public_key expected;
+    ASSERT_EQ(valid[i], crypto::derive_subaddress_public_key(out_keys[i], derivations[i], output_indices[i], expected));
+    if (valid[i])
+      ASSERT_EQ(derived[i], expected);
+  }
+}
@@ -0,0 +1,105 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "common/lru_cache.h"
+
+TEST(lru_cache, evicts_least_recently_used)
+{
+  tools::lru_cache<int, int> cache(3, 1);
+  cache.put(1, 10);
+  cache.put(2, 20);
+  cache.put(3, 30);
+
+  int value;
+  ASSERT_TRUE(cache.get(1, value));
+  ASSERT_EQ(10, value);
+
+  // 2 is now the least recently used
+  cache.put(4, 40);
+  ASSERT_FALSE(cache.get(2, value));
+  ASSERT_TRUE(cache.get(1, value));
+  ASSERT_TRUE(cache.get(3, value));
+  ASSERT_TRUE(cache.get(4, value));
+  ASSERT_EQ(40, value);
+
+  const auto stats = cache.get_stats();
+  ASSERT_EQ(4, stats.hits);
+  ASSERT_EQ(1, stats.misses);
+  ASSERT_EQ(1, stats.evictions);
+  ASSERT_EQ(3, stats.size);
+}
+
+TEST(lru_cache, replace_and_erase)
+{
+  tools::lru_cache<int, int> cache(2, 1);
+  cache.put(1, 10);
+  cache.put(1, 11);
+  ASSERT_EQ(1, cache.size());
+
+  int value;
+  ASSERT_TRUE(cache.get(1, value));
+  ASSERT_EQ(11, value);
+
+  cache.erase(1);
+  ASSERT_FALSE(cache.get(1, value));
+  ASSERT_EQ(0, cache.get_stats().evictions);
+}
+
+TEST(lru_cache, revalidation)
+{
+  tools::lru_cache<int, int> cache(4);
+  cache.put(1, 10);
+  cache.put(2, 20);
+
+  int value;
+  ASSERT_TRUE(cache.get(1, value, [](int &v) { v = 12; return true; }));
+  ASSERT_EQ(12, value);
+  ASSERT_TRUE(cache.get(1, value));
+  ASSERT_EQ(12, value);
+
+  ASSERT_FALSE(cache.get(2, value, [](int &v) { return false; }));
+  ASSERT_FALSE(cache.get(2, value));
+  ASSERT_EQ(1, cache.size());
+  ASSERT_EQ(2, cache.get_stats().misses);
+}
+
+TEST(lru_cache, bounded)
+{
+  tools::lru_cache<int, int> cache(64, 8);
+  for (int n = 0; n < 1000; ++n)
+    cache.put(n, n);
+  ASSERT_LE(cache.size(), 64);
+  ASSERT_EQ(1000 - cache.size(), cache.get_stats().evictions);
+
+  tools::lru_cache<int, int> cleared(16);
+  cleared.put(1, 1);
+  cleared.clear();
+  ASSERT_EQ(0, cleared.size());
+}
@@ -79,6 +79,8 @@ public:
   bool get_blocks(uint64_t start_offset, size_t count, std::vector<std::pair<cryptonote::blobdata, cryptonote::block>>& blocks, std::vector<cryptonote::blobdata>& txs) const { return false; }
   bool get_transactions(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::transaction>& txs, std::vector<crypto::hash>& missed_txs) const { return false; }
   bool get_block_by_hash(const crypto::hash &h, cryptonote::block &blk, bool *orphan = NULL) const { return false; }
+  bool get_block_blob_and_tx_hashes(const crypto::hash &blkid, cryptonote::blobdata &block_blob, std::vector<crypto::hash> &tx_hashes) const { return false; }
+  bool get_stored_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs) const { return false; }
   uint8_t get_ideal_hard_fork_version() const { return 0; }
   uint8_t get_ideal_hard_fork_version(uint64_t height) const { return 0; }
   uint8_t get_hard_fork_version(uint64_t height) const { return 0; }
@@ -87,6 +89,7 @@ public:
   bool fluffy_blocks_enabled() const { return false; }
   // TODO(triton): Write tests
   bool add_deregister_vote(const triton::service_node_deregister::vote& vote, cryptonote::vote_verification_context &vvc) { return true; }
+  bool verify_deregister_vote_signatures(const std::vector<triton::service_node_deregister::vote>& votes) const { return true; }
   virtual void set_deregister_votes_relayed(const std::vector<triton::service_node_deregister::vote>& votes) {}
   uint64_t prevalidate_block_hashes(uint64_t height, const std::vector<crypto::hash> &hashes, const std::vector<uint64_t> &weights) { return 0; }
   bool pad_transactions() { return false; }
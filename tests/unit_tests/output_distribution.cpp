@@ -33,6 +33,7 @@
 #include "cryptonote_core/cryptonote_core.h"
 #include "cryptonote_core/tx_pool.h"
 #include "cryptonote_core/blockchain.h"
+#include "cryptonote_core/output_distribution_cache.h"
 #include "blockchain_db/testdb.h"
 
 static const uint64_t test_distribution[32] = {
@@ -91,43 +92,36 @@ bool get_output_distribution(uint64_t amount, uint64_t from, uint64_t to, uint64
   return r && bc->get_output_distribution(amount, from, to, start_height, distribution, base);
 }
 
-crypto::hash get_block_hash(uint64_t height)
-{
-  crypto::hash hash = crypto::null_hash;
-  *((uint64_t*)&hash) = height;
-  return hash;
-}
-
 TEST(output_distribution, extend)
 {
   boost::optional<cryptonote::rpc::output_distribution_data> res;
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 29, ::get_block_hash, false, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 29, false);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 2);
   ASSERT_EQ(res->distribution, std::vector<uint64_t>({5, 0}));
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 29, ::get_block_hash, true, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 29, true);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 2);
   ASSERT_EQ(res->distribution, std::vector<uint64_t>({55, 55}));
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 30, ::get_block_hash, false, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 30, false);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 3);
   ASSERT_EQ(res->distribution, std::vector<uint64_t>({5, 0, 2}));
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 30, ::get_block_hash, true, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 30, true);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 3);
   ASSERT_EQ(res->distribution, std::vector<uint64_t>({55, 55, 57}));
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 31, ::get_block_hash, false, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 31, false);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 4);
   ASSERT_EQ(res->distribution, std::vector<uint64_t>({5, 0, 2, 3}));
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 31, ::get_block_hash, true, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 28, 31, true);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 4);
   ASSERT_EQ(res->distribution, std::vector<uint64_t>({55, 55, 57, 60}));
@@ -137,7 +131,7 @@ TEST(output_distribution, one)
 {
   boost::optional<cryptonote::rpc::output_distribution_data> res;
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 0, 0, ::get_block_hash, false, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 0, 0, false);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 1);
   ASSERT_EQ(res->distribution.back(), 0);
@@ -147,7 +141,7 @@ TEST(output_distribution, full_cumulative)
 {
   boost::optional<cryptonote::rpc::output_distribution_data> res;
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 0, 31, ::get_block_hash, true, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 0, 31, true);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 32);
   ASSERT_EQ(res->distribution.back(), 60);
@@ -157,7 +151,7 @@ TEST(output_distribution, full_noncumulative)
 {
   boost::optional<cryptonote::rpc::output_distribution_data> res;
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 0, 31, ::get_block_hash, false, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 0, 31, false);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 32);
   for (size_t i = 0; i < 32; ++i)
@@ -168,7 +162,7 @@ TEST(output_distribution, part_cumulative)
 {
   boost::optional<cryptonote::rpc::output_distribution_data> res;
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 4, 8, ::get_block_hash, true, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 4, 8, true);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 5);
   ASSERT_EQ(res->distribution, std::vector<uint64_t>({0, 1, 6, 7, 11}));
@@ -178,8 +172,82 @@ TEST(output_distribution, part_noncumulative)
 {
   boost::optional<cryptonote::rpc::output_distribution_data> res;
 
-  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 4, 8, ::get_block_hash, false, test_distribution_size);
+  res = cryptonote::rpc::RpcHandler::get_output_distribution(::get_output_distribution, 0, 4, 8, false);
   ASSERT_TRUE(res != boost::none);
   ASSERT_EQ(res->distribution.size(), 5);
   ASSERT_EQ(res->distribution, std::vector<uint64_t>({0, 1, 5, 1, 4}));
 }
+
+TEST(output_distribution, cache)
+{
+  cryptonote::output_distribution_cache cache(2);
+  const uint64_t chunk = cryptonote::output_distribution_cache::CHUNK_HEIGHTS;
+  crypto::hash top = crypto::null_hash;
+
+  std::vector<uint64_t> cumulative(chunk - 1);
+  for (uint64_t h = 0; h < cumulative.size(); ++h)
+    cumulative[h] = h * 2;
+  ASSERT_TRUE(cache.put(5, cumulative, top) != nullptr);
+  ASSERT_TRUE(cache.put(0, cumulative, top) != nullptr);
+
+  // amount 0 keeps its slot, the others evict the least recently used
+  ASSERT_TRUE(cache.put(7, cumulative, top) != nullptr);
+  ASSERT_TRUE(cache.get(5) == nullptr);
+  ASSERT_TRUE(cache.get(0) != nullptr);
+  ASSERT_TRUE(cache.put(5, cumulative, top) != nullptr);
+  ASSERT_TRUE(cache.get(7) == nullptr);
+
+  // crossing into a new chunk
+  top.data[0] = 1;
+  cache.on_block_added(chunk - 1, top, 1000, {{5, 3}});
+  top.data[0] = 2;
+  cache.on_block_added(chunk, top, 1001, {});
+  auto d = cache.get(5);
+  ASSERT_TRUE(d != nullptr);
+  ASSERT_EQ(chunk + 1, d->height());
+  ASSERT_EQ(top, d->top_hash());
+  ASSERT_EQ((chunk - 2) * 2 + 3, (*d)[chunk - 1]);
+  ASSERT_EQ((chunk - 2) * 2 + 3, (*d)[chunk]);
+  ASSERT_EQ(1001u, (*cache.get(0))[chunk]);
+
+  std::vector<uint64_t> slice;
+  d->slice(chunk - 3, chunk, slice);
+  ASSERT_EQ(std::vector<uint64_t>({(chunk - 3) * 2, (chunk - 2) * 2, (chunk - 2) * 2 + 3, (chunk - 2) * 2 + 3}), slice);
+
+  // an older snapshot is untouched by later blocks and pops
+  cache.on_blocks_popped(chunk - 1, crypto::null_hash);
+  ASSERT_EQ(chunk + 1, d->height());
+  d = cache.get(5);
+  ASSERT_EQ(chunk - 1, d->height());
+  top.data[0] = 3;
+  cache.on_block_added(chunk - 1, top, 1000, {{5, 1}});
+  ASSERT_EQ((chunk - 2) * 2 + 1, (*cache.get(5))[chunk - 1]);
+
+  // a block which does not follow on drops the distribution
+  cache.on_block_added(chunk + 5, top, 0, {});
+  ASSERT_TRUE(cache.get(5) == nullptr);
+  ASSERT_TRUE(cache.empty());
+}
+
+TEST(output_distribution, cache_lru)
+{
+  cryptonote::output_distribution_cache cache(3);
+  const std::vector<uint64_t> cumulative({1, 2, 3});
+
+  ASSERT_TRUE(cache.put(5, cumulative, crypto::null_hash) != nullptr);
+  ASSERT_TRUE(cache.put(7, cumulative, crypto::null_hash) != nullptr);
+  ASSERT_TRUE(cache.put(0, cumulative, crypto::null_hash) != nullptr);
+  ASSERT_TRUE(cache.get(5) != nullptr);
+  ASSERT_TRUE(cache.put(9, cumulative, crypto::null_hash) != nullptr);
+  ASSERT_TRUE(cache.get(7) == nullptr);
+  ASSERT_TRUE(cache.get(5) != nullptr);
+  ASSERT_TRUE(cache.get(9) != nullptr);
+  ASSERT_TRUE(cache.get(0) != nullptr);
+
+  // with only the reserved slot, other amounts are not cached at all
+  cryptonote::output_distribution_cache rct_only(1);
+  ASSERT_TRUE(rct_only.can_cache(0));
+  ASSERT_FALSE(rct_only.can_cache(5));
+  ASSERT_TRUE(rct_only.put(5, cumulative, crypto::null_hash) == nullptr);
+  ASSERT_TRUE(rct_only.put(0, cumulative, crypto::null_hash) != nullptr);
+}
@@ -1089,3 +1089,31 @@ TEST(ringct, aggregated)
 
   ASSERT_TRUE(verRctSemanticsSimple(sp));
 }
+
+TEST(ringct, batched_mlsags)
+{
+  static const size_t N_SIGS = 8;
+  std::vector<rctSig> s(N_SIGS);
+  std::vector<const rctSig*> sp(N_SIGS);
+
+  for (size_t n = 0; n < N_SIGS; ++n)
+  {
+    static const uint64_t inputs[] = {1000, 1000};
+    static const uint64_t outputs[] = {500, 1500};
+    s[n] = make_sample_simple_rct_sig(NELTS(inputs), inputs, NELTS(outputs), outputs, 0);
+    sp[n] = &s[n];
+  }
+
+  std::vector<bool> valid;
+  ASSERT_TRUE(verRctNonSemanticsSimple(sp, &valid));
+  ASSERT_EQ(std::vector<bool>(N_SIGS, true), valid);
+
+  // one bad input fails only the signature it belongs to
+  s[3].p.MGs[1].ss[0][0] = skGen();
+  ASSERT_FALSE(verRctNonSemanticsSimple(sp, &valid));
+  std::vector<bool> expected(N_SIGS, true);
+  expected[3] = false;
+  ASSERT_EQ(expected, valid);
+  ASSERT_FALSE(verRctNonSemanticsSimple(s[3]));
+  ASSERT_TRUE(verRctNonSemanticsSimple(s[4]));
+}
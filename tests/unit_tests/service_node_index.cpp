@@ -0,0 +1,186 @@
+// Copyright (c) 2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_core/service_node_list.h"
+
+using service_nodes::service_node_index;
+using service_nodes::service_node_info;
+
+namespace
+{
+  crypto::public_key make_key(uint8_t n)
+  {
+    crypto::public_key key;
+    memset(&key, 0, sizeof(key));
+    key.data[0] = n;
+    return key;
+  }
+
+  service_node_info make_info(uint64_t registration_height, uint64_t contributed)
+  {
+    service_node_info info;
+    info.registration_height = registration_height;
+    info.staking_requirement = 100;
+    info.total_reserved = 100;
+    info.total_contributed = contributed;
+    return info;
+  }
+}
+
+TEST(service_node_index, active_sorted_by_pubkey)
+{
+  service_node_index index;
+  index.clear(false);
+
+  const service_node_info funded = make_info(10, 100);
+  index.update(make_key(3), &funded);
+  index.update(make_key(1), &funded);
+  index.update(make_key(2), &funded);
+
+  ASSERT_EQ(3u, index.active().size());
+  ASSERT_EQ(make_key(1), index.active()[0]);
+  ASSERT_EQ(make_key(2), index.active()[1]);
+  ASSERT_EQ(make_key(3), index.active()[2]);
+
+  index.update(make_key(2), nullptr);
+  ASSERT_EQ(2u, index.active().size());
+  ASSERT_EQ(make_key(3), index.active()[1]);
+}
+
+TEST(service_node_index, partially_funded)
+{
+  const service_node_info partial = make_info(10, 50);
+  service_node_index index;
+
+  index.clear(false);
+  index.update(make_key(1), &partial);
+  ASSERT_TRUE(index.active().empty());
+  ASSERT_EQ(1u, index.by_registration_height().size());
+
+  index.clear(true);
+  index.update(make_key(1), &partial);
+  ASSERT_TRUE(index.active().empty());
+
+  // valid once contributions cover the reserved amount
+  service_node_info valid = partial;
+  valid.total_reserved = 50;
+  index.update(make_key(1), &valid);
+  ASSERT_EQ(1u, index.active().size());
+}
+
+TEST(service_node_index, expiry_order)
+{
+  service_node_index index;
+  index.clear(false);
+
+  const service_node_info a = make_info(30, 100);
+  const service_node_info b = make_info(10, 100);
+  const service_node_info c = make_info(20, 100);
+  index.update(make_key(1), &a);
+  index.update(make_key(2), &b);
+  index.update(make_key(3), &c);
+
+  std::vector<uint64_t> heights;
+  for (const auto& entry : index.by_registration_height())
+    heights.push_back(entry.first);
+  ASSERT_EQ((std::vector<uint64_t>{10, 20, 30}), heights);
+
+  // re-registering moves a node in the expiry order
+  service_node_info moved = c;
+  moved.registration_height = 40;
+  index.update(make_key(3), &moved);
+  ASSERT_EQ(make_key(3), index.by_registration_height().rbegin()->second);
+}
+
+TEST(service_node_list_view, find_and_delta_window)
+{
+  service_nodes::service_node_list_view view;
+  view.height = 100;
+  view.delta_floor = 40;
+  for (uint8_t n : {1, 3, 5})
+    view.entries.push_back({make_key(n), std::make_shared<const service_node_info>(make_info(n, 100)), 90});
+
+  ASSERT_NE(nullptr, view.find(make_key(3)));
+  ASSERT_EQ(3u, view.find(make_key(3))->info->registration_height);
+  ASSERT_EQ(nullptr, view.find(make_key(4)));
+  ASSERT_EQ(nullptr, view.find(make_key(6)));
+
+  ASSERT_FALSE(view.can_delta_since(39));
+  ASSERT_TRUE(view.can_delta_since(40));
+  ASSERT_TRUE(view.can_delta_since(100));
+  ASSERT_FALSE(view.can_delta_since(101));
+}
+
+TEST(quorum_history, compact_chunks)
+{
+  using service_nodes::quorum_history;
+  quorum_history history;
+
+  service_nodes::quorum_state a;
+  a.quorum_nodes = {make_key(1), make_key(2)};
+  a.nodes_to_test = {make_key(3)};
+  service_nodes::quorum_state b;
+  b.quorum_nodes = {make_key(3), make_key(1)};
+  b.nodes_to_test = {make_key(4)};
+
+  const uint64_t base = 10 * quorum_history::CHUNK_HEIGHTS;
+  history.set(base, a);
+  history.set(base + 1, b);
+  history.set(base + quorum_history::CHUNK_HEIGHTS, a);
+
+  // nodes shared between quorums of a chunk are stored once
+  ASSERT_EQ(2u, history.chunks().size());
+  ASSERT_EQ(4u, history.chunks().at(base)->nodes.size());
+  ASSERT_TRUE(history.chunks().at(base)->is_valid());
+
+  std::shared_ptr<const service_nodes::quorum_state> got = history.get(base + 1);
+  ASSERT_NE(nullptr, got);
+  ASSERT_EQ(b.quorum_nodes, got->quorum_nodes);
+  ASSERT_EQ(b.nodes_to_test, got->nodes_to_test);
+  ASSERT_EQ(nullptr, history.get(base + 2));
+
+  // a shared chunk is copied on write rather than changed under its reader
+  const quorum_history::chunk_map shared = history.share();
+  history.erase_from(base + 1);
+  ASSERT_EQ(nullptr, history.get(base + 1));
+  ASSERT_NE(nullptr, quorum_history::get(shared, base + 1));
+  ASSERT_EQ(4u, history.chunks().at(base)->nodes.size());
+
+  // eviction drops whole chunks only
+  history.evict_below(base + quorum_history::CHUNK_HEIGHTS - 1);
+  ASSERT_NE(nullptr, history.get(base));
+  history.evict_below(base + quorum_history::CHUNK_HEIGHTS);
+  ASSERT_EQ(nullptr, history.get(base));
+  ASSERT_NE(nullptr, history.get(base + quorum_history::CHUNK_HEIGHTS));
+
+  quorum_history::chunk bad = *history.chunks().begin()->second;
+  bad.quorums[0].nodes.push_back(bad.nodes.size());
+  ASSERT_FALSE(bad.is_valid());
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "gtest/gtest.h"
+
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_core/service_node_signatures.h"
+
+using service_nodes::signature_batch;
+
+namespace
+{
+  struct signed_item
+  {
+    crypto::hash hash;
+    crypto::public_key pubkey;
+    crypto::signature sig;
+  };
+
+  signed_item make_signed_item()
+  {
+    cryptonote::keypair keys = cryptonote::keypair::generate(hw::get_device("default"));
+    signed_item item;
+    item.hash = crypto::rand<crypto::hash>();
+    item.pubkey = keys.pub;
+    crypto::generate_signature(item.hash, keys.pub, keys.sec, item.sig);
+    return item;
+  }
+}
+
+TEST(service_node_signatures, batch_reports_each_signature)
+{
+  // enough to go through the thread pool
+  std::vector<signed_item> items;
+  for (int i = 0; i < 20; ++i)
+    items.push_back(make_signed_item());
+  items[7].hash = crypto::rand<crypto::hash>();
+
+  signature_batch batch(false);
+  for (const auto &item : items)
+    batch.add(item.hash, item.pubkey, item.sig);
+  // a duplicate of a bad one and of a good one
+  batch.add(items[7].hash, items[7].pubkey, items[7].sig);
+  batch.add(items[3].hash, items[3].pubkey, items[3].sig);
+
+  std::vector<bool> valid;
+  ASSERT_FALSE(batch.check(&valid));
+  ASSERT_EQ(22u, valid.size());
+  for (size_t i = 0; i < valid.size(); ++i)
+    ASSERT_EQ(i != 7 && i != 20, valid[i]);
+}
+
+TEST(service_node_signatures, remembered_signatures_stay_valid)
+{
+  const signed_item good = make_signed_item();
+  signed_item bad = make_signed_item();
+  bad.pubkey = good.pubkey;
+
+  signature_batch first;
+  first.add(good.hash, good.pubkey, good.sig);
+  first.add(bad.hash, bad.pubkey, bad.sig);
+  std::vector<bool> valid;
+  ASSERT_FALSE(first.check(&valid));
+
+  signature_batch second;
+  second.add(bad.hash, bad.pubkey, bad.sig);
+  second.add(good.hash, good.pubkey, good.sig);
+  ASSERT_FALSE(second.check(&valid));
+  ASSERT_FALSE(valid[0]);
+  ASSERT_TRUE(valid[1]);
+
+  service_nodes::signature_queue queue;
+  ASSERT_TRUE(queue.check(good.hash, good.pubkey, good.sig));
+  ASSERT_FALSE(queue.check(bad.hash, bad.pubkey, bad.sig));
+}
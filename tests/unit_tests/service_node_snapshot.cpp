@@ -0,0 +1,150 @@
+// Copyright (c) 2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_core/blockchain.h"
+#include "cryptonote_core/tx_pool.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "cryptonote_core/service_node_list.h"
+#include "cryptonote_core/service_node_deregister.h"
+#include "blockchain_db/testdb.h"
+
+namespace
+{
+  // Empty blocks, service node rules from height 1, and an in memory snapshot table
+  class TestDB: public cryptonote::BaseTestDB
+  {
+  public:
+    TestDB(uint64_t count)
+    {
+      m_open = true;
+      for (uint64_t height = 0; height < count; height++)
+      {
+        cryptonote::block b;
+        b.major_version = b.minor_version = height ? 5 : 1;
+        b.prev_id = height ? cryptonote::get_block_hash(blocks.back()) : crypto::null_hash;
+        b.miner_tx.vin.push_back(cryptonote::txin_gen{height});
+        blocks.push_back(b);
+      }
+    }
+
+    virtual uint64_t height() const override { return blocks.size(); }
+    virtual cryptonote::block get_block_from_height(const uint64_t& height) const override { return blocks[height]; }
+    virtual crypto::hash get_block_hash_from_height(const uint64_t& height) const override { return cryptonote::get_block_hash(blocks[height]); }
+    virtual crypto::hash top_block_hash(uint64_t *block_height = NULL) const override {
+      if (block_height)
+        *block_height = blocks.size() - 1;
+      return cryptonote::get_block_hash(blocks.back());
+    }
+    virtual cryptonote::block get_top_block() const override { return blocks.back(); }
+    virtual uint8_t get_hard_fork_version(uint64_t height) const override { return height ? 5 : 1; }
+    virtual std::vector<uint64_t> get_block_weights(uint64_t start_height, size_t count) const override {
+      return std::vector<uint64_t>(std::min<uint64_t>(count, blocks.size() - std::min<uint64_t>(start_height, blocks.size())), 128);
+    }
+    virtual std::vector<uint64_t> get_long_term_block_weights(uint64_t start_height, size_t count) const override { return get_block_weights(start_height, count); }
+    virtual void pop_block(cryptonote::block &blk, std::vector<cryptonote::transaction> &txs) override { blk = blocks.back(); blocks.pop_back(); }
+
+    virtual void set_service_node_snapshot(uint64_t height, const std::string& data) override { snapshots[height] = data; }
+    virtual bool get_service_node_snapshot(uint64_t max_height, uint64_t& height, std::string& data) const override {
+      auto it = snapshots.upper_bound(max_height);
+      if (it == snapshots.begin())
+        return false;
+      --it;
+      height = it->first;
+      data = it->second;
+      return true;
+    }
+    virtual std::vector<uint64_t> get_service_node_snapshot_heights() const override {
+      std::vector<uint64_t> heights;
+      for (const auto& snapshot : snapshots)
+        heights.push_back(snapshot.first);
+      return heights;
+    }
+    virtual void remove_service_node_snapshot(uint64_t height) override { snapshots.erase(height); }
+
+    std::vector<cryptonote::block> blocks;
+    std::map<uint64_t, std::string> snapshots;
+  };
+
+  struct blockchain_objects
+  {
+    cryptonote::Blockchain m_blockchain;
+    cryptonote::tx_memory_pool m_mempool;
+    service_nodes::service_node_list m_service_node_list;
+    triton::deregister_vote_pool m_deregister_vote_pool;
+    blockchain_objects() :
+      m_blockchain(m_mempool, m_service_node_list, m_deregister_vote_pool),
+      m_mempool(m_blockchain),
+      m_service_node_list(m_blockchain) { }
+  };
+}
+
+TEST(service_node_snapshot, detach_below_restored_snapshot)
+{
+  const uint64_t snapshot_height = 90;
+  TestDB *db = new TestDB(100);
+
+  // a node the chain itself never registered, so only the snapshot knows it
+  crypto::public_key key;
+  memset(&key, 0, sizeof(key));
+  key.data[0] = 1;
+
+  service_nodes::service_node_list::snapshot_for_serialization snapshot;
+  snapshot.height = snapshot_height;
+  snapshot.top_block_hash = db->get_block_hash_from_height(snapshot_height - 1);
+  snapshot.infos.emplace_back();
+  snapshot.infos.back().key = key;
+  snapshot.infos.back().info.registration_height = snapshot_height - 5;
+  snapshot.infos.back().info.staking_requirement = 100;
+  snapshot.infos.back().info.total_reserved = 100;
+  snapshot.infos.back().info.total_contributed = 100;
+  ASSERT_TRUE(cryptonote::t_serializable_object_to_blob(snapshot, db->snapshots[snapshot_height]));
+
+  const std::pair<uint8_t, uint64_t> hard_forks[] = { std::make_pair(1, (uint64_t)0), std::make_pair(5, (uint64_t)1), std::make_pair(0, (uint64_t)0) };
+  const cryptonote::test_options test_options = { hard_forks, 0 };
+  blockchain_objects objects;
+  ASSERT_TRUE(objects.m_blockchain.init(db, cryptonote::FAKECHAIN, true, &test_options, 1, NULL));
+
+  // no stored records: the list restores the snapshot and replays to the tip
+  objects.m_service_node_list.set_db_pointer(db);
+  objects.m_service_node_list.init();
+  ASSERT_TRUE(objects.m_service_node_list.is_service_node(key));
+
+  // detach inside the rollback window but below the snapshot; nothing below
+  // the snapshot can be undone, so the list must be rebuilt from the chain
+  const uint64_t detach_height = snapshot_height - 10;
+  cryptonote::block blk;
+  std::vector<cryptonote::transaction> txs;
+  while (db->height() > detach_height)
+    db->pop_block(blk, txs);
+  objects.m_service_node_list.blockchain_detached(detach_height);
+
+  ASSERT_TRUE(db->snapshots.empty());
+  ASSERT_FALSE(objects.m_service_node_list.is_service_node(key));
+}
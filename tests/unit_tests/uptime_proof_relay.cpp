@@ -0,0 +1,140 @@
+// Copyright (c)      2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <boost/uuid/random_generator.hpp>
+
+#include "storages/portable_storage_template_helper.h"
+#include "cryptonote_protocol/uptime_proof_relay.h"
+
+namespace
+{
+  cryptonote::uptime_proof_entry make_proof(uint64_t timestamp)
+  {
+    cryptonote::uptime_proof_entry entry{};
+    entry.snode_version_major = 3;
+    entry.timestamp = timestamp;
+    entry.pubkey.data[0] = (char)timestamp;
+    return entry;
+  }
+
+  cryptonote::uptime_proof_relay::peer make_peer(bool supports_batch)
+  {
+    return {epee::net_utils::zone::public_, boost::uuids::random_generator()(), supports_batch};
+  }
+
+  void queue(cryptonote::uptime_proof_relay &relay, const cryptonote::uptime_proof_entry &entry)
+  {
+    relay.queue(cryptonote::get_uptime_proof_id(entry), entry);
+  }
+}
+
+TEST(uptime_proof_relay, batches_proofs_per_peer)
+{
+  cryptonote::uptime_proof_relay relay;
+  for (uint64_t t = 1; t <= 3; ++t)
+    queue(relay, make_proof(t));
+  ASSERT_EQ(3, relay.pending());
+
+  const std::vector<cryptonote::uptime_proof_relay::peer> peers{make_peer(true), make_peer(true)};
+  const std::vector<cryptonote::uptime_proof_relay::message> messages = relay.flush(peers, 100);
+  ASSERT_EQ(1, messages.size());
+  ASSERT_EQ((int)cryptonote::NOTIFY_UPTIME_PROOF_BATCH::ID, messages[0].command);
+  ASSERT_EQ(2, messages[0].connections.size());
+  ASSERT_EQ(0, relay.pending());
+
+  cryptonote::NOTIFY_UPTIME_PROOF_BATCH::request req;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(req, messages[0].blob));
+  ASSERT_EQ(3, req.proofs.size());
+  ASSERT_EQ(2, req.proofs[1].timestamp);
+
+  const cryptonote::uptime_proof_relay_stats stats = relay.get_stats();
+  ASSERT_EQ(2, stats.batches_sent);
+  ASSERT_EQ(6, stats.proofs_relayed);
+  ASSERT_EQ(4, stats.messages_saved);
+  ASSERT_GT(stats.bytes_saved, 0);
+}
+
+TEST(uptime_proof_relay, legacy_peers_get_single_proofs)
+{
+  cryptonote::uptime_proof_relay relay;
+  queue(relay, make_proof(1));
+  queue(relay, make_proof(2));
+
+  const std::vector<cryptonote::uptime_proof_relay::peer> peers{make_peer(false)};
+  const std::vector<cryptonote::uptime_proof_relay::message> messages = relay.flush(peers, 100);
+  ASSERT_EQ(2, messages.size());
+  for (const auto &msg: messages)
+  {
+    ASSERT_EQ((int)cryptonote::NOTIFY_UPTIME_PROOF::ID, msg.command);
+    ASSERT_EQ(1, msg.connections.size());
+    cryptonote::NOTIFY_UPTIME_PROOF::request proof;
+    ASSERT_TRUE(epee::serialization::load_t_from_binary(proof, msg.blob));
+    ASSERT_EQ(3, proof.snode_version_major);
+  }
+  ASSERT_EQ(0, relay.get_stats().batches_sent);
+}
+
+TEST(uptime_proof_relay, skips_peers_that_know_the_proof)
+{
+  cryptonote::uptime_proof_relay relay;
+  const cryptonote::uptime_proof_relay::peer sender = make_peer(true), other = make_peer(true);
+  const cryptonote::uptime_proof_entry proof = make_proof(1);
+  const crypto::hash id = cryptonote::get_uptime_proof_id(proof);
+
+  ASSERT_TRUE(relay.mark_known(sender.connection_id, id, 100));
+  ASSERT_FALSE(relay.mark_known(sender.connection_id, id, 100));
+  ASSERT_TRUE(relay.queue(id, proof));
+  ASSERT_FALSE(relay.queue(id, proof));
+
+  std::vector<cryptonote::uptime_proof_relay::message> messages = relay.flush({sender, other}, 100);
+  ASSERT_EQ(1, messages.size());
+  ASSERT_EQ(1, messages[0].connections.size());
+  ASSERT_EQ(other.connection_id, messages[0].connections[0].second);
+  ASSERT_EQ(1, relay.get_stats().proofs_suppressed);
+
+  // both peers have it now
+  queue(relay, proof);
+  ASSERT_TRUE(relay.flush({sender, other}, 100).empty());
+  ASSERT_EQ(3, relay.get_stats().proofs_suppressed);
+
+  // until the filters expire or the peer reconnects
+  relay.prune(100 + P2P_UPTIME_PROOF_KNOWN_LIFETIME + 1);
+  queue(relay, proof);
+  messages = relay.flush({sender, other}, 100 + P2P_UPTIME_PROOF_KNOWN_LIFETIME + 1);
+  ASSERT_EQ(1, messages.size());
+  ASSERT_EQ(2, messages[0].connections.size());
+
+  relay.forget_peer(other.connection_id);
+  queue(relay, proof);
+  messages = relay.flush({sender, other}, 100 + P2P_UPTIME_PROOF_KNOWN_LIFETIME + 1);
+  ASSERT_EQ(1, messages.size());
+  ASSERT_EQ(1, messages[0].connections.size());
+  ASSERT_EQ(other.connection_id, messages[0].connections[0].second);
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2018, The Loki Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "gtest/gtest.h"
+
+#include "cryptonote_core/quorum_cop.h"
+
+using service_nodes::uptime_proof_store;
+
+namespace
+{
+  crypto::public_key make_key(uint8_t n)
+  {
+    crypto::public_key key;
+    memset(&key, 0, sizeof(key));
+    key.data[0] = n;
+    key.data[31] = n;
+    return key;
+  }
+}
+
+TEST(uptime_proof_store, rejects_recent_duplicates)
+{
+  uptime_proof_store store;
+  ASSERT_EQ(0u, store.get(make_key(1)));
+  ASSERT_TRUE(store.add(make_key(1), 1000, 500));
+  ASSERT_EQ(1000u, store.get(make_key(1)));
+  ASSERT_FALSE(store.add(make_key(1), 1100, 1000));
+  ASSERT_EQ(1000u, store.get(make_key(1)));
+  ASSERT_TRUE(store.add(make_key(1), 3000, 2000));
+  ASSERT_EQ(3000u, store.get(make_key(1)));
+  ASSERT_EQ(1u, store.size());
+}
+
+TEST(uptime_proof_store, expires_by_bucket)
+{
+  const uint64_t bucket = uptime_proof_store::BUCKET_SECONDS;
+  uptime_proof_store store;
+  for (uint8_t n = 0; n < 50; ++n)
+    ASSERT_TRUE(store.add(make_key(n), 10 * bucket + n, 0));
+  // a node with an old proof that has since sent a new one
+  ASSERT_TRUE(store.add(make_key(100), 10 * bucket, 0));
+  ASSERT_TRUE(store.add(make_key(100), 20 * bucket, 10 * bucket + 1));
+
+  ASSERT_EQ(0u, store.expire(10 * bucket));
+  ASSERT_EQ(51u, store.size());
+
+  ASSERT_EQ(50u, store.expire(11 * bucket));
+  ASSERT_EQ(1u, store.size());
+  ASSERT_EQ(20 * bucket, store.get(make_key(100)));
+
+  ASSERT_EQ(1u, store.expire(30 * bucket));
+  ASSERT_EQ(0u, store.size());
+}
@@ -29,6 +29,7 @@
 #include <gtest/gtest.h>
 
 #include "rpc/message.h"
+#include "rpc/rpc_handler.h"
 #include "serialization/json_object.h"
 
 TEST(ZmqFullMessage, InvalidRequest)
@@ -53,3 +54,22 @@ TEST(ZmqFullMessage, Request)
   cryptonote::rpc::FullMessage parsed{request, true};
   EXPECT_STREQ("foo", parsed.getRequestType().c_str());
 }
+
+TEST(ZmqBlockTemplate, TemplateId)
+{
+  crypto::hash prev_id;
+  for (size_t n = 0; n < sizeof(prev_id); ++n)
+    prev_id.data[n] = n;
+
+  const std::string id = cryptonote::rpc::RpcHandler::get_block_template_id(prev_id, 1234567890123ull);
+  crypto::hash parsed_prev_id;
+  uint64_t parsed_reward;
+  ASSERT_TRUE(cryptonote::rpc::RpcHandler::parse_block_template_id(id, parsed_prev_id, parsed_reward));
+  EXPECT_EQ(prev_id, parsed_prev_id);
+  EXPECT_EQ(1234567890123ull, parsed_reward);
+
+  EXPECT_NE(id, cryptonote::rpc::RpcHandler::get_block_template_id(prev_id, 1234567890124ull));
+  EXPECT_FALSE(cryptonote::rpc::RpcHandler::parse_block_template_id("", parsed_prev_id, parsed_reward));
+  EXPECT_FALSE(cryptonote::rpc::RpcHandler::parse_block_template_id(id.substr(2), parsed_prev_id, parsed_reward));
+  EXPECT_FALSE(cryptonote::rpc::RpcHandler::parse_block_template_id(std::string(id.size(), 'z'), parsed_prev_id, parsed_reward));
+}